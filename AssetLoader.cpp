@@ -0,0 +1,307 @@
+#include "AssetLoader.h"
+
+#include <objbase.h>
+#include <wincodec.h>
+#include <cstdio>
+
+#pragma comment(lib, "windowscodecs.lib")
+
+namespace
+{
+	// --------------------------------------------------------
+	// An image decoded on a worker, ready to copy into a texture
+	// --------------------------------------------------------
+	struct DecodedImage
+	{
+		std::vector<unsigned char> Pixels;
+		unsigned int Width;
+		unsigned int Height;
+		unsigned int RowPitch;
+		DXGI_FORMAT Format;
+
+		DecodedImage() :
+			Width(0),
+			Height(0),
+			RowPitch(0),
+			Format(DXGI_FORMAT_UNKNOWN)
+		{
+		}
+	};
+
+	// --------------------------------------------------------
+	// WIC needs COM on whichever thread decodes, and jobs can
+	// run on any of them, so each starts it the first time.
+	// It's left running, since the threads live as long as
+	// the job system does.
+	// --------------------------------------------------------
+	void StartCom()
+	{
+		thread_local bool started = false;
+		if (!started)
+		{
+			CoInitializeEx(0, COINIT_MULTITHREADED);
+			started = true;
+		}
+	}
+
+	// --------------------------------------------------------
+	// Decodes an image file with WIC, to 8 bit RGBA, or 8 bit R
+	// if it's greyscale (the same formats CreateWICTextureFromFile()
+	// would pick for the project's PNGs)
+	// --------------------------------------------------------
+	bool DecodeImage(const std::wstring& filename, DecodedImage& image)
+	{
+		StartCom();
+
+		Microsoft::WRL::ComPtr<IWICImagingFactory> factory;
+		Microsoft::WRL::ComPtr<IWICBitmapDecoder> decoder;
+		Microsoft::WRL::ComPtr<IWICBitmapFrameDecode> frame;
+		if (FAILED(CoCreateInstance(CLSID_WICImagingFactory, 0, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(factory.GetAddressOf()))) ||
+			FAILED(factory->CreateDecoderFromFilename(filename.c_str(), 0, GENERIC_READ, WICDecodeMetadataCacheOnDemand, decoder.GetAddressOf())) ||
+			FAILED(decoder->GetFrame(0, frame.GetAddressOf())))
+			return false;
+
+		WICPixelFormatGUID sourceFormat;
+		if (FAILED(frame->GetPixelFormat(&sourceFormat)) ||
+			FAILED(frame->GetSize(&image.Width, &image.Height)))
+			return false;
+
+		bool grey = IsEqualGUID(sourceFormat, GUID_WICPixelFormat8bppGray) != 0;
+		WICPixelFormatGUID targetFormat = grey ? GUID_WICPixelFormat8bppGray : GUID_WICPixelFormat32bppRGBA;
+		image.Format = grey ? DXGI_FORMAT_R8_UNORM : DXGI_FORMAT_R8G8B8A8_UNORM;
+		image.RowPitch = image.Width * (grey ? 1 : 4);
+		image.Pixels.resize((size_t)image.RowPitch * image.Height);
+
+		Microsoft::WRL::ComPtr<IWICFormatConverter> converter;
+		if (FAILED(factory->CreateFormatConverter(converter.GetAddressOf())) ||
+			FAILED(converter->Initialize(frame.Get(), targetFormat, WICBitmapDitherTypeNone, 0, 0.0, WICBitmapPaletteTypeCustom)) ||
+			FAILED(converter->CopyPixels(0, image.RowPitch, (UINT)image.Pixels.size(), image.Pixels.data())))
+		{
+			image.Pixels.clear();
+			return false;
+		}
+		return true;
+	}
+
+	// --------------------------------------------------------
+	// Makes a texture from a decoded image, generating its mips
+	// on the GPU.  Returns null if the image didn't decode.
+	// --------------------------------------------------------
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> CreateTexture(
+		ID3D11Device* device,
+		ID3D11DeviceContext* context,
+		const DecodedImage& image)
+	{
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+		if (image.Pixels.empty())
+			return srv;
+
+		D3D11_TEXTURE2D_DESC desc = {};
+		desc.Width = image.Width;
+		desc.Height = image.Height;
+		desc.MipLevels = 0;	// The whole chain
+		desc.ArraySize = 1;
+		desc.Format = image.Format;
+		desc.SampleDesc.Count = 1;
+		desc.Usage = D3D11_USAGE_DEFAULT;
+		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;	// Render target for GenerateMips()
+		desc.MiscFlags = D3D11_RESOURCE_MISC_GENERATE_MIPS;
+
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+		if (FAILED(device->CreateTexture2D(&desc, 0, texture.GetAddressOf())) ||
+			FAILED(device->CreateShaderResourceView(texture.Get(), 0, srv.GetAddressOf())))
+			return Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>();
+
+		context->UpdateSubresource(texture.Get(), 0, 0, image.Pixels.data(), image.RowPitch, 0);
+		context->GenerateMips(srv.Get());
+		return srv;
+	}
+
+	// --------------------------------------------------------
+	// Makes a cube map from six decoded faces (+X, -X, +Y, -Y,
+	// +Z, -Z).  Returns null unless all six decoded and match.
+	// --------------------------------------------------------
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> CreateCubemap(
+		ID3D11Device* device,
+		const std::vector<DecodedImage>& faces)
+	{
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+		D3D11_SUBRESOURCE_DATA faceData[6] = {};
+		for (int i = 0; i < 6; i++)
+		{
+			if (faces[i].Pixels.empty() ||
+				faces[i].Width != faces[0].Width ||
+				faces[i].Height != faces[0].Height ||
+				faces[i].Format != faces[0].Format)
+				return srv;
+
+			faceData[i].pSysMem = faces[i].Pixels.data();
+			faceData[i].SysMemPitch = faces[i].RowPitch;
+		}
+
+		D3D11_TEXTURE2D_DESC desc = {};
+		desc.Width = faces[0].Width;
+		desc.Height = faces[0].Height;
+		desc.MipLevels = 1;
+		desc.ArraySize = 6;
+		desc.Format = faces[0].Format;
+		desc.SampleDesc.Count = 1;
+		desc.Usage = D3D11_USAGE_IMMUTABLE;
+		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		desc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE;
+
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+		if (FAILED(device->CreateTexture2D(&desc, faceData, texture.GetAddressOf())))
+			return srv;
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = desc.Format;
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+		srvDesc.TextureCube.MipLevels = 1;
+		device->CreateShaderResourceView(texture.Get(), &srvDesc, srv.GetAddressOf());
+		return srv;
+	}
+}
+
+AssetLoader::AssetLoader(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
+	:
+	device(device),
+	context(context),
+	jobs(JobSystem::GetDefault())
+{
+}
+
+AssetLoader::~AssetLoader()
+{
+	// Anything not finished yet is just dropped, once its
+	// jobs are done with it (and its counter).  So is anything
+	// they threw, since destructors mustn't.
+	for (PendingAsset& asset : pending)
+		jobs.WaitQuietly(*asset.Jobs);
+}
+
+MeshHandle AssetLoader::LoadMesh(const std::wstring& filename, const MeshLoadOptions& options)
+{
+	MeshHandle handle;
+	std::shared_ptr<MeshHandle::State> state = std::make_shared<MeshHandle::State>();
+	handle.state = state;
+
+	std::shared_ptr<LoadedMesh> data = std::make_shared<LoadedMesh>();
+	PendingAsset asset;
+	asset.Jobs.reset(new JobCounter());
+	jobs.Run([filename, options, data]()
+	{
+#if defined(DEBUG) || defined(_DEBUG)
+		if (!LoadMeshFile(filename.c_str(), options, *data))
+			printf("Could not load %ls\n", filename.c_str());
+#else
+		LoadMeshFile(filename.c_str(), options, *data);
+#endif
+	}, asset.Jobs.get());
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device = this->device;
+	asset.Create = [filename, data, device, state]()
+	{
+		state->Value = std::make_shared<Mesh>(filename.c_str(), *data, device);
+		state->Ready = true;
+	};
+
+	pending.push_back(std::move(asset));
+	return handle;
+}
+
+TextureHandle AssetLoader::LoadTexture(const std::wstring& filename)
+{
+	TextureHandle handle;
+	std::shared_ptr<TextureHandle::State> state = std::make_shared<TextureHandle::State>();
+	handle.state = state;
+
+	std::shared_ptr<DecodedImage> image = std::make_shared<DecodedImage>();
+	PendingAsset asset;
+	asset.Jobs.reset(new JobCounter());
+	jobs.Run([filename, image]() { DecodeImage(filename, *image); }, asset.Jobs.get());
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device = this->device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context = this->context;
+	asset.Create = [image, device, context, state]()
+	{
+		state->Value = CreateTexture(device.Get(), context.Get(), *image);
+		state->Ready = true;
+	};
+
+	pending.push_back(std::move(asset));
+	return handle;
+}
+
+TextureHandle AssetLoader::LoadCubemap(
+	const std::wstring& right,
+	const std::wstring& left,
+	const std::wstring& up,
+	const std::wstring& down,
+	const std::wstring& front,
+	const std::wstring& back)
+{
+	TextureHandle handle;
+	std::shared_ptr<TextureHandle::State> state = std::make_shared<TextureHandle::State>();
+	handle.state = state;
+
+	// Order matters here!  +X, -X, +Y, -Y, +Z, -Z
+	const std::wstring* filenames[6] = { &right, &left, &up, &down, &front, &back };
+	std::shared_ptr<std::vector<DecodedImage>> faces = std::make_shared<std::vector<DecodedImage>>(6);
+
+	PendingAsset asset;
+	asset.Jobs.reset(new JobCounter());
+	for (int i = 0; i < 6; i++)
+	{
+		std::wstring filename = *filenames[i];
+		jobs.Run([filename, faces, i]() { DecodeImage(filename, (*faces)[i]); }, asset.Jobs.get());
+	}
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device = this->device;
+	asset.Create = [faces, device, state]()
+	{
+		state->Value = CreateCubemap(device.Get(), *faces);
+		state->Ready = true;
+	};
+
+	pending.push_back(std::move(asset));
+	return handle;
+}
+
+size_t AssetLoader::FinishReady()
+{
+	// Stop at the first one still loading, to keep them in order
+	size_t finished = 0;
+	for (; finished < pending.size(); finished++)
+	{
+		PendingAsset& asset = pending[finished];
+		if (!asset.Jobs->IsDone())
+		{
+			pending.erase(pending.begin(), pending.begin() + finished);
+			return pending.size();
+		}
+
+		asset.Create();
+	}
+
+	pending.clear();
+	return 0;
+}
+
+void AssetLoader::Finish()
+{
+	for (PendingAsset& asset : pending)
+	{
+		jobs.Wait(*asset.Jobs);
+		asset.Create();
+	}
+
+	pending.clear();
+}
+
+unsigned int AssetLoader::GetThreadCount()
+{
+	return jobs.GetThreadCount();
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "Mesh.h"
+#include "MeshLoader.h"
+#include "JobSystem.h"
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// A mesh or texture asked for from an AssetLoader, which
+// stays empty until the loader has finished it
+// --------------------------------------------------------
+template<typename T>
+class AssetHandle
+{
+public:
+	bool IsReady() const { return state && state->Ready; }
+	T Get() const { return state ? state->Value : T(); }
+
+private:
+	friend class AssetLoader;
+
+	struct State
+	{
+		T Value;
+		bool Ready;
+		State() : Value(), Ready(false) {}
+	};
+	std::shared_ptr<State> state;
+};
+
+typedef AssetHandle<std::shared_ptr<Mesh>> MeshHandle;
+typedef AssetHandle<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> TextureHandle;
+
+// --------------------------------------------------------
+// Loads meshes & textures as jobs on the default JobSystem
+//
+// - The jobs do everything that doesn't need the device:
+//   reading, parsing & processing meshes (LoadMeshFile()) and
+//   decoding images with WIC
+// - The thread that owns the device & context (the one that
+//   made this loader) then creates the buffers & textures in
+//   Finish() or FinishReady(), in the order they were asked for
+// - A file that fails to load gives an empty mesh or a null
+//   texture, just like loading it directly would
+// --------------------------------------------------------
+class AssetLoader
+{
+public:
+	AssetLoader(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+	~AssetLoader();
+
+	MeshHandle LoadMesh(const std::wstring& filename, const MeshLoadOptions& options = MeshLoadOptions());
+
+	// 8 bit RGBA (or R, for greyscale images) with a full
+	// mip chain generated on the GPU, like CreateWICTextureFromFile()
+	TextureHandle LoadTexture(const std::wstring& filename);
+
+	// A cube map from six images of the same size, without mips
+	// (like Sky::CreateCubemap()), each decoded by its own job
+	TextureHandle LoadCubemap(
+		const std::wstring& right,
+		const std::wstring& left,
+		const std::wstring& up,
+		const std::wstring& down,
+		const std::wstring& front,
+		const std::wstring& back);
+
+	// Creates whatever the jobs have finished with, in
+	// order, without waiting.  Returns how many are left.
+	size_t FinishReady();
+
+	// Waits for everything asked for so far, and creates it all
+	void Finish();
+
+	unsigned int GetThreadCount();	// Of the job system
+
+private:
+	// Something still loading: its jobs, then what the owning
+	// thread does with their results
+	struct PendingAsset
+	{
+		std::unique_ptr<JobCounter> Jobs;
+		std::function<void()> Create;
+	};
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	std::vector<PendingAsset> pending;
+	JobSystem& jobs;
+};
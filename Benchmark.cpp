@@ -0,0 +1,2880 @@
+#include "Benchmark.h"
+#include "ObjParser.h"
+#include "MappedFile.h"
+#include "MeshLoader.h"
+#include "MeshCache.h"
+#include "VertexCacheOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+#include "TangentGenerator.h"
+#include "TangentGeneratorSIMD.h"
+#include "VertexPacking.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include "MeshBounds.h"
+#include "InstanceBatcher.h"
+#include "MeshBVH.h"
+#include "Transform.h"
+#include "MatrixMath.h"
+#include "FrustumCulling.h"
+#include "OcclusionCulling.h"
+#include "FixedTimestep.h"
+#include "FramePipeline.h"
+#include "FrameTelemetry.h"
+#include "RenderSnapshot.h"
+#include "Helpers.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#if !defined(_MSC_VER)
+#define sscanf_s sscanf
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+	// The sample models that ship with the project
+	const wchar_t* sampleModels[] =
+	{
+		L"cube.obj",
+		L"cylinder.obj",
+		L"helix.obj",
+		L"quad.obj",
+		L"quad_double_sided.obj",
+		L"sphere.obj",
+		L"torus.obj",
+	};
+
+	double SecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	// A whole file's bytes, or nothing if it can't be read
+	std::string ReadWholeFile(const std::wstring& filename)
+	{
+		std::string contents;
+		if (FILE* file = OpenForReading(filename))
+		{
+			char buffer[4096];
+			size_t read;
+			while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+				contents.append(buffer, read);
+			fclose(file);
+		}
+		return contents;
+	}
+
+	// The fastest of several runs of some work, in seconds, so
+	// one-off stalls don't skew comparisons
+	template<typename Work>
+	double BestOf(int repeats, Work work)
+	{
+		double best = 1e30;
+		for (int r = 0; r < repeats; r++)
+		{
+			Clock::time_point start = Clock::now();
+			work();
+			best = (std::min)(best, SecondsSince(start));
+		}
+		return best;
+	}
+
+	typedef std::vector<std::pair<std::wstring, MeshData>> NamedMeshes;
+
+	// Adds each sample model that loads, as parsed (one level of
+	// detail, no cache, no BVH), named by its file
+	void LoadSampleMeshes(const std::wstring& modelPath, NamedMeshes& meshes)
+	{
+		MeshLoadOptions options;
+		options.LodCount = 1;
+		options.UseCache = false;
+		options.BuildBVH = false;
+		for (const wchar_t* model : sampleModels)
+		{
+			LoadedMesh loaded;
+			if (LoadMeshFile((modelPath + model).c_str(), options, loaded))
+			{
+				meshes.push_back(std::make_pair(std::wstring(model), MeshData()));
+				meshes.back().second.Vertices.swap(loaded.Data.Vertices);
+				meshes.back().second.Indices.swap(loaded.Data.Indices);
+			}
+		}
+	}
+
+	// --------------------------------------------------------
+	// The original line-by-line OBJ loader, kept here only as a
+	// baseline to measure the memory-mapped parser against
+	// --------------------------------------------------------
+	bool LegacyLoadObj(const std::wstring& filename, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+	{
+		FILE* file = OpenForReading(filename);
+		if (!file)
+			return false;
+
+		std::vector<XMFLOAT3> positions;
+		std::vector<XMFLOAT3> normals;
+		std::vector<XMFLOAT2> uvs;
+		unsigned int indexCounter = 0;
+		char chars[100];
+
+		while (fgets(chars, 100, file))
+		{
+			if (chars[0] == 'v' && chars[1] == 'n')
+			{
+				XMFLOAT3 norm;
+				sscanf_s(chars, "vn %f %f %f", &norm.x, &norm.y, &norm.z);
+				normals.push_back(norm);
+			}
+			else if (chars[0] == 'v' && chars[1] == 't')
+			{
+				XMFLOAT2 uv;
+				sscanf_s(chars, "vt %f %f", &uv.x, &uv.y);
+				uvs.push_back(uv);
+			}
+			else if (chars[0] == 'v')
+			{
+				XMFLOAT3 pos;
+				sscanf_s(chars, "v %f %f %f", &pos.x, &pos.y, &pos.z);
+				positions.push_back(pos);
+			}
+			else if (chars[0] == 'f')
+			{
+				unsigned int i[12];
+				int numbersRead = sscanf_s(chars,
+					"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
+					&i[0], &i[1], &i[2], &i[3], &i[4], &i[5],
+					&i[6], &i[7], &i[8], &i[9], &i[10], &i[11]);
+
+				if (numbersRead == 1)
+				{
+					numbersRead = sscanf_s(chars,
+						"f %d//%d %d//%d %d//%d %d//%d",
+						&i[0], &i[2], &i[3], &i[5], &i[6], &i[8], &i[9], &i[11]);
+					i[1] = i[4] = i[7] = i[10] = 1;
+					if (uvs.size() == 0)
+						uvs.push_back(XMFLOAT2(0, 0));
+				}
+
+				Vertex v[4];
+				int cornerCount = (numbersRead == 12 || numbersRead == 8) ? 4 : 3;
+				for (int c = 0; c < cornerCount; c++)
+				{
+					v[c].Position = positions[i[c * 3] - 1];
+					v[c].UV = uvs[i[c * 3 + 1] - 1];
+					v[c].Normal = normals[i[c * 3 + 2] - 1];
+					v[c].UV.y = 1.0f - v[c].UV.y;
+					v[c].Position.z *= -1.0f;
+					v[c].Normal.z *= -1.0f;
+				}
+
+				verts.push_back(v[0]); verts.push_back(v[2]); verts.push_back(v[1]);
+				if (cornerCount == 4)
+				{
+					verts.push_back(v[0]); verts.push_back(v[3]); verts.push_back(v[2]);
+				}
+
+				while (indexCounter < verts.size())
+					indices.push_back(indexCounter++);
+			}
+		}
+
+		fclose(file);
+		return true;
+	}
+
+	// --------------------------------------------------------
+	// Writes a large grid of quads to an OBJ file, so the
+	// loaders can be measured on more than a few kilobytes
+	// --------------------------------------------------------
+	void WriteSyntheticObj(const std::wstring& filename, int gridSize, bool relativeIndices = false)
+	{
+		FILE* file = OpenForWriting(filename);
+		if (!file)
+			return;
+
+		fprintf(file, "# Synthetic %dx%d grid for benchmarking\n", gridSize, gridSize);
+		for (int y = 0; y <= gridSize; y++)
+		{
+			for (int x = 0; x <= gridSize; x++)
+			{
+				float u = (float)x / gridSize;
+				float v = (float)y / gridSize;
+				fprintf(file, "v %f %f %f\n", u * 100.0f - 50.0f, 0.25f * (float)((x * 7 + y * 13) % 5), v * 100.0f - 50.0f);
+				fprintf(file, "vt %f %f\n", u, v);
+				fprintf(file, "vn %f %f %f\n", 0.0f, 1.0f, 0.0f);
+			}
+		}
+
+		int row = gridSize + 1;
+		for (int y = 0; y < gridSize; y++)
+		{
+			for (int x = 0; x < gridSize; x++)
+			{
+				int a = y * row + x + 1;
+				int b = a + 1;
+				int c = a + row + 1;
+				int d = a + row;
+
+				// Every other row uses negative indices (counted back from the end)
+				if (relativeIndices && y % 2)
+				{
+					int count = row * row + 1;
+					a -= count; b -= count; c -= count; d -= count;
+				}
+				fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, c, c, c, d, d, d);
+			}
+		}
+
+		fclose(file);
+	}
+
+	size_t FileSize(const std::wstring& filename)
+	{
+		MappedFile file(filename.c_str());
+		return file.GetSize();
+	}
+
+	void CompareObjLoaders(const std::wstring& filename, const wchar_t* label)
+	{
+		double megabytes = FileSize(filename) / (1024.0 * 1024.0);
+
+		Clock::time_point start = Clock::now();
+		std::vector<Vertex> legacyVerts;
+		std::vector<unsigned int> legacyIndices;
+		if (!LegacyLoadObj(filename, legacyVerts, legacyIndices))
+		{
+			printf("  %-24ls (missing)\n", label);
+			return;
+		}
+		double legacySeconds = SecondsSince(start);
+
+		start = Clock::now();
+		MeshData mesh;
+		LoadObjMeshData(filename.c_str(), mesh);
+		double mappedSeconds = SecondsSince(start);
+
+		double triangles = mesh.Indices.size() / 3.0;
+		printf("  %-24ls %8.2f MB  %9.0f tris | legacy %8.1f MB/s %11.0f tris/s | mapped %8.1f MB/s %11.0f tris/s | %5.1fx | verts %zu -> %zu\n",
+			label,
+			megabytes,
+			triangles,
+			megabytes / legacySeconds, legacyIndices.size() / 3.0 / legacySeconds,
+			megabytes / mappedSeconds, triangles / mappedSeconds,
+			legacySeconds / mappedSeconds,
+			legacyVerts.size(),
+			mesh.Vertices.size());
+	}
+
+	void PrintCacheStats(const char* label, const MeshData& mesh, double seconds)
+	{
+		const unsigned int* indices = mesh.Indices.data();
+		size_t indexCount = mesh.Indices.size();
+		size_t vertexCount = mesh.Vertices.size();
+		VertexCacheStats fifo16 = SimulateVertexCache(indices, indexCount, vertexCount, 16, VertexCacheType::FIFO);
+		VertexCacheStats fifo32 = SimulateVertexCache(indices, indexCount, vertexCount, 32, VertexCacheType::FIFO);
+		VertexCacheStats lru32 = SimulateVertexCache(indices, indexCount, vertexCount, 32, VertexCacheType::LRU);
+
+		printf("    %-9s ACMR/ATVR  FIFO16 %5.3f / %5.3f  FIFO32 %5.3f / %5.3f  LRU32 %5.3f / %5.3f",
+			label,
+			fifo16.ACMR, fifo16.ATVR,
+			fifo32.ACMR, fifo32.ATVR,
+			lru32.ACMR, lru32.ATVR);
+
+		if (seconds > 0.0)
+			printf("  (%.2f ms)", seconds * 1000.0);
+		printf("\n");
+	}
+
+	void CompareVertexCacheOrder(MeshData& mesh, const wchar_t* label)
+	{
+		printf("  %ls: %zu tris, %zu verts\n", label, mesh.Indices.size() / 3, mesh.Vertices.size());
+		PrintCacheStats("original", mesh, 0.0);
+
+		Clock::time_point start = Clock::now();
+		OptimizeMeshForGPU(mesh);
+		PrintCacheStats("optimized", mesh, SecondsSince(start));
+	}
+
+	// --------------------------------------------------------
+	// A lumpy UV sphere, with a UV seam down one side (where
+	// the first and last column of vertices overlap)
+	// --------------------------------------------------------
+	void MakeLumpySphere(int segments, MeshData& mesh)
+	{
+		const float pi = 3.14159265f;
+		int rings = segments / 2;
+
+		for (int y = 0; y <= rings; y++)
+		{
+			for (int x = 0; x <= segments; x++)
+			{
+				float u = (float)x / segments;
+				float v = (float)y / rings;
+				// Wrap around exactly, so both sides of the seam match
+				float theta = (x % segments) * 2.0f * pi / segments;
+				float phi = v * pi;
+				float radius = 1.0f + 0.05f * std::sin(theta * 5.0f) * std::sin(phi * 4.0f);
+
+				Vertex vert = {};
+				vert.Normal = XMFLOAT3(std::sin(phi) * std::cos(theta), std::cos(phi), std::sin(phi) * std::sin(theta));
+				if (y == 0 || y == rings)
+					vert.Normal = XMFLOAT3(0, y == 0 ? 1.0f : -1.0f, 0);
+				vert.Position = XMFLOAT3(vert.Normal.x * radius, vert.Normal.y * radius, vert.Normal.z * radius);
+				vert.UV = XMFLOAT2(u, v);
+				mesh.Vertices.push_back(vert);
+			}
+		}
+
+		int row = segments + 1;
+		for (int y = 0; y < rings; y++)
+		{
+			for (int x = 0; x < segments; x++)
+			{
+				// The triangles touching the poles would have no area
+				unsigned int a = y * row + x;
+				unsigned int quad[6] = { a, a + 1, a + row, a + 1, a + row + 1, a + row };
+				mesh.Indices.insert(mesh.Indices.end(), quad + (y == 0 ? 3 : 0), quad + (y == rings - 1 ? 3 : 6));
+			}
+		}
+	}
+
+	// Edges (by position) used by only one triangle: holes in the surface
+	size_t CountOpenEdges(const MeshData& mesh, const MeshLod& lod)
+	{
+		auto less = [](const XMFLOAT3& a, const XMFLOAT3& b)
+		{
+			if (a.x != b.x) return a.x < b.x;
+			if (a.y != b.y) return a.y < b.y;
+			return a.z < b.z;
+		};
+
+		std::vector<std::pair<unsigned int, unsigned int>> keys;
+		std::vector<XMFLOAT3> positions;
+		for (const Vertex& v : mesh.Vertices)
+			positions.push_back(v.Position);
+
+		// Number each distinct position, so seam copies count as one
+		std::vector<unsigned int> order(positions.size());
+		for (size_t i = 0; i < order.size(); i++)
+			order[i] = (unsigned int)i;
+		std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return less(positions[a], positions[b]); });
+
+		std::vector<unsigned int> id(positions.size());
+		for (size_t i = 0; i < order.size(); i++)
+			id[order[i]] = (i > 0 && !less(positions[order[i - 1]], positions[order[i]])) ? id[order[i - 1]] : (unsigned int)i;
+
+		for (unsigned int i = 0; i < lod.IndexCount; i += 3)
+		{
+			const unsigned int* tri = &mesh.Indices[lod.IndexOffset + i];
+			for (int e = 0; e < 3; e++)
+			{
+				unsigned int a = id[tri[e]];
+				unsigned int b = id[tri[(e + 1) % 3]];
+				keys.push_back(std::make_pair((std::min)(a, b), (std::max)(a, b)));
+			}
+		}
+		std::sort(keys.begin(), keys.end());
+
+		size_t open = 0;
+		for (size_t i = 0; i < keys.size(); i++)
+		{
+			bool shared =
+				(i > 0 && keys[i - 1] == keys[i]) ||
+				(i + 1 < keys.size() && keys[i + 1] == keys[i]);
+			if (!shared)
+				open++;
+		}
+
+		return open;
+	}
+
+	// --------------------------------------------------------
+	// A transform's world matrix, rebuilt from its own values
+	// and every parent's, without any of the cached matrices
+	// --------------------------------------------------------
+	XMMATRIX WorldFromScratch(Transform* transform)
+	{
+		XMMATRIX world = XMMatrixIdentity();
+		for (; transform; transform = transform->GetParent())
+		{
+			XMFLOAT3 pos = transform->GetPosition();
+			XMFLOAT3 rot = transform->GetPitchYawRoll();
+			XMFLOAT3 sc = transform->GeScale();
+			world = world *
+				XMMatrixScaling(sc.x, sc.y, sc.z) *
+				XMMatrixRotationRollPitchYaw(rot.x, rot.y, rot.z) *
+				XMMatrixTranslation(pos.x, pos.y, pos.z);
+		}
+		return world;
+	}
+
+	bool NearlyEqual(const XMFLOAT4X4& a, FXMMATRIX b, float tolerance)
+	{
+		XMFLOAT4X4 bf;
+		XMStoreFloat4x4(&bf, b);
+		for (int r = 0; r < 4; r++)
+			for (int c = 0; c < 4; c++)
+				if (std::fabs(a.m[r][c] - bf.m[r][c]) > tolerance * (1.0f + std::fabs(bf.m[r][c])))
+					return false;
+		return true;
+	}
+
+	// --------------------------------------------------------
+	// How Transform used to find a direction, converting its
+	// angles to a quaternion on every call, kept here only as
+	// a baseline
+	// --------------------------------------------------------
+	XMFLOAT3 LegacyDirection(const XMFLOAT3& pitchYawRoll, FXMVECTOR axis)
+	{
+		XMVECTOR rotation = XMQuaternionRotationRollPitchYaw(pitchYawRoll.x, pitchYawRoll.y, pitchYawRoll.z);
+		XMFLOAT3 direction;
+		XMStoreFloat3(&direction, XMVector3Rotate(axis, rotation));
+		return direction;
+	}
+
+	float Difference(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMVectorGetX(XMVector3Length(XMLoadFloat3(&a) - XMLoadFloat3(&b)));
+	}
+
+	// The largest difference between two matrices, relative to
+	// the largest element of the expected one
+	float RelativeError(const XMFLOAT4X4& result, const XMFLOAT4X4& expected)
+	{
+		float worst = 0.0f;
+		float largest = 0.0f;
+		for (int r = 0; r < 4; r++)
+			for (int c = 0; c < 4; c++)
+			{
+				worst = (std::max)(worst, std::fabs(result.m[r][c] - expected.m[r][c]));
+				largest = (std::max)(largest, std::fabs(expected.m[r][c]));
+			}
+		return worst / (std::max)(largest, 1e-20f);
+	}
+
+	// Does the straight line from origin to target stay clear
+	// of all the boxes?
+	bool RayReaches(const XMFLOAT3& origin, const XMFLOAT3& target, const std::vector<BoundingBox>& boxes)
+	{
+		XMVECTOR start = XMLoadFloat3(&origin);
+		XMVECTOR offset = XMLoadFloat3(&target) - start;
+		float length = XMVectorGetX(XMVector3Length(offset));
+		XMVECTOR direction = offset / length;
+		for (const BoundingBox& box : boxes)
+		{
+			float distance;
+			if (box.Intersects(start, direction, distance) && distance < length * 0.999f)
+				return false;
+		}
+		return true;
+	}
+
+	long long SerialFibonacci(int n)
+	{
+		return n < 2 ? n : SerialFibonacci(n - 1) + SerialFibonacci(n - 2);
+	}
+
+	// --------------------------------------------------------
+	// The classic fork/join test: each call starts a job for
+	// one half and does the other itself, down to a cutoff
+	// --------------------------------------------------------
+	long long ParallelFibonacci(JobSystem& jobs, int n, int cutoff)
+	{
+		if (n < cutoff)
+			return SerialFibonacci(n);
+
+		long long left = 0;
+		JobCounter counter;
+		jobs.Run([&]() { left = ParallelFibonacci(jobs, n - 1, cutoff); }, &counter);
+		long long right = ParallelFibonacci(jobs, n - 2, cutoff);
+		jobs.Wait(counter);
+		return left + right;
+	}
+}
+
+void RunBenchmarks(const std::wstring& modelPath)
+{
+	BenchmarkObjLoading(modelPath);
+	BenchmarkParallelObjParsing(modelPath);
+	BenchmarkMeshCache(modelPath);
+	BenchmarkVertexCache(modelPath);
+	BenchmarkLodGeneration(modelPath);
+	BenchmarkMeshlets();
+	BenchmarkVertexPacking(modelPath);
+	BenchmarkTangents();
+	BenchmarkAssetLoading(modelPath);
+	BenchmarkBoundingVolumes(modelPath);
+	BenchmarkInstancing();
+	BenchmarkRayCasts(modelPath);
+	BenchmarkTransforms();
+	BenchmarkTransformQueries();
+	BenchmarkInverseTranspose();
+	BenchmarkFrustumCulling();
+	BenchmarkOcclusionCulling();
+	BenchmarkFixedTimestep();
+	BenchmarkFramePipeline();
+	BenchmarkJobSystem();
+	BenchmarkProfiler(modelPath);
+	BenchmarkFrameTelemetry(modelPath);
+}
+
+// --------------------------------------------------------
+// Compares the original getline/sscanf OBJ loader against
+// the memory-mapped parser, on the sample models and on a
+// large synthetic grid
+// --------------------------------------------------------
+void BenchmarkObjLoading(const std::wstring& modelPath)
+{
+	printf("OBJ loading\n");
+
+	for (const wchar_t* model : sampleModels)
+		CompareObjLoaders(modelPath + model, model);
+
+	std::wstring syntheticPath = modelPath + L"benchmark_grid.obj";
+	WriteSyntheticObj(syntheticPath, 700);
+	CompareObjLoaders(syntheticPath, L"synthetic 700x700 grid");
+	RemoveFile(syntheticPath);
+
+	printf("\n");
+}
+
+// --------------------------------------------------------
+// Measures how chunked, multithreaded OBJ parsing scales
+// with the number of threads, and checks that its output
+// matches the serial parser exactly
+// --------------------------------------------------------
+void BenchmarkParallelObjParsing(const std::wstring& modelPath)
+{
+	printf("Parallel OBJ parsing\n");
+
+	std::wstring syntheticPath = modelPath + L"benchmark_grid.obj";
+	WriteSyntheticObj(syntheticPath, 1200, true);
+
+	MappedFile file(syntheticPath.c_str());
+	if (!file.IsOpen())
+	{
+		printf("  (could not write %ls)\n\n", syntheticPath.c_str());
+		return;
+	}
+
+	const char* begin = file.GetData();
+	const char* end = begin + file.GetSize();
+	double megabytes = file.GetSize() / (1024.0 * 1024.0);
+
+	Clock::time_point start = Clock::now();
+	ObjData serial;
+	ParseObj(begin, end, serial);
+	double serialSeconds = SecondsSince(start);
+	printf("  serial      %8.1f MB/s\n", megabytes / serialSeconds);
+
+	unsigned int maxThreads = std::thread::hardware_concurrency();
+	for (unsigned int threads = 1; threads <= maxThreads; threads *= 2)
+	{
+		start = Clock::now();
+		ObjData parallel;
+		ParseObjParallel(begin, end, parallel, threads);
+		double seconds = SecondsSince(start);
+
+		bool identical =
+			parallel.Positions.size() == serial.Positions.size() &&
+			parallel.UVs.size() == serial.UVs.size() &&
+			parallel.Normals.size() == serial.Normals.size() &&
+			parallel.Corners.size() == serial.Corners.size() &&
+			memcmp(parallel.Positions.data(), serial.Positions.data(), serial.Positions.size() * sizeof(XMFLOAT3)) == 0 &&
+			memcmp(parallel.UVs.data(), serial.UVs.data(), serial.UVs.size() * sizeof(XMFLOAT2)) == 0 &&
+			memcmp(parallel.Normals.data(), serial.Normals.data(), serial.Normals.size() * sizeof(XMFLOAT3)) == 0 &&
+			memcmp(parallel.Corners.data(), serial.Corners.data(), serial.Corners.size() * sizeof(ObjCorner)) == 0;
+
+		printf("  %2u threads  %8.1f MB/s  %5.2fx  %s\n",
+			threads,
+			megabytes / seconds,
+			serialSeconds / seconds,
+			identical ? "identical" : "MISMATCH");
+
+		// Make sure the last step is always the full core count
+		if (threads < maxThreads && threads * 2 > maxThreads)
+			threads = maxThreads / 2;
+	}
+
+	RemoveFile(syntheticPath);
+	printf("\n");
+}
+
+// --------------------------------------------------------
+// Compares building a mesh from its .obj against loading it
+// from the .dxmesh cache, checks that both give the same
+// arrays, that rewriting the .obj unchanged keeps the cache
+// (after hashing it, once), and that editing it or corrupting
+// the cache's indices invalidates it
+// --------------------------------------------------------
+void BenchmarkMeshCache(const std::wstring& modelPath)
+{
+	printf("Mesh cache\n");
+
+	std::wstring syntheticPath = modelPath + L"benchmark_grid.obj";
+	std::wstring cachePath = GetMeshCachePath(syntheticPath.c_str());
+	WriteSyntheticObj(syntheticPath, 700);
+	RemoveFile(cachePath);
+
+	MeshLoadOptions options;
+
+	// Scoped, so the cache isn't still mapped (and locked) below
+	{
+		Clock::time_point start = Clock::now();
+		LoadedMesh built;
+		if (!LoadMeshFile(syntheticPath.c_str(), options, built))
+		{
+			printf("  (could not write %ls)\n\n", syntheticPath.c_str());
+			return;
+		}
+		double buildSeconds = SecondsSince(start);
+
+		start = Clock::now();
+		LoadedMesh cached;
+		LoadMeshFile(syntheticPath.c_str(), options, cached);
+		double cachedSeconds = SecondsSince(start);
+
+		bool identical =
+			cached.FromCache &&
+			cached.VertexCount == built.VertexCount &&
+			cached.IndexCount == built.IndexCount &&
+			memcmp(cached.Vertices, built.Vertices, built.VertexCount * sizeof(Vertex)) == 0 &&
+			memcmp(cached.Indices, built.Indices, built.IndexCount * sizeof(unsigned int)) == 0;
+
+		printf("  build from .obj  %8.2f ms\n", buildSeconds * 1000.0);
+		printf("  load .dxmesh     %8.2f ms  %5.1fx  %s\n",
+			cachedSeconds * 1000.0,
+			buildSeconds / cachedSeconds,
+			identical ? "identical" : "MISMATCH");
+
+		// Written through a temporary file, which is gone now
+		FILE* temp = OpenForReading(cachePath + L".tmp");
+		printf("  temporary file   %s\n", temp ? "LEFT BEHIND" : "renamed into place");
+		if (temp)
+			fclose(temp);
+	}
+
+	// Same contents, newer write time: hashed, and still reused
+	WriteSyntheticObj(syntheticPath, 700);
+	FILE* file = 0;
+	{
+		Clock::time_point start = Clock::now();
+		LoadedMesh rewritten;
+		LoadMeshFile(syntheticPath.c_str(), options, rewritten);
+		double rewrittenSeconds = SecondsSince(start);
+		printf("  rewritten source %8.2f ms  %s\n",
+			rewrittenSeconds * 1000.0,
+			rewritten.FromCache ? "cache reused" : "REBUILT");
+	}
+
+	// ...and the new write time saved, so it isn't hashed again
+	{
+		MappedFile source(syntheticPath.c_str());
+		MappedFile cache(cachePath.c_str());
+		bool updated =
+			cache.GetSize() >= sizeof(MeshCacheHeader) &&
+			GetMeshCacheHeader(cache)->SourceWriteTime == source.GetWriteTime();
+		printf("  source time      %s\n", updated ? "updated" : "NOT UPDATED");
+	}
+
+	// An index past the last vertex should be caught, not drawn
+	file = OpenForUpdating(cachePath);
+	if (file)
+	{
+		MeshCacheHeader header = {};
+		unsigned int badIndex = 0xFFFFFFFF;
+		if (fread(&header, sizeof(header), 1, file) == 1 &&
+			fseek(file, (long)header.IndexOffset, SEEK_SET) == 0)
+			fwrite(&badIndex, sizeof(badIndex), 1, file);
+		fclose(file);
+	}
+
+	{
+		LoadedMesh corrupted;
+		LoadMeshFile(syntheticPath.c_str(), options, corrupted);
+		printf("  bad index        %s\n", corrupted.FromCache ? "CORRUPT CACHE USED" : "rebuilt");
+	}
+
+	// Touch the source; the cache should be rebuilt rather than reused
+	file = OpenForUpdating(syntheticPath);
+	if (file)
+	{
+		fseek(file, 0, SEEK_END);
+		fprintf(file, "# edited\n");
+		fclose(file);
+	}
+
+	{
+		LoadedMesh rebuilt;
+		LoadMeshFile(syntheticPath.c_str(), options, rebuilt);
+		printf("  edited source    %s\n", rebuilt.FromCache ? "STALE CACHE USED" : "rebuilt");
+	}
+
+	RemoveFile(syntheticPath);
+	RemoveFile(cachePath);
+	printf("\n");
+}
+
+// --------------------------------------------------------
+// Simulates the GPU's post-transform vertex cache on each
+// mesh before and after reordering it.  ACMR is transforms
+// per triangle (0.5 is the best possible on a regular grid),
+// ATVR is transforms per vertex (1.0 is perfect).
+// --------------------------------------------------------
+void BenchmarkVertexCache(const std::wstring& modelPath)
+{
+	printf("Vertex cache optimization\n");
+
+	MeshLoadOptions options;
+	options.OptimizeForGPU = false;
+	options.LodCount = 1;
+	options.UseCache = false;
+
+	for (const wchar_t* model : sampleModels)
+	{
+		LoadedMesh loaded;
+		if (LoadMeshFile((modelPath + model).c_str(), options, loaded))
+			CompareVertexCacheOrder(loaded.Data, model);
+	}
+
+	std::wstring syntheticPath = modelPath + L"benchmark_grid.obj";
+	WriteSyntheticObj(syntheticPath, 300);
+	LoadedMesh grid;
+	if (LoadMeshFile(syntheticPath.c_str(), options, grid))
+	{
+		MeshData shuffled = grid.Data;
+		CompareVertexCacheOrder(grid.Data, L"synthetic 300x300 grid");
+
+		// Exporters don't always write faces in a sensible order
+		std::mt19937 random(1234);
+		size_t triangleCount = shuffled.Indices.size() / 3;
+		for (size_t i = triangleCount - 1; i > 0; i--)
+		{
+			size_t j = std::uniform_int_distribution<size_t>(0, i)(random);
+			for (int c = 0; c < 3; c++)
+				std::swap(shuffled.Indices[i * 3 + c], shuffled.Indices[j * 3 + c]);
+		}
+		CompareVertexCacheOrder(shuffled, L"same grid, shuffled");
+	}
+	RemoveFile(syntheticPath);
+
+	printf("\n");
+}
+
+// --------------------------------------------------------
+// Builds a LOD chain for a closed, seamed sphere and for the
+// sample models, reporting each level's triangle count and
+// error.  A closed sphere should stay closed at every level
+// (no open edges), which shows the seam wasn't torn.
+// --------------------------------------------------------
+void BenchmarkLodGeneration(const std::wstring& modelPath)
+{
+	printf("LOD generation\n");
+
+	NamedMeshes meshes;
+	meshes.push_back(std::make_pair(std::wstring(L"lumpy sphere"), MeshData()));
+	MakeLumpySphere(512, meshes.back().second);
+	LoadSampleMeshes(modelPath, meshes);
+
+	for (auto& entry : meshes)
+	{
+		MeshData& mesh = entry.second;
+		OptimizeMeshForGPU(mesh);
+
+		Clock::time_point start = Clock::now();
+		std::vector<MeshLod> lods;
+		GenerateLods(mesh, 5, lods);
+		double seconds = SecondsSince(start);
+
+		printf("  %ls: %zu verts, %.2f ms\n", entry.first.c_str(), mesh.Vertices.size(), seconds * 1000.0);
+		for (size_t i = 0; i < lods.size(); i++)
+		{
+			VertexCacheStats stats = SimulateVertexCache(
+				&mesh.Indices[lods[i].IndexOffset], lods[i].IndexCount, mesh.Vertices.size(), 32, VertexCacheType::LRU);
+
+			printf("    LOD %zu %9u tris  error %9.6f  ACMR %5.3f  open edges %zu\n",
+				i,
+				lods[i].IndexCount / 3,
+				lods[i].Error,
+				stats.ACMR,
+				CountOpenEdges(mesh, lods[i]));
+		}
+	}
+
+	printf("\n");
+}
+
+// --------------------------------------------------------
+// Builds meshlets for a large sphere, then culls them from
+// cameras all around it.  Every triangle in a culled meshlet
+// is checked to make sure it really was off screen or facing
+// away, so culling is never wrong, only conservative.
+// --------------------------------------------------------
+void BenchmarkMeshlets()
+{
+	printf("Meshlets\n");
+
+	MeshData mesh;
+	MakeLumpySphere(512, mesh);
+	OptimizeVertexCache(&mesh.Indices[0], mesh.Indices.size(), mesh.Vertices.size());
+
+	Clock::time_point start = Clock::now();
+	std::vector<Meshlet> meshlets;
+	BuildMeshlets(&mesh.Vertices[0], mesh.Vertices.size(), &mesh.Indices[0], mesh.Indices.size(), meshlets);
+	double buildSeconds = SecondsSince(start);
+
+	size_t meshletVertices = 0;
+	for (const Meshlet& m : meshlets)
+		meshletVertices += m.VertexCount;
+
+	VertexCacheStats stats = SimulateVertexCache(&mesh.Indices[0], mesh.Indices.size(), mesh.Vertices.size(), 32, VertexCacheType::LRU);
+	printf("  built %zu meshlets from %zu tris in %.2f ms (%.1f tris, %.1f verts each, LRU32 ACMR %.3f)\n",
+		meshlets.size(),
+		mesh.Indices.size() / 3,
+		buildSeconds * 1000.0,
+		mesh.Indices.size() / 3.0 / meshlets.size(),
+		(double)meshletVertices / meshlets.size(),
+		stats.ACMR);
+
+	XMFLOAT4X4 world, view, projection;
+	XMStoreFloat4x4(&world, XMMatrixIdentity());
+	XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(1.0472f, 16.0f / 9.0f, 0.1f, 800.0f));
+
+	const int cameraCount = 16;
+	const int repeats = 64;
+	size_t visibleTotal = 0;
+	size_t wronglyCulled = 0;
+	double cullSeconds = 0.0;
+	std::vector<unsigned int> visible;
+
+	for (int c = 0; c < cameraCount; c++)
+	{
+		// Orbit the sphere, close enough that some of it is off screen
+		float angle = c * 6.2831853f / cameraCount;
+		XMVECTOR eye = XMVectorSet(std::cos(angle) * 1.8f, 0.4f, std::sin(angle) * 1.8f, 0.0f);
+		XMVECTOR target = XMVectorSet(0.3f, 0.0f, 0.0f, 0.0f);
+		XMMATRIX viewMat = XMMatrixLookToLH(eye, target - eye, XMVectorSet(0, 1, 0, 0));
+		XMStoreFloat4x4(&view, viewMat);
+
+		start = Clock::now();
+		for (int r = 0; r < repeats; r++)
+			CullMeshlets(meshlets.data(), meshlets.size(), world, view, projection, visible);
+		cullSeconds += SecondsSince(start);
+		visibleTotal += visible.size();
+
+		// Check every triangle of every culled meshlet
+		XMMATRIX viewProjection = viewMat * XMLoadFloat4x4(&projection);
+		std::vector<bool> isVisible(meshlets.size(), false);
+		for (unsigned int v : visible)
+			isVisible[v] = true;
+
+		for (size_t m = 0; m < meshlets.size(); m++)
+		{
+			if (isVisible[m])
+				continue;
+
+			const unsigned int* tris = &mesh.Indices[meshlets[m].IndexOffset];
+			for (unsigned int t = 0; t < meshlets[m].TriangleCount; t++)
+			{
+				XMVECTOR p[3];
+				bool onScreen = false;
+				for (int k = 0; k < 3; k++)
+				{
+					p[k] = XMLoadFloat3(&mesh.Vertices[tris[t * 3 + k]].Position);
+					XMFLOAT4 clip;
+					XMStoreFloat4(&clip, XMVector4Transform(XMVectorSetW(p[k], 1.0f), viewProjection));
+					if (clip.w > 0 && std::fabs(clip.x) <= clip.w && std::fabs(clip.y) <= clip.w && clip.z >= 0 && clip.z <= clip.w)
+						onScreen = true;
+				}
+
+				XMVECTOR normal = XMVector3Cross(p[1] - p[0], p[2] - p[0]);
+				bool facing = XMVectorGetX(XMVector3Dot(normal, eye - p[0])) > 0.0f;
+				if (onScreen && facing)
+					wronglyCulled++;
+			}
+		}
+	}
+
+	size_t cullCount = (size_t)cameraCount * repeats;
+	printf("  culling: %.1f%% of meshlets kept, %.2f us per cull (%.1f M meshlets/s), %zu visible triangles culled\n",
+		100.0 * visibleTotal / (cameraCount * meshlets.size()),
+		cullSeconds * 1e6 / cullCount,
+		cullCount * meshlets.size() / cullSeconds / 1e6,
+		wronglyCulled);
+
+	printf("\n");
+}
+
+// --------------------------------------------------------
+// Packs a large sphere and the sample models, reporting the
+// size saved, how long packing takes and the worst error.
+// 16 bit positions should land within half a step of the
+// bounds / 65535 on each axis.
+// --------------------------------------------------------
+void BenchmarkVertexPacking(const std::wstring& modelPath)
+{
+	printf("Vertex packing (%zu bytes -> %zu bytes per vertex)\n", sizeof(Vertex), sizeof(PackedVertex));
+
+	MeshData sphere;
+	MakeLumpySphere(512, sphere);
+	GenerateTangents(&sphere.Vertices[0], (int)sphere.Vertices.size(), &sphere.Indices[0], (int)sphere.Indices.size());
+
+	NamedMeshes meshes;
+	meshes.push_back(std::make_pair(std::wstring(L"lumpy sphere"), MeshData()));
+	meshes.back().second.Vertices.swap(sphere.Vertices);
+	meshes.back().second.Indices.swap(sphere.Indices);
+	LoadSampleMeshes(modelPath, meshes);
+
+	for (auto& entry : meshes)
+	{
+		MeshData& mesh = entry.second;
+		XMVECTOR minPos = XMLoadFloat3(&mesh.Vertices[0].Position);
+		XMVECTOR maxPos = minPos;
+		for (const Vertex& v : mesh.Vertices)
+		{
+			minPos = XMVectorMin(minPos, XMLoadFloat3(&v.Position));
+			maxPos = XMVectorMax(maxPos, XMLoadFloat3(&v.Position));
+		}
+		XMFLOAT3 boundsMin, boundsMax;
+		XMStoreFloat3(&boundsMin, minPos);
+		XMStoreFloat3(&boundsMax, maxPos);
+
+		// The sphere's tangents came from GenerateTangents(), which
+		// leaves the signs alone
+		std::vector<float> signs(mesh.Vertices.size());
+		CalculateTangentSigns(&mesh.Vertices[0], (int)mesh.Vertices.size(), &mesh.Indices[0], (int)mesh.Indices.size(), signs.data());
+		for (size_t i = 0; i < signs.size(); i++)
+			mesh.Vertices[i].TangentSign = signs[i];
+
+		std::vector<PackedVertex> packed(mesh.Vertices.size());
+		Clock::time_point start = Clock::now();
+		PackVertices(&mesh.Vertices[0], mesh.Vertices.size(), boundsMin, boundsMax, packed.data());
+		double seconds = SecondsSince(start);
+
+		PackedVertexError error;
+		PackVertices(&mesh.Vertices[0], mesh.Vertices.size(), boundsMin, boundsMax, packed.data(), &error);
+
+		size_t mirrored = std::count(signs.begin(), signs.end(), -1.0f);
+		float halfStep = XMVectorGetX(XMVector3Length(maxPos - minPos)) / 65535.0f * 0.5f;
+		printf("  %ls: %zu verts (%zu mirrored) in %.2f ms (%.1f M verts/s), %.2f MB -> %.2f MB\n",
+			entry.first.c_str(),
+			mesh.Vertices.size(),
+			mirrored,
+			seconds * 1000.0,
+			mesh.Vertices.size() / seconds / 1e6,
+			mesh.Vertices.size() * sizeof(Vertex) / (1024.0 * 1024.0),
+			mesh.Vertices.size() * sizeof(PackedVertex) / (1024.0 * 1024.0));
+		printf("    max error: position %g (bound %g), normal %.4f deg, tangent %.4f deg, uv %g\n",
+			error.MaxPositionError,
+			halfStep,
+			error.MaxNormalError,
+			error.MaxTangentError,
+			error.MaxUVError);
+	}
+
+	printf("\n");
+}
+
+// --------------------------------------------------------
+// Times the original tangent generator against each SIMD
+// kernel this CPU supports on a ~1M triangle sphere, and
+// checks they agree (angle between tangents & signs).  Then
+// scales the best kernel across threads on a ~2M triangle
+// sphere, checking that every thread count gives exactly the
+// same bits.  Below 4 threads that's the serial version.
+// --------------------------------------------------------
+void BenchmarkTangents()
+{
+	const char* kernelNames[] = { "auto", "scalar", "SSE4", "AVX2" };
+	printf("Tangent generation (best kernel: %s)\n", kernelNames[(int)GetBestTangentKernel()]);
+
+	MeshData mesh;
+	MakeLumpySphere(1000, mesh);
+	const int repeats = 5;
+
+	// The original, plus its separate sign pass
+	std::vector<Vertex> reference = mesh.Vertices;
+	std::vector<float> referenceSigns(reference.size());
+	double referenceSeconds = BestOf(repeats, [&]()
+	{
+		GenerateTangents(&reference[0], (int)reference.size(), &mesh.Indices[0], (int)mesh.Indices.size());
+		CalculateTangentSigns(&reference[0], (int)reference.size(), &mesh.Indices[0], (int)mesh.Indices.size(), referenceSigns.data());
+	});
+	printf("  %zu tris, %zu verts\n", mesh.Indices.size() / 3, mesh.Vertices.size());
+	printf("  original + signs  %8.2f ms\n", referenceSeconds * 1000.0);
+
+	TangentKernel kernels[] = { TangentKernel::Scalar, TangentKernel::SSE4, TangentKernel::AVX2 };
+	for (TangentKernel kernel : kernels)
+	{
+		if ((int)kernel > (int)GetBestTangentKernel())
+			continue;
+
+		std::vector<Vertex> verts = mesh.Vertices;
+		double seconds = BestOf(repeats, [&]()
+		{
+			GenerateTangentsSIMD(&verts[0], (int)verts.size(), &mesh.Indices[0], (int)mesh.Indices.size(), kernel);
+		});
+
+		float maxAngle = 0.0f;
+		size_t signMismatches = 0;
+		for (size_t i = 0; i < verts.size(); i++)
+		{
+			XMVECTOR a = XMLoadFloat3(&reference[i].Tangent);
+			XMVECTOR b = XMLoadFloat3(&verts[i].Tangent);
+			float angle = std::atan2(
+				XMVectorGetX(XMVector3Length(XMVector3Cross(a, b))),
+				XMVectorGetX(XMVector3Dot(a, b)));
+			maxAngle = (std::max)(maxAngle, angle * 57.2957795f);
+			signMismatches += verts[i].TangentSign != referenceSigns[i];
+		}
+
+		printf("  %-16s  %8.2f ms  (%.2fx)  max difference %.5f deg, %zu signs differ\n",
+			kernelNames[(int)kernel],
+			seconds * 1000.0,
+			referenceSeconds / seconds,
+			maxAngle,
+			signMismatches);
+	}
+
+	// Threaded, which should match the single threaded result exactly.
+	// This needs a mesh past GenerateTangentsParallel()'s cutoff.
+	mesh = MeshData();
+	MakeLumpySphere(1500, mesh);
+	printf("  %zu tris, %zu verts, %u cores\n",
+		mesh.Indices.size() / 3,
+		mesh.Vertices.size(),
+		std::thread::hardware_concurrency());
+
+	std::vector<Vertex> serial = mesh.Vertices;
+	double serialSeconds = BestOf(repeats, [&]()
+	{
+		GenerateTangentsSIMD(&serial[0], (int)serial.size(), &mesh.Indices[0], (int)mesh.Indices.size());
+	});
+
+	unsigned int cores = (std::max)(1u, std::thread::hardware_concurrency());
+	for (unsigned int threads = 1; threads <= (std::max)(8u, cores); threads *= 2)
+	{
+		std::vector<Vertex> verts = mesh.Vertices;
+		double seconds = BestOf(repeats, [&]()
+		{
+			GenerateTangentsParallel(&verts[0], (int)verts.size(), &mesh.Indices[0], (int)mesh.Indices.size(), threads);
+		});
+
+		bool identical = memcmp(&verts[0], &serial[0], verts.size() * sizeof(Vertex)) == 0;
+		printf("  %2u thread%s       %8.2f ms  (%.2fx vs 1 thread SIMD)  %s\n",
+			threads,
+			threads == 1 ? " " : "s",
+			seconds * 1000.0,
+			serialSeconds / seconds,
+			identical ? "identical" : "DIFFERENT");
+	}
+
+	printf("\n");
+}
+
+// --------------------------------------------------------
+// Loads a batch of meshes one after another, then as jobs
+// (like AssetLoader does) with more and more
+// threads.  Each file is built from source, single threaded,
+// so only the loading of separate files overlaps.
+// --------------------------------------------------------
+void BenchmarkAssetLoading(const std::wstring& modelPath)
+{
+	printf("Parallel asset loading\n");
+
+	std::vector<std::wstring> files;
+	for (const wchar_t* model : sampleModels)
+		files.push_back(modelPath + model);
+
+	const int gridCount = 8;
+	for (int i = 0; i < gridCount; i++)
+	{
+		std::wstring path = modelPath + L"benchmark_asset_" + std::to_wstring(i) + L".obj";
+		WriteSyntheticObj(path, 150);
+		files.push_back(path);
+	}
+
+	MeshLoadOptions options;
+	options.UseCache = false;
+	options.ParseThreads = 1;
+
+	Clock::time_point start = Clock::now();
+	size_t serialTriangles = 0;
+	for (const std::wstring& file : files)
+	{
+		LoadedMesh mesh;
+		LoadMeshFile(file.c_str(), options, mesh);
+		serialTriangles += mesh.IndexCount / 3;
+	}
+	double serialSeconds = SecondsSince(start);
+	printf("  %zu files, serial  %8.2f ms\n", files.size(), serialSeconds * 1000.0);
+
+	unsigned int maxThreads = std::thread::hardware_concurrency();
+	for (unsigned int threads = 1; threads <= maxThreads; threads *= 2)
+	{
+		start = Clock::now();
+		size_t triangles = 0;
+		{
+			// This thread helps while it waits, so it's one of them
+			JobSystem jobs(threads - 1);
+			JobCounter loads;
+			std::atomic<size_t> loadedTriangles(0);
+			for (const std::wstring& file : files)
+			{
+				jobs.Run([&options, &loadedTriangles, file]()
+				{
+					LoadedMesh mesh;
+					LoadMeshFile(file.c_str(), options, mesh);
+					loadedTriangles += mesh.IndexCount / 3;
+				}, &loads);
+			}
+
+			jobs.Wait(loads);
+			triangles = loadedTriangles;
+		}
+		double seconds = SecondsSince(start);
+
+		printf("  %2u threads        %8.2f ms  %5.2fx  %s\n",
+			threads,
+			seconds * 1000.0,
+			serialSeconds / seconds,
+			triangles == serialTriangles ? "same meshes" : "MISMATCH");
+
+		// Make sure the last step is always the full core count
+		if (threads < maxThreads && threads * 2 > maxThreads)
+			threads = maxThreads / 2;
+	}
+
+	for (int i = 0; i < gridCount; i++)
+		RemoveFile(modelPath + L"benchmark_asset_" + std::to_wstring(i) + L".obj");
+	printf("\n");
+}
+
+// --------------------------------------------------------
+// How tight each kind of bounds is on the sample models,
+// and how fast local bounds move into world space compared
+// to DirectXCollision's own BoundingBox::Transform()
+// --------------------------------------------------------
+void BenchmarkBoundingVolumes(const std::wstring& modelPath)
+{
+	printf("Bounding volumes (sphere radius, oriented box volume vs. the box)\n");
+
+	NamedMeshes meshes;
+	meshes.push_back(std::make_pair(std::wstring(L"lumpy sphere"), MeshData()));
+	MakeLumpySphere(512, meshes.back().second);
+	LoadSampleMeshes(modelPath, meshes);
+
+	for (auto& entry : meshes)
+	{
+		const std::vector<Vertex>& verts = entry.second.Vertices;
+
+		Clock::time_point start = Clock::now();
+		MeshBounds bounds;
+		CalculateMeshBounds(verts.data(), verts.size(), bounds);
+		double seconds = SecondsSince(start);
+
+		BoundingSphere ritter = CalculateBoundingSphere(verts.data(), verts.size(), 0);
+		float boxRadius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&bounds.Box.Extents)));
+		float boxVolume = bounds.Box.Extents.x * bounds.Box.Extents.y * bounds.Box.Extents.z;
+		float orientedVolume = bounds.OrientedBox.Extents.x * bounds.OrientedBox.Extents.y * bounds.OrientedBox.Extents.z;
+
+		printf("  %-22ls %8zu verts  %7.2f ms  sphere %.4f (Ritter %.4f, around box %.4f)  oriented box %5.1f%%\n",
+			entry.first.c_str(),
+			verts.size(),
+			seconds * 1000.0,
+			bounds.Sphere.Radius,
+			ritter.Radius,
+			boxRadius,
+			boxVolume > 0.0f ? 100.0f * orientedVolume / boxVolume : 100.0f);
+	}
+
+	// Lots of boxes through lots of world matrices
+	const size_t count = 1 << 20;
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> random(-1.0f, 1.0f);
+	std::vector<BoundingBox> local(count);
+	std::vector<XMFLOAT4X4> worlds(256);
+	for (BoundingBox& box : local)
+		box = BoundingBox(XMFLOAT3(random(rng), random(rng), random(rng)), XMFLOAT3(1.0f + random(rng) * 0.5f, 1.0f, 0.5f));
+	for (XMFLOAT4X4& world : worlds)
+	{
+		XMStoreFloat4x4(&world,
+			XMMatrixScaling(1.5f + random(rng), 1.0f, 2.0f) *
+			XMMatrixRotationRollPitchYaw(random(rng) * 3.0f, random(rng) * 3.0f, random(rng) * 3.0f) *
+			XMMatrixTranslation(random(rng) * 100.0f, random(rng) * 100.0f, random(rng) * 100.0f));
+	}
+
+	std::vector<BoundingBox> arvo(count);
+	Clock::time_point start = Clock::now();
+	for (size_t i = 0; i < count; i++)
+		arvo[i] = TransformBounds(local[i], XMLoadFloat4x4(&worlds[i & 255]));
+	double arvoSeconds = SecondsSince(start);
+
+	std::vector<BoundingBox> corners(count);
+	start = Clock::now();
+	for (size_t i = 0; i < count; i++)
+		local[i].Transform(corners[i], XMLoadFloat4x4(&worlds[i & 255]));
+	double cornerSeconds = SecondsSince(start);
+
+	// Both are the exact box around the transformed box
+	float maxDifference = 0.0f;
+	for (size_t i = 0; i < count; i++)
+	{
+		XMVECTOR difference = XMVectorAbs(XMLoadFloat3(&arvo[i].Extents) - XMLoadFloat3(&corners[i].Extents)) +
+			XMVectorAbs(XMLoadFloat3(&arvo[i].Center) - XMLoadFloat3(&corners[i].Center));
+		maxDifference = (std::max)(maxDifference, XMVectorGetX(XMVector3Length(difference)));
+	}
+
+	printf("  box to world space: %.1f ns each (BoundingBox::Transform %.1f ns), max difference %g\n",
+		arvoSeconds * 1e9 / count,
+		cornerSeconds * 1e9 / count,
+		maxDifference);
+	printf("\n");
+}
+
+// --------------------------------------------------------
+// Groups scenes of objects spread over a handful of meshes,
+// materials & levels of detail the way Game::Draw() does,
+// counting draw calls with & without instancing, timing the
+// grouping & packing, and checking every instance ended up
+// in the right batch with its own matrices
+// --------------------------------------------------------
+void BenchmarkInstancing()
+{
+	printf("Instancing (draw calls and grouping time per frame)\n");
+
+	// Batching only compares these, so anything with an address will do
+	const int meshCount = 8;
+	const int materialCount = 4;
+	const int lodCount = 3;
+	char meshes[meshCount];
+	char materials[materialCount];
+
+	const unsigned int sceneSizes[] = { 100, 1000, 10000, 100000 };
+	for (unsigned int objectCount : sceneSizes)
+	{
+		// A few one-off meshes, then everything spread over the same few
+		struct Object
+		{
+			int Mesh;
+			int Material;
+			int Lod;
+			XMFLOAT4X4 World;
+			XMFLOAT4X4 WorldInvTranspose;
+		};
+		std::vector<Object> objects(objectCount);
+		std::mt19937 rng(objectCount);
+		std::uniform_real_distribution<float> random(-100.0f, 100.0f);
+		for (unsigned int i = 0; i < objectCount; i++)
+		{
+			Object& object = objects[i];
+			object.Mesh = i < 7 ? (int)i : (int)(rng() % meshCount);
+			object.Material = (int)(rng() % materialCount);
+			object.Lod = (int)(rng() % lodCount);
+
+			XMMATRIX world = XMMatrixScaling(1.0f, 2.0f, 1.0f) * XMMatrixTranslation(random(rng), random(rng), random(rng));
+			XMStoreFloat4x4(&object.World, world);
+			XMStoreFloat4x4(&object.WorldInvTranspose, XMMatrixInverse(0, XMMatrixTranspose(world)));
+		}
+
+		InstanceBatcher batcher;
+		const int frames = objectCount > 10000 ? 10 : 100;
+		double seconds = 0.0;
+		for (int frame = 0; frame <= frames; frame++)
+		{
+			Clock::time_point start = Clock::now();
+			batcher.Begin();
+			for (unsigned int i = 0; i < objectCount; i++)
+			{
+				const Object& object = objects[i];
+				batcher.Add(&meshes[object.Mesh], &materials[object.Material], object.Lod, object.World, object.WorldInvTranspose, i);
+			}
+			batcher.Build();
+
+			// The first frame allocates everything, so it doesn't count
+			if (frame > 0)
+				seconds += SecondsSince(start);
+		}
+
+		// Every object must be in exactly one batch that matches it
+		const std::vector<InstanceData>& data = batcher.GetInstanceData();
+		const std::vector<unsigned int>& sources = batcher.GetInstanceSources();
+		std::vector<bool> seen(objectCount, false);
+		unsigned int mistakes = 0;
+		for (const InstanceBatch& batch : batcher.GetBatches())
+		{
+			unsigned int previous = 0;
+			for (unsigned int i = batch.FirstInstance; i < batch.FirstInstance + batch.InstanceCount; i++)
+			{
+				const Object& object = objects[sources[i]];
+				bool matches =
+					!seen[sources[i]] &&
+					batch.Mesh == &meshes[object.Mesh] &&
+					batch.Material == &materials[object.Material] &&
+					batch.Lod == object.Lod &&
+					(i == batch.FirstInstance || sources[i] > previous) &&
+					memcmp(&data[i].World, &object.World, sizeof(XMFLOAT4X4)) == 0 &&
+					memcmp(&data[i].WorldInvTranspose, &object.WorldInvTranspose, sizeof(XMFLOAT4X4)) == 0;
+				if (!matches)
+					mistakes++;
+				seen[sources[i]] = true;
+				previous = sources[i];
+			}
+		}
+		if (std::find(seen.begin(), seen.end(), false) != seen.end())
+			mistakes++;
+
+		InstanceBatchStats stats = batcher.GetStats();
+		printf("  %7u objects: %6u draw calls -> %3u (largest batch %6u)  %8.3f ms  %6.1f MB/s packed  %s\n",
+			objectCount,
+			stats.Instances,
+			stats.Batches,
+			stats.LargestBatch,
+			seconds * 1000.0 / frames,
+			seconds > 0.0 ? sizeof(InstanceData) * (double)objectCount * frames / seconds / (1024.0 * 1024.0) : 0.0,
+			mistakes == 0 ? "ok" : "MISMATCH");
+	}
+	printf("\n");
+}
+
+// --------------------------------------------------------
+// Builds BVHs for the sample models and some large spheres,
+// on one thread and on all of them, then casts random rays
+// through each, checking a sample against testing every
+// triangle
+// --------------------------------------------------------
+void BenchmarkRayCasts(const std::wstring& modelPath)
+{
+	printf("Ray casts (BVH build time, rays per second)\n");
+
+	NamedMeshes meshes;
+	LoadSampleMeshes(modelPath, meshes);
+
+	const int sphereSegments[] = { 128, 512, 1024 };
+	for (int segments : sphereSegments)
+	{
+		wchar_t name[64];
+		swprintf(name, 64, L"lumpy sphere %d", segments);
+		meshes.push_back(std::make_pair(std::wstring(name), MeshData()));
+		MakeLumpySphere(segments, meshes.back().second);
+	}
+
+	unsigned int threadCount = (std::max)(1u, std::thread::hardware_concurrency());
+	for (auto& entry : meshes)
+	{
+		const MeshData& mesh = entry.second;
+
+		MeshBVH serial;
+		Clock::time_point start = Clock::now();
+		serial.Build(mesh.Vertices.data(), mesh.Vertices.size(), mesh.Indices.data(), mesh.Indices.size(), 1);
+		double serialSeconds = SecondsSince(start);
+
+		MeshBVH bvh;
+		start = Clock::now();
+		bvh.Build(mesh.Vertices.data(), mesh.Vertices.size(), mesh.Indices.data(), mesh.Indices.size(), threadCount);
+		double parallelSeconds = SecondsSince(start);
+
+		// Rays from around the mesh towards random points inside its bounds
+		XMVECTOR minPos = XMLoadFloat3(&mesh.Vertices[0].Position);
+		XMVECTOR maxPos = minPos;
+		for (const Vertex& v : mesh.Vertices)
+		{
+			minPos = XMVectorMin(minPos, XMLoadFloat3(&v.Position));
+			maxPos = XMVectorMax(maxPos, XMLoadFloat3(&v.Position));
+		}
+		XMVECTOR center = (minPos + maxPos) * 0.5f;
+		XMVECTOR extents = (std::max)(XMVectorGetX(XMVector3Length(maxPos - minPos)), 0.01f) * XMVectorReplicate(0.5f);
+
+		const size_t rayCount = 1 << 17;
+		std::vector<XMFLOAT3> origins(rayCount);
+		std::vector<XMFLOAT3> directions(rayCount);
+		std::mt19937 rng(11);
+		std::uniform_real_distribution<float> random(-1.0f, 1.0f);
+		for (size_t i = 0; i < rayCount; i++)
+		{
+			XMVECTOR from = center + XMVector3Normalize(XMVectorSet(random(rng), random(rng), random(rng), 0.0f)) * extents * 3.0f;
+			XMVECTOR to = center + XMVectorSet(random(rng), random(rng), random(rng), 0.0f) * extents * 0.5f;
+			XMStoreFloat3(&origins[i], from);
+			XMStoreFloat3(&directions[i], XMVector3Normalize(to - from));
+		}
+
+		unsigned int hits = 0;
+		std::vector<RayHit> results(rayCount);
+		std::vector<char> found(rayCount);
+		start = Clock::now();
+		for (size_t i = 0; i < rayCount; i++)
+		{
+			found[i] = bvh.Intersect(origins[i], directions[i], FLT_MAX, results[i]);
+			hits += found[i];
+		}
+		double raySeconds = SecondsSince(start);
+
+		// Testing every triangle is slow, so only check a sample that way
+		size_t checkCount = (std::min)(rayCount, (size_t)(20000000 / (mesh.Indices.size() / 3 + 1)) + 1);
+		unsigned int mismatches = 0;
+		start = Clock::now();
+		for (size_t i = 0; i < checkCount; i++)
+		{
+			RayHit bruteHit;
+			bool bruteFound = bvh.IntersectBruteForce(origins[i], directions[i], FLT_MAX, bruteHit);
+			if (bruteFound != (found[i] != 0) ||
+				(bruteFound && (bruteHit.Triangle != results[i].Triangle || bruteHit.Distance != results[i].Distance)))
+				mismatches++;
+		}
+		double bruteSeconds = SecondsSince(start);
+
+		// The tree shouldn't depend on the thread count
+		MeshBVHStats stats = bvh.GetStats();
+		MeshBVHStats serialStats = serial.GetStats();
+		bool sameTree = stats.Nodes == serialStats.Nodes && stats.SahCost == serialStats.SahCost;
+
+		printf("  %-22ls %8zu tris  build %8.2f ms (%u threads %8.2f ms)  depth %2u  %6.2f Mrays/s (every triangle %9.0f rays/s)  %u%% hit  %s\n",
+			entry.first.c_str(),
+			mesh.Indices.size() / 3,
+			serialSeconds * 1000.0,
+			threadCount,
+			parallelSeconds * 1000.0,
+			stats.MaxDepth,
+			rayCount / raySeconds / 1e6,
+			checkCount / bruteSeconds,
+			hits * 100 / (unsigned int)rayCount,
+			mismatches == 0 && sameTree ? "ok" : "MISMATCH");
+	}
+	printf("\n");
+}
+
+// --------------------------------------------------------
+// A forest of 1000 three-level hierarchies (100,000
+// transforms), where some fraction of them move each frame
+// before every world matrix is fetched, as drawing does.
+// The dirty matrices are rebuilt one at a time as they're
+// fetched, or all at once by the store beforehand, on one
+// thread and on all of them.  Compares against rebuilding
+// every matrix from scratch, checks the cached matrices
+// and their inverse transposes against those, and checks
+// that reparenting, moving & destroying keep the links intact.
+// --------------------------------------------------------
+void BenchmarkTransforms()
+{
+	printf("Transform hierarchies (world matrices for every transform per frame)\n");
+
+	const unsigned int rootCount = 1000;
+	const unsigned int childrenPerRoot = 9;
+	const unsigned int grandchildrenPerChild = 10;
+	const unsigned int perRoot = 1 + childrenPerRoot * (1 + grandchildrenPerChild);
+	const unsigned int transformCount = rootCount * perRoot;
+
+	TransformStore store;
+	std::vector<Transform> transforms;
+	transforms.reserve(transformCount);
+	for (unsigned int i = 0; i < transformCount; i++)
+		transforms.push_back(Transform(store));
+	std::mt19937 rng(15);
+	std::uniform_real_distribution<float> random(-1.0f, 1.0f);
+	for (unsigned int root = 0; root < rootCount; root++)
+	{
+		unsigned int base = root * perRoot;
+		transforms[base].SetPosition(random(rng) * 100.0f, 0.0f, random(rng) * 100.0f);
+		for (unsigned int c = 0; c < childrenPerRoot; c++)
+		{
+			unsigned int child = base + 1 + c * (1 + grandchildrenPerChild);
+			transforms[child].SetParent(&transforms[base]);
+			for (unsigned int g = 1; g <= grandchildrenPerChild; g++)
+				transforms[child + g].SetParent(&transforms[child]);
+		}
+	}
+
+	// Uniform scales, so reparenting can keep world matrices exactly
+	for (Transform& t : transforms)
+	{
+		float scale = 1.0f + random(rng) * 0.25f;
+		t.MoveAbsolute(random(rng), random(rng), random(rng));
+		t.SetPitchYawRoll(random(rng), random(rng), random(rng));
+		t.SetScale(scale, scale, scale);
+	}
+
+	// Which transforms move, in no particular order
+	std::vector<unsigned int> order(transformCount);
+	for (unsigned int i = 0; i < transformCount; i++)
+		order[i] = i;
+	std::shuffle(order.begin(), order.end(), rng);
+
+	const int frames = 20;
+	XMFLOAT4X4 sink = {};
+
+	double scratchSeconds = 0.0;
+	for (int frame = 0; frame < frames; frame++)
+	{
+		Clock::time_point start = Clock::now();
+		for (Transform& t : transforms)
+			XMStoreFloat4x4(&sink, WorldFromScratch(&t));
+		scratchSeconds += SecondsSince(start);
+	}
+	printf("  every matrix rebuilt from scratch           %8.3f ms\n", scratchSeconds * 1000.0 / frames);
+
+	unsigned int threadCount = (std::max)(1u, std::thread::hardware_concurrency());
+	const float movingFractions[] = { 0.0f, 0.01f, 0.1f, 1.0f };
+	for (float fraction : movingFractions)
+	{
+		unsigned int moving = (unsigned int)(transformCount * fraction);
+		unsigned int mismatches = 0;
+
+		// One at a time as they're fetched, then batched on 1 & every thread
+		double seconds[3] = {};
+		const unsigned int batchThreads[3] = { 0, 1, threadCount };
+		for (int run = 0; run < 3; run++)
+		{
+			for (int frame = 0; frame <= frames; frame++)
+			{
+				Clock::time_point start = Clock::now();
+				for (unsigned int i = 0; i < moving; i++)
+					transforms[order[i]].Rotate(0.0f, 0.01f, 0.0f);
+				if (batchThreads[run] > 0)
+					store.UpdateMatrices(batchThreads[run]);
+				for (Transform& t : transforms)
+				{
+					sink = t.GetWorldMatrix();
+					sink = t.GetWorldInverseTransposeMatrix();
+				}
+
+				// The first frame brings everything up to date, so it doesn't count
+				if (frame > 0)
+					seconds[run] += SecondsSince(start);
+			}
+
+			for (Transform& t : transforms)
+			{
+				XMMATRIX world = WorldFromScratch(&t);
+				XMFLOAT4X4 inverseTranspose;
+				XMStoreFloat4x4(&inverseTranspose, XMMatrixInverse(0, XMMatrixTranspose(world)));
+				if (!NearlyEqual(t.GetWorldMatrix(), world, 1e-4f) ||
+					RelativeError(t.GetWorldInverseTransposeMatrix(), inverseTranspose) > 1e-4f)
+					mismatches++;
+			}
+		}
+
+		printf("  %7u of %7u moving (%5.1f%%)  one at a time %8.3f ms  batched %8.3f ms (%u threads %8.3f ms)  %s\n",
+			moving,
+			transformCount,
+			fraction * 100.0f,
+			seconds[0] * 1000.0 / frames,
+			seconds[1] * 1000.0 / frames,
+			threadCount,
+			seconds[2] * 1000.0 / frames,
+			mismatches == 0 ? "ok" : "MISMATCH");
+	}
+
+	// Inverse transposes fetched on their own, without the
+	// world matrix, then changed again before that's fetched
+	bool inverseTransposes = true;
+	{
+		Transform parent(store);
+		Transform child(store);
+		child.SetParent(&parent);
+		const float scales[] = { 2.0f, 4.0f, 8.0f };
+		for (float scale : scales)
+		{
+			parent.SetScale(scale, scale, scale);
+			child.SetScale(scale, scale, scale);
+			XMFLOAT4X4 parentInverse = parent.GetWorldInverseTransposeMatrix();
+			XMFLOAT4X4 childInverse = child.GetWorldInverseTransposeMatrix();
+			inverseTransposes &= std::abs(parentInverse._11 - 1.0f / scale) < 1e-5f;
+			inverseTransposes &= std::abs(childInverse._11 - 1.0f / (scale * scale)) < 1e-5f;
+		}
+		inverseTransposes &= std::abs(child.GetWorldMatrix()._11 - 64.0f) < 1e-4f;
+	}
+	printf("  inverse transposes without world matrices %s\n", inverseTransposes ? "ok" : "MISMATCH");
+
+	// Reparenting without moving in the world, moves & destruction
+	bool linked = true;
+	{
+		Transform& grandchild = transforms[2];
+		XMFLOAT4X4 before = grandchild.GetWorldMatrix();
+		grandchild.SetParent(&transforms[perRoot], true);
+		XMFLOAT4X4 after = grandchild.GetWorldMatrix();
+		linked &= grandchild.GetParent() == &transforms[perRoot];
+		linked &= NearlyEqual(before, XMLoadFloat4x4(&after), 1e-3f);
+		linked &= NearlyEqual(after, WorldFromScratch(&grandchild), 1e-4f);
+
+		std::vector<Transform> moved;
+		moved.push_back(std::move(transforms[1]));
+		Transform& child = moved.back();
+		linked &= child.GetParent() == &transforms[0] && transforms[1].GetParent() == 0;
+		linked &= child.GetChildCount() == grandchildrenPerChild - 1 && transforms[1].GetChildCount() == 0;
+		for (size_t i = 0; i < child.GetChildCount(); i++)
+			linked &= child.GetChild(i)->GetParent() == &child;
+
+		// Growing the vector moves the transforms again
+		for (int i = 0; i < 100; i++)
+			moved.push_back(Transform(store));
+		linked &= moved[0].GetChildCount() == grandchildrenPerChild - 1 && moved[0].GetChild(0)->GetParent() == &moved[0];
+
+		Transform* orphan = moved[0].GetChild(0);
+		moved.erase(moved.begin());
+		linked &= orphan->GetParent() == 0;
+		linked &= NearlyEqual(orphan->GetWorldMatrix(), WorldFromScratch(orphan), 1e-4f);
+
+		// Loops are refused
+		transforms[0].SetParent(&transforms[13]);
+		linked &= transforms[0].GetParent() == 0;
+	}
+	printf("  reparenting, moves & destruction          %s\n", linked ? "ok" : "MISMATCH");
+	printf("\n");
+}
+
+// --------------------------------------------------------
+// Per-call costs of the direction getters, MoveRelative()
+// and the camera's view matrix, with the directions cached
+// against converting the angles on every call as before.
+// Also checks the cached directions and the quaternion
+// setters against building the same rotations directly.
+// --------------------------------------------------------
+void BenchmarkTransformQueries()
+{
+	printf("Transform queries (ns per call)\n");
+
+	const unsigned int transformCount = 1024;
+	const int rounds = 500;
+	const double calls = (double)transformCount * rounds;
+
+	TransformStore store;
+	std::vector<Transform> transforms;
+	std::vector<XMFLOAT3> angles(transformCount);
+	std::vector<XMFLOAT3> positions(transformCount);
+	transforms.reserve(transformCount);
+	std::mt19937 rng(17);
+	std::uniform_real_distribution<float> random(-3.0f, 3.0f);
+	for (unsigned int i = 0; i < transformCount; i++)
+	{
+		angles[i] = XMFLOAT3(random(rng) * 0.5f, random(rng), random(rng));
+		positions[i] = XMFLOAT3(random(rng), random(rng), random(rng));
+		transforms.push_back(Transform(store));
+		transforms[i].SetPitchYawRoll(angles[i].x, angles[i].y, angles[i].z);
+		transforms[i].SetPosition(positions[i].x, positions[i].y, positions[i].z);
+	}
+
+	XMVECTOR sum = XMVectorZero();
+	XMVECTOR forwardAxis = XMVectorSet(0, 0, 1, 0);
+
+	// Forward vectors
+	Clock::time_point start = Clock::now();
+	for (int r = 0; r < rounds; r++)
+		for (unsigned int i = 0; i < transformCount; i++)
+		{
+			XMFLOAT3 forward = LegacyDirection(angles[i], forwardAxis);
+			sum += XMLoadFloat3(&forward);
+		}
+	double legacyForward = SecondsSince(start);
+
+	start = Clock::now();
+	for (int r = 0; r < rounds; r++)
+		for (Transform& t : transforms)
+		{
+			XMFLOAT3 forward = t.GetForward();
+			sum += XMLoadFloat3(&forward);
+		}
+	double cachedForward = SecondsSince(start);
+
+	// Camera::UpdateViewMatrix(), before (three calls each) & after
+	start = Clock::now();
+	for (int r = 0; r < rounds; r++)
+		for (unsigned int i = 0; i < transformCount; i++)
+		{
+			Transform& t = transforms[i];
+			XMVECTOR pos = XMVectorSet(t.GetPosition().x, t.GetPosition().y, t.GetPosition().z, 0);
+			XMVECTOR direction = XMVectorSet(
+				LegacyDirection(angles[i], forwardAxis).x,
+				LegacyDirection(angles[i], forwardAxis).y,
+				LegacyDirection(angles[i], forwardAxis).z, 0);
+			sum += XMMatrixLookToLH(pos, direction, XMVectorSet(0, 1, 0, 0)).r[3];
+		}
+	double legacyView = SecondsSince(start);
+
+	start = Clock::now();
+	for (int r = 0; r < rounds; r++)
+		for (Transform& t : transforms)
+		{
+			XMFLOAT3 position = t.GetPosition();
+			XMFLOAT3 forward = t.GetForward();
+			sum += XMMatrixLookToLH(XMLoadFloat3(&position), XMLoadFloat3(&forward), XMVectorSet(0, 1, 0, 0)).r[3];
+		}
+	double cachedView = SecondsSince(start);
+
+	// Moving along the transform's own axes
+	start = Clock::now();
+	for (int r = 0; r < rounds; r++)
+		for (unsigned int i = 0; i < transformCount; i++)
+		{
+			XMVECTOR rotation = XMQuaternionRotationRollPitchYaw(angles[i].x, angles[i].y, angles[i].z);
+			XMVECTOR move = XMVector3Rotate(XMVectorSet(0.01f, 0.0f, 0.02f, 0.0f), rotation);
+			XMStoreFloat3(&positions[i], XMLoadFloat3(&positions[i]) + move);
+		}
+	double legacyMove = SecondsSince(start);
+
+	start = Clock::now();
+	for (int r = 0; r < rounds; r++)
+		for (Transform& t : transforms)
+			t.MoveRelative(0.01f, 0.0f, 0.02f);
+	double cachedMove = SecondsSince(start);
+
+	// The cached directions & the moves they made
+	float worst = 0.0f;
+	float worstMove = 0.0f;
+	for (unsigned int i = 0; i < transformCount; i++)
+	{
+		Transform& t = transforms[i];
+		worst = (std::max)(worst, Difference(t.GetRight(), LegacyDirection(angles[i], XMVectorSet(1, 0, 0, 0))));
+		worst = (std::max)(worst, Difference(t.GetUp(), LegacyDirection(angles[i], XMVectorSet(0, 1, 0, 0))));
+		worst = (std::max)(worst, Difference(t.GetForward(), LegacyDirection(angles[i], forwardAxis)));
+		worstMove = (std::max)(worstMove, Difference(t.GetPosition(), positions[i]));
+	}
+
+	// Quaternions in, matching angles & directions out
+	for (unsigned int i = 0; i < transformCount; i++)
+	{
+		Transform& t = transforms[i];
+		XMVECTOR axis = XMVector3Normalize(XMVectorSet(random(rng), random(rng), random(rng), 0.0f));
+		float angle = random(rng);
+		XMFLOAT4 rotation = t.GetRotation();
+		XMVECTOR before = XMLoadFloat4(&rotation);
+		XMVECTOR expected = XMQuaternionMultiply(before, XMQuaternionRotationAxis(axis, angle));
+
+		XMFLOAT3 axisF;
+		XMStoreFloat3(&axisF, axis);
+		t.RotateAxisAngle(axisF, angle);
+		XMFLOAT3 expectedForward;
+		XMStoreFloat3(&expectedForward, XMVector3Rotate(forwardAxis, expected));
+		worst = (std::max)(worst, Difference(t.GetForward(), expectedForward));
+
+		// The angles have to describe the same rotation
+		XMFLOAT3 ypr = t.GetPitchYawRoll();
+		worst = (std::max)(worst, Difference(t.GetForward(), LegacyDirection(ypr, forwardAxis)));
+
+		// Half way there and back
+		XMFLOAT4 target;
+		XMStoreFloat4(&target, before);
+		XMFLOAT3 halfway;
+		XMStoreFloat3(&halfway, XMVector3Rotate(forwardAxis, XMQuaternionSlerp(expected, before, 0.5f)));
+		t.SlerpRotation(target, 0.5f);
+		worst = (std::max)(worst, Difference(t.GetForward(), halfway));
+		t.SlerpRotation(target, 1.0f);
+		worst = (std::max)(worst, Difference(t.GetForward(), LegacyDirection(angles[i], forwardAxis)));
+	}
+
+	// So none of the timed loops can be thrown away
+	volatile float checksum = XMVectorGetX(sum);
+	(void)checksum;
+
+	printf("  GetForward()          %7.1f -> %7.1f\n", legacyForward * 1e9 / calls, cachedForward * 1e9 / calls);
+	printf("  Camera view matrix    %7.1f -> %7.1f\n", legacyView * 1e9 / calls, cachedView * 1e9 / calls);
+	printf("  MoveRelative()        %7.1f -> %7.1f\n", legacyMove * 1e9 / calls, cachedMove * 1e9 / calls);
+	printf("  largest difference    %9.2g (moves %9.2g)  %s\n",
+		worst,
+		worstMove,
+		worst < 1e-4f && worstMove < 1e-3f ? "ok" : "MISMATCH");
+	printf("\n");
+}
+
+// --------------------------------------------------------
+// Inverse transposes of scale * rotation * translation
+// matrices, and of products of two (which can be sheared),
+// with the general 4x4 inverse against the affine shortcuts,
+// checking every result against the general one
+// --------------------------------------------------------
+void BenchmarkInverseTranspose()
+{
+	printf("Inverse transposes (ns per matrix)\n");
+
+	const size_t matrixCount = 1 << 16;
+	const int rounds = 10;
+	const double calls = (double)matrixCount * rounds;
+
+	// Random rotations, scales from 0.1 to 10 on each axis & positions
+	std::vector<XMFLOAT3> rights(matrixCount), ups(matrixCount), forwards(matrixCount);
+	std::vector<XMFLOAT3> scales(matrixCount), positions(matrixCount);
+	std::vector<XMFLOAT4X4> trs(matrixCount), chained(matrixCount);
+	std::mt19937 rng(18);
+	std::uniform_real_distribution<float> random(-1.0f, 1.0f);
+	for (size_t i = 0; i < matrixCount; i++)
+	{
+		XMVECTOR rotation = XMQuaternionNormalize(XMVectorSet(random(rng), random(rng), random(rng), random(rng) + 0.01f));
+		XMMATRIX rotationMat = XMMatrixRotationQuaternion(rotation);
+		XMStoreFloat3(&rights[i], rotationMat.r[0]);
+		XMStoreFloat3(&ups[i], rotationMat.r[1]);
+		XMStoreFloat3(&forwards[i], rotationMat.r[2]);
+		scales[i] = XMFLOAT3(std::pow(10.0f, random(rng)), std::pow(10.0f, random(rng)), std::pow(10.0f, random(rng)));
+		positions[i] = XMFLOAT3(random(rng) * 100.0f, random(rng) * 100.0f, random(rng) * 100.0f);
+
+		XMMATRIX world = XMMatrixScaling(scales[i].x, scales[i].y, scales[i].z) * rotationMat * XMMatrixTranslation(positions[i].x, positions[i].y, positions[i].z);
+		XMStoreFloat4x4(&trs[i], world);
+	}
+	for (size_t i = 0; i < matrixCount; i++)
+		XMStoreFloat4x4(&chained[i], XMLoadFloat4x4(&trs[i]) * XMLoadFloat4x4(&trs[(i * 7919) % matrixCount]));
+
+	const std::vector<XMFLOAT4X4>* sets[] = { &trs, &chained };
+	const char* setNames[] = { "scale * rotation * translation", "two of those chained" };
+	for (int set = 0; set < 2; set++)
+	{
+		const std::vector<XMFLOAT4X4>& matrices = *sets[set];
+		std::vector<XMFLOAT4X4> expected(matrixCount), results(matrixCount);
+		printf("  %s\n", setNames[set]);
+
+		Clock::time_point start = Clock::now();
+		for (int r = 0; r < rounds; r++)
+			for (size_t i = 0; i < matrixCount; i++)
+				XMStoreFloat4x4(&expected[i], XMMatrixInverse(0, XMMatrixTranspose(XMLoadFloat4x4(&matrices[i]))));
+		double generalSeconds = SecondsSince(start);
+		printf("    general 4x4 inverse  %7.1f\n", generalSeconds * 1e9 / calls);
+
+		start = Clock::now();
+		for (int r = 0; r < rounds; r++)
+			for (size_t i = 0; i < matrixCount; i++)
+				XMStoreFloat4x4(&results[i], AffineInverseTranspose(XMLoadFloat4x4(&matrices[i])));
+		double affineSeconds = SecondsSince(start);
+		float affineError = 0.0f;
+		for (size_t i = 0; i < matrixCount; i++)
+			affineError = (std::max)(affineError, RelativeError(results[i], expected[i]));
+		printf("    affine               %7.1f  error %8.2g  %s\n", affineSeconds * 1e9 / calls, affineError, affineError < 1e-4f ? "ok" : "MISMATCH");
+
+		start = Clock::now();
+		for (int r = 0; r < rounds; r++)
+			AffineInverseTransposeBatch(matrices.data(), results.data(), matrixCount);
+		double batchSeconds = SecondsSince(start);
+		float batchError = 0.0f;
+		for (size_t i = 0; i < matrixCount; i++)
+			batchError = (std::max)(batchError, RelativeError(results[i], expected[i]));
+		printf("    affine, 4 at a time  %7.1f  error %8.2g  %s\n", batchSeconds * 1e9 / calls, batchError, batchError < 1e-4f ? "ok" : "MISMATCH");
+
+		// Only the unchained matrices have parts to start from
+		if (set > 0)
+			continue;
+
+		start = Clock::now();
+		for (int r = 0; r < rounds; r++)
+			for (size_t i = 0; i < matrixCount; i++)
+			{
+				XMMATRIX result = InverseTransposeTRS(
+					XMLoadFloat3(&rights[i]),
+					XMLoadFloat3(&ups[i]),
+					XMLoadFloat3(&forwards[i]),
+					XMLoadFloat3(&scales[i]),
+					XMLoadFloat3(&positions[i]));
+				XMStoreFloat4x4(&results[i], result);
+			}
+		double trsSeconds = SecondsSince(start);
+		float trsError = 0.0f;
+		for (size_t i = 0; i < matrixCount; i++)
+			trsError = (std::max)(trsError, RelativeError(results[i], expected[i]));
+		printf("    from the parts       %7.1f  error %8.2g  %s\n", trsSeconds * 1e9 / calls, trsError, trsError < 1e-4f ? "ok" : "MISMATCH");
+	}
+	printf("\n");
+}
+
+// --------------------------------------------------------
+// Culls 10k, 100k & 1M random objects against a camera's
+// frustum with each kernel this CPU supports, checking they
+// all find exactly the same objects, and that every one of
+// them also passes the plain sphere test.  The one object at
+// a time sphere test over an array of spheres is the baseline.
+// --------------------------------------------------------
+void BenchmarkFrustumCulling()
+{
+	const char* kernelNames[] = { "auto", "scalar", "SSE", "AVX" };
+	printf("Frustum culling, objects per ms (best kernel: %s)\n", kernelNames[(int)GetBestCullKernel()]);
+
+	// A camera in the middle of the objects, looking along +Z
+	XMFLOAT4X4 viewProjection;
+	XMStoreFloat4x4(&viewProjection,
+		XMMatrixLookToLH(XMVectorZero(), XMVectorSet(0, 0, 1, 0), XMVectorSet(0, 1, 0, 0)) *
+		XMMatrixPerspectiveFovLH(1.0472f, 16.0f / 9.0f, 0.1f, 400.0f));
+	Frustum frustum;
+	ExtractFrustumPlanes(viewProjection, frustum);
+
+	const size_t counts[] = { 10000, 100000, 1000000 };
+	const int repeats = 5;
+	for (size_t count : counts)
+	{
+		// Spheres with boxes inside them, scattered through a cube twice the far distance across
+		std::vector<XMFLOAT3> centers(count);
+		std::vector<float> radii(count);
+		CullingBounds bounds;
+		bounds.Reserve(count);
+		std::mt19937 rng(19);
+		std::uniform_real_distribution<float> position(-400.0f, 400.0f);
+		std::uniform_real_distribution<float> size(0.5f, 5.0f);
+		std::uniform_real_distribution<float> fill(0.3f, 0.577f);
+		for (size_t i = 0; i < count; i++)
+		{
+			centers[i] = XMFLOAT3(position(rng), position(rng), position(rng));
+			radii[i] = size(rng);
+			BoundingSphere sphere(centers[i], radii[i]);
+			BoundingBox box(centers[i], XMFLOAT3(radii[i] * fill(rng), radii[i] * fill(rng), radii[i] * fill(rng)));
+			bounds.Add(sphere, box);
+		}
+
+		// Enough passes that each timing covers about a million objects
+		int passes = (int)(1000000 / count);
+		double objects = (double)count * passes;
+
+		std::vector<unsigned int> reference;
+		double baselineSeconds = BestOf(repeats, [&]()
+		{
+			for (int pass = 0; pass < passes; pass++)
+			{
+				reference.clear();
+				for (size_t i = 0; i < count; i++)
+					if (FrustumIntersectsSphere(frustum, centers[i], radii[i]))
+						reference.push_back((unsigned int)i);
+			}
+		});
+		printf("  %zu objects, %zu spheres visible\n", count, reference.size());
+		printf("    spheres, one at a time  %10.0f\n", objects / (baselineSeconds * 1000.0));
+
+		std::vector<unsigned int> expected;
+		CullKernel kernels[] = { CullKernel::Scalar, CullKernel::SSE, CullKernel::AVX };
+		for (CullKernel kernel : kernels)
+		{
+			if ((int)kernel > (int)GetBestCullKernel())
+				continue;
+
+			std::vector<unsigned int> visible;
+			double seconds = BestOf(repeats, [&]()
+			{
+				for (int pass = 0; pass < passes; pass++)
+					CullBounds(frustum, bounds, visible, kernel);
+			});
+
+			// The scalar kernel is the one the others must match exactly
+			if (kernel == CullKernel::Scalar)
+				expected = visible;
+			bool inSpheres = std::includes(reference.begin(), reference.end(), visible.begin(), visible.end());
+			bool ok = inSpheres && visible == expected;
+
+			printf("    %-22s  %10.0f  (%.2fx)  %zu visible  %s\n",
+				kernelNames[(int)kernel],
+				objects / (seconds * 1000.0),
+				baselineSeconds / seconds,
+				visible.size(),
+				ok ? "ok" : "MISMATCH");
+		}
+	}
+	printf("\n");
+}
+
+// --------------------------------------------------------
+// A headless city: a grid of buildings with streets between
+// them, full of small props, and a camera walking down a
+// street while looking around.  Each frame frustum culls
+// everything, draws the buildings that cover the most of the
+// screen into an OcclusionBuffer, then tests what's left.
+//
+// Reports the time per frame and how much each step culled,
+// checks that 1 and N threads cull exactly the same objects,
+// and checks a sample of the occluded props by casting rays
+// at their corners past the buildings' boxes (which are
+// exactly what the occluders are), counting any that could
+// actually be seen.
+// --------------------------------------------------------
+void BenchmarkOcclusionCulling()
+{
+	printf("Occlusion culling, city scene\n");
+
+	// A unit cube, which every building scales
+	Vertex cubeVertices[8] = {};
+	for (int v = 0; v < 8; v++)
+		cubeVertices[v].Position = XMFLOAT3(v & 1 ? 1.0f : -1.0f, v & 2 ? 1.0f : -1.0f, v & 4 ? 1.0f : -1.0f);
+	const unsigned int cubeIndices[36] =
+	{
+		0, 2, 3, 0, 3, 1,	4, 5, 7, 4, 7, 6,	0, 1, 5, 0, 5, 4,
+		2, 6, 7, 2, 7, 3,	0, 4, 6, 0, 6, 2,	1, 3, 7, 1, 7, 5,
+	};
+	OccluderMesh cube;
+	cube.Build(cubeVertices, 8, cubeIndices, 36);
+
+	// 16 x 16 blocks, 12 units wide with 8 unit streets, then props on the streets
+	const int blocks = 16;
+	const float blockSize = 12.0f;
+	const float spacing = 20.0f;
+	const float cityHalfWidth = blocks * spacing * 0.5f;
+	std::mt19937 rng(20);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	std::vector<BoundingBox> buildings;
+	std::vector<XMFLOAT4X4> buildingWorlds;
+	for (int bx = 0; bx < blocks; bx++)
+		for (int bz = 0; bz < blocks; bz++)
+		{
+			float height = 4.0f + 20.0f * unit(rng);
+			XMFLOAT3 center(-cityHalfWidth + (bx + 0.5f) * spacing, height * 0.5f, -cityHalfWidth + (bz + 0.5f) * spacing);
+			XMFLOAT3 extents(blockSize * 0.5f, height * 0.5f, blockSize * 0.5f);
+			buildings.push_back(BoundingBox(center, extents));
+
+			XMFLOAT4X4 world;
+			XMStoreFloat4x4(&world, XMMatrixScaling(extents.x, extents.y, extents.z) * XMMatrixTranslation(center.x, center.y, center.z));
+			buildingWorlds.push_back(world);
+		}
+
+	CullingBounds bounds;
+	for (const BoundingBox& building : buildings)
+	{
+		BoundingSphere sphere;
+		BoundingSphere::CreateFromBoundingBox(sphere, building);
+		bounds.Add(sphere, building);
+	}
+	const size_t propCount = 50000;
+	while (bounds.GetCount() < buildings.size() + propCount)
+	{
+		XMFLOAT3 center(
+			(unit(rng) * 2.0f - 1.0f) * cityHalfWidth,
+			0.0f,
+			(unit(rng) * 2.0f - 1.0f) * cityHalfWidth);
+		float offsetX = std::fmod(center.x + cityHalfWidth, spacing);
+		float offsetZ = std::fmod(center.z + cityHalfWidth, spacing);
+		float gap = (spacing - blockSize) * 0.5f;
+		if (offsetX > gap && offsetX < spacing - gap && offsetZ > gap && offsetZ < spacing - gap)
+			continue;
+
+		float size = 0.25f + 0.5f * unit(rng);
+		center.y = size;
+		BoundingBox box(center, XMFLOAT3(size, size, size));
+		BoundingSphere sphere;
+		BoundingSphere::CreateFromBoundingBox(sphere, box);
+		bounds.Add(sphere, box);
+	}
+
+	// Down the middle of a street at head height, turning as it goes
+	const int frameCount = 60;
+	std::vector<XMFLOAT3> eyes(frameCount);
+	std::vector<XMFLOAT4X4> viewProjections(frameCount);
+	std::vector<Frustum> frustums(frameCount);
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(1.0472f, 16.0f / 9.0f, 0.1f, 400.0f);
+	for (int f = 0; f < frameCount; f++)
+	{
+		float t = (float)f / frameCount;
+		eyes[f] = XMFLOAT3(-cityHalfWidth * 0.8f + t * cityHalfWidth * 1.6f, 1.7f, spacing * 0.5f - cityHalfWidth);
+		float yaw = XM_PIDIV2 + std::sin(t * XM_2PI) * 0.8f;
+		XMVECTOR direction = XMVectorSet(std::sin(yaw), 0.0f, std::cos(yaw), 0.0f);
+		XMStoreFloat4x4(&viewProjections[f], XMMatrixLookToLH(XMLoadFloat3(&eyes[f]), direction, XMVectorSet(0, 1, 0, 0)) * projection);
+		ExtractFrustumPlanes(viewProjections[f], frustums[f]);
+	}
+
+	unsigned int cores = (std::max)(1u, std::thread::hardware_concurrency());
+	unsigned int threadCounts[] = { 1, cores };
+	std::vector<std::vector<unsigned int>> firstResults(frameCount);
+	OcclusionBuffer buffer;
+	printf("  %zu buildings, %zu props, %dx%d buffer, %d frames\n",
+		buildings.size(), propCount, buffer.GetWidth(), buffer.GetHeight(), frameCount);
+
+	for (int run = 0; run < (cores > 1 ? 2 : 1); run++)
+	{
+		unsigned int threads = threadCounts[run];
+		double frustumSeconds = 0.0, rasterSeconds = 0.0, testSeconds = 0.0;
+		size_t inFrustum = 0, occluded = 0, trianglesDrawn = 0;
+		bool same = true;
+		size_t checked = 0, wronglyCulled = 0;
+
+		std::vector<unsigned int> visible;
+		std::vector<std::pair<float, unsigned int>> candidates;
+		for (int f = 0; f < frameCount; f++)
+		{
+			Clock::time_point start = Clock::now();
+			CullBounds(frustums[f], bounds, visible);
+			frustumSeconds += SecondsSince(start);
+			inFrustum += visible.size();
+
+			// The buildings covering the most of the screen, as in Game::CullOccludedEntities()
+			start = Clock::now();
+			buffer.Begin(viewProjections[f]);
+			candidates.clear();
+			for (unsigned int i : visible)
+			{
+				if (i >= buildings.size())
+					break;
+				float x = bounds.SphereX[i] - eyes[f].x;
+				float y = bounds.SphereY[i] - eyes[f].y;
+				float z = bounds.SphereZ[i] - eyes[f].z;
+				float size = bounds.SphereRadius[i] / (std::max)(std::sqrt(x * x + y * y + z * z), 0.001f);
+				if (size >= 0.1f)
+					candidates.push_back(std::make_pair(-size, i));
+			}
+			size_t occluderCount = (std::min)(candidates.size(), (size_t)32);
+			std::partial_sort(candidates.begin(), candidates.begin() + occluderCount, candidates.end());
+			for (size_t c = 0; c < occluderCount; c++)
+				buffer.AddOccluder(&cube, buildingWorlds[candidates[c].second]);
+			buffer.Rasterize(threads);
+			rasterSeconds += SecondsSince(start);
+
+			std::vector<unsigned int> inView = visible;
+			start = Clock::now();
+			buffer.FilterVisible(bounds, visible, threads);
+			testSeconds += SecondsSince(start);
+			occluded += inView.size() - visible.size();
+			trianglesDrawn += buffer.GetStats().TrianglesDrawn;
+
+			if (run == 0)
+				firstResults[f] = visible;
+			else
+				same = same && visible == firstResults[f];
+
+			// Every 10th frame, every 16th occluded prop: can a ray reach any corner?
+			if (run == 0 && f % 10 == 0)
+			{
+				size_t next = 0, hiddenCount = 0;
+				for (unsigned int i : inView)
+				{
+					if (next < visible.size() && visible[next] == i)
+					{
+						next++;
+						continue;
+					}
+					if (i < buildings.size() || hiddenCount++ % 16 != 0)
+						continue;
+
+					checked++;
+					XMFLOAT3 c(bounds.BoxX[i], bounds.BoxY[i], bounds.BoxZ[i]);
+					XMFLOAT3 e(bounds.ExtentX[i], bounds.ExtentY[i], bounds.ExtentZ[i]);
+					bool seen = RayReaches(eyes[f], c, buildings);
+					for (int corner = 0; corner < 8 && !seen; corner++)
+					{
+						XMFLOAT3 p(
+							c.x + (corner & 1 ? e.x : -e.x) * 0.99f,
+							c.y + (corner & 2 ? e.y : -e.y) * 0.99f,
+							c.z + (corner & 4 ? e.z : -e.z) * 0.99f);
+						seen = RayReaches(eyes[f], p, buildings);
+					}
+					wronglyCulled += seen;
+				}
+			}
+		}
+
+		double objects = (double)bounds.GetCount() * frameCount;
+		printf("  %u thread%s\n", threads, threads == 1 ? "" : "s");
+		printf("    frustum culled    %5.1f%%  %7.3f ms per frame\n", 100.0 * (1.0 - inFrustum / objects), frustumSeconds * 1000.0 / frameCount);
+		printf("    occluders drawn           %7.3f ms per frame  (%.0f triangles)\n", rasterSeconds * 1000.0 / frameCount, (double)trianglesDrawn / frameCount);
+		printf("    occlusion culled  %5.1f%%  %7.3f ms per frame  (of those in the frustum)\n",
+			inFrustum ? 100.0 * occluded / inFrustum : 0.0, testSeconds * 1000.0 / frameCount);
+		printf("    left to draw      %5.1f%%\n", 100.0 * (inFrustum - occluded) / objects);
+		if (run == 0)
+			printf("    %zu occluded props checked, %zu could be seen  %s\n", checked, wronglyCulled, wronglyCulled == 0 ? "ok" : "MISMATCH");
+		else
+			printf("    same objects as 1 thread  %s\n", same ? "ok" : "MISMATCH");
+	}
+	printf("\n");
+}
+
+// --------------------------------------------------------
+// Five seconds of a 60 Hz simulation drawn at several frame
+// rates (each frame's length jittered a little), and at 60
+// fps with a half second stall every second.  Each tick
+// moves & turns 2000 transforms with 4 children each; each
+// frame interpolates them and rebuilds the dirty matrices.
+//
+// Reports ticks per second and their cost, which shouldn't
+// depend on the frame rate, and the interpolation's cost per
+// frame.  Checks that every rendered root & child is exactly
+// where the motion puts it at the time being drawn: one tick
+// behind the newest state, plus alpha of a tick.
+// --------------------------------------------------------
+void BenchmarkFixedTimestep()
+{
+	printf("Fixed timestep (60 Hz ticks, interpolated transforms)\n");
+
+	const unsigned int rootCount = 2000;
+	const unsigned int childrenPerRoot = 4;
+	const float speed = 3.0f;		// Units per second along x
+	const float turnRate = 1.5f;	// Radians per second of yaw
+	const double seconds = 5.0;
+
+	struct Run { const char* Name; double Fps; bool Stalls; };
+	const Run runs[] =
+	{
+		{ "30 fps", 30.0, false },
+		{ "60 fps", 60.0, false },
+		{ "144 fps", 144.0, false },
+		{ "1000 fps", 1000.0, false },
+		{ "60 fps + stalls", 60.0, true },
+	};
+
+	for (const Run& run : runs)
+	{
+		TransformStore store;
+		std::vector<Transform> transforms;
+		transforms.reserve(rootCount * (1 + childrenPerRoot));
+		for (unsigned int i = 0; i < rootCount * (1 + childrenPerRoot); i++)
+			transforms.push_back(Transform(store));
+		for (unsigned int root = 0; root < rootCount; root++)
+		{
+			Transform& parent = transforms[root * (1 + childrenPerRoot)];
+			parent.SetPosition(0.0f, 0.0f, (float)root);
+			for (unsigned int c = 1; c <= childrenPerRoot; c++)
+			{
+				Transform& child = transforms[root * (1 + childrenPerRoot) + c];
+				child.SetParent(&parent);
+				child.SetPosition((float)c, 0.0f, 0.0f);
+			}
+		}
+		store.UpdateMatrices(1);
+
+		FixedTimestep timestep(60.0f, 8);
+		std::mt19937 rng(21);
+		std::uniform_real_distribution<double> jitter(0.8, 1.2);
+
+		double clock = 0.0;
+		double tickSeconds = 0.0;
+		double frameSeconds = 0.0;
+		float maxError = 0.0f;
+		while (clock < seconds)
+		{
+			double frameLength = jitter(rng) / run.Fps;
+			if (run.Stalls && timestep.GetFrameCount() % 60 == 59)
+				frameLength = 0.5;
+			clock += frameLength;
+
+			Clock::time_point start = Clock::now();
+			timestep.BeginFrame(frameLength);
+			while (timestep.Tick())
+			{
+				store.BeginTick();
+				float step = timestep.GetTickSeconds();
+				for (unsigned int root = 0; root < rootCount; root++)
+				{
+					Transform& t = transforms[root * (1 + childrenPerRoot)];
+					t.MoveAbsolute(speed * step, 0.0f, 0.0f);
+					t.Rotate(0.0f, turnRate * step, 0.0f);
+				}
+				store.EndTick();
+			}
+			tickSeconds += SecondsSince(start);
+
+			start = Clock::now();
+			store.SetInterpolation(timestep.GetAlpha());
+			store.UpdateMatrices(1);
+			frameSeconds += SecondsSince(start);
+
+			// Where everything should be drawn, once there are two ticks to draw between
+			if (timestep.GetTickCount() < 2)
+				continue;
+			float drawnTime = (float)(timestep.GetTickCount() - 1 + timestep.GetAlpha()) * timestep.GetTickSeconds();
+			float x = speed * drawnTime;
+			float yaw = turnRate * drawnTime;
+			for (unsigned int root = 0; root < rootCount; root += 97)
+			{
+				for (unsigned int c = 0; c <= childrenPerRoot; c++)
+				{
+					XMFLOAT3 drawn = transforms[root * (1 + childrenPerRoot) + c].GetWorldPosition();
+					XMFLOAT3 expected(x + c * cosf(yaw), 0.0f, root - c * sinf(yaw));
+					maxError = (std::max)(maxError, fabsf(drawn.x - expected.x));
+					maxError = (std::max)(maxError, fabsf(drawn.y - expected.y));
+					maxError = (std::max)(maxError, fabsf(drawn.z - expected.z));
+				}
+			}
+		}
+
+		printf("  %-16s %5llu frames  %4llu ticks (%5.1f per second, %3llu skipped)  ticks %7.3f ms per second  interpolation %6.3f ms per frame  error %8.2g  %s\n",
+			run.Name,
+			timestep.GetFrameCount(),
+			timestep.GetTickCount(),
+			timestep.GetTickCount() / clock,
+			timestep.GetSkippedTickCount(),
+			tickSeconds * 1000.0 / clock,
+			frameSeconds * 1000.0 / timestep.GetFrameCount(),
+			maxError,
+			maxError < 1e-3f ? "ok" : "MISMATCH");
+	}
+	printf("\n");
+}
+
+// --------------------------------------------------------
+// A headless stand-in for the game loop.  Each update moves
+// 20,000 transforms, rebuilds their matrices and fills a
+// RenderSnapshot (entities & instance batches, without any
+// meshes or materials); each draw walks the last published
+// snapshot's instances as submitting them would, summing
+// every matrix it would upload.
+//
+// Reports the time per frame with the stages run one after
+// the other and pipelined, which can only overlap with more
+// than one core.  Checks that every draw sees the snapshot
+// from the expected frame (this one, or the one before while
+// pipelining), exactly as its update built it.
+// --------------------------------------------------------
+void BenchmarkFramePipeline()
+{
+	printf("Frame pipeline (%u hardware threads)\n", std::thread::hardware_concurrency());
+
+	const unsigned int transformCount = 20000;
+	const unsigned int frameCount = 100;
+
+	TransformStore store;
+	std::vector<Transform> transforms;
+	transforms.reserve(transformCount);
+	for (unsigned int i = 0; i < transformCount; i++)
+	{
+		transforms.push_back(Transform(store));
+		transforms[i].SetPosition((float)(i % 100), 0.0f, (float)(i / 100));
+	}
+
+	RenderSnapshot snapshots[2];
+	unsigned int drawnSnapshot = 0;
+	double checksums[2] = {};	// Of each snapshot, as its update built it
+
+	// Every instance matrix, as drawing would upload them
+	auto sumInstances = [](const RenderSnapshot& snapshot)
+	{
+		double sum = 0.0;
+		for (const InstanceData& instance : snapshot.Batches.GetInstanceData())
+			for (int row = 0; row < 4; row++)
+				for (int column = 0; column < 4; column++)
+					sum += instance.World.m[row][column] + instance.WorldInvTranspose.m[row][column];
+		return sum;
+	};
+
+	const char* modeNames[] = { "one after the other", "pipelined" };
+	for (int mode = 0; mode < 2; mode++)
+	{
+		FramePipeline pipeline;
+		pipeline.SetPipelined(mode == 1);
+
+		unsigned long long frame = 0;
+		double updateTime = 0.0, drawTime = 0.0;
+		bool correct = true;
+		double sink = 0.0;
+
+		Clock::time_point start = Clock::now();
+		for (unsigned int f = 0; f < frameCount; f++)
+		{
+			frame++;
+			bool overlapping = mode == 1 && f > 0;
+
+			pipeline.RunFrame(
+				[&]()
+				{
+					for (Transform& t : transforms)
+					{
+						t.MoveAbsolute(0.0f, 0.01f, 0.0f);
+						t.Rotate(0.0f, 0.01f, 0.0f);
+					}
+					store.UpdateMatrices(1);
+
+					RenderSnapshot& snapshot = snapshots[1 - drawnSnapshot];
+					snapshot.Clear();
+					snapshot.Frame = frame;
+					snapshot.Instancing = true;
+					for (unsigned int i = 0; i < transformCount; i++)
+					{
+						SnapshotEntity entity = {};
+						entity.World = transforms[i].GetWorldMatrix();
+						entity.WorldInvTranspose = transforms[i].GetWorldInverseTransposeMatrix();
+						entity.Lod = i % 4;
+						snapshot.Entities.push_back(entity);
+						snapshot.Batches.Add(0, 0, entity.Lod, entity.World, entity.WorldInvTranspose, i);
+					}
+					snapshot.Batches.Build();
+					checksums[1 - drawnSnapshot] = sumInstances(snapshot);
+				},
+				[&]()
+				{
+					drawnSnapshot = 1 - drawnSnapshot;
+				},
+				[&]()
+				{
+					const RenderSnapshot& snapshot = snapshots[drawnSnapshot];
+					double sum = sumInstances(snapshot);
+					sink += sum;
+					if (snapshot.Frame != (overlapping ? frame - 1 : frame) ||
+						sum != checksums[drawnSnapshot] ||
+						snapshot.Entities.size() != transformCount)
+						correct = false;
+				});
+
+			updateTime += pipeline.GetStats().Update;
+			drawTime += pipeline.GetStats().Draw;
+		}
+		double seconds = SecondsSince(start);
+
+		printf("  %-20s %7.3f ms per frame  (update %7.3f ms, draw %7.3f ms)  %s\n",
+			modeNames[mode],
+			seconds * 1000.0 / frameCount,
+			updateTime / frameCount,
+			drawTime / frameCount,
+			correct && sink != 0.0 ? "ok" : "MISMATCH");
+	}
+	printf("\n");
+}
+
+// --------------------------------------------------------
+// The job system on its own:
+// - Spawn overhead: the cost of an empty job, run & waited on
+//   from this thread, with no workers (queueing alone) and
+//   with every core
+// - Fork/join: a recursive Fibonacci, with each level starting
+//   a job for one branch, reporting how many jobs were stolen
+// - Fine grained: ParallelFor() over a big array with a cheap
+//   body, and with a body whose cost climbs along the range
+//   (where fixed splits leave threads idle)
+// - Main thread jobs: started after a set of ordinary jobs,
+//   and only ever run on the main thread
+// - Exceptions: a job that throws still finishes its counter,
+//   and the exception comes out of Wait() (& ParallelFor())
+//
+// Each of the scaling tests runs with more and more threads,
+// comparing against the same work done serially.
+// --------------------------------------------------------
+void BenchmarkJobSystem()
+{
+	unsigned int maxThreads = (std::max)(1u, std::thread::hardware_concurrency());
+	printf("Job system (%u hardware threads)\n", maxThreads);
+
+	// Spawn overhead
+	const unsigned int spawnCount = 200000;
+	unsigned int spawnThreads[] = { 1, maxThreads };
+	for (int run = 0; run < (maxThreads > 1 ? 2 : 1); run++)
+	{
+		unsigned int threads = spawnThreads[run];
+		JobSystem jobs(threads - 1);
+		std::atomic<unsigned int> ran(0);
+		Clock::time_point start = Clock::now();
+		JobCounter counter;
+		for (unsigned int i = 0; i < spawnCount; i++)
+			jobs.Run([&ran]() { ran.fetch_add(1, std::memory_order_relaxed); }, &counter);
+		jobs.Wait(counter);
+		double seconds = SecondsSince(start);
+
+		printf("  Spawn & wait, %2u threads  %7.1f ns per job  %s\n",
+			threads,
+			seconds * 1e9 / spawnCount,
+			ran == spawnCount ? "ok" : "MISMATCH");
+	}
+
+	// Fork/join
+	const int fibonacciN = 32;
+	const int cutoff = 16;
+	Clock::time_point start = Clock::now();
+	long long expected = SerialFibonacci(fibonacciN);
+	double serialSeconds = SecondsSince(start);
+	printf("  Fork/join fib(%d), serial     %8.2f ms\n", fibonacciN, serialSeconds * 1000.0);
+
+	for (unsigned int threads = 1; threads <= maxThreads; threads *= 2)
+	{
+		JobSystem jobs(threads - 1);
+		start = Clock::now();
+		long long result = ParallelFibonacci(jobs, fibonacciN, cutoff);
+		double seconds = SecondsSince(start);
+		JobSystemStats stats = jobs.GetStats();
+
+		printf("  Fork/join, %2u threads       %8.2f ms  %5.2fx  %6llu jobs, %5.1f%% stolen  %s\n",
+			threads,
+			seconds * 1000.0,
+			serialSeconds / seconds,
+			stats.Jobs,
+			stats.Jobs ? 100.0 * stats.Steals / stats.Jobs : 0.0,
+			result == expected ? "ok" : "MISMATCH");
+
+		// Make sure the last step is always the full core count
+		if (threads < maxThreads && threads * 2 > maxThreads)
+			threads = maxThreads / 2;
+	}
+
+	// Fine grained
+	const size_t elementCount = 4 * 1024 * 1024;
+	std::vector<float> input(elementCount), output(elementCount), expectedOutput(elementCount);
+	for (size_t i = 0; i < elementCount; i++)
+		input[i] = (float)(i % 1000) * 0.01f;
+
+	const char* bodyNames[] = { "even", "uneven" };
+	for (int uneven = 0; uneven < 2; uneven++)
+	{
+		// The uneven body loops more the further along it is
+		auto body = [&](size_t begin, size_t end, float* results)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				float x = input[i];
+				int steps = uneven ? 1 + (int)(i * 16 / elementCount) : 1;
+				for (int step = 0; step < steps; step++)
+					x = std::sqrt(x * x + 1.0f);
+				results[i] = x;
+			}
+		};
+
+		start = Clock::now();
+		body(0, elementCount, expectedOutput.data());
+		serialSeconds = SecondsSince(start);
+		printf("  ParallelFor %-6s, serial   %8.2f ms\n", bodyNames[uneven], serialSeconds * 1000.0);
+
+		for (unsigned int threads = 1; threads <= maxThreads; threads *= 2)
+		{
+			JobSystem jobs(threads - 1);
+			std::fill(output.begin(), output.end(), 0.0f);
+			std::atomic<unsigned int> pieces(0);
+			start = Clock::now();
+			jobs.ParallelFor(elementCount, [&](size_t begin, size_t end)
+			{
+				pieces.fetch_add(1, std::memory_order_relaxed);
+				body(begin, end, output.data());
+			});
+			double seconds = SecondsSince(start);
+
+			printf("  ParallelFor %-6s, %2u threads %8.2f ms  %5.2fx  %6u pieces  %s\n",
+				bodyNames[uneven],
+				threads,
+				seconds * 1000.0,
+				serialSeconds / seconds,
+				pieces.load(),
+				output == expectedOutput ? "ok" : "MISMATCH");
+
+			if (threads < maxThreads && threads * 2 > maxThreads)
+				threads = maxThreads / 2;
+		}
+	}
+
+	// Main thread jobs
+	{
+		JobSystem jobs(maxThreads > 1 ? maxThreads - 1 : 1);
+		std::thread::id mainThread = std::this_thread::get_id();
+		std::atomic<unsigned int> ran(0), wrongThread(0);
+		JobCounter work, mainThreadWork;
+		for (int i = 0; i < 64; i++)
+			jobs.Run([&ran]() { ran++; }, &work);
+		for (int i = 0; i < 16; i++)
+		{
+			jobs.RunAfter(work, [&]()
+			{
+				if (ran != 64 || std::this_thread::get_id() != mainThread)
+					wrongThread++;
+			}, &mainThreadWork, JobAffinity::MainThread);
+		}
+
+		// Some from the frame loop, the rest while waiting
+		jobs.Wait(work);
+		size_t ranInLoop = jobs.RunMainThreadJobs();
+		jobs.Wait(mainThreadWork);
+
+		printf("  Main thread jobs: %llu run (%zu between frames)  %s\n",
+			jobs.GetStats().MainThreadJobs,
+			ranInLoop,
+			wrongThread == 0 && jobs.GetStats().MainThreadJobs == 16 ? "ok" : "MISMATCH");
+	}
+
+	// Exceptions
+	{
+		JobSystem jobs(maxThreads > 1 ? maxThreads - 1 : 1);
+		std::atomic<unsigned int> ran(0);
+		JobCounter work;
+		for (int i = 0; i < 64; i++)
+		{
+			jobs.Run([&ran, i]()
+			{
+				ran++;
+				if (i % 16 == 3)
+					throw std::runtime_error("job");
+			}, &work);
+		}
+
+		unsigned int caught = 0;
+		try { jobs.Wait(work); } catch (const std::runtime_error&) { caught++; }
+
+		// The counter is clean again afterwards
+		jobs.Run([&ran]() { ran++; }, &work);
+		try { jobs.Wait(work); } catch (...) { caught += 100; }
+
+		try
+		{
+			jobs.ParallelFor(100000, [](size_t begin, size_t end)
+			{
+				if (begin <= 50000 && 50000 < end)
+					throw std::runtime_error("piece");
+			}, 100);
+		}
+		catch (const std::runtime_error&)
+		{
+			caught++;
+		}
+
+		printf("  Exceptions: %u caught from %u jobs & a ParallelFor  %s\n",
+			caught,
+			ran.load(),
+			caught == 2 && ran == 65 && work.IsDone() ? "ok" : "MISMATCH");
+	}
+
+	printf("\n");
+}
+
+// --------------------------------------------------------
+// What a PROFILE_SCOPE() costs: compiled in but disabled
+// (which should be next to nothing), and recording.  Then
+// checks a capture from several threads: every scope is
+// there, nested properly on its own thread, a full buffer
+// drops events instead of blocking, and the Chrome trace
+// has every event.
+// --------------------------------------------------------
+void BenchmarkProfiler(const std::wstring& modelPath)
+{
+	printf("Profiler\n");
+
+	Profiler& profiler = Profiler::GetDefault();
+	bool wasEnabled = Profiler::IsEnabled();
+	profiler.EndFrame();	// Anything left over from before
+
+	// Overhead
+	const unsigned int scopeCount = 4000000;
+	const unsigned int scopesPerFrame = Profiler::BufferCapacity / 2;
+	volatile unsigned int sink = 0;
+	double baseline = 0.0;
+	const char* modeNames[] = { "no scope", "disabled", "recording" };
+	for (int mode = 0; mode < 3; mode++)
+	{
+		Profiler::SetEnabled(mode == 2);
+		Clock::time_point start = Clock::now();
+		for (unsigned int i = 0; i < scopeCount; i++)
+		{
+			if (mode == 0)
+			{
+				sink = sink + 1;
+			}
+			else
+			{
+				PROFILE_SCOPE("Benchmark scope");
+				sink = sink + 1;
+			}
+
+			// Drained like a frame would be, so nothing's dropped
+			if (mode == 2 && i % scopesPerFrame == scopesPerFrame - 1)
+				profiler.EndFrame();
+		}
+		double nanoseconds = SecondsSince(start) * 1e9 / scopeCount;
+		if (mode == 0)
+			baseline = nanoseconds;
+
+		printf("  %-10s %6.2f ns per scope  (+%.2f ns)\n", modeNames[mode], nanoseconds, nanoseconds - baseline);
+	}
+	Profiler::SetEnabled(false);
+	profiler.EndFrame();
+
+	// A capture from several threads, each with nested scopes
+	const unsigned int threadCount = 4;
+	const unsigned int frameCount = 8;
+	const unsigned int outerPerFrame = 100;	// Each with two inner scopes, one inside the other
+	profiler.StartCapture(frameCount);
+
+	bool correct = true;
+	for (unsigned int frame = 0; frame < frameCount; frame++)
+	{
+		std::vector<std::thread> threads;
+		for (unsigned int t = 0; t < threadCount; t++)
+		{
+			threads.push_back(std::thread([&]()
+			{
+				Profiler::SetThreadName("Benchmark thread");
+				for (unsigned int i = 0; i < outerPerFrame; i++)
+				{
+					PROFILE_SCOPE("Outer");
+					{
+						PROFILE_SCOPE("Middle");
+						{
+							PROFILE_SCOPE("Inner");
+							sink = sink + 1;
+						}
+					}
+				}
+			}));
+		}
+		for (std::thread& thread : threads)
+			thread.join();
+		profiler.EndFrame();
+
+		// Every scope, at the right depth, inside the one before it
+		const std::vector<ProfileEvent>& events = profiler.GetLastFrame().Events;
+		if (events.size() != threadCount * outerPerFrame * 3)
+			correct = false;
+		for (size_t e = 0; e + 2 < events.size(); e += 3)
+		{
+			const ProfileEvent& inner = events[e];
+			const ProfileEvent& middle = events[e + 1];
+			const ProfileEvent& outer = events[e + 2];
+			if (inner.Depth != 2 || middle.Depth != 1 || outer.Depth != 0 ||
+				inner.Thread != middle.Thread || middle.Thread != outer.Thread ||
+				inner.Start < middle.Start || inner.End > middle.End ||
+				middle.Start < outer.Start || middle.End > outer.End ||
+				profiler.GetThreadName(outer.Thread) != "Benchmark thread")
+				correct = false;
+		}
+	}
+
+	// Finished threads' buffers are reused, not piled up
+	printf("  %u frames of %u threads, %u thread buffers  %s\n",
+		profiler.GetCapturedFrameCount(),
+		threadCount,
+		profiler.GetThreadCount(),
+		correct && !profiler.IsCapturing() && profiler.GetCapturedFrameCount() == frameCount ? "ok" : "MISMATCH");
+
+	// A full buffer drops what doesn't fit
+	Profiler::SetEnabled(true);
+	unsigned long long droppedBefore = profiler.GetDroppedCount();
+	for (unsigned int i = 0; i < Profiler::BufferCapacity + 100; i++)
+	{
+		PROFILE_SCOPE("Overflow");
+	}
+	unsigned long long dropped = profiler.GetDroppedCount() - droppedBefore;
+	profiler.EndFrame();
+	size_t kept = profiler.GetLastFrame().Events.size();
+	Profiler::SetEnabled(wasEnabled);
+	printf("  Overflow: %zu kept, %llu dropped  %s\n",
+		kept,
+		dropped,
+		kept == Profiler::BufferCapacity && dropped == 100 ? "ok" : "MISMATCH");
+
+	// The trace has every scope and frame, as complete events
+	std::wstring tracePath = modelPath + L"benchmark_profile.json";
+	bool saved = profiler.SaveChromeTrace(tracePath);
+	std::string json = ReadWholeFile(tracePath);
+	RemoveFile(tracePath);
+
+	size_t completeEvents = 0;
+	for (size_t at = json.find("\"ph\":\"X\""); at != std::string::npos; at = json.find("\"ph\":\"X\"", at + 1))
+		completeEvents++;
+	bool wellFormed = json.compare(0, 1, "{") == 0 && json.find("]}") != std::string::npos;
+
+	size_t expectedEvents = frameCount * (threadCount * outerPerFrame * 3 + 1);
+	printf("  Chrome trace: %zu complete events  %s\n",
+		completeEvents,
+		saved && wellFormed && completeEvents == expectedEvents ? "ok" : "MISMATCH");
+
+	printf("\n");
+}
+
+// --------------------------------------------------------
+// What adding a frame & reading percentiles cost, then checks
+// the histogram against the exact percentiles of a sorted copy
+// (they should never be under, and at most a bucket over),
+// over the whole run & just the window, plus the hitch counts
+// and the CSV.  Frame times are log-normal around 16.7 ms,
+// with a long tail, like a real game's.
+// --------------------------------------------------------
+void BenchmarkFrameTelemetry(const std::wstring& modelPath)
+{
+	printf("Frame telemetry\n");
+
+	const unsigned int frameCount = 200000;
+	const unsigned int windowFrames = 1000;
+	std::mt19937 random(25);
+	std::lognormal_distribution<float> frameTimes(std::log(16.7f), 0.35f);
+	std::vector<float> frames(frameCount);
+	for (float& frame : frames)
+		frame = frameTimes(random);
+
+	FrameTelemetry telemetry(windowFrames);
+	Clock::time_point start = Clock::now();
+	for (float frame : frames)
+	{
+		telemetry.SetPresentTime(frame * 0.1f);
+		telemetry.AddFrame(frame, frame * 0.4f, frame * 0.5f);
+	}
+	double addNanoseconds = SecondsSince(start) * 1e9 / frameCount;
+
+	const unsigned int readCount = 1000;
+	volatile float sink = 0.0f;
+	start = Clock::now();
+	for (unsigned int i = 0; i < readCount; i++)
+		sink = sink + telemetry.GetLifetime(FramePhase::Frame).GetPercentile(99.9);
+	double readMicroseconds = SecondsSince(start) * 1e6 / readCount;
+
+	printf("  %u frames: %.1f ns per frame added, %.2f us per percentile\n",
+		frameCount, addNanoseconds, readMicroseconds);
+
+	// Each reported percentile (and the max) against the exact
+	// one, by nearest rank
+	auto check = [](const FrameHistogram& histogram, std::vector<float> times, const char* name)
+	{
+		std::sort(times.begin(), times.end());
+		bool correct = histogram.GetCount() == times.size();
+		double worst = 0.0;
+
+		std::vector<double> percentiles(std::begin(FrameTelemetry::ReportedPercentiles), std::end(FrameTelemetry::ReportedPercentiles));
+		percentiles.push_back(100.0);
+		printf("  %-8s", name);
+		for (double percentile : percentiles)
+		{
+			size_t rank = (size_t)std::ceil(percentile / 100.0 * times.size());
+			float exact = times[(std::max)(rank, (size_t)1) - 1];
+			float reported = percentile < 100.0 ? histogram.GetPercentile(percentile) : histogram.GetMax();
+			double error = (reported - exact) / exact;
+			worst = (std::max)(worst, error);
+
+			// Rounding to the microsecond can put it a hair under
+			if (reported < exact - 0.001f || error > 1.0 / 64.0 + 1e-4)
+				correct = false;
+			printf(" p%g %.2f (%.2f)", percentile, reported, exact);
+		}
+		printf("  worst +%.2f%%  %s\n", worst * 100.0, correct ? "ok" : "MISMATCH");
+	};
+
+	check(telemetry.GetLifetime(FramePhase::Frame), frames, "Run:");
+	std::vector<float> windowed(frames.end() - windowFrames, frames.end());
+	check(telemetry.GetWindow(FramePhase::Frame), windowed, "Window:");
+
+	std::vector<float> presents(windowed);
+	for (float& present : presents)
+		present *= 0.1f;
+	check(telemetry.GetWindow(FramePhase::Present), presents, "Present:");
+
+	// Hitches, over the window & the run
+	bool hitchesCorrect = true;
+	const std::vector<float>& thresholds = telemetry.GetHitchThresholds();
+	for (unsigned int i = 0; i < thresholds.size(); i++)
+	{
+		unsigned long long inWindow = 0;
+		unsigned long long inRun = 0;
+		for (unsigned int f = 0; f < frameCount; f++)
+		{
+			if (frames[f] > thresholds[i])
+			{
+				inRun++;
+				if (f >= frameCount - windowFrames)
+					inWindow++;
+			}
+		}
+		printf("  Over %.1f ms: %llu in the window, %llu in the run\n", thresholds[i], inWindow, inRun);
+		if (telemetry.GetWindowHitches(i) != inWindow || telemetry.GetLifetimeHitches(i) != inRun)
+			hitchesCorrect = false;
+	}
+
+	// New thresholds recount the window from the frames in it
+	telemetry.SetHitchThresholds({ 20.0f });
+	unsigned long long over20 = (unsigned long long)std::count_if(windowed.begin(), windowed.end(), [](float frame) { return frame > 20.0f; });
+	if (telemetry.GetWindowHitches(0) != over20 || telemetry.GetLifetimeHitches(0) != 0)
+		hitchesCorrect = false;
+	printf("  Hitch counts  %s\n", hitchesCorrect ? "ok" : "MISMATCH");
+
+	// The CSV: a header, then every phase for the window & the run
+	std::wstring csvPath = modelPath + L"benchmark_telemetry.csv";
+	bool saved = telemetry.SaveCsv(csvPath);
+	std::string csv = ReadWholeFile(csvPath);
+	RemoveFile(csvPath);
+
+	size_t lines = (size_t)std::count(csv.begin(), csv.end(), '\n');
+	bool csvCorrect = saved &&
+		lines == 1 + 2 * (size_t)FramePhase::Count &&
+		csv.compare(0, 18, "scope,phase,frames") == 0 &&
+		csv.find("\nwindow,Frame,1000,") != std::string::npos &&
+		csv.find("\nlifetime,Present,200000,") != std::string::npos;
+	printf("  CSV: %zu lines  %s\n", lines, csvCorrect ? "ok" : "MISMATCH");
+
+	printf("\n");
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+
+// --------------------------------------------------------
+// Headless CPU benchmarks
+//
+// None of these touch Direct3D or the window, so they can be
+// run on any machine.  Launch the executable with "-benchmark"
+// to run them all and print the results to a console.
+//
+// modelPath - Folder containing the sample .obj files
+// --------------------------------------------------------
+void RunBenchmarks(const std::wstring& modelPath);
+
+// Individual benchmarks
+void BenchmarkObjLoading(const std::wstring& modelPath);
+void BenchmarkParallelObjParsing(const std::wstring& modelPath);
+void BenchmarkMeshCache(const std::wstring& modelPath);
+void BenchmarkVertexCache(const std::wstring& modelPath);
+void BenchmarkLodGeneration(const std::wstring& modelPath);
+void BenchmarkMeshlets();
+void BenchmarkVertexPacking(const std::wstring& modelPath);
+void BenchmarkTangents();
+void BenchmarkAssetLoading(const std::wstring& modelPath);
+void BenchmarkBoundingVolumes(const std::wstring& modelPath);
+void BenchmarkInstancing();
+void BenchmarkRayCasts(const std::wstring& modelPath);
+void BenchmarkTransforms();
+void BenchmarkTransformQueries();
+void BenchmarkInverseTranspose();
+void BenchmarkFrustumCulling();
+void BenchmarkOcclusionCulling();
+void BenchmarkFixedTimestep();
+void BenchmarkFramePipeline();
+void BenchmarkJobSystem();
+void BenchmarkProfiler(const std::wstring& modelPath);
+void BenchmarkFrameTelemetry(const std::wstring& modelPath);
@@ -30,17 +30,28 @@ Camera::Camera(float aspectRatio, DirectX::XMFLOAT3 initialPos) :
 
 XMFLOAT4X4 Camera::GetViewMatrix() { return viewMat; }
 XMFLOAT4X4 Camera::GetProjectionMatrix() { return projectionMat; }
-Transform Camera::GetTransform() { return transform; }
+Transform* Camera::GetTransform() { return &transform; }
+const Frustum& Camera::GetFrustum() { return frustum; }
 
 void Camera::UpdateProjectionMatrix(float aspectRatio) {
 	XMStoreFloat4x4(&projectionMat, XMMatrixPerspectiveFovLH(fov, aspectRatio, nearClipDist, farClipDist));
+	UpdateFrustum();
 }
 
 void Camera::UpdateViewMatrix() {
-	XMVECTOR pos = XMVectorSet(transform.GetPosition().x, transform.GetPosition().y, transform.GetPosition().z, 0);
-	XMVECTOR direction = XMVectorSet(transform.GetForward().x, transform.GetForward().y, transform.GetForward().z, 0);
+	XMFLOAT3 position = transform.GetPosition();
+	XMFLOAT3 forward = transform.GetForward();
+	XMVECTOR pos = XMLoadFloat3(&position);
+	XMVECTOR direction = XMLoadFloat3(&forward);
 
 	XMStoreFloat4x4(&viewMat, XMMatrixLookToLH(pos, direction, XMVectorSet(0, 1, 0, 0)));
+	UpdateFrustum();
+}
+
+void Camera::UpdateFrustum() {
+	XMFLOAT4X4 viewProjection;
+	XMStoreFloat4x4(&viewProjection, XMLoadFloat4x4(&viewMat) * XMLoadFloat4x4(&projectionMat));
+	ExtractFrustumPlanes(viewProjection, frustum);
 }
 
 void Camera::Update(float dt) {
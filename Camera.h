@@ -1,6 +1,7 @@
 #pragma once
 
 #include <DirectXMath.h>
+#include "Frustum.h"
 #include "Input.h"
 #include "Transform.h"
 
@@ -12,17 +13,23 @@ public:
 
 	DirectX::XMFLOAT4X4 GetViewMatrix();
 	DirectX::XMFLOAT4X4 GetProjectionMatrix();
-	Transform GetTransform();
+	Transform* GetTransform();
+
+	// World space planes of what the camera can see, kept up
+	// to date with the view & projection matrices
+	const Frustum& GetFrustum();
 
 	void UpdateProjectionMatrix(float aspectRatio);
 	void UpdateViewMatrix();
 	void Update(float dt);
 
-
 private:
+	void UpdateFrustum();
+
 	Transform transform;
 	DirectX::XMFLOAT4X4 viewMat;
 	DirectX::XMFLOAT4X4 projectionMat;
+	Frustum frustum;
 
 	float fov;
 	float nearClipDist;
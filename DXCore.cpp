@@ -1,5 +1,9 @@
 #include "DXCore.h"
+#include "Helpers.h"
 #include "Input.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include "TransformStore.h"
 
 #include "ImGui/imgui.h"
 #include "ImGui/imgui_impl_dx11.h"
@@ -49,12 +53,15 @@ DXCore::DXCore(
 	dxFeatureLevel(D3D_FEATURE_LEVEL_11_0),
 	fpsTimeElapsed(0),
 	fpsFrameCount(0),
+	fpsTickCount(0),
 	previousTime(0),
 	currentTime(0),
 	hasFocus(true),
 	deltaTime(0),
 	startTime(0),
 	totalTime(0),
+	drawDeltaTime(0),
+	drawTotalTime(0),
 	hWnd(0)
 {
 	// Save a static reference to this object.
@@ -67,6 +74,11 @@ DXCore::DXCore(
 	__int64 perfFreq = 0;
 	QueryPerformanceFrequency((LARGE_INTEGER*)&perfFreq);
 	perfCounterSeconds = 1.0 / (double)perfFreq;
+
+	// Jobs that need the immediate context run on this thread,
+	// which owns it, whichever thread first used the job system
+	JobSystem::GetDefault().SetMainThread();
+	Profiler::SetThreadName("Main");
 }
 
 // --------------------------------------------------------
@@ -413,10 +425,54 @@ HRESULT DXCore::Run()
 
 			// Update the input manager
 			Input::GetInstance().Update();
-
-			// The game loop
-			Update(deltaTime, totalTime);
-			Draw(deltaTime, totalTime);
+			BeginFrame();
+
+			// The game loop, with this frame's simulation possibly
+			// running alongside drawing the last one.  Messages are
+			// only handled between frames, when neither is running.
+			framePipeline.RunFrame(
+				[&]()
+				{
+					// Catch the simulation up to now in fixed steps, then
+					// draw transforms between the last two
+					TransformStore& transforms = TransformStore::GetDefault();
+					fixedTimestep.BeginFrame(deltaTime);
+					while (fixedTimestep.Tick())
+					{
+						PROFILE_SCOPE("FixedUpdate");
+						transforms.BeginTick();
+						FixedUpdate(fixedTimestep.GetTickSeconds(), (float)fixedTimestep.GetSimulationTime());
+						transforms.EndTick();
+					}
+					transforms.SetInterpolation(fixedTimestep.GetAlpha());
+
+					PROFILE_SCOPE("Update");
+					Update(deltaTime, totalTime);
+				},
+				[&]()
+				{
+					PublishFrame();
+					drawDeltaTime = deltaTime;
+					drawTotalTime = totalTime;
+				},
+				[&]()
+				{
+					PROFILE_SCOPE("Draw");
+					Draw(drawDeltaTime, drawTotalTime);
+				});
+
+			// Jobs that needed the context, now nothing else is using it
+			JobSystem::GetDefault().RunMainThreadJobs();
+
+			// Everything timed this frame, from every thread
+			Profiler::GetDefault().EndFrame();
+
+			// The first frame's delta includes Init(), so leave it out
+			if (fixedTimestep.GetFrameCount() > 1)
+			{
+				const FramePipelineStats& stages = framePipeline.GetStats();
+				frameTelemetry.AddFrame(deltaTime * 1000.0f, stages.Update, stages.Draw);
+			}
 
 			// Frame is over, notify the input manager
 			Input::GetInstance().EndOfFrame();
@@ -425,6 +481,7 @@ HRESULT DXCore::Run()
 
 	// We'll end up here once we get a WM_QUIT message,
 	// which usually comes from the user closing the window
+	frameTelemetry.SaveCsv(FixPath(L"frame_telemetry.csv"));
 	return (HRESULT)msg.wParam;
 }
 
@@ -489,7 +546,8 @@ void DXCore::UpdateTitleBarStats()
 		"    Width: "		<< windowWidth <<
 		"    Height: "		<< windowHeight <<
 		"    FPS: "			<< fpsFrameCount <<
-		"    Frame Time: "	<< mspf << "ms";
+		"    Frame Time: "	<< mspf << "ms" <<
+		"    Ticks/s: "		<< fixedTimestep.GetTickCount() - fpsTickCount;
 
 	// Append the version of Direct3D the app is using
 	switch (dxFeatureLevel)
@@ -507,6 +565,7 @@ void DXCore::UpdateTitleBarStats()
 	// Actually update the title bar and reset fps data
 	SetWindowText(hWnd, output.str().c_str());
 	fpsFrameCount = 0;
+	fpsTickCount = fixedTimestep.GetTickCount();
 	fpsTimeElapsed += 1.0f;
 }
 
@@ -5,6 +5,10 @@
 #include <string>
 #include <wrl/client.h> // Used for ComPtr - a smart pointer for COM objects
 
+#include "FixedTimestep.h"
+#include "FramePipeline.h"
+#include "FrameTelemetry.h"
+
 // We can include the correct library files here
 // instead of in Visual Studio settings if we want
 #pragma comment(lib, "d3d11.lib")
@@ -45,6 +49,22 @@ public:
 	virtual void Update(float deltaTime, float totalTime) = 0;
 	virtual void Draw(float deltaTime, float totalTime) = 0;
 
+	// Runs at the fixed tick rate (zero or more times a frame,
+	// before Update), with the tick's length and the simulated
+	// time it ends at.  Transforms it changes are drawn
+	// interpolated between ticks.
+	virtual void FixedUpdate(float tickSeconds, float simulationTime) {}
+
+	// Hands the frame Update() just built over to Draw(), with
+	// neither running.  Update() and Draw() can run at the same
+	// time on different threads (see FramePipeline), so Draw()
+	// should only read what's been published.
+	virtual void PublishFrame() {}
+
+	// Runs on this (the window's) thread before each frame, for
+	// anything that can't be done from Update()'s thread
+	virtual void BeginFrame() {}
+
 protected:
 	HINSTANCE		hInstance;		// The handle to the application
 	HWND			hWnd;			// The handle to the window itself
@@ -72,6 +92,15 @@ protected:
 	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> backBufferRTV;
 	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> depthBufferDSV;
 
+	// Tick rate, catch-up limit & tick/frame counters for FixedUpdate()
+	FixedTimestep fixedTimestep;
+
+	// Runs Update() alongside Draw() for the frame before (on by default)
+	FramePipeline framePipeline;
+
+	// Frame time percentiles & hitches, saved as CSV on exit
+	FrameTelemetry frameTelemetry;
+
 	// Helper function for allocating a console window
 	void CreateConsoleWindow(int bufferLines, int bufferColumns, int windowLines, int windowColumns);
 
@@ -84,9 +113,15 @@ private:
 	__int64 currentTime;
 	__int64 previousTime;
 
+	// The times of the frame Draw() is drawing, which lags a
+	// frame behind while pipelining
+	float drawDeltaTime;
+	float drawTotalTime;
+
 	// FPS calculation
 	int fpsFrameCount;
 	float fpsTimeElapsed;
+	unsigned long long fpsTickCount;	// Ticks run as of the last title bar update
 
 	void UpdateTimer();			// Updates the timer for this frame
 	void UpdateTitleBarStats();	// Puts debug info in the title bar
@@ -0,0 +1,78 @@
+#include "FixedTimestep.h"
+
+#include <algorithm>
+#include <cmath>
+
+FixedTimestep::FixedTimestep(float ticksPerSecond, unsigned int maxTicksPerFrame) :
+	tickSeconds(1.0 / 60.0),
+	maxTicksPerFrame(8),
+	accumulator(0),
+	simulationTime(0),
+	tickCount(0),
+	frameCount(0),
+	skippedTickCount(0),
+	ticksThisFrame(0)
+{
+	SetTickRate(ticksPerSecond);
+	SetMaxTicksPerFrame(maxTicksPerFrame);
+}
+
+void FixedTimestep::SetTickRate(float ticksPerSecond)
+{
+	if (ticksPerSecond > 0.0f)
+		tickSeconds = 1.0 / ticksPerSecond;
+}
+
+void FixedTimestep::SetMaxTicksPerFrame(unsigned int maxTicksPerFrame)
+{
+	this->maxTicksPerFrame = (std::max)(1u, maxTicksPerFrame);
+}
+
+float FixedTimestep::GetTickRate() { return (float)(1.0 / tickSeconds); }
+float FixedTimestep::GetTickSeconds() { return (float)tickSeconds; }
+unsigned int FixedTimestep::GetMaxTicksPerFrame() { return maxTicksPerFrame; }
+
+void FixedTimestep::BeginFrame(double frameSeconds)
+{
+	// A clock that steps backwards adds nothing
+	accumulator += (std::max)(0.0, frameSeconds);
+	ticksThisFrame = 0;
+	frameCount++;
+}
+
+// --------------------------------------------------------
+// Uses up a tick's worth of the frame's time if there's
+// enough left, and this frame hasn't run out of ticks
+// --------------------------------------------------------
+bool FixedTimestep::Tick()
+{
+	if (accumulator < tickSeconds)
+		return false;
+
+	if (ticksThisFrame >= maxTicksPerFrame)
+	{
+		// Drop whole ticks, but keep the fraction so alpha still moves smoothly
+		double dropped = std::floor(accumulator / tickSeconds);
+		skippedTickCount += (unsigned long long)dropped;
+		accumulator -= dropped * tickSeconds;
+		return false;
+	}
+
+	accumulator -= tickSeconds;
+	simulationTime += tickSeconds;
+	ticksThisFrame++;
+	tickCount++;
+	return true;
+}
+
+float FixedTimestep::GetAlpha()
+{
+	return (float)(std::min)(1.0, accumulator / tickSeconds);
+}
+
+double FixedTimestep::GetSimulationTime() { return simulationTime; }
+
+unsigned long long FixedTimestep::GetTickCount() { return tickCount; }
+unsigned long long FixedTimestep::GetFrameCount() { return frameCount; }
+unsigned long long FixedTimestep::GetSkippedTickCount() { return skippedTickCount; }
+unsigned int FixedTimestep::GetTicksThisFrame() { return ticksThisFrame; }
@@ -0,0 +1,54 @@
+#pragma once
+
+// --------------------------------------------------------
+// Schedules fixed size simulation steps ("ticks") from
+// frames of any length
+//
+// Each frame, BeginFrame() with how long it took, then
+// Tick() until it says to stop, running one step of the
+// simulation each time it returns true.  Time not yet big
+// enough for a whole tick carries over to the next frame,
+// and GetAlpha() says how far the frame is between the last
+// two ticks, for drawing things in between.
+//
+// A frame can run at most maxTicksPerFrame ticks.  After a
+// long stall the rest are dropped (and counted) instead, so
+// a slow frame can't leave the next one even further behind.
+// The dropped time is lost for good: the simulation falls
+// that far behind real time and never makes it up.
+// --------------------------------------------------------
+class FixedTimestep
+{
+public:
+	FixedTimestep(float ticksPerSecond = 60.0f, unsigned int maxTicksPerFrame = 8);
+
+	void SetTickRate(float ticksPerSecond);
+	void SetMaxTicksPerFrame(unsigned int maxTicksPerFrame);
+	float GetTickRate();
+	float GetTickSeconds();				// 1 / tick rate
+	unsigned int GetMaxTicksPerFrame();
+
+	void BeginFrame(double frameSeconds);
+	bool Tick();
+
+	float GetAlpha();					// 0 - 1, from the last tick but one to the last
+	double GetSimulationTime();			// As of the last tick
+
+	// Counters, for profiling
+	unsigned long long GetTickCount();	// Ticks run so far
+	unsigned long long GetFrameCount();
+	unsigned long long GetSkippedTickCount();	// Dropped after stalls
+	unsigned int GetTicksThisFrame();
+
+private:
+	double tickSeconds;
+	unsigned int maxTicksPerFrame;
+
+	double accumulator;		// Time not yet simulated
+	double simulationTime;
+
+	unsigned long long tickCount;
+	unsigned long long frameCount;
+	unsigned long long skippedTickCount;
+	unsigned int ticksThisFrame;
+};
@@ -0,0 +1,26 @@
+#include "FramePipeline.h"
+#include "Profiler.h"
+
+FramePipeline::FramePipeline() :
+	simulationThread(1, []() { Profiler::SetThreadName("Simulation"); }),
+	pipelined(true),
+	hasPublished(false),
+	stats()
+{
+}
+
+void FramePipeline::SetPipelined(bool pipelined)
+{
+	this->pipelined = pipelined;
+}
+
+bool FramePipeline::IsPipelined() { return pipelined; }
+
+unsigned int FramePipeline::GetLatency() { return pipelined ? 1 : 0; }
+
+const FramePipelineStats& FramePipeline::GetStats() { return stats; }
+
+float FramePipeline::MillisecondsSince(Clock::time_point start)
+{
+	return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+
+// How long the last frame's stages took, in milliseconds
+struct FramePipelineStats
+{
+	float Update;
+	float Draw;
+	float Frame;		// The whole of RunFrame()
+	bool Pipelined;		// Whether the stages overlapped
+};
+
+// --------------------------------------------------------
+// Overlaps each frame's update with drawing the frame
+// before it
+//
+// Every frame, RunFrame() is given three stages:
+//  - update:  simulates a frame and builds what's needed to
+//             draw it (such as a RenderSnapshot) without
+//             touching anything draw reads
+//  - publish: hands the frame update just built over to
+//             draw; runs while neither of the others is
+//  - draw:    draws the frame last published
+//
+// Pipelined, update runs on the simulation thread while this
+// one draws the previous frame, so a frame takes about as
+// long as the slower stage rather than both, and is shown a
+// frame later than it would be otherwise.  Not pipelined (or
+// before anything has been published) the stages just run in
+// order on this thread.
+//
+// update always runs on the same simulation thread while
+// pipelining, so anything it keeps per thread stays put.
+// --------------------------------------------------------
+class FramePipeline
+{
+public:
+	FramePipeline();
+
+	FramePipeline(const FramePipeline&) = delete;
+	FramePipeline& operator=(const FramePipeline&) = delete;
+
+	// Takes effect from the next frame, so it's safe to call from update
+	void SetPipelined(bool pipelined);
+	bool IsPipelined();
+
+	// Frames between one being updated and it being drawn (0 or 1)
+	unsigned int GetLatency();
+
+	const FramePipelineStats& GetStats();
+
+	template<typename Update, typename Publish, typename Draw>
+	void RunFrame(Update update, Publish publish, Draw draw)
+	{
+		Clock::time_point frameStart = Clock::now();
+		float updateTime = 0.0f;
+		float drawTime = 0.0f;
+		auto timedUpdate = [&]()
+		{
+			Clock::time_point start = Clock::now();
+			update();
+			updateTime = MillisecondsSince(start);
+		};
+
+		bool overlap = pipelined && hasPublished;
+		if (overlap)
+		{
+			std::future<void> simulation = simulationThread.Submit(timedUpdate);
+
+			// update uses this frame, so it can't be left (by
+			// throwing) until update has finished
+			Clock::time_point start = Clock::now();
+			try
+			{
+				draw();
+			}
+			catch (...)
+			{
+				simulation.wait();
+				throw;
+			}
+			drawTime = MillisecondsSince(start);
+
+			// Rethrows anything update threw
+			simulation.get();
+			publish();
+		}
+		else
+		{
+			timedUpdate();
+			publish();
+
+			Clock::time_point start = Clock::now();
+			draw();
+			drawTime = MillisecondsSince(start);
+		}
+		hasPublished = true;
+
+		stats.Update = updateTime;
+		stats.Draw = drawTime;
+		stats.Frame = MillisecondsSince(frameStart);
+		stats.Pipelined = overlap;
+	}
+
+private:
+	typedef std::chrono::high_resolution_clock Clock;
+
+	ThreadPool simulationThread;
+	std::atomic<bool> pipelined;
+	bool hasPublished;
+	FramePipelineStats stats;
+
+	static float MillisecondsSince(Clock::time_point start);
+};
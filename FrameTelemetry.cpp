@@ -0,0 +1,287 @@
+#include "FrameTelemetry.h"
+#include "Helpers.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+const unsigned int FrameHistogram::BucketCount;
+const double FrameTelemetry::ReportedPercentiles[4] = { 50.0, 90.0, 99.0, 99.9 };
+
+namespace
+{
+	const char* phaseNames[] = { "Frame", "Update", "Draw", "Present" };
+
+	// Anything longer lands in the last bucket
+	const unsigned long long MaxMicroseconds = (1ull << 37) - 1;
+}
+
+FrameHistogram::FrameHistogram() :
+	counts(BucketCount, 0),
+	count(0),
+	sum(0.0),
+	max(0.0f)
+{
+}
+
+void FrameHistogram::Record(float milliseconds)
+{
+	counts[GetBucket(ToMicroseconds(milliseconds))]++;
+	count++;
+	sum += milliseconds;
+	max = (std::max)(max, milliseconds);
+}
+
+void FrameHistogram::Remove(float milliseconds)
+{
+	unsigned int& bucket = counts[GetBucket(ToMicroseconds(milliseconds))];
+	if (bucket == 0)
+		return;
+
+	bucket--;
+	count--;
+	sum -= milliseconds;
+	if (count == 0)
+	{
+		sum = 0.0;
+		max = 0.0f;
+	}
+}
+
+void FrameHistogram::Reset()
+{
+	std::fill(counts.begin(), counts.end(), 0u);
+	count = 0;
+	sum = 0.0;
+	max = 0.0f;
+}
+
+unsigned long long FrameHistogram::GetCount() const { return count; }
+
+float FrameHistogram::GetMean() const { return count > 0 ? (float)(sum / count) : 0.0f; }
+
+// --------------------------------------------------------
+// Walks the buckets until enough of the times are below,
+// reporting the top of the bucket it stops in (so it never
+// understates a percentile), but never more than the max
+// --------------------------------------------------------
+float FrameHistogram::GetPercentile(double percentile) const
+{
+	if (count == 0)
+		return 0.0f;
+
+	unsigned long long target = (unsigned long long)std::ceil(percentile / 100.0 * count);
+	target = (std::max)(1ull, (std::min)(target, count));
+
+	unsigned long long below = 0;
+	for (unsigned int bucket = 0; bucket < BucketCount; bucket++)
+	{
+		below += counts[bucket];
+		if (below >= target)
+			return (std::min)(GetBucketTop(bucket), max);
+	}
+	return max;
+}
+
+float FrameHistogram::GetMax() const
+{
+	for (unsigned int bucket = BucketCount; bucket > 0; bucket--)
+		if (counts[bucket - 1] > 0)
+			return (std::min)(GetBucketTop(bucket - 1), max);
+	return 0.0f;
+}
+
+// --------------------------------------------------------
+// One bucket per microsecond below 128, then 64 per power of
+// two, each a 64th of the power of two it's in
+// --------------------------------------------------------
+unsigned int FrameHistogram::GetBucket(unsigned long long microseconds)
+{
+	microseconds = (std::min)(microseconds, MaxMicroseconds);
+	if (microseconds < 128)
+		return (unsigned int)microseconds;
+
+	unsigned int power = 7;
+	while ((microseconds >> (power + 1)) != 0)
+		power++;
+
+	unsigned int sub = (unsigned int)(microseconds >> (power - 6)) - 64;
+	return 128 + (power - 7) * 64 + sub;
+}
+
+float FrameHistogram::GetBucketTop(unsigned int bucket)
+{
+	if (bucket < 128)
+		return bucket / 1000.0f;
+
+	unsigned int power = 7 + (bucket - 128) / 64;
+	unsigned long long sub = (bucket - 128) % 64;
+	unsigned long long width = 1ull << (power - 6);
+	return (float)(((64 + sub) * width + width - 1) / 1000.0);
+}
+
+unsigned long long FrameHistogram::ToMicroseconds(float milliseconds)
+{
+	if (!(milliseconds > 0.0f))
+		return 0;
+	return (unsigned long long)(milliseconds * 1000.0 + 0.5);
+}
+
+FrameTelemetry::FrameTelemetry(unsigned int windowFrames) :
+	windowFrames((std::max)(windowFrames, 1u)),
+	oldest(0),
+	presentTime(0.0f)
+{
+	// 30, 20 & 10 fps
+	SetHitchThresholds({ 1000.0f / 30.0f, 50.0f, 100.0f });
+}
+
+// --------------------------------------------------------
+// Adds a frame to the run & the window, pushing the oldest
+// out of the window once it's full
+// --------------------------------------------------------
+void FrameTelemetry::AddFrame(float frame, float update, float draw)
+{
+	FrameSample sample;
+	sample.Times[(int)FramePhase::Frame] = frame;
+	sample.Times[(int)FramePhase::Update] = update;
+	sample.Times[(int)FramePhase::Draw] = draw;
+	sample.Times[(int)FramePhase::Present] = presentTime;
+	presentTime = 0.0f;
+
+	if (recent.size() == windowFrames)
+	{
+		FrameSample& out = recent[oldest];
+		for (int phase = 0; phase < (int)FramePhase::Count; phase++)
+			window[phase].Remove(out.Times[phase]);
+		CountHitches(out.Times[(int)FramePhase::Frame], windowHitches, true);
+
+		out = sample;
+		oldest = (oldest + 1) % windowFrames;
+	}
+	else
+	{
+		recent.push_back(sample);
+	}
+
+	for (int phase = 0; phase < (int)FramePhase::Count; phase++)
+	{
+		window[phase].Record(sample.Times[phase]);
+		lifetime[phase].Record(sample.Times[phase]);
+	}
+	CountHitches(frame, windowHitches, false);
+	CountHitches(frame, lifetimeHitches, false);
+}
+
+void FrameTelemetry::SetPresentTime(float milliseconds) { presentTime = milliseconds; }
+
+void FrameTelemetry::SetWindowFrames(unsigned int windowFrames)
+{
+	this->windowFrames = (std::max)(windowFrames, 1u);
+	recent.clear();
+	oldest = 0;
+	for (FrameHistogram& histogram : window)
+		histogram.Reset();
+	std::fill(windowHitches.begin(), windowHitches.end(), 0ull);
+}
+
+unsigned int FrameTelemetry::GetWindowFrames() { return windowFrames; }
+
+void FrameTelemetry::SetHitchThresholds(const std::vector<float>& milliseconds)
+{
+	hitchThresholds = milliseconds;
+	lifetimeHitches.assign(hitchThresholds.size(), 0);
+
+	// The window's frames are all still here to count again
+	windowHitches.assign(hitchThresholds.size(), 0);
+	for (const FrameSample& sample : recent)
+		CountHitches(sample.Times[(int)FramePhase::Frame], windowHitches, false);
+}
+
+const std::vector<float>& FrameTelemetry::GetHitchThresholds() { return hitchThresholds; }
+
+const FrameHistogram& FrameTelemetry::GetWindow(FramePhase phase) { return window[(int)phase]; }
+
+const FrameHistogram& FrameTelemetry::GetLifetime(FramePhase phase) { return lifetime[(int)phase]; }
+
+unsigned long long FrameTelemetry::GetWindowHitches(unsigned int threshold)
+{
+	return threshold < windowHitches.size() ? windowHitches[threshold] : 0;
+}
+
+unsigned long long FrameTelemetry::GetLifetimeHitches(unsigned int threshold)
+{
+	return threshold < lifetimeHitches.size() ? lifetimeHitches[threshold] : 0;
+}
+
+void FrameTelemetry::Reset()
+{
+	SetWindowFrames(windowFrames);
+	for (FrameHistogram& histogram : lifetime)
+		histogram.Reset();
+	std::fill(lifetimeHitches.begin(), lifetimeHitches.end(), 0ull);
+}
+
+// --------------------------------------------------------
+// One row per phase for the window and for the run, in
+// milliseconds, with hitch counts on the Frame rows, so runs
+// can be compared line by line
+// --------------------------------------------------------
+bool FrameTelemetry::SaveCsv(const std::wstring& filename)
+{
+	FILE* file = OpenForWriting(filename);
+	if (!file)
+		return false;
+
+	fprintf(file, "scope,phase,frames,mean_ms");
+	for (double percentile : ReportedPercentiles)
+		fprintf(file, ",p%g_ms", percentile);
+	fprintf(file, ",max_ms");
+	for (float threshold : hitchThresholds)
+		fprintf(file, ",hitches_over_%g_ms", threshold);
+	fprintf(file, "\n");
+
+	for (int scope = 0; scope < 2; scope++)
+	{
+		const FrameHistogram* histograms = scope == 0 ? window : lifetime;
+		const std::vector<unsigned long long>& hitches = scope == 0 ? windowHitches : lifetimeHitches;
+		for (int phase = 0; phase < (int)FramePhase::Count; phase++)
+		{
+			const FrameHistogram& histogram = histograms[phase];
+			fprintf(file, "%s,%s,%llu,%.3f",
+				scope == 0 ? "window" : "lifetime",
+				phaseNames[phase],
+				histogram.GetCount(),
+				histogram.GetMean());
+			for (double percentile : ReportedPercentiles)
+				fprintf(file, ",%.3f", histogram.GetPercentile(percentile));
+			fprintf(file, ",%.3f", histogram.GetMax());
+			for (unsigned long long hitchCount : hitches)
+			{
+				if (phase == (int)FramePhase::Frame)
+					fprintf(file, ",%llu", hitchCount);
+				else
+					fprintf(file, ",");
+			}
+			fprintf(file, "\n");
+		}
+	}
+
+	bool written = ferror(file) == 0;
+	fclose(file);
+	return written;
+}
+
+void FrameTelemetry::CountHitches(float frame, std::vector<unsigned long long>& hitches, bool remove)
+{
+	for (size_t i = 0; i < hitchThresholds.size(); i++)
+	{
+		if (frame > hitchThresholds[i])
+		{
+			if (remove)
+				hitches[i]--;
+			else
+				hitches[i]++;
+		}
+	}
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// A histogram of times with log sized buckets (like an HDR
+// histogram): exact below 128 microseconds, then 64 buckets
+// per power of two, so any percentile is within about 1.6%
+// of the real value from a microsecond to over a day, in a
+// fixed 16 KB
+//
+// Values can be removed again, for a rolling window.
+// --------------------------------------------------------
+class FrameHistogram
+{
+public:
+	FrameHistogram();
+
+	void Record(float milliseconds);
+	void Remove(float milliseconds);	// One that was recorded before
+	void Reset();
+
+	unsigned long long GetCount() const;
+	float GetMean() const;
+
+	// The smallest time at least this percentage (0 - 100) of
+	// the recorded times are at or below, or 0 if there are none
+	float GetPercentile(double percentile) const;
+
+	// The largest time recorded, or (once any have been removed)
+	// the largest left, to the precision of a bucket
+	float GetMax() const;
+
+	static const unsigned int BucketCount = 128 + 30 * 64;
+
+private:
+	std::vector<unsigned int> counts;
+	unsigned long long count;
+	double sum;
+	float max;		// Of every time recorded, removed or not
+
+	static unsigned int GetBucket(unsigned long long microseconds);
+	static float GetBucketTop(unsigned int bucket);	// In milliseconds
+	static unsigned long long ToMicroseconds(float milliseconds);
+};
+
+// The parts of a frame that are timed
+enum class FramePhase
+{
+	Frame,		// From one frame starting to the next
+	Update,
+	Draw,
+	Present,	// Part of draw
+	Count
+};
+
+// One frame's times, in milliseconds
+struct FrameSample
+{
+	float Times[(int)FramePhase::Count];
+};
+
+// --------------------------------------------------------
+// Frame time statistics: percentiles and hitches, over the
+// last so many frames and over the whole run
+//
+// An average hides the occasional slow frame that makes a
+// game feel like it stutters, so every phase of every frame
+// goes into a histogram instead, and frames over each of a
+// set of thresholds are counted as hitches.
+//
+// Add a frame each time one ends.  Present is usually timed
+// inside drawing, so it can be handed over ahead of time with
+// SetPresentTime(); it's used by the next AddFrame().
+// --------------------------------------------------------
+class FrameTelemetry
+{
+public:
+	FrameTelemetry(unsigned int windowFrames = 1000);
+
+	void AddFrame(float frame, float update, float draw);
+	void SetPresentTime(float milliseconds);
+
+	// Starts the window (& its hitches) over
+	void SetWindowFrames(unsigned int windowFrames);
+	unsigned int GetWindowFrames();
+
+	// Frames longer than these (in milliseconds) are hitches.
+	// The window's are recounted; the run's start over.
+	void SetHitchThresholds(const std::vector<float>& milliseconds);
+	const std::vector<float>& GetHitchThresholds();
+
+	// Over the window, or every frame since the last Reset()
+	const FrameHistogram& GetWindow(FramePhase phase);
+	const FrameHistogram& GetLifetime(FramePhase phase);
+	unsigned long long GetWindowHitches(unsigned int threshold);
+	unsigned long long GetLifetimeHitches(unsigned int threshold);
+
+	// Starts both over (but keeps a Present time already set
+	// for the frame in progress)
+	void Reset();
+
+	// Every phase's percentiles & hitch counts, for the window
+	// and the run, as CSV
+	bool SaveCsv(const std::wstring& filename);
+
+	// The percentiles reported in the CSV (and anywhere else
+	// that wants the usual set)
+	static const double ReportedPercentiles[4];
+
+private:
+	FrameHistogram window[(int)FramePhase::Count];
+	FrameHistogram lifetime[(int)FramePhase::Count];
+
+	// The frames in the window, oldest first from "oldest"
+	std::vector<FrameSample> recent;
+	unsigned int windowFrames;
+	unsigned int oldest;
+
+	std::vector<float> hitchThresholds;
+	std::vector<unsigned long long> windowHitches;
+	std::vector<unsigned long long> lifetimeHitches;
+
+	float presentTime;
+
+	void CountHitches(float frame, std::vector<unsigned long long>& hitches, bool remove);
+};
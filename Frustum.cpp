@@ -0,0 +1,52 @@
+#include "Frustum.h"
+
+#include <cmath>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// DirectX uses row vectors (clip = p * M), so each clip
+// space inequality is a combination of the matrix columns.
+// Depth runs from 0 to 1, so the near plane is just z >= 0.
+// --------------------------------------------------------
+void ExtractFrustumPlanes(const XMFLOAT4X4& m, Frustum& frustum)
+{
+	XMFLOAT4 column1(m._11, m._21, m._31, m._41);
+	XMFLOAT4 column2(m._12, m._22, m._32, m._42);
+	XMFLOAT4 column3(m._13, m._23, m._33, m._43);
+	XMFLOAT4 column4(m._14, m._24, m._34, m._44);
+
+	XMFLOAT4* planes = frustum.Planes;
+	planes[Frustum::Left] = XMFLOAT4(column4.x + column1.x, column4.y + column1.y, column4.z + column1.z, column4.w + column1.w);
+	planes[Frustum::Right] = XMFLOAT4(column4.x - column1.x, column4.y - column1.y, column4.z - column1.z, column4.w - column1.w);
+	planes[Frustum::Bottom] = XMFLOAT4(column4.x + column2.x, column4.y + column2.y, column4.z + column2.z, column4.w + column2.w);
+	planes[Frustum::Top] = XMFLOAT4(column4.x - column2.x, column4.y - column2.y, column4.z - column2.z, column4.w - column2.w);
+	planes[Frustum::Near] = column3;
+	planes[Frustum::Far] = XMFLOAT4(column4.x - column3.x, column4.y - column3.y, column4.z - column3.z, column4.w - column3.w);
+
+	// Normalize, so plane equations give real distances
+	for (int i = 0; i < Frustum::SideCount; i++)
+	{
+		XMFLOAT4& p = planes[i];
+		float length = std::sqrt(p.x * p.x + p.y * p.y + p.z * p.z);
+		if (length > 0.0f)
+		{
+			p.x /= length;
+			p.y /= length;
+			p.z /= length;
+			p.w /= length;
+		}
+	}
+}
+
+bool FrustumIntersectsSphere(const Frustum& frustum, const XMFLOAT3& center, float radius)
+{
+	for (int i = 0; i < Frustum::SideCount; i++)
+	{
+		const XMFLOAT4& p = frustum.Planes[i];
+		if (p.x * center.x + p.y * center.y + p.z * center.z + p.w < -radius)
+			return false;
+	}
+
+	return true;
+}
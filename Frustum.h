@@ -0,0 +1,29 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+// --------------------------------------------------------
+// The six planes of a view frustum
+//
+// Each plane is (a, b, c, d) with a normalized (a, b, c)
+// pointing into the frustum, so for any point p inside,
+// a*p.x + b*p.y + c*p.z + d >= 0 for every plane.
+// --------------------------------------------------------
+struct Frustum
+{
+	enum Side { Left, Right, Bottom, Top, Near, Far, SideCount };
+
+	DirectX::XMFLOAT4 Planes[SideCount];
+};
+
+// --------------------------------------------------------
+// Pulls the planes straight out of a combined matrix
+// (Gribb & Hartmann).  With view * projection they're in
+// world space; with world * view * projection they're in
+// that object's own space.
+// --------------------------------------------------------
+void ExtractFrustumPlanes(const DirectX::XMFLOAT4X4& viewProjection, Frustum& frustum);
+
+// Is any part of the sphere inside the frustum?  (Conservative:
+// spheres just outside a corner can still count as inside)
+bool FrustumIntersectsSphere(const Frustum& frustum, const DirectX::XMFLOAT3& center, float radius);
@@ -0,0 +1,331 @@
+#include "FrustumCulling.h"
+
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CULL_SIMD_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC lets any function use any intrinsic, while GCC & Clang
+// need to be told which functions may use the newer ones
+#if defined(CULL_SIMD_X86) && !defined(_MSC_VER)
+#define CULL_TARGET(isa) __attribute__((target(isa)))
+#else
+#define CULL_TARGET(isa)
+#endif
+
+using namespace DirectX;
+
+void CullingBounds::Clear()
+{
+	SphereX.clear(); SphereY.clear(); SphereZ.clear(); SphereRadius.clear();
+	BoxX.clear(); BoxY.clear(); BoxZ.clear();
+	ExtentX.clear(); ExtentY.clear(); ExtentZ.clear();
+}
+
+void CullingBounds::Reserve(size_t count)
+{
+	SphereX.reserve(count); SphereY.reserve(count); SphereZ.reserve(count); SphereRadius.reserve(count);
+	BoxX.reserve(count); BoxY.reserve(count); BoxZ.reserve(count);
+	ExtentX.reserve(count); ExtentY.reserve(count); ExtentZ.reserve(count);
+}
+
+void CullingBounds::Add(const BoundingSphere& sphere, const BoundingBox& box)
+{
+	SphereX.push_back(sphere.Center.x);
+	SphereY.push_back(sphere.Center.y);
+	SphereZ.push_back(sphere.Center.z);
+	SphereRadius.push_back(sphere.Radius);
+	BoxX.push_back(box.Center.x);
+	BoxY.push_back(box.Center.y);
+	BoxZ.push_back(box.Center.z);
+	ExtentX.push_back(box.Extents.x);
+	ExtentY.push_back(box.Extents.y);
+	ExtentZ.push_back(box.Extents.z);
+}
+
+size_t CullingBounds::GetCount() const
+{
+	return SphereX.size();
+}
+
+namespace
+{
+	// --------------------------------------------------------
+	// The frustum's planes split into one array per value, plus
+	// the normals' absolute values for the box test
+	// --------------------------------------------------------
+	struct CullPlanes
+	{
+		float A[Frustum::SideCount], B[Frustum::SideCount], C[Frustum::SideCount], D[Frustum::SideCount];
+		float AbsA[Frustum::SideCount], AbsB[Frustum::SideCount], AbsC[Frustum::SideCount];
+
+		explicit CullPlanes(const Frustum& frustum)
+		{
+			for (int p = 0; p < Frustum::SideCount; p++)
+			{
+				const XMFLOAT4& plane = frustum.Planes[p];
+				A[p] = plane.x;
+				B[p] = plane.y;
+				C[p] = plane.z;
+				D[p] = plane.w;
+				AbsA[p] = std::fabs(plane.x);
+				AbsB[p] = std::fabs(plane.y);
+				AbsC[p] = std::fabs(plane.z);
+			}
+		}
+	};
+
+	// --------------------------------------------------------
+	// A sphere is outside a plane when its center is more than
+	// a radius behind it.  A box is outside when even its
+	// corner furthest along the normal is behind it: that
+	// corner is the center plus the extents, each signed to
+	// match the normal, which is the center's distance plus
+	// |normal| . extents.
+	//
+	// The SIMD kernels do exactly the same operations in the
+	// same order, so every kernel agrees on objects that just
+	// touch a plane.  Each visible index is written & the count
+	// only moved on if it was visible, so there's no branch.
+	// --------------------------------------------------------
+	size_t CullScalar(const CullPlanes& planes, const CullingBounds& bounds, size_t first, size_t last, unsigned int* visible)
+	{
+		const float* sx = bounds.SphereX.data();
+		const float* sy = bounds.SphereY.data();
+		const float* sz = bounds.SphereZ.data();
+		const float* sr = bounds.SphereRadius.data();
+		const float* bx = bounds.BoxX.data();
+		const float* by = bounds.BoxY.data();
+		const float* bz = bounds.BoxZ.data();
+		const float* ex = bounds.ExtentX.data();
+		const float* ey = bounds.ExtentY.data();
+		const float* ez = bounds.ExtentZ.data();
+
+		size_t count = 0;
+		for (size_t i = first; i < last; i++)
+		{
+			float negativeRadius = -sr[i];
+			bool inside = true;
+			for (int p = 0; p < Frustum::SideCount; p++)
+			{
+				float sphereDistance = planes.A[p] * sx[i] + planes.B[p] * sy[i] + planes.C[p] * sz[i] + planes.D[p];
+				float boxDistance =
+					planes.A[p] * bx[i] + planes.B[p] * by[i] + planes.C[p] * bz[i] + planes.D[p] +
+					planes.AbsA[p] * ex[i] + planes.AbsB[p] * ey[i] + planes.AbsC[p] * ez[i];
+				inside &= (sphereDistance >= negativeRadius) & (boxDistance >= 0.0f);
+			}
+
+			visible[count] = (unsigned int)i;
+			count += inside;
+		}
+		return count;
+	}
+
+#if defined(CULL_SIMD_X86)
+	// --------------------------------------------------------
+	// SSE: four objects at a time, one per lane
+	// --------------------------------------------------------
+	CULL_TARGET("sse2")
+	size_t CullSSE(const CullPlanes& planes, const CullingBounds& bounds, size_t first, size_t last, unsigned int* visible)
+	{
+		const float* sx = bounds.SphereX.data();
+		const float* sy = bounds.SphereY.data();
+		const float* sz = bounds.SphereZ.data();
+		const float* sr = bounds.SphereRadius.data();
+		const float* bx = bounds.BoxX.data();
+		const float* by = bounds.BoxY.data();
+		const float* bz = bounds.BoxZ.data();
+		const float* ex = bounds.ExtentX.data();
+		const float* ey = bounds.ExtentY.data();
+		const float* ez = bounds.ExtentZ.data();
+
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 signBit = _mm_set1_ps(-0.0f);
+
+		size_t count = 0;
+		for (size_t i = first; i + 4 <= last; i += 4)
+		{
+			__m128 sphereX = _mm_loadu_ps(sx + i);
+			__m128 sphereY = _mm_loadu_ps(sy + i);
+			__m128 sphereZ = _mm_loadu_ps(sz + i);
+			__m128 negativeRadius = _mm_xor_ps(_mm_loadu_ps(sr + i), signBit);
+			__m128 boxX = _mm_loadu_ps(bx + i);
+			__m128 boxY = _mm_loadu_ps(by + i);
+			__m128 boxZ = _mm_loadu_ps(bz + i);
+			__m128 extentX = _mm_loadu_ps(ex + i);
+			__m128 extentY = _mm_loadu_ps(ey + i);
+			__m128 extentZ = _mm_loadu_ps(ez + i);
+
+			__m128 inside = _mm_cmpeq_ps(zero, zero);
+			for (int p = 0; p < Frustum::SideCount; p++)
+			{
+				__m128 a = _mm_set1_ps(planes.A[p]);
+				__m128 b = _mm_set1_ps(planes.B[p]);
+				__m128 c = _mm_set1_ps(planes.C[p]);
+				__m128 d = _mm_set1_ps(planes.D[p]);
+
+				__m128 sphereDistance = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(a, sphereX), _mm_mul_ps(b, sphereY)), _mm_mul_ps(c, sphereZ)), d);
+				__m128 boxDistance = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(a, boxX), _mm_mul_ps(b, boxY)), _mm_mul_ps(c, boxZ)), d);
+				boxDistance = _mm_add_ps(boxDistance, _mm_mul_ps(_mm_set1_ps(planes.AbsA[p]), extentX));
+				boxDistance = _mm_add_ps(boxDistance, _mm_mul_ps(_mm_set1_ps(planes.AbsB[p]), extentY));
+				boxDistance = _mm_add_ps(boxDistance, _mm_mul_ps(_mm_set1_ps(planes.AbsC[p]), extentZ));
+
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(sphereDistance, negativeRadius));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(boxDistance, zero));
+			}
+
+			int mask = _mm_movemask_ps(inside);
+			for (int lane = 0; lane < 4; lane++)
+			{
+				visible[count] = (unsigned int)(i + lane);
+				count += (mask >> lane) & 1;
+			}
+		}
+		return count;
+	}
+
+	// --------------------------------------------------------
+	// AVX: eight objects at a time.  Only AVX's wider float math
+	// is needed, not AVX2's integer instructions.
+	// --------------------------------------------------------
+	CULL_TARGET("avx")
+	size_t CullAVX(const CullPlanes& planes, const CullingBounds& bounds, size_t first, size_t last, unsigned int* visible)
+	{
+		const float* sx = bounds.SphereX.data();
+		const float* sy = bounds.SphereY.data();
+		const float* sz = bounds.SphereZ.data();
+		const float* sr = bounds.SphereRadius.data();
+		const float* bx = bounds.BoxX.data();
+		const float* by = bounds.BoxY.data();
+		const float* bz = bounds.BoxZ.data();
+		const float* ex = bounds.ExtentX.data();
+		const float* ey = bounds.ExtentY.data();
+		const float* ez = bounds.ExtentZ.data();
+
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 signBit = _mm256_set1_ps(-0.0f);
+
+		size_t count = 0;
+		for (size_t i = first; i + 8 <= last; i += 8)
+		{
+			__m256 sphereX = _mm256_loadu_ps(sx + i);
+			__m256 sphereY = _mm256_loadu_ps(sy + i);
+			__m256 sphereZ = _mm256_loadu_ps(sz + i);
+			__m256 negativeRadius = _mm256_xor_ps(_mm256_loadu_ps(sr + i), signBit);
+			__m256 boxX = _mm256_loadu_ps(bx + i);
+			__m256 boxY = _mm256_loadu_ps(by + i);
+			__m256 boxZ = _mm256_loadu_ps(bz + i);
+			__m256 extentX = _mm256_loadu_ps(ex + i);
+			__m256 extentY = _mm256_loadu_ps(ey + i);
+			__m256 extentZ = _mm256_loadu_ps(ez + i);
+
+			__m256 inside = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+			for (int p = 0; p < Frustum::SideCount; p++)
+			{
+				__m256 a = _mm256_broadcast_ss(&planes.A[p]);
+				__m256 b = _mm256_broadcast_ss(&planes.B[p]);
+				__m256 c = _mm256_broadcast_ss(&planes.C[p]);
+				__m256 d = _mm256_broadcast_ss(&planes.D[p]);
+
+				__m256 sphereDistance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+					_mm256_mul_ps(a, sphereX), _mm256_mul_ps(b, sphereY)), _mm256_mul_ps(c, sphereZ)), d);
+				__m256 boxDistance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+					_mm256_mul_ps(a, boxX), _mm256_mul_ps(b, boxY)), _mm256_mul_ps(c, boxZ)), d);
+				boxDistance = _mm256_add_ps(boxDistance, _mm256_mul_ps(_mm256_broadcast_ss(&planes.AbsA[p]), extentX));
+				boxDistance = _mm256_add_ps(boxDistance, _mm256_mul_ps(_mm256_broadcast_ss(&planes.AbsB[p]), extentY));
+				boxDistance = _mm256_add_ps(boxDistance, _mm256_mul_ps(_mm256_broadcast_ss(&planes.AbsC[p]), extentZ));
+
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(sphereDistance, negativeRadius, _CMP_GE_OQ));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(boxDistance, zero, _CMP_GE_OQ));
+			}
+
+			int mask = _mm256_movemask_ps(inside);
+			for (int lane = 0; lane < 8; lane++)
+			{
+				visible[count] = (unsigned int)(i + lane);
+				count += (mask >> lane) & 1;
+			}
+		}
+		return count;
+	}
+#endif
+
+	CullKernel DetectCullKernel()
+	{
+#if !defined(CULL_SIMD_X86)
+		return CullKernel::Scalar;
+#else
+		bool sse = false;
+		bool avx = false;
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 1);
+		sse = (info[3] & (1 << 26)) != 0;
+
+		// AVX also needs the OS to save the upper halves of the registers
+		avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+#else
+		__builtin_cpu_init();
+		sse = __builtin_cpu_supports("sse2") != 0;
+		avx = __builtin_cpu_supports("avx") != 0;
+#endif
+		if (avx)
+			return CullKernel::AVX;
+		if (sse)
+			return CullKernel::SSE;
+		return CullKernel::Scalar;
+#endif
+	}
+}
+
+CullKernel GetBestCullKernel()
+{
+	static const CullKernel best = DetectCullKernel();
+	return best;
+}
+
+CullKernel CullBounds(
+	const Frustum& frustum,
+	const CullingBounds& bounds,
+	std::vector<unsigned int>& visible,
+	CullKernel kernel)
+{
+	// Falls back to whatever this CPU can actually run
+	CullKernel best = GetBestCullKernel();
+	if (kernel == CullKernel::Auto || (int)kernel > (int)best)
+		kernel = best;
+
+	// Room for everything to be visible, trimmed afterwards
+	size_t count = bounds.GetCount();
+	visible.resize(count);
+	if (count == 0)
+		return kernel;
+
+	CullPlanes planes(frustum);
+	unsigned int* out = visible.data();
+	size_t done = 0;
+	size_t visibleCount = 0;
+#if defined(CULL_SIMD_X86)
+	if (kernel == CullKernel::AVX)
+	{
+		done = count & ~(size_t)7;
+		visibleCount = CullAVX(planes, bounds, 0, done, out);
+	}
+	else if (kernel == CullKernel::SSE)
+	{
+		done = count & ~(size_t)3;
+		visibleCount = CullSSE(planes, bounds, 0, done, out);
+	}
+#endif
+	visibleCount += CullScalar(planes, bounds, done, count, out + visibleCount);
+
+	visible.resize(visibleCount);
+	return kernel;
+}
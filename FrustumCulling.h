@@ -0,0 +1,58 @@
+#pragma once
+
+#include <DirectXCollision.h>
+#include <cstddef>
+#include <vector>
+
+#include "Frustum.h"
+
+// --------------------------------------------------------
+// The world space bounds of many objects, for culling them
+// all at once
+//
+// Every value has its own array, so the SIMD kernels load
+// the same value for several objects in one go.  An object
+// is visible when both its sphere and its box touch the
+// frustum: whichever fits the object more tightly decides.
+// --------------------------------------------------------
+struct CullingBounds
+{
+	std::vector<float> SphereX, SphereY, SphereZ, SphereRadius;
+	std::vector<float> BoxX, BoxY, BoxZ;
+	std::vector<float> ExtentX, ExtentY, ExtentZ;
+
+	void Clear();
+	void Reserve(size_t count);
+	void Add(const DirectX::BoundingSphere& sphere, const DirectX::BoundingBox& box);
+	size_t GetCount() const;
+};
+
+// --------------------------------------------------------
+// Instruction sets the culling kernel can use
+// --------------------------------------------------------
+enum class CullKernel
+{
+	Auto,	// The best one this CPU supports
+	Scalar,
+	SSE,	// 4 objects at a time
+	AVX		// 8 at a time
+};
+
+// The kernel Auto picks on this CPU
+CullKernel GetBestCullKernel();
+
+// --------------------------------------------------------
+// Fills "visible" with the index of every object whose
+// bounds touch the frustum, in increasing order.  Like
+// FrustumIntersectsSphere(), bounds just outside a corner
+// can still count as visible.
+//
+// Every kernel gives exactly the same list.  Returns the
+// kernel that was actually used, since the one asked for
+// may not be supported by this CPU.
+// --------------------------------------------------------
+CullKernel CullBounds(
+	const Frustum& frustum,
+	const CullingBounds& bounds,
+	std::vector<unsigned int>& visible,
+	CullKernel kernel = CullKernel::Auto);
@@ -3,21 +3,40 @@
 #include "Input.h"
 #include "Helpers.h"
 #include "Material.h"
+#include "Profiler.h"
 
 #include "ImGui/imgui.h"
 #include "ImGui/imgui_impl_dx11.h"
 #include "ImGui/imgui_impl_win32.h"
 
-#include "WICTextureLoader.h"
-
 // Needed for a helper function to load pre-compiled shader files
 #pragma comment(lib, "d3dcompiler.lib")
 #include <d3dcompiler.h>
 #include "BufferStructs.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
 // For the DirectX Math library
 using namespace DirectX;
 
+namespace
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+	float MillisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+	}
+
+	// Entities become occluders when their bounding sphere's radius
+	// is at least this fraction of their distance from the camera
+	const float MinOccluderSize = 0.1f;
+	const size_t MaxOccluders = 16;
+}
+
 // --------------------------------------------------------
 // Constructor
 //
@@ -33,7 +52,24 @@ Game::Game(HINSTANCE hInstance)
 		1280,				// Width of the window's client area
 		720,				// Height of the window's client area
 		false,				// Sync the framerate to the monitor refresh? (lock framerate)
-		true)				// Show extra stats (fps) in title bar?
+		true),				// Show extra stats (fps) in title bar?
+	inspectedEntityCount(0),
+	selectedEntity(-1),
+	selectedHit(),
+	lodPixelError(1.0f),
+	spinEntities(false),
+	meshletCulling(false),
+	frustumCulling(true),
+	occlusionCulling(true),
+	instancing(true),
+	instanceBufferCapacity(0),
+	drawCallCount(0),
+	drawnSnapshot(0),
+	launchTime(Clock::now()),
+	assetLoadTime(0.0f),
+	timeToFirstFrame(-1.0f),
+	assetThreadCount(0),
+	profilerTraceSaved(0)
 {
 #if defined(DEBUG) || defined(_DEBUG)
 	// Do we want a console window?  Probably only in debug mode
@@ -56,6 +92,10 @@ Game::~Game()
 	// Call Release() on any Direct3D objects made within this class
 	// - Note: this is unnecessary for D3D objects stored in ComPtrs
 
+	// The snapshots hold copies of ImGui's draw lists
+	snapshots[0].Clear();
+	snapshots[1].Clear();
+
 	ImGui_ImplDX11_Shutdown();
 	ImGui_ImplWin32_Shutdown();
 	ImGui::DestroyContext();
@@ -79,10 +119,23 @@ void Game::Init()
 	// geometry to draw and some simple camera matrices.
 	//  - You'll be expanding and/or replacing these later
 	InitLights();
-	LoadShaders();
 
-	CreateGeometry();
-	LoadTextures();
+	// Meshes & textures are read, parsed and decoded on worker threads
+	// (see AssetLoader.h) while this thread loads the shaders, and only
+	// their buffers & textures are made here once they're ready
+	Clock::time_point assetStart = Clock::now();
+	{
+		AssetLoader loader(device, context);
+		assetThreadCount = loader.GetThreadCount();
+
+		SceneAssets assets = RequestAssets(loader);
+		LoadShaders();
+		loader.Finish();
+
+		CreateGeometry(assets);
+		LoadTextures(assets);
+	}
+	assetLoadTime = MillisecondsSince(assetStart);
 	
 	// Set initial graphics API state
 	//  - These settings persist until we change them
@@ -156,9 +209,128 @@ void Game::LoadShaders()
 	vertexShader = std::make_shared<SimpleVertexShader>(device, context, FixPath(L"VertexShader.cso").c_str());
 	pixelShader = std::make_shared<SimplePixelShader>(device, context, FixPath(L"PixelShader.cso").c_str());
 	customPixelShader = std::make_shared<SimplePixelShader>(device, context, FixPath(L"CustomPS.cso").c_str());
+
+	// Reflection can only describe 32 bit inputs, so the packed
+	// vertex shader needs its input layout made by hand
+	// - Matches PackedVertex in VertexPacking.h
+	Microsoft::WRL::ComPtr<ID3DBlob> packedShaderBlob;
+	D3DReadFileToBlob(FixPath(L"PackedVertexShader.cso").c_str(), packedShaderBlob.GetAddressOf());
+
+	D3D11_INPUT_ELEMENT_DESC packedInputDesc[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	};
+
+	Microsoft::WRL::ComPtr<ID3D11InputLayout> packedInputLayout;
+	if (packedShaderBlob)
+	{
+		device->CreateInputLayout(
+			packedInputDesc,
+			ARRAYSIZE(packedInputDesc),
+			packedShaderBlob->GetBufferPointer(),
+			packedShaderBlob->GetBufferSize(),
+			packedInputLayout.GetAddressOf());
+	}
+	packedVertexShader = std::make_shared<SimpleVertexShader>(device, context, FixPath(L"PackedVertexShader.cso").c_str(), packedInputLayout, false);
+
+	// Reflection picks up the "_PER_INSTANCE" inputs on its own...
+	instancedVertexShader = std::make_shared<SimpleVertexShader>(device, context, FixPath(L"InstancedVertexShader.cso").c_str());
+
+	// ...but the packed version needs them added to its layout by hand
+	// - Slot 1 matches InstanceData in InstanceBatcher.h
+	Microsoft::WRL::ComPtr<ID3DBlob> packedInstancedShaderBlob;
+	D3DReadFileToBlob(FixPath(L"PackedInstancedVertexShader.cso").c_str(), packedInstancedShaderBlob.GetAddressOf());
+
+	D3D11_INPUT_ELEMENT_DESC packedInstancedInputDesc[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "WORLD_PER_INSTANCE", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD_PER_INSTANCE", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD_PER_INSTANCE", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD_PER_INSTANCE", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLDINVTRANSPOSE_PER_INSTANCE", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLDINVTRANSPOSE_PER_INSTANCE", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLDINVTRANSPOSE_PER_INSTANCE", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLDINVTRANSPOSE_PER_INSTANCE", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	};
+
+	Microsoft::WRL::ComPtr<ID3D11InputLayout> packedInstancedInputLayout;
+	if (packedInstancedShaderBlob)
+	{
+		device->CreateInputLayout(
+			packedInstancedInputDesc,
+			ARRAYSIZE(packedInstancedInputDesc),
+			packedInstancedShaderBlob->GetBufferPointer(),
+			packedInstancedShaderBlob->GetBufferSize(),
+			packedInstancedInputLayout.GetAddressOf());
+	}
+	packedInstancedVertexShader = std::make_shared<SimpleVertexShader>(device, context, FixPath(L"PackedInstancedVertexShader.cso").c_str(), packedInstancedInputLayout, true);
+}
+
+// --------------------------------------------------------
+// Asks the loader for every mesh & texture the scene uses,
+// all at once, so they load alongside each other
+// --------------------------------------------------------
+Game::SceneAssets Game::RequestAssets(AssetLoader& loader)
+{
+	// The sky draws the cube with its own shader, so it stays unpacked
+	MeshLoadOptions packedOptions;
+	packedOptions.PackVertices = true;
+
+	SceneAssets assets;
+	assets.Cube = loader.LoadMesh(FixPath(L"../../Assets/Models/cube.obj"));
+	assets.Cylinder = loader.LoadMesh(FixPath(L"../../Assets/Models/cylinder.obj"), packedOptions);
+	assets.Helix = loader.LoadMesh(FixPath(L"../../Assets/Models/helix.obj"), packedOptions);
+	assets.Quad = loader.LoadMesh(FixPath(L"../../Assets/Models/quad.obj"), packedOptions);
+	assets.DoubleSidedQuad = loader.LoadMesh(FixPath(L"../../Assets/Models/quad_double_sided.obj"), packedOptions);
+	assets.Sphere = loader.LoadMesh(FixPath(L"../../Assets/Models/sphere.obj"), packedOptions);
+	assets.Torus = loader.LoadMesh(FixPath(L"../../Assets/Models/torus.obj"), packedOptions);
+
+	assets.Floor = RequestPbrTextures(loader, L"floor");
+	assets.Cobblestone = RequestPbrTextures(loader, L"cobblestone");
+	assets.Bronze = RequestPbrTextures(loader, L"bronze");
+
+	assets.SkyBox = loader.LoadCubemap(
+		FixPath(L"../../Assets/Textures/Planet/right.png"),
+		FixPath(L"../../Assets/Textures/Planet/left.png"),
+		FixPath(L"../../Assets/Textures/Planet/up.png"),
+		FixPath(L"../../Assets/Textures/Planet/down.png"),
+		FixPath(L"../../Assets/Textures/Planet/front.png"),
+		FixPath(L"../../Assets/Textures/Planet/back.png"));
+
+	return assets;
 }
 
-void Game::LoadTextures() {
+Game::PbrTextures Game::RequestPbrTextures(AssetLoader& loader, const std::wstring& name)
+{
+	std::wstring path = FixPath(L"../../Assets/Textures/PBR/" + name);
+
+	PbrTextures textures;
+	textures.Albedo = loader.LoadTexture(path + L"_albedo.png");
+	textures.Normals = loader.LoadTexture(path + L"_normals.png");
+	textures.Roughness = loader.LoadTexture(path + L"_roughness.png");
+	textures.Metalness = loader.LoadTexture(path + L"_metal.png");
+	return textures;
+}
+
+std::shared_ptr<Material> Game::CreatePbrMaterial(const PbrTextures& textures, Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler)
+{
+	std::shared_ptr<Material> material = std::make_shared<Material>(XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), vertexShader, pixelShader, 0.0f);
+	material->AddTextureSRV("Albedo", textures.Albedo.Get());
+	material->AddTextureSRV("NormalMap", textures.Normals.Get());
+	material->AddTextureSRV("RoughnessMap", textures.Roughness.Get());
+	material->AddTextureSRV("MetalnessMap", textures.Metalness.Get());
+	material->AddSampler("BasicSampler", sampler);
+	material->SetPackedVertexShader(packedVertexShader);
+	material->SetInstancedVertexShaders(instancedVertexShader, packedInstancedVertexShader);
+	return material;
+}
+
+void Game::LoadTextures(const SceneAssets& assets) {
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler;
 	D3D11_SAMPLER_DESC samplerDesc = {};
 	samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
@@ -169,53 +341,9 @@ void Game::LoadTextures() {
 	samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
 	device->CreateSamplerState(&samplerDesc, sampler.GetAddressOf());
 
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> metalSRV;
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/PBR/floor_albedo.png").c_str(), 0, metalSRV.GetAddressOf());
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> metalNormalSRV;
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/PBR/floor_normals.png").c_str(), 0, metalNormalSRV.GetAddressOf());
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> metalRoughnessSRV;
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/PBR/floor_roughness.png").c_str(), 0, metalRoughnessSRV.GetAddressOf());
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> metalMetalnessSRV;
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/PBR/floor_metal.png").c_str(), 0, metalMetalnessSRV.GetAddressOf());
-
-	metalMat = std::make_shared<Material>(XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), vertexShader, pixelShader, 0.0f);
-	metalMat->AddTextureSRV("Albedo", metalSRV);
-	metalMat->AddTextureSRV("NormalMap", metalNormalSRV);
-	metalMat->AddTextureSRV("RoughnessMap", metalRoughnessSRV);
-	metalMat->AddTextureSRV("MetalnessMap", metalMetalnessSRV);
-	metalMat->AddSampler("BasicSampler", sampler);
-
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> tilesSRV;
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/PBR/cobblestone_albedo.png").c_str(), 0, tilesSRV.GetAddressOf());
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> tilesNormalSRV;
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/PBR/cobblestone_normals.png").c_str(), 0, tilesNormalSRV.GetAddressOf());
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> tilesRoughnessSRV;
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/PBR/cobblestone_roughness.png").c_str(), 0, tilesRoughnessSRV.GetAddressOf());
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> tilesMetalnessSRV;
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/PBR/cobblestone_metal.png").c_str(), 0, tilesMetalnessSRV.GetAddressOf());
-
-	tileMat = std::make_shared<Material>(XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), vertexShader, pixelShader, 0.0f);
-	tileMat->AddTextureSRV("Albedo", tilesSRV);
-	tileMat->AddTextureSRV("NormalMap", tilesNormalSRV);
-	tileMat->AddTextureSRV("RoughnessMap", tilesRoughnessSRV);
-	tileMat->AddTextureSRV("MetalnessMap", tilesMetalnessSRV);
-	tileMat->AddSampler("BasicSampler", sampler);
-
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> bronzeSRV;
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/PBR/bronze_albedo.png").c_str(), 0, tilesSRV.GetAddressOf());
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> bronzeNormalSRV;
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/PBR/bronze_normals.png").c_str(), 0, tilesNormalSRV.GetAddressOf());
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> bronzeRoughnessSRV;
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/PBR/bronze_roughness.png").c_str(), 0, tilesRoughnessSRV.GetAddressOf());
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> bronzeMetalnessSRV;
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/PBR/bronze_metal.png").c_str(), 0, tilesMetalnessSRV.GetAddressOf());
-
-	bronzeMat = std::make_shared<Material>(XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), vertexShader, pixelShader, 0.0f);
-	bronzeMat->AddTextureSRV("Albedo", tilesSRV);
-	bronzeMat->AddTextureSRV("NormalMap", tilesNormalSRV);
-	bronzeMat->AddTextureSRV("RoughnessMap", tilesRoughnessSRV);
-	bronzeMat->AddTextureSRV("MetalnessMap", tilesMetalnessSRV);
-	bronzeMat->AddSampler("BasicSampler", sampler);
+	metalMat = CreatePbrMaterial(assets.Floor, sampler);
+	tileMat = CreatePbrMaterial(assets.Cobblestone, sampler);
+	bronzeMat = CreatePbrMaterial(assets.Bronze, sampler);
 
 	std::shared_ptr<SimpleVertexShader> skyVS = std::make_shared<SimpleVertexShader>(device, context, FixPath(L"SkyVertexShader.cso").c_str());
 	std::shared_ptr<SimplePixelShader> skyPS = std::make_shared<SimplePixelShader>(device, context, FixPath(L"SkyPixelShader.cso").c_str());
@@ -226,12 +354,7 @@ void Game::LoadTextures() {
 		context,
 		skyPS,
 		skyVS,
-		FixPath(L"../../Assets/Textures/Planet/right.png").c_str(),
-		FixPath(L"../../Assets/Textures/Planet/left.png").c_str(),
-		FixPath(L"../../Assets/Textures/Planet/up.png").c_str(),
-		FixPath(L"../../Assets/Textures/Planet/down.png").c_str(),
-		FixPath(L"../../Assets/Textures/Planet/front.png").c_str(),
-		FixPath(L"../../Assets/Textures/Planet/back.png").c_str());
+		assets.SkyBox.Get());
 
 	entities = std::vector<GameEntity>();
 	entities.push_back(GameEntity(cubeMesh, tileMat));
@@ -249,21 +372,36 @@ void Game::LoadTextures() {
 	entities[4].GetTransform()->SetPosition(+2.0f, +0.0f, +8.0f);
 	entities[5].GetTransform()->SetPosition(+5.0f, +0.0f, +8.0f);
 	entities[6].GetTransform()->SetPosition(+8.0f, +0.0f, +8.0f);
+	inspectedEntityCount = entities.size();
+
+	// A floor of cubes that all share a mesh & material, which
+	// instancing draws in one go
+	const int gridSize = 16;
+	for (int z = 0; z < gridSize; z++)
+	{
+		for (int x = 0; x < gridSize; x++)
+		{
+			entities.push_back(GameEntity(cubeMesh, tileMat));
+			Transform* transform = entities.back().GetTransform();
+			transform->SetPosition((x - gridSize / 2) * 1.25f, -3.0f, 4.0f + z * 1.25f);
+			transform->SetScale(0.5f, 0.5f, 0.5f);
+		}
+	}
 }
 
 
 // --------------------------------------------------------
-// Creates the geometry we're going to draw - a single triangle for now
+// Takes the meshes we're going to draw from the loaded assets
 // --------------------------------------------------------
-void Game::CreateGeometry()
+void Game::CreateGeometry(const SceneAssets& assets)
 {
-	cubeMesh = std::make_shared<Mesh>(FixPath(L"../../Assets/Models/cube.obj").c_str(), device);
-	cylMesh = std::make_shared<Mesh>(FixPath(L"../../Assets/Models/cylinder.obj").c_str(), device);
-	helixMesh = std::make_shared<Mesh>(FixPath(L"../../Assets/Models/helix.obj").c_str(), device);
-	quadMesh = std::make_shared<Mesh>(FixPath(L"../../Assets/Models/quad.obj").c_str(), device);
-	doubleSidedQuadMesh = std::make_shared<Mesh>(FixPath(L"../../Assets/Models/quad_double_sided.obj").c_str(), device);
-	sphereMesh = std::make_shared<Mesh>(FixPath(L"../../Assets/Models/sphere.obj").c_str(), device);
-	torusMesh = std::make_shared<Mesh>(FixPath(L"../../Assets/Models/torus.obj").c_str(), device);
+	cubeMesh = assets.Cube.Get();
+	cylMesh = assets.Cylinder.Get();
+	helixMesh = assets.Helix.Get();
+	quadMesh = assets.Quad.Get();
+	doubleSidedQuadMesh = assets.DoubleSidedQuad.Get();
+	sphereMesh = assets.Sphere.Get();
+	torusMesh = assets.Torus.Get();
 }
 
 void Game::CreateShadowResources() {
@@ -301,6 +439,16 @@ void Game::OnResize()
 // --------------------------------------------------------
 // Update your game here - user input, move objects, AI, etc.
 // --------------------------------------------------------
+// --------------------------------------------------------
+// One fixed length step of the simulation (see DXCore::Run)
+// --------------------------------------------------------
+void Game::FixedUpdate(float tickSeconds, float simulationTime)
+{
+	if (spinEntities)
+		for (GameEntity& entity : entities)
+			entity.GetTransform()->Rotate(0.0f, tickSeconds * 0.5f, 0.0f);
+}
+
 void Game::Update(float deltaTime, float totalTime)
 {
 	// Get a reference to our custom input manager
@@ -326,7 +474,6 @@ void Game::Update(float deltaTime, float totalTime)
 	input.GetKeyArray(io.KeysDown, 256);
 	// Reset the frame
 	ImGui_ImplDX11_NewFrame();
-	ImGui_ImplWin32_NewFrame();
 	ImGui::NewFrame();
 	// Determine new input capture (youll uncomment later)
 	input.SetKeyboardCapture(io.WantCaptureKeyboard);
@@ -334,16 +481,106 @@ void Game::Update(float deltaTime, float totalTime)
 	// Show the demo window
 	ImGui::ShowDemoWindow();
 
+	// Right click to select whatever's under the mouse
+	if (input.MouseRightPress())
+		PickEntity(input.GetMouseX(), input.GetMouseY());
+
 	// ImGui Windows
 	{
 		ImGui::Begin("Data");
 		ImGui::Text("Current FPS: %f", io.Framerate);
+		float firstFrame = timeToFirstFrame;
+		if (firstFrame >= 0.0f)
+			ImGui::Text("Time to first frame: %.1f ms (assets %.1f ms on %u threads)", firstFrame, assetLoadTime, assetThreadCount);
+		ImGui::SliderFloat("LOD pixel error", &lodPixelError, 0.0f, 16.0f);
+		ImGui::Checkbox("Meshlet culling", &meshletCulling);
+		ImGui::Checkbox("Frustum culling", &frustumCulling);
+		ImGui::Checkbox("Occlusion culling", &occlusionCulling);
+		ImGui::Text("Visible: %zu of %zu entities", visibleEntities.size(), entities.size());
+		if (occlusionCulling)
+		{
+			const OcclusionStats& occlusion = occlusionBuffer.GetStats();
+			ImGui::Text("Occluded: %u (%u occluders, %u of %u triangles drawn)",
+				occlusion.Occluded, occlusion.Occluders, occlusion.TrianglesDrawn, occlusion.Triangles);
+		}
+		ImGui::Checkbox("Instancing", &instancing);
+		ImGui::Text("Draw calls: %u for %zu entities", drawCallCount.load(), entities.size());
+		ImGui::Checkbox("Spin entities", &spinEntities);
+		float tickRate = fixedTimestep.GetTickRate();
+		if (ImGui::SliderFloat("Tick rate", &tickRate, 10.0f, 240.0f, "%.0f Hz"))
+			fixedTimestep.SetTickRate(tickRate);
+		ImGui::Text("Ticks: %u this frame (alpha %.2f), %llu in %llu frames, %llu skipped",
+			fixedTimestep.GetTicksThisFrame(), fixedTimestep.GetAlpha(),
+			fixedTimestep.GetTickCount(), fixedTimestep.GetFrameCount(), fixedTimestep.GetSkippedTickCount());
+		bool pipelined = framePipeline.IsPipelined();
+		if (ImGui::Checkbox("Update while drawing (a frame of latency)", &pipelined))
+			framePipeline.SetPipelined(pipelined);
+		const FramePipelineStats& pipeline = framePipeline.GetStats();
+		ImGui::Text("Last frame: update %.2f ms, draw %.2f ms, %.2f ms in all", pipeline.Update, pipeline.Draw, pipeline.Frame);
+
+		// Percentiles over the last so many frames, by phase
+		ImGui::Text("Frame times (ms) over the last %llu frames:",
+			frameTelemetry.GetWindow(FramePhase::Frame).GetCount());
+		if (ImGui::BeginTable("Frame times", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingFixedFit))
+		{
+			const char* phaseNames[] = { "Frame", "Update", "Draw", "Present" };
+			ImGui::TableSetupColumn("");
+			for (double percentile : FrameTelemetry::ReportedPercentiles)
+			{
+				char label[16];
+				snprintf(label, sizeof(label), "p%g", percentile);
+				ImGui::TableSetupColumn(label);
+			}
+			ImGui::TableSetupColumn("Max");
+			ImGui::TableHeadersRow();
+
+			for (int phase = 0; phase < (int)FramePhase::Count; phase++)
+			{
+				const FrameHistogram& times = frameTelemetry.GetWindow((FramePhase)phase);
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(phaseNames[phase]);
+				for (double percentile : FrameTelemetry::ReportedPercentiles)
+				{
+					ImGui::TableNextColumn();
+					ImGui::Text("%.2f", times.GetPercentile(percentile));
+				}
+				ImGui::TableNextColumn();
+				ImGui::Text("%.2f", times.GetMax());
+			}
+			ImGui::EndTable();
+		}
+
+		const std::vector<float>& hitchThresholds = frameTelemetry.GetHitchThresholds();
+		for (unsigned int i = 0; i < hitchThresholds.size(); i++)
+		{
+			ImGui::Text("Hitches over %.1f ms: %llu recently, %llu in all",
+				hitchThresholds[i], frameTelemetry.GetWindowHitches(i), frameTelemetry.GetLifetimeHitches(i));
+		}
+		if (ImGui::Button("Reset frame times"))
+			frameTelemetry.Reset();
 		ImGui::End();
 
+		ShowProfiler();
+
 		ImGui::Begin("Object Inspector");
 		XMFLOAT3 currentPos;
-		for (int i = 0; i < entities.size(); i++) {
-			ImGui::Text("Entity %i Movement Controls", i);
+		if (selectedEntity >= 0) {
+			ImGui::Text("Selected entity %i (triangle %u, %.1f%% of the way to the far plane)",
+				selectedEntity, selectedHit.Triangle, selectedHit.Distance * 100.0f);
+
+			currentPos = entities[selectedEntity].GetTransform()->GetPosition();
+			ImGui::PushID("selected");
+			if (ImGui::DragFloat3("##", &currentPos.x, 0.1f)) {
+				entities[selectedEntity].GetTransform()->SetPosition(currentPos.x, currentPos.y, currentPos.z);
+			}
+			ImGui::PopID();
+		}
+		else {
+			ImGui::Text("Right click an entity to select it");
+		}
+		for (unsigned int i = 0; i < inspectedEntityCount; i++) {
+			ImGui::Text("Entity %u Movement Controls", i);
 
 			currentPos = entities[i].GetTransform()->GetPosition();
 			ImGui::PushID("ent" + i);
@@ -373,6 +610,177 @@ void Game::Update(float deltaTime, float totalTime)
 		Quit();
 
 	camera.Update(deltaTime);
+
+	// What Draw() needs, for it to draw while the next frame updates
+	BuildSnapshot(snapshots[1 - drawnSnapshot]);
+}
+
+// --------------------------------------------------------
+// Copies what Draw() needs out of the scene, once Update()
+// is done with it.  Matrices, culling, levels of detail &
+// instance grouping are all worked out here, leaving Draw()
+// with just the Direct3D calls.
+// --------------------------------------------------------
+void Game::BuildSnapshot(RenderSnapshot& snapshot)
+{
+	PROFILE_SCOPE("BuildSnapshot");
+	snapshot.Clear();
+	snapshot.Frame = fixedTimestep.GetFrameCount();
+
+	// Everything that moved this frame, in one batch, before
+	// the matrices are asked for one entity at a time
+	TransformStore::GetDefault().UpdateMatrices();
+	CullEntities();
+
+	snapshot.Camera.View = camera.GetViewMatrix();
+	snapshot.Camera.Projection = camera.GetProjectionMatrix();
+	snapshot.Camera.Position = camera.GetTransform()->GetPosition();
+	snapshot.Lights = lights;
+	snapshot.MeshletCulling = meshletCulling;
+	snapshot.Instancing = instancing;
+
+	for (unsigned int i : visibleEntities)
+	{
+		GameEntity& ge = entities[i];
+		Transform* transform = ge.GetTransform();
+		SnapshotEntity entity;
+		entity.World = transform->GetWorldMatrix();
+		entity.WorldInvTranspose = transform->GetWorldInverseTransposeMatrix();
+		entity.Geometry = ge.GetMesh().get();
+		entity.MaterialIndex = snapshot.AddMaterial(ge.GetMaterial().get());
+		entity.Lod = ge.SelectLod(&camera, (float)windowHeight, lodPixelError);
+		snapshot.Entities.push_back(entity);
+	}
+
+	if (instancing)
+	{
+		for (unsigned int i = 0; i < snapshot.Entities.size(); i++)
+		{
+			const SnapshotEntity& entity = snapshot.Entities[i];
+			snapshot.Batches.Add(
+				entity.Geometry,
+				snapshot.Materials[entity.MaterialIndex].Source,
+				entity.Lod,
+				entity.World,
+				entity.WorldInvTranspose,
+				i);
+		}
+		snapshot.Batches.Build();
+	}
+
+	// ImGui's frame ends here, since the next Update() starts another
+	ImGui::Render();
+	snapshot.CaptureUi(ImGui::GetDrawData());
+}
+
+// --------------------------------------------------------
+// The profiler's controls, and a timeline of the last frame
+// with a row for each thread and a bar for each scope, nested
+// scopes below the ones they're in
+// --------------------------------------------------------
+void Game::ShowProfiler()
+{
+	Profiler& profiler = Profiler::GetDefault();
+	ImGui::Begin("Profiler");
+
+	bool enabled = Profiler::IsEnabled();
+	if (ImGui::Checkbox("Record", &enabled))
+		Profiler::SetEnabled(enabled);
+	ImGui::SameLine();
+	if (profiler.IsCapturing())
+		ImGui::Text("Capturing... %u frames", profiler.GetCapturedFrameCount());
+	else if (ImGui::Button("Capture 120 frames"))
+	{
+		profiler.StartCapture(120);
+		profilerTraceSaved = 0;
+	}
+
+	if (!profiler.IsCapturing() && profiler.GetCapturedFrameCount() > 0)
+	{
+		ImGui::SameLine();
+		if (ImGui::Button("Save Chrome trace"))
+			profilerTraceSaved = profiler.SaveChromeTrace(FixPath(L"profile.json")) ? 1 : -1;
+		if (profilerTraceSaved != 0)
+		{
+			ImGui::SameLine();
+			ImGui::Text(profilerTraceSaved > 0 ? "Saved profile.json" : "Couldn't save profile.json");
+		}
+	}
+
+	const ProfileFrame& frame = profiler.GetLastFrame();
+	long long span = frame.End - frame.Start;
+	ImGui::Text("Last frame: %.2f ms, %zu scopes, %llu dropped",
+		span / 1e6, frame.Events.size(), profiler.GetDroppedCount());
+
+	float width = ImGui::GetContentRegionAvail().x;
+	if (span <= 0 || width <= 0.0f)
+	{
+		ImGui::End();
+		return;
+	}
+
+	const float barHeight = ImGui::GetTextLineHeight() + 2.0f;
+	ImDrawList* drawList = ImGui::GetWindowDrawList();
+	unsigned int threadCount = profiler.GetThreadCount();
+	for (unsigned int thread = 0; thread < threadCount; thread++)
+	{
+		unsigned int rows = 0;
+		for (const ProfileEvent& event : frame.Events)
+			if (event.Thread == thread)
+				rows = (std::max)(rows, event.Depth + 1);
+		if (rows == 0)
+			continue;
+
+		ImGui::Text("%s", profiler.GetThreadName(thread).c_str());
+		ImVec2 origin = ImGui::GetCursorScreenPos();
+		ImGui::PushID((int)thread);
+		ImGui::InvisibleButton("timeline", ImVec2(width, rows * barHeight));
+		bool hovered = ImGui::IsItemHovered();
+		ImGui::PopID();
+
+		ImVec2 mouse = ImGui::GetIO().MousePos;
+		for (const ProfileEvent& event : frame.Events)
+		{
+			if (event.Thread != thread)
+				continue;
+
+			// Clamped to the frame, since a scope can start before it
+			float x0 = origin.x + width * (float)(std::max)(0.0, (double)(event.Start - frame.Start) / span);
+			float x1 = origin.x + width * (float)(std::min)(1.0, (double)(event.End - frame.Start) / span);
+			float y0 = origin.y + event.Depth * barHeight;
+			ImVec2 topLeft(x0, y0);
+			ImVec2 bottomRight((std::max)(x1, x0 + 1.0f), y0 + barHeight - 1.0f);
+
+			// The same color for the same name, every frame
+			float hue = (float)(((size_t)event.Name >> 4) % 64) / 64.0f;
+			drawList->AddRectFilled(topLeft, bottomRight, ImColor::HSV(hue, 0.5f, 0.8f));
+			if (x1 - x0 > 40.0f)
+			{
+				drawList->PushClipRect(topLeft, bottomRight, true);
+				drawList->AddText(ImVec2(x0 + 2.0f, y0), IM_COL32(0, 0, 0, 255), event.Name);
+				drawList->PopClipRect();
+			}
+
+			if (hovered && mouse.x >= topLeft.x && mouse.x < bottomRight.x && mouse.y >= topLeft.y && mouse.y < bottomRight.y)
+				ImGui::SetTooltip("%s\n%.3f ms", event.Name, (event.End - event.Start) / 1e6);
+		}
+	}
+
+	ImGui::End();
+}
+
+// The Win32 side of ImGui's frame calls into the window (to
+// read the mouse and set the cursor), so it can't run on the
+// simulation thread with the rest of Update()
+void Game::BeginFrame()
+{
+	ImGui_ImplWin32_NewFrame();
+}
+
+// The snapshot Update() just built becomes the one to draw
+void Game::PublishFrame()
+{
+	drawnSnapshot = 1 - drawnSnapshot;
 }
 
 void Game::RenderShadowMap() {
@@ -393,11 +801,231 @@ void Game::RenderShadowMap() {
 }
 
 
+// --------------------------------------------------------
+// Casts a ray from the camera through a pixel, selecting the
+// nearest entity it hits (or nothing)
+// --------------------------------------------------------
+void Game::PickEntity(int mouseX, int mouseY)
+{
+	XMFLOAT4X4 view = camera.GetViewMatrix();
+	XMFLOAT4X4 projection = camera.GetProjectionMatrix();
+	XMMATRIX viewMat = XMLoadFloat4x4(&view);
+	XMMATRIX projectionMat = XMLoadFloat4x4(&projection);
+
+	// From the near plane to the far plane, so a hit's distance
+	// is how far between the two it is
+	XMVECTOR nearPoint = XMVector3Unproject(
+		XMVectorSet((float)mouseX, (float)mouseY, 0.0f, 0.0f),
+		0.0f, 0.0f, (float)windowWidth, (float)windowHeight, 0.0f, 1.0f,
+		projectionMat, viewMat, XMMatrixIdentity());
+	XMVECTOR farPoint = XMVector3Unproject(
+		XMVectorSet((float)mouseX, (float)mouseY, 1.0f, 0.0f),
+		0.0f, 0.0f, (float)windowWidth, (float)windowHeight, 0.0f, 1.0f,
+		projectionMat, viewMat, XMMatrixIdentity());
+
+	XMFLOAT3 origin, direction;
+	XMStoreFloat3(&origin, nearPoint);
+	XMStoreFloat3(&direction, farPoint - nearPoint);
+
+	selectedEntity = -1;
+	float nearest = 1.0f;
+	for (unsigned int i = 0; i < entities.size(); i++)
+	{
+		RayHit hit;
+		if (entities[i].Intersect(origin, direction, nearest, hit))
+		{
+			nearest = hit.Distance;
+			selectedEntity = (int)i;
+			selectedHit = hit;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Fills visibleEntities with the entities the camera could
+// see (or all of them, with culling off)
+// --------------------------------------------------------
+void Game::CullEntities()
+{
+	PROFILE_SCOPE("CullEntities");
+	if (!frustumCulling && !occlusionCulling)
+	{
+		visibleEntities.resize(entities.size());
+		for (unsigned int i = 0; i < entities.size(); i++)
+			visibleEntities[i] = i;
+		return;
+	}
+
+	entityBounds.Clear();
+	entityBounds.Reserve(entities.size());
+	for (GameEntity& ge : entities)
+		entityBounds.Add(ge.GetWorldBoundingSphere(), ge.GetWorldBoundingBox());
+
+	if (frustumCulling)
+		CullBounds(camera.GetFrustum(), entityBounds, visibleEntities);
+	else
+	{
+		visibleEntities.resize(entities.size());
+		for (unsigned int i = 0; i < entities.size(); i++)
+			visibleEntities[i] = i;
+	}
+
+	if (occlusionCulling)
+		CullOccludedEntities();
+}
+
+// --------------------------------------------------------
+// Draws the visible entities that cover the most of the
+// screen into the occlusion buffer, then drops the visible
+// entities hidden behind them
+// - Ties go to the lower index, so the same view always
+//   picks the same occluders
+// --------------------------------------------------------
+void Game::CullOccludedEntities()
+{
+	PROFILE_SCOPE("CullOccludedEntities");
+	XMFLOAT4X4 view = camera.GetViewMatrix();
+	XMFLOAT4X4 projection = camera.GetProjectionMatrix();
+	XMFLOAT4X4 viewProjection;
+	XMStoreFloat4x4(&viewProjection, XMLoadFloat4x4(&view) * XMLoadFloat4x4(&projection));
+	occlusionBuffer.Begin(viewProjection);
+
+	XMFLOAT3 eye = camera.GetTransform()->GetPosition();
+	occluderCandidates.clear();
+	for (unsigned int i : visibleEntities)
+	{
+		float x = entityBounds.SphereX[i] - eye.x;
+		float y = entityBounds.SphereY[i] - eye.y;
+		float z = entityBounds.SphereZ[i] - eye.z;
+		float size = entityBounds.SphereRadius[i] / (std::max)(std::sqrt(x * x + y * y + z * z), 0.001f);
+		if (size >= MinOccluderSize)
+			occluderCandidates.push_back(std::make_pair(-size, i));
+	}
+	size_t occluderCount = (std::min)(occluderCandidates.size(), MaxOccluders);
+	std::partial_sort(occluderCandidates.begin(), occluderCandidates.begin() + occluderCount, occluderCandidates.end());
+
+	for (size_t c = 0; c < occluderCount; c++)
+	{
+		GameEntity& entity = entities[occluderCandidates[c].second];
+		occlusionBuffer.AddOccluder(entity.GetMesh()->GetOccluder().get(), entity.GetTransform()->GetWorldMatrix());
+	}
+	occlusionBuffer.Rasterize();
+	occlusionBuffer.FilterVisible(entityBounds, visibleEntities);
+}
+
+// --------------------------------------------------------
+// Draws each entity in a snapshot on its own
+// --------------------------------------------------------
+void Game::DrawEntities(RenderSnapshot& frame)
+{
+	PROFILE_SCOPE("DrawEntities");
+	for (const SnapshotEntity& entity : frame.Entities) {
+		const SnapshotMaterial& material = frame.Materials[entity.MaterialIndex];
+		material.Source->PrepareMaterial();
+		material.Source->GetPixelShader()->SetData("lights", &frame.Lights[0], sizeof(Light) * (int)frame.Lights.size());
+		GameEntity::Draw(context, entity, material, frame.Camera, frame.MeshletCulling, visibleMeshlets);
+	}
+	drawCallCount = (unsigned int)frame.Entities.size();
+}
+
+// --------------------------------------------------------
+// Draws a snapshot's entities grouped by mesh, material &
+// level of detail, with one DrawIndexedInstanced() per group
+// - An entity in a group of its own is drawn as usual, so
+//   it can still cull its meshlets
+// --------------------------------------------------------
+void Game::DrawEntitiesInstanced(RenderSnapshot& frame)
+{
+	PROFILE_SCOPE("DrawEntitiesInstanced");
+	drawCallCount = 0;
+	const std::vector<InstanceData>& instances = frame.Batches.GetInstanceData();
+	if (instances.empty())
+		return;
+
+	// Every instance goes up in one go, growing the buffer if it's too small
+	if (instances.size() > instanceBufferCapacity)
+	{
+		instanceBufferCapacity = (std::max)(instanceBufferCapacity * 2, instances.size());
+
+		D3D11_BUFFER_DESC desc = {};
+		desc.ByteWidth = (UINT)(sizeof(InstanceData) * instanceBufferCapacity);
+		desc.Usage = D3D11_USAGE_DYNAMIC;
+		desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		instanceBuffer.Reset();
+		device->CreateBuffer(&desc, 0, instanceBuffer.GetAddressOf());
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	if (FAILED(context->Map(instanceBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		return;
+	memcpy(mapped.pData, instances.data(), sizeof(InstanceData) * instances.size());
+	context->Unmap(instanceBuffer.Get(), 0);
+
+	unsigned int drawCalls = 0;
+	const std::vector<unsigned int>& sources = frame.Batches.GetInstanceSources();
+	for (const InstanceBatch& batch : frame.Batches.GetBatches())
+	{
+		// Everything in the batch has the same mesh & material as its first entity
+		const SnapshotEntity& first = frame.Entities[sources[batch.FirstInstance]];
+		const SnapshotMaterial& surface = frame.Materials[first.MaterialIndex];
+		Mesh* mesh = first.Geometry;
+		Material* material = surface.Source;
+		material->PrepareMaterial();
+		material->GetPixelShader()->SetData("lights", &frame.Lights[0], sizeof(Light) * (int)frame.Lights.size());
+
+		std::shared_ptr<SimpleVertexShader> vs = mesh->IsPacked() ?
+			material->GetPackedInstancedVertexShader() :
+			material->GetInstancedVertexShader();
+
+		if (batch.InstanceCount == 1 || !vs)
+		{
+			for (unsigned int i = 0; i < batch.InstanceCount; i++)
+			{
+				const SnapshotEntity& entity = frame.Entities[sources[batch.FirstInstance + i]];
+				GameEntity::Draw(context, entity, surface, frame.Camera, frame.MeshletCulling, visibleMeshlets);
+			}
+			drawCalls += batch.InstanceCount;
+			continue;
+		}
+
+		// The same as GameEntity::Draw(), minus the world matrices
+		vs->SetShader();
+		material->GetPixelShader()->SetShader();
+
+		vs->SetMatrix4x4("view", frame.Camera.View);
+		vs->SetMatrix4x4("projection", frame.Camera.Projection);
+		if (mesh->IsPacked())
+		{
+			XMFLOAT3 offset, scale;
+			GetPackedPositionTransform(mesh->GetBoundsMin(), mesh->GetBoundsMax(), offset, scale);
+			vs->SetFloat3("positionOffset", offset);
+			vs->SetFloat3("positionScale", scale);
+		}
+		vs->CopyAllBufferData();
+
+		std::shared_ptr<SimplePixelShader> ps = material->GetPixelShader();
+		ps->SetFloat4("colorTint", surface.ColorTint);
+		ps->SetFloat3("cameraPosition", frame.Camera.Position);
+		ps->SetFloat("roughness", surface.Roughness);
+		ps->CopyAllBufferData();
+
+		mesh->DrawInstanced(context, batch.Lod, instanceBuffer, sizeof(InstanceData), batch.FirstInstance, batch.InstanceCount);
+		drawCalls++;
+	}
+	drawCallCount = drawCalls;
+}
+
+
 // --------------------------------------------------------
 // Clear the screen, redraw everything, present to the user
+// - Only the last published snapshot is drawn, since the
+//   next frame may be updating on another thread
 // --------------------------------------------------------
 void Game::Draw(float deltaTime, float totalTime)
 {
+	RenderSnapshot& frame = snapshots[drawnSnapshot];
+
 	// Frame START
 	// - These things should happen ONCE PER FRAME
 	// - At the beginning of Game::Draw() before drawing *anything*
@@ -410,26 +1038,41 @@ void Game::Draw(float deltaTime, float totalTime)
 		context->ClearDepthStencilView(depthBufferDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
 	}
 
-	for(GameEntity ge : entities) {
-		ge.GetMaterial()->PrepareMaterial();
-		ge.GetMaterial()->GetPixelShader()->SetData("lights", &lights[0], sizeof(Light) * (int)lights.size());
-		ge.Draw(context, &camera);
-	}
+	if (frame.Instancing)
+		DrawEntitiesInstanced(frame);
+	else
+		DrawEntities(frame);
 
-	sky->Draw(camera);
+	sky->Draw(frame.Camera.View, frame.Camera.Projection);
 
 	// Frame END
 	// - These should happen exactly ONCE PER FRAME
 	// - At the very end of the frame (after drawing *everything*)
 	{
-		// Draw ImGui
-		ImGui::Render();
-		ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
+		// Draw ImGui, as it was when the snapshot was taken
+		if (ImDrawData* ui = frame.GetUiDrawData())
+		{
+			PROFILE_SCOPE("ImGui");
+			ImGui_ImplDX11_RenderDrawData(ui);
+		}
 
 		// Present the back buffer to the user
 		//  - Puts the results of what we've drawn onto the window
 		//  - Without this, the user never sees anything
-		swapChain->Present(vsync ? 1 : 0, 0);
+		{
+			PROFILE_SCOPE("Present");
+			Clock::time_point presentStart = Clock::now();
+			swapChain->Present(vsync ? 1 : 0, 0);
+			frameTelemetry.SetPresentTime(MillisecondsSince(presentStart));
+		}
+
+		if (timeToFirstFrame < 0.0f)
+		{
+			timeToFirstFrame = MillisecondsSince(launchTime);
+#if defined(DEBUG) || defined(_DEBUG)
+			printf("Time to first frame: %.1f ms (assets %.1f ms on %u threads)\n", timeToFirstFrame.load(), assetLoadTime, assetThreadCount);
+#endif
+		}
 
 		// Must re-bind buffers after presenting, as they become unbound
 		context->OMSetRenderTargets(1, backBufferRTV.GetAddressOf(), depthBufferDSV.Get());
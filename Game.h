@@ -7,10 +7,18 @@
 #include "SimpleShader.h"
 #include "Lights.h"
 #include "Sky.h"
+#include "AssetLoader.h"
+#include "InstanceBatcher.h"
+#include "FrustumCulling.h"
+#include "OcclusionCulling.h"
+#include "RenderSnapshot.h"
 
 #include <DirectXMath.h>
 #include <wrl/client.h> // Used for ComPtr - a smart pointer for COM objects
+#include <atomic>
+#include <chrono>
 #include <memory>
+#include <utility>
 #include <vector>
 
 class Game 
@@ -25,18 +33,57 @@ public:
 	// will be called automatically
 	void Init();
 	void OnResize();
+	void FixedUpdate(float tickSeconds, float simulationTime);
 	void Update(float deltaTime, float totalTime);
 	void Draw(float deltaTime, float totalTime);
+	void PublishFrame();
+	void BeginFrame();
 
 private:
 
+	// The textures of one PBR material
+	struct PbrTextures
+	{
+		TextureHandle Albedo;
+		TextureHandle Normals;
+		TextureHandle Roughness;
+		TextureHandle Metalness;
+	};
+
+	// Everything Init() asks the asset loader for
+	struct SceneAssets
+	{
+		MeshHandle Cube;
+		MeshHandle Cylinder;
+		MeshHandle Helix;
+		MeshHandle Quad;
+		MeshHandle DoubleSidedQuad;
+		MeshHandle Sphere;
+		MeshHandle Torus;
+
+		PbrTextures Floor;
+		PbrTextures Cobblestone;
+		PbrTextures Bronze;
+		TextureHandle SkyBox;
+	};
+
 	// Initialization helper methods - feel free to customize, combine, remove, etc.
 	void InitLights();
 	void LoadShaders();
-	void LoadTextures();
-	void CreateGeometry();
+	SceneAssets RequestAssets(AssetLoader& loader);
+	PbrTextures RequestPbrTextures(AssetLoader& loader, const std::wstring& name);
+	std::shared_ptr<Material> CreatePbrMaterial(const PbrTextures& textures, Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler);
+	void LoadTextures(const SceneAssets& assets);
+	void CreateGeometry(const SceneAssets& assets);
 	void CreateShadowResources();
 	void RenderShadowMap();
+	void CullEntities();
+	void CullOccludedEntities();
+	void BuildSnapshot(RenderSnapshot& snapshot);
+	void DrawEntities(RenderSnapshot& frame);
+	void DrawEntitiesInstanced(RenderSnapshot& frame);
+	void PickEntity(int mouseX, int mouseY);
+	void ShowProfiler();
 
 	// Note the usage of ComPtr below
 	//  - This is a smart pointer for objects that abide by the
@@ -51,6 +98,9 @@ private:
 	std::shared_ptr<SimplePixelShader> pixelShader;
 	std::shared_ptr<SimplePixelShader> customPixelShader;
 	std::shared_ptr<SimpleVertexShader> vertexShader;
+	std::shared_ptr<SimpleVertexShader> packedVertexShader;	// For meshes loaded with PackVertices
+	std::shared_ptr<SimpleVertexShader> instancedVertexShader;
+	std::shared_ptr<SimpleVertexShader> packedInstancedVertexShader;
 
 	std::vector<Light> lights;
 	std::shared_ptr<Material> metalMat;
@@ -66,6 +116,50 @@ private:
 	std::shared_ptr<Mesh> torusMesh;
 
 	std::vector<GameEntity> entities;
+	size_t inspectedEntityCount;	// The first few, which the inspector lists
+
+	// The entity last right clicked on (-1 for none), and where
+	int selectedEntity;
+	RayHit selectedHit;
+
+	// How far (in pixels) a level of detail's surface may
+	// stray from the full mesh before a finer one is used
+	float lodPixelError;
+
+	// Turn every entity a little each simulation tick, which is
+	// drawn smoothly between ticks at any tick rate
+	bool spinEntities;
+
+	// Draw only the meshlets of each entity that could be visible
+	bool meshletCulling;
+
+	// Skip entities outside the camera's frustum.  Every entity's
+	// world bounds are gathered into one array each frame, and
+	// the indices of the ones left are what gets drawn.
+	bool frustumCulling;
+	CullingBounds entityBounds;
+	std::vector<unsigned int> visibleEntities;
+
+	// Then skip those hidden behind the biggest ones on screen,
+	// drawn into a small depth buffer on the CPU
+	bool occlusionCulling;
+	OcclusionBuffer occlusionBuffer;
+	std::vector<std::pair<float, unsigned int>> occluderCandidates;
+
+	// Draw entities that share a mesh, material & level of detail
+	// together (see InstanceBatcher.h), with their matrices in a
+	// dynamic vertex buffer that grows as needed
+	bool instancing;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> instanceBuffer;
+	size_t instanceBufferCapacity;
+	std::atomic<unsigned int> drawCallCount;	// Last frame's, for entities
+
+	// Update() fills one snapshot while Draw() draws the other
+	// (see FramePipeline), and PublishFrame() swaps them.  Draw()
+	// reads nothing else that Update() changes.
+	RenderSnapshot snapshots[2];
+	unsigned int drawnSnapshot;
+	std::vector<unsigned int> visibleMeshlets;	// Scratch space for Draw()
 
 	// Shadow mapping variables
 	UINT shadowMapRes;
@@ -76,5 +170,16 @@ private:
 
 	Camera camera;
 	std::shared_ptr<Sky> sky;
+
+	// Startup timing, from the Game being constructed (before
+	// the window & device) to the first frame being presented
+	std::chrono::high_resolution_clock::time_point launchTime;
+	float assetLoadTime;		// Milliseconds Init() spent loading assets
+	std::atomic<float> timeToFirstFrame;	// Milliseconds, or negative before the first frame
+	unsigned int assetThreadCount;
+
+	// Whether the last capture was saved (1), failed to save
+	// (-1) or hasn't been yet (0)
+	int profilerTraceSaved;
 };
 
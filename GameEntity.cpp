@@ -1,5 +1,7 @@
 #include "GameEntity.h"
 #include "BufferStructs.h"
+#include "MeshBounds.h"
+#include "Profiler.h"
 using namespace DirectX;
 
 GameEntity::GameEntity(
@@ -30,27 +32,122 @@ void GameEntity::SetMaterial(Material _material) {
 	material = std::make_shared<Material>(_material);
 }
 
+BoundingBox GameEntity::GetWorldBoundingBox()
+{
+	XMFLOAT4X4 world = transform.GetWorldMatrix();
+	return TransformBounds(mesh->GetBoundingBox(), XMLoadFloat4x4(&world));
+}
+
+BoundingSphere GameEntity::GetWorldBoundingSphere()
+{
+	XMFLOAT4X4 world = transform.GetWorldMatrix();
+	return TransformBounds(mesh->GetBoundingSphere(), XMLoadFloat4x4(&world));
+}
+
+bool GameEntity::Intersect(
+	const XMFLOAT3& origin,
+	const XMFLOAT3& direction,
+	float maxDistance,
+	RayHit& hit)
+{
+	std::shared_ptr<const MeshBVH> bvh = mesh->GetBVH();
+	if (!bvh || bvh->IsEmpty())
+		return false;
+
+	// Rule out rays that miss the bounds before going any further
+	XMVECTOR worldOrigin = XMLoadFloat3(&origin);
+	XMVECTOR worldDirection = XMLoadFloat3(&direction);
+	float sphereDistance = 0.0f;
+	BoundingSphere sphere = GetWorldBoundingSphere();
+	if (!sphere.Contains(worldOrigin) &&
+		(!sphere.Intersects(worldOrigin, XMVector3Normalize(worldDirection), sphereDistance) ||
+		sphereDistance > maxDistance * XMVectorGetX(XMVector3Length(worldDirection))))
+		return false;
+
+	// Into the mesh's own space, without normalizing the direction,
+	// so distances along the ray stay the same
+	XMFLOAT4X4 world = transform.GetWorldMatrix();
+	XMMATRIX worldToLocal = XMMatrixInverse(0, XMLoadFloat4x4(&world));
+	XMFLOAT3 localOrigin, localDirection;
+	XMStoreFloat3(&localOrigin, XMVector3TransformCoord(worldOrigin, worldToLocal));
+	XMStoreFloat3(&localDirection, XMVector3TransformNormal(worldDirection, worldToLocal));
+	return bvh->Intersect(localOrigin, localDirection, maxDistance, hit);
+}
+
+int GameEntity::SelectLod(Camera* camera, float screenHeight, float maxPixelError)
+{
+	XMFLOAT4X4 world = transform.GetWorldMatrix();
+	XMMATRIX worldMat = XMLoadFloat4x4(&world);
+
+	// Bounding sphere of the mesh, in world space
+	BoundingSphere sphere = TransformBounds(mesh->GetBoundingSphere(), worldMat);
+	XMVECTOR center = XMLoadFloat3(&sphere.Center);
+	float radius = sphere.Radius;
+	float scale = XMVectorGetX(XMVectorMax(
+		XMVector3Length(worldMat.r[0]),
+		XMVectorMax(XMVector3Length(worldMat.r[1]), XMVector3Length(worldMat.r[2]))));
+
+	// Anything the camera is inside of (or very close to) gets full detail
+	XMFLOAT3 cameraPos = camera->GetTransform()->GetPosition();
+	float distance = XMVectorGetX(XMVector3Length(center - XMLoadFloat3(&cameraPos))) - radius;
+	if (distance <= 0.0f || scale <= 0.0f)
+		return 0;
+
+	// The projection's y scale is 1 / tan(fov / 2), so this is how
+	// many pixels one unit covers at a distance of one unit
+	XMFLOAT4X4 projection = camera->GetProjectionMatrix();
+	float pixelsPerUnit = projection._22 * screenHeight * 0.5f;
+
+	// The mesh's errors are in its own units, before scaling
+	return mesh->SelectLod(distance / scale, pixelsPerUnit, maxPixelError);
+}
+
 void GameEntity::Draw(
-	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, 
-	Camera* camera) 
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	const SnapshotEntity& entity,
+	const SnapshotMaterial& surface,
+	const SnapshotCamera& camera,
+	bool cullMeshlets,
+	std::vector<unsigned int>& visibleMeshlets)
 {
+	PROFILE_SCOPE("GameEntity::Draw");
+	Mesh* mesh = entity.Geometry;
+	Material* material = surface.Source;
+	int lod = entity.Lod;
+
+	// Nothing can decode a packed mesh without a packed vertex shader
+	std::shared_ptr<SimpleVertexShader> vs = material->GetVertexShader();
+	if (mesh->IsPacked())
+	{
+		vs = material->GetPackedVertexShader();
+		if (!vs)
+			return;
+	}
+
 	// Set shader data
 	{
-		material->GetVertexShader()->SetShader();
+		vs->SetShader();
 		material->GetPixelShader()->SetShader();
 
-		std::shared_ptr<SimpleVertexShader> vs = material->GetVertexShader();
-		vs->SetMatrix4x4("world", transform.GetWorldMatrix());
-		vs->SetMatrix4x4("worldInvTranspose", transform.GetWorldInverseTransposeMatrix());
-		vs->SetMatrix4x4("view", camera->GetViewMatrix());
-		vs->SetMatrix4x4("projection", camera->GetProjectionMatrix());
+		vs->SetMatrix4x4("world", entity.World);
+		vs->SetMatrix4x4("worldInvTranspose", entity.WorldInvTranspose);
+		vs->SetMatrix4x4("view", camera.View);
+		vs->SetMatrix4x4("projection", camera.Projection);
+
+		if (mesh->IsPacked())
+		{
+			XMFLOAT3 offset, scale;
+			GetPackedPositionTransform(mesh->GetBoundsMin(), mesh->GetBoundsMax(), offset, scale);
+			vs->SetFloat3("positionOffset", offset);
+			vs->SetFloat3("positionScale", scale);
+		}
 
 		vs->CopyAllBufferData();
 
 		std::shared_ptr<SimplePixelShader> ps = material->GetPixelShader();
-		ps->SetFloat4("colorTint", material->GetColorTint());
-		ps->SetFloat3("cameraPosition", camera->GetTransform().GetPosition());
-		ps->SetFloat("roughness", material->GetRoughness());
+		ps->SetFloat4("colorTint", surface.ColorTint);
+		ps->SetFloat3("cameraPosition", camera.Position);
+		ps->SetFloat("roughness", surface.Roughness);
 
 		ps->CopyAllBufferData();
 	}
@@ -59,6 +156,21 @@ void GameEntity::Draw(
 	// - These steps are generally repeated for EACH object you draw
 	// - Other Direct3D calls will also be necessary to do more complex things
 	{
-		mesh->Draw(context);
+		const std::vector<Meshlet>& meshlets = mesh->GetMeshlets();
+		if (cullMeshlets && lod == 0 && !meshlets.empty())
+		{
+			CullMeshlets(
+				meshlets.data(),
+				meshlets.size(),
+				entity.World,
+				camera.View,
+				camera.Projection,
+				visibleMeshlets);
+			mesh->DrawMeshlets(context, visibleMeshlets);
+		}
+		else
+		{
+			mesh->Draw(context, lod);
+		}
 	}
-}
\ No newline at end of file
+}
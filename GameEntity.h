@@ -4,7 +4,9 @@
 #include "Mesh.h"
 #include "Camera.h"
 #include "Material.h"
+#include "RenderSnapshot.h"
 #include <memory>
+#include <vector>
 
 class GameEntity
 {
@@ -16,9 +18,35 @@ public:
 	std::shared_ptr<Material> GetMaterial();
 	void SetMaterial(Material _material);
 
-	void Draw(
+	// The mesh's bounds, moved to where this entity is
+	DirectX::BoundingBox GetWorldBoundingBox();
+	DirectX::BoundingSphere GetWorldBoundingSphere();
+
+	// The nearest hit on this entity's mesh along a world space ray
+	// (origin + direction * Distance, for Distance up to maxDistance).
+	// Distances from different entities can be compared directly.
+	bool Intersect(
+		const DirectX::XMFLOAT3& origin,
+		const DirectX::XMFLOAT3& direction,
+		float maxDistance,
+		RayHit& hit);
+
+	// Level of detail to draw from this camera, keeping the mesh's
+	// simplification error under maxPixelError pixels on screen
+	int SelectLod(Camera* camera, float screenHeight, float maxPixelError);
+
+	// Draws an entity from a snapshot, reading nothing that an
+	// update could be changing at the same time.  With cullMeshlets,
+	// full detail meshes that have meshlets only draw the clusters
+	// that could be visible from the camera; visibleMeshlets is
+	// scratch space for that.
+	static void Draw(
 		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
-		Camera* camera);
+		const SnapshotEntity& entity,
+		const SnapshotMaterial& material,
+		const SnapshotCamera& camera,
+		bool cullMeshlets,
+		std::vector<unsigned int>& visibleMeshlets);
 
 private:
 	Transform transform;
@@ -86,3 +86,76 @@ std::wstring NarrowToWide(const std::string& str)
 	std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
 	return converter.from_bytes(str);
 }
+
+
+// ----------------------------------------------------
+//  Opens a file for reading or writing (in binary) from
+//  a wide path, since only MSVC's standard library
+//  accepts wide file names directly
+// ----------------------------------------------------
+FILE* OpenForReading(const std::wstring& filename)
+{
+#if defined(_WIN32)
+	FILE* file = 0;
+	_wfopen_s(&file, filename.c_str(), L"rb");
+	return file;
+#else
+	return fopen(WideToNarrow(filename).c_str(), "rb");
+#endif
+}
+
+FILE* OpenForWriting(const std::wstring& filename)
+{
+#if defined(_WIN32)
+	FILE* file = 0;
+	_wfopen_s(&file, filename.c_str(), L"wb");
+	return file;
+#else
+	return fopen(WideToNarrow(filename).c_str(), "wb");
+#endif
+}
+
+
+// ----------------------------------------------------
+//  Opens an existing file for reading and writing (in
+//  binary) without truncating it, from a wide path
+// ----------------------------------------------------
+FILE* OpenForUpdating(const std::wstring& filename)
+{
+#if defined(_WIN32)
+	FILE* file = 0;
+	_wfopen_s(&file, filename.c_str(), L"r+b");
+	return file;
+#else
+	return fopen(WideToNarrow(filename).c_str(), "r+b");
+#endif
+}
+
+
+// ----------------------------------------------------
+//  Deletes a file from a wide path
+// ----------------------------------------------------
+bool RemoveFile(const std::wstring& filename)
+{
+#if defined(_WIN32)
+	return _wremove(filename.c_str()) == 0;
+#else
+	return remove(WideToNarrow(filename).c_str()) == 0;
+#endif
+}
+
+
+// ----------------------------------------------------
+//  Renames a file over another, so anything reading
+//  the second sees either all of the old file or all
+//  of the new one (as long as they're on the same
+//  drive).  Fails if the replaced file is in use.
+// ----------------------------------------------------
+bool ReplaceWithFile(const std::wstring& filename, const std::wstring& replaced)
+{
+#if defined(_WIN32)
+	return MoveFileExW(filename.c_str(), replaced.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	return rename(WideToNarrow(filename).c_str(), WideToNarrow(replaced).c_str()) == 0;
+#endif
+}
@@ -1,9 +1,23 @@
 #pragma once
 
+#include <cstdio>
 #include <string>
 
 // Helpers for determining the actual path to the executable
 std::wstring GetExePath();
 std::wstring FixPath(const std::wstring& relativeFilePath);
 std::string WideToNarrow(const std::wstring& str);
-std::wstring NarrowToWide(const std::string& str);
\ No newline at end of file
+std::wstring NarrowToWide(const std::string& str);
+
+// Opens a file for reading or writing (in binary) from a wide path, or returns null
+FILE* OpenForReading(const std::wstring& filename);
+FILE* OpenForWriting(const std::wstring& filename);
+
+// Opens an existing file to overwrite parts of it (in binary), or returns null
+FILE* OpenForUpdating(const std::wstring& filename);
+
+// Deletes a file, returning whether it did
+bool RemoveFile(const std::wstring& filename);
+
+// Renames a file, replacing whatever's already at the new path
+bool ReplaceWithFile(const std::wstring& filename, const std::wstring& replaced);
\ No newline at end of file
@@ -0,0 +1,100 @@
+#include "InstanceBatcher.h"
+
+#include <algorithm>
+#include <functional>
+
+using namespace DirectX;
+
+bool InstanceBatcher::BatchKey::operator==(const BatchKey& other) const
+{
+	return Mesh == other.Mesh && Material == other.Material && Lod == other.Lod;
+}
+
+size_t InstanceBatcher::BatchKeyHash::operator()(const BatchKey& key) const
+{
+	size_t hash = std::hash<const void*>()(key.Mesh);
+	hash ^= std::hash<const void*>()(key.Material) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+	hash ^= std::hash<int>()(key.Lod) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+	return hash;
+}
+
+void InstanceBatcher::Begin()
+{
+	// Clear rather than reallocate, so a steady scene stops allocating
+	submissions.clear();
+	batches.clear();
+	instanceData.clear();
+	instanceSources.clear();
+	batchLookup.clear();
+}
+
+void InstanceBatcher::Add(
+	const void* mesh,
+	const void* material,
+	int lod,
+	const XMFLOAT4X4& world,
+	const XMFLOAT4X4& worldInvTranspose,
+	unsigned int source)
+{
+	BatchKey key = { mesh, material, lod };
+	auto found = batchLookup.find(key);
+	if (found == batchLookup.end())
+	{
+		InstanceBatch batch = { mesh, material, lod, 0, 0 };
+		found = batchLookup.insert({ key, (unsigned int)batches.size() }).first;
+		batches.push_back(batch);
+	}
+	batches[found->second].InstanceCount++;
+
+	Submission submission;
+	submission.Data.World = world;
+	submission.Data.WorldInvTranspose = worldInvTranspose;
+	submission.Source = source;
+	submission.Batch = found->second;
+	submissions.push_back(submission);
+}
+
+// --------------------------------------------------------
+// A counting sort: every batch already knows its size, so
+// each gets its own range and the instances are copied
+// straight into place
+// --------------------------------------------------------
+void InstanceBatcher::Build()
+{
+	unsigned int first = 0;
+	for (InstanceBatch& batch : batches)
+	{
+		batch.FirstInstance = first;
+		first += batch.InstanceCount;
+	}
+
+	instanceData.resize(submissions.size());
+	instanceSources.resize(submissions.size());
+
+	cursors.resize(batches.size());
+	for (size_t i = 0; i < batches.size(); i++)
+		cursors[i] = batches[i].FirstInstance;
+
+	for (const Submission& submission : submissions)
+	{
+		unsigned int slot = cursors[submission.Batch]++;
+		instanceData[slot] = submission.Data;
+		instanceSources[slot] = submission.Source;
+	}
+}
+
+const std::vector<InstanceBatch>& InstanceBatcher::GetBatches() const { return batches; }
+
+const std::vector<InstanceData>& InstanceBatcher::GetInstanceData() const { return instanceData; }
+
+const std::vector<unsigned int>& InstanceBatcher::GetInstanceSources() const { return instanceSources; }
+
+InstanceBatchStats InstanceBatcher::GetStats() const
+{
+	InstanceBatchStats stats = {};
+	stats.Instances = (unsigned int)submissions.size();
+	stats.Batches = (unsigned int)batches.size();
+	for (const InstanceBatch& batch : batches)
+		stats.LargestBatch = (std::max)(stats.LargestBatch, batch.InstanceCount);
+	return stats;
+}
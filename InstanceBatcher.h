@@ -0,0 +1,108 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+// --------------------------------------------------------
+// What one instance hands the instanced vertex shaders
+// (InstancedVertexShader.hlsl), laid out exactly as the
+// per instance input slot reads it
+// --------------------------------------------------------
+struct InstanceData
+{
+	DirectX::XMFLOAT4X4 World;
+	DirectX::XMFLOAT4X4 WorldInvTranspose;
+};
+
+// --------------------------------------------------------
+// A run of instances that share a mesh, material & level of
+// detail, so they can go in one DrawIndexedInstanced()
+// --------------------------------------------------------
+struct InstanceBatch
+{
+	const void* Mesh;
+	const void* Material;
+	int Lod;
+	unsigned int FirstInstance;	// Into GetInstanceData() & GetInstanceSources()
+	unsigned int InstanceCount;
+};
+
+// How much batching saved
+struct InstanceBatchStats
+{
+	unsigned int Instances;		// Everything added (one draw call each without batching)
+	unsigned int Batches;		// Draw calls with batching
+	unsigned int LargestBatch;
+};
+
+// --------------------------------------------------------
+// Groups objects by mesh, material & level of detail and packs
+// their matrices so each group's are next to each other.
+//
+// Meshes & materials are only compared, never used, so this
+// has nothing to do with Direct3D and can run headless (see
+// BenchmarkInstancing()).  Each frame:
+//
+//  - Begin()
+//  - Add() each object
+//  - Build()
+//  - Copy GetInstanceData() into an instance buffer, then
+//    draw each batch starting at its FirstInstance
+//
+// Batches come out in the order their first object was added,
+// and instances within a batch keep the order they were added
+// in, so the output only changes when the input does.
+// --------------------------------------------------------
+class InstanceBatcher
+{
+public:
+	void Begin();
+
+	// "source" is handed back by GetInstanceSources(), to find
+	// whatever each instance came from (such as its entity)
+	void Add(
+		const void* mesh,
+		const void* material,
+		int lod,
+		const DirectX::XMFLOAT4X4& world,
+		const DirectX::XMFLOAT4X4& worldInvTranspose,
+		unsigned int source);
+
+	void Build();
+
+	const std::vector<InstanceBatch>& GetBatches() const;
+	const std::vector<InstanceData>& GetInstanceData() const;
+	const std::vector<unsigned int>& GetInstanceSources() const;
+	InstanceBatchStats GetStats() const;
+
+private:
+	// What Add() was given, before grouping
+	struct Submission
+	{
+		InstanceData Data;
+		unsigned int Source;
+		unsigned int Batch;
+	};
+	std::vector<Submission> submissions;
+
+	std::vector<InstanceBatch> batches;
+	std::vector<InstanceData> instanceData;
+	std::vector<unsigned int> instanceSources;
+	std::vector<unsigned int> cursors;	// Where Build() puts each batch's next instance
+
+	// Which batch each mesh, material & level of detail went in
+	struct BatchKey
+	{
+		const void* Mesh;
+		const void* Material;
+		int Lod;
+		bool operator==(const BatchKey& other) const;
+	};
+	struct BatchKeyHash
+	{
+		size_t operator()(const BatchKey& key) const;
+	};
+	std::unordered_map<BatchKey, unsigned int, BatchKeyHash> batchLookup;
+};
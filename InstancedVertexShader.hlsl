@@ -0,0 +1,32 @@
+#include "ShaderIncludes.hlsli"
+
+cbuffer ExternalData : register(b0)
+{
+	matrix view;
+	matrix projection;
+}
+
+// --------------------------------------------------------
+// The same as VertexShader.hlsl, but each instance brings
+// its own world matrices (see InstanceBatcher.h), so many
+// objects can share one DrawIndexedInstanced()
+// --------------------------------------------------------
+VertexToPixel main( VertexShaderInput input, InstanceInput instance )
+{
+	matrix world = InstanceWorld(instance);
+	matrix worldInvTranspose = InstanceWorldInvTranspose(instance);
+
+	VertexToPixel output;
+
+	matrix wvp = mul(projection, mul(view, world));
+	output.screenPosition = mul(wvp, float4(input.localPosition, 1.0f));
+
+	output.uv = input.uv;
+
+	output.normal = mul((float3x3)worldInvTranspose, input.normal);
+	output.worldPosition = mul(world, float4(input.localPosition, 1)).xyz;
+	output.tangent = mul((float3x3)world, input.tangent);
+	output.tangentSign = input.tangentSign;
+
+	return output;
+}
@@ -0,0 +1,435 @@
+#include "JobSystem.h"
+#include "Profiler.h"
+
+namespace
+{
+	// Which worker (of which system) this thread is, if any
+	thread_local JobSystem* currentSystem = 0;
+	thread_local unsigned int currentWorker = 0;
+
+	// Where a thief starts looking, different for each thread
+	// so they don't all pile onto the same worker
+	thread_local unsigned int stealSeed = 0;
+
+	unsigned int NextVictim(unsigned int count)
+	{
+		if (stealSeed == 0)
+			stealSeed = (unsigned int)std::hash<std::thread::id>()(std::this_thread::get_id()) | 1;
+
+		// xorshift32
+		stealSeed ^= stealSeed << 13;
+		stealSeed ^= stealSeed >> 17;
+		stealSeed ^= stealSeed << 5;
+		return stealSeed % count;
+	}
+
+	// Failed looks for work before an idle worker goes to sleep
+	const int IdleSpins = 64;
+}
+
+JobCounter::JobCounter() :
+	remaining(0),
+	pending(0)
+{
+}
+
+bool JobCounter::IsDone() const
+{
+	return pending.load(std::memory_order_acquire) == 0;
+}
+
+JobSystem::JobSystem(unsigned int workerCount) :
+	mainThread(std::this_thread::get_id()),
+	queued(0),
+	sleeping(0),
+	stopping(false),
+	otherJobsRun(0),
+	otherSteals(0),
+	mainThreadJobsRun(0)
+{
+	// Every worker exists before any starts, so they can all steal from each other
+	for (unsigned int i = 0; i < workerCount; i++)
+		workers.push_back(std::unique_ptr<Worker>(new Worker()));
+
+	for (unsigned int i = 0; i < workerCount; i++)
+	{
+		Worker* worker = workers[i].get();
+		worker->Thread = std::thread([this, worker, i]()
+		{
+			currentSystem = this;
+			currentWorker = i;
+			Profiler::SetThreadName("Job worker");
+			WorkerLoop(worker);
+		});
+	}
+}
+
+// --------------------------------------------------------
+// Lets the workers finish every job that's been started
+// (but not main thread jobs, which are dropped)
+// --------------------------------------------------------
+JobSystem::~JobSystem()
+{
+	stopping = true;
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	wake.notify_all();
+
+	for (std::unique_ptr<Worker>& worker : workers)
+		worker->Thread.join();
+}
+
+JobSystem& JobSystem::GetDefault()
+{
+	static JobSystem system(GetDefaultWorkerCount());
+	return system;
+}
+
+unsigned int JobSystem::GetDefaultWorkerCount()
+{
+	unsigned int cores = std::thread::hardware_concurrency();
+	return cores > 1 ? cores - 1 : 1;
+}
+
+unsigned int JobSystem::GetWorkerCount() { return (unsigned int)workers.size(); }
+
+unsigned int JobSystem::GetThreadCount() { return (unsigned int)workers.size() + 1; }
+
+void JobSystem::SetMainThread()
+{
+	std::lock_guard<std::mutex> lock(mainThreadMutex);
+	mainThread = std::this_thread::get_id();
+}
+
+bool JobSystem::IsMainThread()
+{
+	std::lock_guard<std::mutex> lock(mainThreadMutex);
+	return mainThread == std::this_thread::get_id();
+}
+
+void JobSystem::Run(std::function<void()> job, JobCounter* counter, JobAffinity affinity)
+{
+	if (counter)
+	{
+		counter->remaining++;
+		counter->pending++;
+	}
+
+	QueuedJob queuedJob;
+	queuedJob.Function = std::move(job);
+	queuedJob.Counter = counter;
+	queuedJob.Affinity = affinity;
+	Push(std::move(queuedJob));
+}
+
+// --------------------------------------------------------
+// Either starts the job now, if the dependency's already
+// done, or leaves it for the dependency's last job to start
+// --------------------------------------------------------
+void JobSystem::RunAfter(
+	JobCounter& dependency,
+	std::function<void()> job,
+	JobCounter* counter,
+	JobAffinity affinity)
+{
+	if (counter)
+	{
+		counter->remaining++;
+		counter->pending++;
+	}
+
+	QueuedJob queuedJob;
+	queuedJob.Function = std::move(job);
+	queuedJob.Counter = counter;
+	queuedJob.Affinity = affinity;
+
+	{
+		std::lock_guard<std::mutex> lock(dependency.continuationMutex);
+		if (dependency.remaining.load() != 0)
+		{
+			std::shared_ptr<QueuedJob> later = std::make_shared<QueuedJob>(std::move(queuedJob));
+			dependency.continuations.push_back([this, later]() { Push(std::move(*later)); });
+			return;
+		}
+	}
+	Push(std::move(queuedJob));
+}
+
+// --------------------------------------------------------
+// Queues a job where it belongs: the main thread's queue,
+// this worker's own deque, or the shared queue.  Wakes a
+// sleeping worker if there is one.
+// - "queued" goes up before "sleeping" is read, and a worker
+//   going to sleep bumps "sleeping" before reading "queued",
+//   so one of the two always sees the other
+// --------------------------------------------------------
+void JobSystem::Push(QueuedJob job)
+{
+	if (job.Affinity == JobAffinity::MainThread)
+	{
+		std::lock_guard<std::mutex> lock(mainThreadMutex);
+		mainThreadJobs.push_back(std::move(job));
+		return;
+	}
+
+	Worker* self = GetCurrentWorker();
+	if (self)
+	{
+		std::lock_guard<std::mutex> lock(self->Mutex);
+		self->Jobs.push_back(std::move(job));
+	}
+	else
+	{
+		std::lock_guard<std::mutex> lock(sharedMutex);
+		sharedJobs.push_back(std::move(job));
+	}
+
+	queued++;
+	if (sleeping.load() > 0)
+	{
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+		}
+		wake.notify_one();
+	}
+}
+
+// --------------------------------------------------------
+// The next job for this thread: the newest from its own
+// deque, then (on the main thread) a main thread job, then
+// the oldest shared one, then the oldest from another worker
+// --------------------------------------------------------
+bool JobSystem::FindJob(QueuedJob& job, Worker* self, bool mainThreadJobsToo)
+{
+	if (self)
+	{
+		std::lock_guard<std::mutex> lock(self->Mutex);
+		if (!self->Jobs.empty())
+		{
+			job = std::move(self->Jobs.back());
+			self->Jobs.pop_back();
+			queued--;
+			return true;
+		}
+	}
+
+	if (mainThreadJobsToo)
+	{
+		std::lock_guard<std::mutex> lock(mainThreadMutex);
+		if (!mainThreadJobs.empty())
+		{
+			job = std::move(mainThreadJobs.front());
+			mainThreadJobs.pop_front();
+			return true;
+		}
+	}
+
+	if (queued.load() == 0)
+		return false;
+
+	{
+		std::lock_guard<std::mutex> lock(sharedMutex);
+		if (!sharedJobs.empty())
+		{
+			job = std::move(sharedJobs.front());
+			sharedJobs.pop_front();
+			queued--;
+			return true;
+		}
+	}
+
+	unsigned int count = (unsigned int)workers.size();
+	if (count == 0)
+		return false;
+
+	unsigned int first = NextVictim(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		Worker* victim = workers[(first + i) % count].get();
+		if (victim == self)
+			continue;
+
+		std::lock_guard<std::mutex> lock(victim->Mutex);
+		if (!victim->Jobs.empty())
+		{
+			job = std::move(victim->Jobs.front());
+			victim->Jobs.pop_front();
+			queued--;
+			if (self)
+				self->Steals.fetch_add(1, std::memory_order_relaxed);
+			else
+				otherSteals.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+	return false;
+}
+
+// --------------------------------------------------------
+// Runs a job, keeping any exception on its counter for Wait(),
+// so the counter is always finished
+// --------------------------------------------------------
+void JobSystem::Execute(QueuedJob& job, Worker* self)
+{
+	try
+	{
+		job.Function();
+	}
+	catch (...)
+	{
+		if (!job.Counter)
+			std::terminate();
+
+		std::lock_guard<std::mutex> lock(job.Counter->continuationMutex);
+		if (!job.Counter->exception)
+			job.Counter->exception = std::current_exception();
+	}
+	job.Function = nullptr;	// Let go of anything it holds before the counter says it's done
+
+	if (job.Affinity == JobAffinity::MainThread)
+		mainThreadJobsRun.fetch_add(1, std::memory_order_relaxed);
+	if (self)
+		self->JobsRun.fetch_add(1, std::memory_order_relaxed);
+	else
+		otherJobsRun.fetch_add(1, std::memory_order_relaxed);
+
+	Finish(job.Counter);
+}
+
+// --------------------------------------------------------
+// Counts a job as done, starting whatever was waiting on it
+// if it was the last
+// - Nothing touches the counter after "pending" drops, since
+//   a waiting thread may destroy it as soon as it does
+// --------------------------------------------------------
+void JobSystem::Finish(JobCounter* counter)
+{
+	if (!counter)
+		return;
+
+	if (counter->remaining.fetch_sub(1) == 1)
+	{
+		std::vector<std::function<void()>> continuations;
+		{
+			std::lock_guard<std::mutex> lock(counter->continuationMutex);
+			continuations.swap(counter->continuations);
+		}
+		for (std::function<void()>& start : continuations)
+			start();
+	}
+
+	counter->pending.fetch_sub(1, std::memory_order_release);
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+	WaitQuietly(counter);
+
+	// Taken off the counter, so it can be reused
+	std::exception_ptr exception;
+	{
+		std::lock_guard<std::mutex> lock(counter.continuationMutex);
+		exception = counter.exception;
+		counter.exception = nullptr;
+	}
+	if (exception)
+		std::rethrow_exception(exception);
+}
+
+// Waits without rethrowing, leaving any exception on the counter
+void JobSystem::WaitQuietly(JobCounter& counter)
+{
+	Worker* self = GetCurrentWorker();
+	bool mainThreadJobsToo = IsMainThread();
+	while (!counter.IsDone())
+	{
+		QueuedJob job;
+		if (FindJob(job, self, mainThreadJobsToo))
+			Execute(job, self);
+		else
+			std::this_thread::yield();
+	}
+}
+
+size_t JobSystem::RunMainThreadJobs()
+{
+	if (!IsMainThread())
+		return 0;
+
+	// Just the ones already queued, so jobs that queue more can't keep this going
+	std::deque<QueuedJob> jobs;
+	{
+		std::lock_guard<std::mutex> lock(mainThreadMutex);
+		jobs.swap(mainThreadJobs);
+	}
+
+	for (QueuedJob& job : jobs)
+		Execute(job, GetCurrentWorker());
+	return jobs.size();
+}
+
+// --------------------------------------------------------
+// Runs jobs until the system is destroyed and there are none
+// left, sleeping whenever there's nothing to do for a while
+// --------------------------------------------------------
+void JobSystem::WorkerLoop(Worker* self)
+{
+	int idle = 0;
+	while (true)
+	{
+		QueuedJob job;
+		if (FindJob(job, self, false))
+		{
+			Execute(job, self);
+			idle = 0;
+			continue;
+		}
+
+		if (stopping.load())
+			return;
+
+		if (++idle < IdleSpins)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		sleeping++;
+		wake.wait(lock, [this]() { return queued.load() > 0 || stopping.load(); });
+		sleeping--;
+		idle = 0;
+	}
+}
+
+JobSystem::Worker* JobSystem::GetCurrentWorker()
+{
+	return currentSystem == this ? workers[currentWorker].get() : 0;
+}
+
+JobSystemStats JobSystem::GetStats()
+{
+	JobSystemStats stats = {};
+	stats.Jobs = otherJobsRun.load();
+	stats.Steals = otherSteals.load();
+	stats.MainThreadJobs = mainThreadJobsRun.load();
+	for (std::unique_ptr<Worker>& worker : workers)
+	{
+		stats.Jobs += worker->JobsRun.load();
+		stats.Steals += worker->Steals.load();
+	}
+	return stats;
+}
+
+void JobSystem::ResetStats()
+{
+	otherJobsRun = 0;
+	otherSteals = 0;
+	mainThreadJobsRun = 0;
+	for (std::unique_ptr<Worker>& worker : workers)
+	{
+		worker->JobsRun = 0;
+		worker->Steals = 0;
+	}
+}
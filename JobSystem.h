@@ -0,0 +1,249 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Where a job may run
+enum class JobAffinity
+{
+	Any,		// Any worker, or any thread waiting on a counter
+	MainThread	// Only the main thread, for anything using the immediate context
+};
+
+// --------------------------------------------------------
+// Counts the jobs given it that haven't finished, to wait
+// for them (JobSystem::Wait()) or start more jobs once
+// they're done (JobSystem::RunAfter())
+//
+// It can be reused once it's done.  It must outlive every
+// job counted on it, which Wait() makes sure of.
+//
+// A job that throws still counts as done; the first exception
+// from its jobs is kept, and rethrown by Wait().
+// --------------------------------------------------------
+class JobCounter
+{
+public:
+	JobCounter();
+
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+
+	bool IsDone() const;
+
+private:
+	friend class JobSystem;
+
+	// Both count unfinished jobs.  The last job to finish is
+	// the one that takes "remaining" to zero, and starts the
+	// continuations; "pending" drops last of all, once nothing
+	// touches the counter any more, so it's what Wait() reads.
+	std::atomic<unsigned int> remaining;
+	std::atomic<unsigned int> pending;
+
+	std::mutex continuationMutex;
+	std::vector<std::function<void()>> continuations;
+	std::exception_ptr exception;	// Also guarded by continuationMutex
+};
+
+// What the job system has done since its stats were reset
+struct JobSystemStats
+{
+	unsigned long long Jobs;		// Run to completion
+	unsigned long long Steals;		// Taken from another worker's deque
+	unsigned long long MainThreadJobs;
+};
+
+// --------------------------------------------------------
+// A work stealing job scheduler
+//
+// - Each worker has its own deque.  Jobs a worker starts go
+//   on the back of its own, and it takes its next job from
+//   the back too (the newest, whose data is likely still in
+//   its cache).  A worker with nothing to do steals from the
+//   front of another's (the oldest, which for recursive work
+//   is the biggest).  Jobs started by other threads go in a
+//   shared queue any worker takes from.
+// - A thread waiting on a counter runs jobs until it's done,
+//   so jobs can start & wait for jobs of their own, and a
+//   system with no workers still works (on whoever waits)
+// - Main thread jobs only ever run on the main thread: when
+//   it calls RunMainThreadJobs(), or while it waits
+// - ParallelFor() splits a range between up to a given
+//   number of threads, sizing the pieces as it goes
+// - Idle workers sleep until there are jobs again
+//
+// Everything is thread safe.
+// --------------------------------------------------------
+class JobSystem
+{
+public:
+	// Starts workerCount workers (which can be none)
+	explicit JobSystem(unsigned int workerCount);
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	// The system everything shares, with one worker fewer than
+	// there are cores (the main thread makes up the difference)
+	static JobSystem& GetDefault();
+	static unsigned int GetDefaultWorkerCount();
+
+	unsigned int GetWorkerCount();
+	unsigned int GetThreadCount();	// Workers plus a thread waiting for them
+
+	// The main thread is the one that made the system, unless set
+	void SetMainThread();
+	bool IsMainThread();
+
+	// Starts a job, counted on counter (if there is one).  A job
+	// with no counter has nowhere to send an exception, so one
+	// escaping it ends the program, as it would any thread.
+	void Run(std::function<void()> job, JobCounter* counter = 0, JobAffinity affinity = JobAffinity::Any);
+
+	// Starts a job once everything on dependency is done.  It's
+	// counted on counter straight away, so it can be waited for.
+	void RunAfter(
+		JobCounter& dependency,
+		std::function<void()> job,
+		JobCounter* counter = 0,
+		JobAffinity affinity = JobAffinity::Any);
+
+	// Runs jobs until everything on the counter is done, then
+	// rethrows the first exception any of them threw
+	void Wait(JobCounter& counter);
+
+	// Wait() without rethrowing, leaving any exception on the
+	// counter.  For destructors and cleanup after a throw.
+	void WaitQuietly(JobCounter& counter);
+
+	// Runs every main thread job queued so far; call it from the
+	// main thread now and then.  Returns how many it ran.
+	size_t RunMainThreadJobs();
+
+	// --------------------------------------------------------
+	// Calls job(begin, end) for ranges covering [0, count) on up
+	// to maxThreads threads (0 = all of them), including this
+	// one, returning once they're all done.
+	//
+	// Each thread takes a share of what's left each time it
+	// needs more, so pieces start large and shrink toward the
+	// end, balancing uneven work without a fixed grain size.
+	// No piece is smaller than minGrain, unless it's the last.
+	// --------------------------------------------------------
+	template<typename Job>
+	void ParallelFor(size_t count, const Job& job, size_t minGrain = 1, unsigned int maxThreads = 0)
+	{
+		minGrain = (std::max)(minGrain, (size_t)1);
+		unsigned int threads = GetThreadCount();
+		if (maxThreads != 0)
+			threads = (std::min)(threads, maxThreads);
+		size_t pieces = (count + minGrain - 1) / minGrain;
+		if (threads <= 1 || pieces <= 1)
+		{
+			if (count > 0)
+				job(0, count);
+			return;
+		}
+
+		std::atomic<size_t> next(0);
+		size_t share = (size_t)threads * 2;
+		auto runPieces = [&]()
+		{
+			size_t begin = next.load(std::memory_order_relaxed);
+			while (true)
+			{
+				size_t size;
+				do
+				{
+					if (begin >= count)
+						return;
+					size = (std::min)(count - begin, (std::max)(minGrain, (count - begin) / share));
+				} while (!next.compare_exchange_weak(begin, begin + size));
+
+				job(begin, begin + size);
+				begin = next.load(std::memory_order_relaxed);
+			}
+		};
+
+		// Helpers that start once everything's taken just return.
+		// They use this frame, so it can't be left (by throwing)
+		// until they've all finished.
+		JobCounter helpers;
+		size_t helperCount = (std::min)((size_t)threads - 1, pieces - 1);
+		for (size_t i = 0; i < helperCount; i++)
+			Run(runPieces, &helpers);
+		try
+		{
+			runPieces();
+		}
+		catch (...)
+		{
+			next = count;
+			WaitQuietly(helpers);
+			throw;
+		}
+		Wait(helpers);
+	}
+
+	JobSystemStats GetStats();
+	void ResetStats();
+
+private:
+	struct QueuedJob
+	{
+		std::function<void()> Function;
+		JobCounter* Counter;
+		JobAffinity Affinity;
+	};
+
+	struct Worker
+	{
+		std::thread Thread;
+		std::mutex Mutex;
+		std::deque<QueuedJob> Jobs;
+		std::atomic<unsigned long long> JobsRun;
+		std::atomic<unsigned long long> Steals;
+		Worker() : JobsRun(0), Steals(0) {}
+	};
+
+	std::vector<std::unique_ptr<Worker>> workers;
+
+	// Jobs from threads that aren't workers
+	std::mutex sharedMutex;
+	std::deque<QueuedJob> sharedJobs;
+
+	std::mutex mainThreadMutex;
+	std::deque<QueuedJob> mainThreadJobs;
+	std::thread::id mainThread;
+
+	// Jobs in the deques & the shared queue, for idle workers
+	// to sleep on
+	std::atomic<size_t> queued;
+	std::atomic<unsigned int> sleeping;
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+	std::atomic<bool> stopping;
+
+	// Jobs run & stolen by threads that aren't workers
+	std::atomic<unsigned long long> otherJobsRun;
+	std::atomic<unsigned long long> otherSteals;
+	std::atomic<unsigned long long> mainThreadJobsRun;
+
+	void Push(QueuedJob job);
+	bool FindJob(QueuedJob& job, Worker* self, bool mainThreadJobsToo);
+	void Execute(QueuedJob& job, Worker* self);
+	void Finish(JobCounter* counter);
+	void WorkerLoop(Worker* self);
+	Worker* GetCurrentWorker();
+};
@@ -1,6 +1,10 @@
 
 #include <Windows.h>
+#include <cstdio>
+#include <cstring>
 #include "Game.h"
+#include "Benchmark.h"
+#include "Helpers.h"
 
 // --------------------------------------------------------
 // Entry point for a graphical (non-console) Windows application
@@ -18,6 +22,30 @@ int WINAPI WinMain(
 	_CrtSetDbgFlag( _CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF );
 #endif
 
+	// Run the headless CPU benchmarks instead of the game?
+	//  - No window or Direct3D device is created in this mode
+	//  - Output goes to the console we were launched from, or a new one
+	if (strstr(lpCmdLine, "-benchmark"))
+	{
+		bool ownConsole = !AttachConsole(ATTACH_PARENT_PROCESS);
+		if (ownConsole)
+			AllocConsole();
+
+		FILE* stream;
+		freopen_s(&stream, "CONOUT$", "w", stdout);
+		freopen_s(&stream, "CONIN$", "r", stdin);
+
+		RunBenchmarks(FixPath(L"../../Assets/Models/"));
+
+		// Keep a console we created open long enough to read it
+		if (ownConsole)
+		{
+			printf("Press enter to exit...");
+			getchar();
+		}
+		return 0;
+	}
+
 	// Create the Game object using
 	// the app handle we got from WinMain
 	Game dxGame(hInstance);
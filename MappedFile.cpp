@@ -0,0 +1,100 @@
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include "Helpers.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// --------------------------------------------------------
+// Opens and maps the given file.  If anything fails the
+// object is left closed (IsOpen() returns false), which
+// mirrors how std::ifstream reports a missing file.
+//
+// Empty files are reported as closed too, since there is
+// nothing to map (and mapping zero bytes is an error).
+// --------------------------------------------------------
+MappedFile::MappedFile(const wchar_t* filename) :
+	data(0),
+	size(0),
+	writeTime(0)
+{
+#if defined(_WIN32)
+	fileHandle = INVALID_HANDLE_VALUE;
+	mappingHandle = 0;
+
+	HANDLE file = CreateFileW(
+		filename,
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		0,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+		0);
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+	fileHandle = file;
+
+	FILETIME lastWrite = {};
+	if (GetFileTime(file, 0, 0, &lastWrite))
+		writeTime = ((unsigned long long)lastWrite.dwHighDateTime << 32) | lastWrite.dwLowDateTime;
+
+	LARGE_INTEGER fileSize = {};
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+		return;
+
+	HANDLE mapping = CreateFileMappingW(file, 0, PAGE_READONLY, 0, 0, 0);
+	if (mapping == 0)
+		return;
+	mappingHandle = mapping;
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == 0)
+		return;
+
+	data = (const char*)view;
+	size = (size_t)fileSize.QuadPart;
+#else
+	fileDescriptor = -1;
+
+	// POSIX wants a narrow (UTF-8) path
+	int fd = open(WideToNarrow(filename).c_str(), O_RDONLY);
+	if (fd < 0)
+		return;
+	fileDescriptor = fd;
+
+	struct stat info = {};
+	if (fstat(fd, &info) != 0 || info.st_size == 0)
+		return;
+	writeTime = (unsigned long long)info.st_mtim.tv_sec * 1000000000ull + (unsigned long long)info.st_mtim.tv_nsec;
+
+	void* view = mmap(0, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (view == MAP_FAILED)
+		return;
+	madvise(view, (size_t)info.st_size, MADV_SEQUENTIAL);
+
+	data = (const char*)view;
+	size = (size_t)info.st_size;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#if defined(_WIN32)
+	if (data) UnmapViewOfFile(data);
+	if (mappingHandle) CloseHandle(mappingHandle);
+	if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+#else
+	if (data) munmap((void*)data, size);
+	if (fileDescriptor >= 0) close(fileDescriptor);
+#endif
+}
+
+bool MappedFile::IsOpen() const { return data != 0; }
+const char* MappedFile::GetData() const { return data; }
+size_t MappedFile::GetSize() const { return size; }
+unsigned long long MappedFile::GetWriteTime() const { return writeTime; }
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+
+// --------------------------------------------------------
+// A read-only, memory-mapped view of an entire file
+//
+// - The file's bytes are exposed directly through GetData(),
+//   so nothing is copied into our own buffers while loading
+// - Works on Windows (CreateFileMapping) and on POSIX (mmap),
+//   so the loaders built on top of it can run headless
+// - The mapping is released when the object is destroyed
+// --------------------------------------------------------
+class MappedFile
+{
+public:
+	MappedFile(const wchar_t* filename);
+	~MappedFile();
+
+	// Mappings own OS handles, so they can't be copied
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool IsOpen() const;
+	const char* GetData() const;
+	size_t GetSize() const;
+
+	// When the file was last written, in the OS's own units
+	// (only good for comparing against another time from here)
+	unsigned long long GetWriteTime() const;
+
+private:
+	const char* data;
+	size_t size;
+	unsigned long long writeTime;
+
+#if defined(_WIN32)
+	void* fileHandle;
+	void* mappingHandle;
+#else
+	int fileDescriptor;
+#endif
+};
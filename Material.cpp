@@ -22,6 +22,12 @@ std::shared_ptr<SimpleVertexShader> Material::GetVertexShader() { return vs; }
 
 std::shared_ptr<SimplePixelShader> Material::GetPixelShader() { return ps; }
 
+std::shared_ptr<SimpleVertexShader> Material::GetPackedVertexShader() { return packedVS; }
+
+std::shared_ptr<SimpleVertexShader> Material::GetInstancedVertexShader() { return instancedVS; }
+
+std::shared_ptr<SimpleVertexShader> Material::GetPackedInstancedVertexShader() { return packedInstancedVS; }
+
 void Material::SetColorTint(DirectX::XMFLOAT4 _tint)
 {
 	tint = _tint;
@@ -37,6 +43,19 @@ void Material::SetPixelShader(std::shared_ptr<SimplePixelShader> _ps)
 	ps = _ps;
 }
 
+void Material::SetPackedVertexShader(std::shared_ptr<SimpleVertexShader> _packedVS)
+{
+	packedVS = _packedVS;
+}
+
+void Material::SetInstancedVertexShaders(
+	std::shared_ptr<SimpleVertexShader> _instancedVS,
+	std::shared_ptr<SimpleVertexShader> _packedInstancedVS)
+{
+	instancedVS = _instancedVS;
+	packedInstancedVS = _packedInstancedVS;
+}
+
 void Material::PrepareMaterial() {
 	for (auto& t : textureSRVs) { ps->SetShaderResourceView(t.first.c_str(), t.second); }
 	for (auto& s : samplers) { ps->SetSamplerState(s.first.c_str(), s.second); }
@@ -19,9 +19,21 @@ public:
 	std::shared_ptr<SimpleVertexShader> GetVertexShader();
 	std::shared_ptr<SimplePixelShader> GetPixelShader();
 
+	// Used in place of the vertex shader for packed meshes (see Mesh::IsPacked())
+	std::shared_ptr<SimpleVertexShader> GetPackedVertexShader();
+
+	// Used when drawing many objects with this material at once
+	// (see InstanceBatcher.h), for regular & packed meshes
+	std::shared_ptr<SimpleVertexShader> GetInstancedVertexShader();
+	std::shared_ptr<SimpleVertexShader> GetPackedInstancedVertexShader();
+
 	void SetColorTint(DirectX::XMFLOAT4 _tint);
 	void SetVertexShader(std::shared_ptr<SimpleVertexShader> _vs);
 	void SetPixelShader(std::shared_ptr<SimplePixelShader> _ps);
+	void SetPackedVertexShader(std::shared_ptr<SimpleVertexShader> _packedVS);
+	void SetInstancedVertexShaders(
+		std::shared_ptr<SimpleVertexShader> _instancedVS,
+		std::shared_ptr<SimpleVertexShader> _packedInstancedVS);
 
 	void PrepareMaterial();
 	void AddTextureSRV(std::string shaderName, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
@@ -31,6 +43,9 @@ private:
 	DirectX::XMFLOAT4 tint;
 	std::shared_ptr<SimpleVertexShader> vs;
 	std::shared_ptr<SimplePixelShader> ps;
+	std::shared_ptr<SimpleVertexShader> packedVS;
+	std::shared_ptr<SimpleVertexShader> instancedVS;
+	std::shared_ptr<SimpleVertexShader> packedInstancedVS;
 	float roughness;
 
 	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> textureSRVs;
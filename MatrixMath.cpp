@@ -0,0 +1,97 @@
+#include "MatrixMath.h"
+
+#include <algorithm>
+
+using namespace DirectX;
+
+namespace
+{
+	// Puts -(row . translation) in each row's W, completing the
+	// inverse transpose from its upper 3x3
+	XMMATRIX WithTranslation(FXMVECTOR row0, FXMVECTOR row1, FXMVECTOR row2, GXMVECTOR translation)
+	{
+		return XMMATRIX(
+			XMVectorSetW(row0, -XMVectorGetX(XMVector3Dot(row0, translation))),
+			XMVectorSetW(row1, -XMVectorGetX(XMVector3Dot(row1, translation))),
+			XMVectorSetW(row2, -XMVectorGetX(XMVector3Dot(row2, translation))),
+			XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f));
+	}
+}
+
+XMMATRIX InverseTransposeTRS(FXMVECTOR right, FXMVECTOR up, FXMVECTOR forward, GXMVECTOR scale, HXMVECTOR position)
+{
+	XMVECTOR inverseScale = XMVectorReciprocal(scale);
+	return WithTranslation(
+		right * XMVectorSplatX(inverseScale),
+		up * XMVectorSplatY(inverseScale),
+		forward * XMVectorSplatZ(inverseScale),
+		position);
+}
+
+XMMATRIX AffineInverseTranspose(FXMMATRIX matrix)
+{
+	XMVECTOR cofactor0 = XMVector3Cross(matrix.r[1], matrix.r[2]);
+	XMVECTOR cofactor1 = XMVector3Cross(matrix.r[2], matrix.r[0]);
+	XMVECTOR cofactor2 = XMVector3Cross(matrix.r[0], matrix.r[1]);
+	XMVECTOR inverseDeterminant = XMVectorReciprocal(XMVector3Dot(matrix.r[0], cofactor0));
+
+	return WithTranslation(
+		cofactor0 * inverseDeterminant,
+		cofactor1 * inverseDeterminant,
+		cofactor2 * inverseDeterminant,
+		matrix.r[3]);
+}
+
+// --------------------------------------------------------
+// Transposes four matrices' rows so each vector holds one
+// element from all four, does the cofactor math a lane per
+// matrix, then transposes back
+// --------------------------------------------------------
+void AffineInverseTransposeBatch(const XMFLOAT4X4* matrices, XMFLOAT4X4* results, size_t count)
+{
+	for (size_t first = 0; first < count; first += 4)
+	{
+		// A short last group repeats its last matrix
+		size_t inGroup = (std::min)((size_t)4, count - first);
+		XMMATRIX m[4];
+		for (size_t i = 0; i < 4; i++)
+			m[i] = XMLoadFloat4x4(&matrices[first + (std::min)(i, inGroup - 1)]);
+
+		// e[row].r[column] = that element of all four matrices
+		XMMATRIX e[4];
+		for (int row = 0; row < 4; row++)
+			e[row] = XMMatrixTranspose(XMMATRIX(m[0].r[row], m[1].r[row], m[2].r[row], m[3].r[row]));
+
+		const XMVECTOR* a0 = e[0].r;
+		const XMVECTOR* a1 = e[1].r;
+		const XMVECTOR* a2 = e[2].r;
+		const XMVECTOR* t = e[3].r;
+
+		XMVECTOR c00 = a1[1] * a2[2] - a1[2] * a2[1];
+		XMVECTOR c01 = a1[2] * a2[0] - a1[0] * a2[2];
+		XMVECTOR c02 = a1[0] * a2[1] - a1[1] * a2[0];
+		XMVECTOR c10 = a2[1] * a0[2] - a2[2] * a0[1];
+		XMVECTOR c11 = a2[2] * a0[0] - a2[0] * a0[2];
+		XMVECTOR c12 = a2[0] * a0[1] - a2[1] * a0[0];
+		XMVECTOR c20 = a0[1] * a1[2] - a0[2] * a1[1];
+		XMVECTOR c21 = a0[2] * a1[0] - a0[0] * a1[2];
+		XMVECTOR c22 = a0[0] * a1[1] - a0[1] * a1[0];
+
+		XMVECTOR inverseDeterminant = XMVectorReciprocal(a0[0] * c00 + a0[1] * c01 + a0[2] * c02);
+		c00 *= inverseDeterminant; c01 *= inverseDeterminant; c02 *= inverseDeterminant;
+		c10 *= inverseDeterminant; c11 *= inverseDeterminant; c12 *= inverseDeterminant;
+		c20 *= inverseDeterminant; c21 *= inverseDeterminant; c22 *= inverseDeterminant;
+
+		XMVECTOR w0 = XMVectorNegate(c00 * t[0] + c01 * t[1] + c02 * t[2]);
+		XMVECTOR w1 = XMVectorNegate(c10 * t[0] + c11 * t[1] + c12 * t[2]);
+		XMVECTOR w2 = XMVectorNegate(c20 * t[0] + c21 * t[1] + c22 * t[2]);
+
+		XMMATRIX row0 = XMMatrixTranspose(XMMATRIX(c00, c01, c02, w0));
+		XMMATRIX row1 = XMMatrixTranspose(XMMATRIX(c10, c11, c12, w1));
+		XMMATRIX row2 = XMMatrixTranspose(XMMATRIX(c20, c21, c22, w2));
+		XMVECTOR row3 = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+
+		for (size_t i = 0; i < inGroup; i++)
+			XMStoreFloat4x4(&results[first + i], XMMATRIX(row0.r[i], row1.r[i], row2.r[i], row3));
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstddef>
+
+// --------------------------------------------------------
+// Inverse transposes (for transforming normals) without a
+// general 4x4 inverse
+//
+// Each matches XMMatrixInverse(0, XMMatrixTranspose(m)) for
+// the matrices it's given: the inverse transpose of the upper
+// 3x3, with -(translation * inverse) down the last column.
+// A matrix that can't be inverted (a zero scale) gives
+// infinities, as the general inverse would.
+// --------------------------------------------------------
+
+// Of scale * rotation * translation, given the parts: the
+// rows are just the rotation's rows divided by their scale.
+// right, up & forward must be orthonormal (the rows of the
+// rotation matrix).
+DirectX::XMMATRIX InverseTransposeTRS(
+	DirectX::FXMVECTOR right,
+	DirectX::FXMVECTOR up,
+	DirectX::FXMVECTOR forward,
+	DirectX::GXMVECTOR scale,
+	DirectX::HXMVECTOR position);
+
+// Of any matrix whose last column is (0, 0, 0, 1), such as a
+// chain of the above (which can be sheared): each row is a
+// cross product of the other two, over the determinant
+DirectX::XMMATRIX AffineInverseTranspose(DirectX::FXMMATRIX matrix);
+
+// The same for many matrices at once, four at a time with one
+// matrix per SSE lane.  results may be the same as matrices.
+void AffineInverseTransposeBatch(
+	const DirectX::XMFLOAT4X4* matrices,
+	DirectX::XMFLOAT4X4* results,
+	size_t count);
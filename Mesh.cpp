@@ -1,6 +1,7 @@
 #include "Mesh.h"
-#include <vector>
-#include <fstream>
+#include "TangentGeneratorSIMD.h"
+#include "Profiler.h"
+#include <cstdio>
 #include <DirectXMath.h>
 
 using namespace DirectX;
@@ -12,235 +13,89 @@ Mesh::Mesh(
 	int numIndices,
 	Microsoft::WRL::ComPtr<ID3D11Device> bufferCreator)
 	:
-	numIndices(numIndices)
+	numIndices(numIndices),
+	numVertices(numVertices),
+	sourceVertexCount(numVertices),
+	boundsMin(0, 0, 0),
+	boundsMax(0, 0, 0),
+	bounds(),
+	packed(false),
+	vertexStride(sizeof(Vertex)),
+	packingError()
 {
+	if (numVertices > 0)
+	{
+		XMVECTOR minPos = XMLoadFloat3(&objArray[0].Position);
+		XMVECTOR maxPos = minPos;
+		for (int i = 1; i < numVertices; i++)
+		{
+			XMVECTOR pos = XMLoadFloat3(&objArray[i].Position);
+			minPos = XMVectorMin(minPos, pos);
+			maxPos = XMVectorMax(maxPos, pos);
+		}
+		XMStoreFloat3(&boundsMin, minPos);
+		XMStoreFloat3(&boundsMax, maxPos);
+	}
+	CalculateMeshBounds(objArray, numVertices, bounds);
+
+	MeshLod full = { 0, (unsigned int)numIndices, 0.0f };
+	lods.push_back(full);
+
 	CalculateTangents(objArray, numVertices, indices, numIndices);
 	SetBufferData(objArray, numVertices, indices, numIndices, bufferCreator);
+
+	std::shared_ptr<MeshBVH> newBVH = std::make_shared<MeshBVH>();
+	newBVH->Build(objArray, numVertices, indices, numIndices);
+	bvh = newBVH;
+
+	BuildOccluder(objArray, numVertices, indices);
 }
 
 Mesh::Mesh(const wchar_t* filename, 
+	Microsoft::WRL::ComPtr<ID3D11Device> bufferCreator,
+	MeshLoadOptions options)
+	:
+	numIndices(0),
+	numVertices(0),
+	sourceVertexCount(0),
+	boundsMin(0, 0, 0),
+	boundsMax(0, 0, 0),
+	bounds(),
+	packed(false),
+	vertexStride(sizeof(Vertex)),
+	packingError()
+{
+	// Load the file into GPU-ready vertex & index arrays
+	// - The first load parses, welds and calculates tangents (see MeshLoader.cpp),
+	//   then saves the result to a .dxmesh cache file next to the .obj
+	// - Later loads just memory-map that cache, so the arrays below
+	//   point straight at the file's bytes and nothing is parsed at all
+	LoadedMesh data;
+	if (!LoadMeshFile(filename, options, data))
+		return;
+
+	CreateFromLoadedMesh(filename, data, bufferCreator);
+}
+
+Mesh::Mesh(const wchar_t* name,
+	const LoadedMesh& data,
 	Microsoft::WRL::ComPtr<ID3D11Device> bufferCreator)
+	:
+	numIndices(0),
+	numVertices(0),
+	sourceVertexCount(0),
+	boundsMin(0, 0, 0),
+	boundsMax(0, 0, 0),
+	bounds(),
+	packed(false),
+	vertexStride(sizeof(Vertex)),
+	packingError()
 {
-	// Load mesh
-	
-	// Author: Chris Cascioli
-	// Purpose: Basic .OBJ 3D model loading, supporting positions, uvs and normals
-	// 
-	// - You are allowed to directly copy/paste this into your code base
-	//   for assignments, given that you clearly cite that this is not
-	//   code of your own design.
-	//
-	// - NOTE: You'll need to #include <fstream>
-	
-	
-	// File input object
-	std::ifstream obj(filename);
-	
-	// Check for successful open
-	if (!obj.is_open())
+	// An empty mesh (a file that failed to load) stays empty
+	if (data.VertexCount == 0)
 		return;
-	
-	// Variables used while reading the file
-	std::vector<XMFLOAT3> positions;	// Positions from the file
-	std::vector<XMFLOAT3> normals;		// Normals from the file
-	std::vector<XMFLOAT2> uvs;		// UVs from the file
-	std::vector<Vertex> verts;		// Verts we're assembling
-	std::vector<UINT> indices;		// Indices of these verts
-	int vertCounter = 0;			// Count of vertices
-	int indexCounter = 0;			// Count of indices
-	char chars[100];			// String for line reading
-	
-	// Still have data left?
-	while (obj.good())
-	{
-		// Get the line (100 characters should be more than enough)
-		obj.getline(chars, 100);
-	
-		// Check the type of line
-		if (chars[0] == 'v' && chars[1] == 'n')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 norm;
-			sscanf_s(
-				chars,
-				"vn %f %f %f",
-				&norm.x, &norm.y, &norm.z);
-	
-			// Add to the list of normals
-			normals.push_back(norm);
-		}
-		else if (chars[0] == 'v' && chars[1] == 't')
-		{
-			// Read the 2 numbers directly into an XMFLOAT2
-			XMFLOAT2 uv;
-			sscanf_s(
-				chars,
-				"vt %f %f",
-				&uv.x, &uv.y);
-	
-			// Add to the list of uv's
-			uvs.push_back(uv);
-		}
-		else if (chars[0] == 'v')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 pos;
-			sscanf_s(
-				chars,
-				"v %f %f %f",
-				&pos.x, &pos.y, &pos.z);
-	
-			// Add to the positions
-			positions.push_back(pos);
-		}
-		else if (chars[0] == 'f')
-		{
-			// Read the face indices into an array
-			// NOTE: This assumes the given obj file contains
-			//  vertex positions, uv coordinates AND normals.
-			unsigned int i[12];
-			int numbersRead = sscanf_s(
-				chars,
-				"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
-				&i[0], &i[1], &i[2],
-				&i[3], &i[4], &i[5],
-				&i[6], &i[7], &i[8],
-				&i[9], &i[10], &i[11]);
-	
-			// If we only got the first number, chances are the OBJ
-			// file has no UV coordinates.  This isn't great, but we
-			// still want to load the model without crashing, so we
-			// need to re-read a different pattern (in which we assume
-			// there are no UVs denoted for any of the vertices)
-			if (numbersRead == 1)
-			{
-				// Re-read with a different pattern
-				numbersRead = sscanf_s(
-					chars,
-					"f %d//%d %d//%d %d//%d %d//%d",
-					&i[0], &i[2],
-					&i[3], &i[5],
-					&i[6], &i[8],
-					&i[9], &i[11]);
-	
-				// The following indices are where the UVs should 
-				// have been, so give them a valid value
-				i[1] = 1;
-				i[4] = 1;
-				i[7] = 1;
-				i[10] = 1;
-	
-				// If we have no UVs, create a single UV coordinate
-				// that will be used for all vertices
-				if (uvs.size() == 0)
-					uvs.push_back(XMFLOAT2(0, 0));
-			}
-	
-			// - Create the verts by looking up
-			//    corresponding data from vectors
-			// - OBJ File indices are 1-based, so
-			//    they need to be adusted
-			Vertex v1;
-			v1.Position = positions[i[0] - 1];
-			v1.UV = uvs[i[1] - 1];
-			v1.Normal = normals[i[2] - 1];
-	
-			Vertex v2;
-			v2.Position = positions[i[3] - 1];
-			v2.UV = uvs[i[4] - 1];
-			v2.Normal = normals[i[5] - 1];
-	
-			Vertex v3;
-			v3.Position = positions[i[6] - 1];
-			v3.UV = uvs[i[7] - 1];
-			v3.Normal = normals[i[8] - 1];
-	
-			// The model is most likely in a right-handed space,
-			// especially if it came from Maya.  We want to convert
-			// to a left-handed space for DirectX.  This means we 
-			// need to:
-			//  - Invert the Z position
-			//  - Invert the normal's Z
-			//  - Flip the winding order
-			// We also need to flip the UV coordinate since DirectX
-			// defines (0,0) as the top left of the texture, and many
-			// 3D modeling packages use the bottom left as (0,0)
-	
-			// Flip the UV's since they're probably "upside down"
-			v1.UV.y = 1.0f - v1.UV.y;
-			v2.UV.y = 1.0f - v2.UV.y;
-			v3.UV.y = 1.0f - v3.UV.y;
-	
-			// Flip Z (LH vs. RH)
-			v1.Position.z *= -1.0f;
-			v2.Position.z *= -1.0f;
-			v3.Position.z *= -1.0f;
-	
-			// Flip normal's Z
-			v1.Normal.z *= -1.0f;
-			v2.Normal.z *= -1.0f;
-			v3.Normal.z *= -1.0f;
-	
-			// Add the verts to the vector (flipping the winding order)
-			verts.push_back(v1);
-			verts.push_back(v3);
-			verts.push_back(v2);
-			vertCounter += 3;
-	
-			// Add three more indices
-			indices.push_back(indexCounter); indexCounter += 1;
-			indices.push_back(indexCounter); indexCounter += 1;
-			indices.push_back(indexCounter); indexCounter += 1;
-	
-			// Was there a 4th face?
-			// - 12 numbers read means 4 faces WITH uv's
-			// - 8 numbers read means 4 faces WITHOUT uv's
-			if (numbersRead == 12 || numbersRead == 8)
-			{
-				// Make the last vertex
-				Vertex v4;
-				v4.Position = positions[i[9] - 1];
-				v4.UV = uvs[i[10] - 1];
-				v4.Normal = normals[i[11] - 1];
-	
-				// Flip the UV, Z pos and normal's Z
-				v4.UV.y = 1.0f - v4.UV.y;
-				v4.Position.z *= -1.0f;
-				v4.Normal.z *= -1.0f;
-	
-				// Add a whole triangle (flipping the winding order)
-				verts.push_back(v1);
-				verts.push_back(v4);
-				verts.push_back(v3);
-				vertCounter += 3;
-	
-				// Add three more indices
-				indices.push_back(indexCounter); indexCounter += 1;
-				indices.push_back(indexCounter); indexCounter += 1;
-				indices.push_back(indexCounter); indexCounter += 1;
-			}
-		}
-	}
-	
-	// Close the file and create the actual buffers
-	obj.close();
-	
-	// - At this point, "verts" is a vector of Vertex structs, and can be used
-	//    directly to create a vertex buffer:  &verts[0] is the address of the first vert
-	//
-	// - The vector "indices" is similar. It's a vector of unsigned ints and
-	//    can be used directly for the index buffer: &indices[0] is the address of the first int
-	//
-	// - "vertCounter" is the number of vertices
-	// - "indexCounter" is the number of indices
-	// - Yes, these are effectively the same since OBJs do not index entire vertices!  This means
-	//    an index buffer isn't doing much for us.  We could try to optimize the mesh ourselves
-	//    and detect duplicate vertices, but at that point it would be better to use a more
-	//    sophisticated model loading library like TinyOBJLoader or The Open Asset Importer Library
-	
-	numIndices = indexCounter;
-	CalculateTangents(&verts[0], vertCounter, &indices[0], indexCounter);
-	SetBufferData(&verts[0], vertCounter, &indices[0], indexCounter, bufferCreator);
+
+	CreateFromLoadedMesh(name, data, bufferCreator);
 }
 
 Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetVertexBuffer() {
@@ -255,11 +110,77 @@ int Mesh::GetIndexCount() {
 	return numIndices;
 }
 
-void Mesh::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context) {
+int Mesh::GetVertexCount() {
+	return numVertices;
+}
+
+int Mesh::GetSourceVertexCount() {
+	return sourceVertexCount;
+}
+
+XMFLOAT3 Mesh::GetBoundsMin() {
+	return boundsMin;
+}
+
+XMFLOAT3 Mesh::GetBoundsMax() {
+	return boundsMax;
+}
+
+const BoundingBox& Mesh::GetBoundingBox() {
+	return bounds.Box;
+}
+
+const BoundingSphere& Mesh::GetBoundingSphere() {
+	return bounds.Sphere;
+}
+
+const BoundingOrientedBox& Mesh::GetOrientedBoundingBox() {
+	return bounds.OrientedBox;
+}
+
+int Mesh::GetLodCount() {
+	return (int)lods.size();
+}
+
+MeshLod Mesh::GetLod(int lod) {
+	return lods[lod];
+}
+
+std::shared_ptr<const MeshBVH> Mesh::GetBVH() {
+	return bvh;
+}
+
+std::shared_ptr<const OccluderMesh> Mesh::GetOccluder() {
+	return occluder;
+}
+
+bool Mesh::IsPacked() {
+	return packed;
+}
+
+PackedVertexError Mesh::GetPackingError() {
+	return packingError;
+}
+
+int Mesh::SelectLod(float distance, float pixelsPerUnit, float maxPixelError) {
+	// Errors only get bigger with each level, so take the last one that's small enough
+	int lod = 0;
+	float maxError = maxPixelError * distance / pixelsPerUnit;
+	while (lod + 1 < (int)lods.size() && lods[lod + 1].Error <= maxError)
+		lod++;
+
+	return lod;
+}
+
+void Mesh::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, int lod) {
+	// Nothing to draw if the file failed to load
+	if (lods.empty())
+		return;
+
 	// DRAW geometry
 	// - These steps are generally repeated for EACH object you draw
 	// - Other Direct3D calls will also be necessary to do more complex things
-	UINT stride = sizeof(Vertex);
+	UINT stride = vertexStride;
 	UINT offset = 0;
 	{
 		// Set buffers in the input assembler (IA) stage
@@ -276,16 +197,135 @@ void Mesh::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context) {
 		//  - This will use all currently set Direct3D resources (shaders, buffers, etc)
 		//  - DrawIndexed() uses the currently set INDEX BUFFER to look up corresponding
 		//     vertices in the currently set VERTEX BUFFER
+		//  - Each level of detail is its own range of the index buffer
 		context->DrawIndexed(
-			numIndices,     // The number of indices to use (we could draw a subset if we wanted)
-			0,				// Offset to the first index we want to use
-			0);				// Offset to add to each index when looking up vertices
+			lods[lod].IndexCount,	// The number of indices to use (we could draw a subset if we wanted)
+			lods[lod].IndexOffset,	// Offset to the first index we want to use
+			0);						// Offset to add to each index when looking up vertices
+	}
+}
+
+void Mesh::DrawInstanced(
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	int lod,
+	Microsoft::WRL::ComPtr<ID3D11Buffer> instances,
+	unsigned int instanceStride,
+	unsigned int firstInstance,
+	unsigned int instanceCount)
+{
+	if (lods.empty() || instanceCount == 0)
+		return;
+
+	// Slot 0 has the vertices, slot 1 the instances (where
+	// SimpleVertexShader expects "_PER_INSTANCE" inputs)
+	ID3D11Buffer* buffers[2] = { vertexBuffer.Get(), instances.Get() };
+	UINT strides[2] = { (UINT)vertexStride, instanceStride };
+	UINT offsets[2] = { 0, 0 };
+	context->IASetVertexBuffers(0, 2, buffers, strides, offsets);
+	context->IASetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+
+	context->DrawIndexedInstanced(
+		lods[lod].IndexCount,
+		instanceCount,
+		lods[lod].IndexOffset,
+		0,
+		firstInstance);	// Per instance data starts this far into the instance buffer
+}
+
+const std::vector<Meshlet>& Mesh::GetMeshlets() {
+	return meshlets;
+}
+
+void Mesh::DrawMeshlets(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, const std::vector<unsigned int>& visible) {
+	if (visible.empty())
+		return;
+
+	UINT stride = vertexStride;
+	UINT offset = 0;
+	context->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
+	context->IASetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+
+	// Neighbouring meshlets are next to each other in the index buffer,
+	// so each run of visible ones can go in a single draw
+	size_t i = 0;
+	while (i < visible.size())
+	{
+		const Meshlet& first = meshlets[visible[i]];
+		unsigned int indexCount = first.TriangleCount * 3;
+		size_t next = i + 1;
+		while (next < visible.size() && visible[next] == visible[next - 1] + 1)
+		{
+			indexCount += meshlets[visible[next]].TriangleCount * 3;
+			next++;
+		}
+
+		context->DrawIndexed(indexCount, first.IndexOffset, 0);
+		i = next;
 	}
 }
 
-void Mesh::SetBufferData(Vertex* objArray,
+// --------------------------------------------------------
+// Takes everything from an already loaded mesh file and
+// creates its buffers
+// --------------------------------------------------------
+void Mesh::CreateFromLoadedMesh(const wchar_t* name,
+	const LoadedMesh& data,
+	Microsoft::WRL::ComPtr<ID3D11Device> bufferCreator)
+{
+	PROFILE_SCOPE("Mesh::CreateFromLoadedMesh");
+	numVertices = (int)data.VertexCount;
+	numIndices = (int)data.IndexCount;
+	sourceVertexCount = (int)data.SourceVertexCount;
+	boundsMin = data.BoundsMin;
+	boundsMax = data.BoundsMax;
+	bounds = data.Bounds;
+	bvh = data.BVH;
+	lods = data.Lods;
+	meshlets = data.Meshlets;
+	packed = !data.PackedVertices.empty();
+	vertexStride = packed ? sizeof(PackedVertex) : sizeof(Vertex);
+	packingError = data.PackingError;
+	BuildOccluder(data.Vertices, numVertices, data.Indices);
+
+#if defined(DEBUG) || defined(_DEBUG)
+	// One line per mesh; the benchmarks report the details
+	printf("Loaded %ls%s: %d -> %d vertices, %zu LODs, %zu meshlets%s\n",
+		name,
+		data.FromCache ? " (cached)" : "",
+		sourceVertexCount,
+		numVertices,
+		lods.size(),
+		meshlets.size(),
+		packed ? ", packed" : "");
+#endif
+
+	if (packed)
+		SetBufferData(data.PackedVertices.data(), numVertices, data.Indices, numIndices, bufferCreator);
+	else
+		SetBufferData(data.Vertices, numVertices, data.Indices, numIndices, bufferCreator);
+}
+
+// --------------------------------------------------------
+// Copies the simplest level of detail that stays within 1% of
+// the mesh's size of the full one into an occluder
+// - Simplifying only ever moves vertices onto other vertices,
+//   so it never sticks out past the mesh's bounding box
+// --------------------------------------------------------
+void Mesh::BuildOccluder(const Vertex* vertices, int numVertices, const unsigned int* indices)
+{
+	size_t lod = 0;
+	while (lod + 1 < lods.size() && lods[lod + 1].Error <= bounds.Sphere.Radius * 0.01f)
+		lod++;
+
+	std::shared_ptr<OccluderMesh> newOccluder = std::make_shared<OccluderMesh>();
+	if (!lods.empty())
+		newOccluder->Build(vertices, numVertices, indices + lods[lod].IndexOffset, lods[lod].IndexCount);
+	occluder = newOccluder;
+}
+
+void Mesh::SetBufferData(const void* vertexData,
 	int numVertices,
-	unsigned int* indices,
+	const unsigned int* indices,
 	int numIndices,
 	Microsoft::WRL::ComPtr<ID3D11Device> bufferCreator)
 {
@@ -299,7 +339,7 @@ void Mesh::SetBufferData(Vertex* objArray,
 		//  - After the buffer is created, this description variable is unnecessary
 		D3D11_BUFFER_DESC vbd = {};
 		vbd.Usage = D3D11_USAGE_IMMUTABLE;	// Will NEVER change
-		vbd.ByteWidth = sizeof(Vertex) * numVertices;       // 3 = number of vertices in the buffer
+		vbd.ByteWidth = vertexStride * numVertices;       // 3 = number of vertices in the buffer
 		vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER; // Tells Direct3D this is a vertex buffer
 		vbd.CPUAccessFlags = 0;	// Note: We cannot access the data from C++ (this is good)
 		vbd.MiscFlags = 0;
@@ -309,7 +349,7 @@ void Mesh::SetBufferData(Vertex* objArray,
 		// - This is how we initially fill the buffer with data
 		// - Essentially, we're specifying a pointer to the data to copy
 		D3D11_SUBRESOURCE_DATA initialVertexData = {};
-		initialVertexData.pSysMem = objArray; // pSysMem = Pointer to System Memory
+		initialVertexData.pSysMem = vertexData; // pSysMem = Pointer to System Memory
 
 		// Actually create the buffer on the GPU with the initial data
 		// - Once we do this, we'll NEVER CHANGE DATA IN THE BUFFER AGAIN
@@ -344,93 +384,14 @@ void Mesh::SetBufferData(Vertex* objArray,
 }
 
 // --------------------------------------------------------
-// Author: Chris Cascioli
-// Purpose: Calculates the tangents of the vertices in a mesh
-// 
-// - You are allowed to directly copy/paste this into your code base
-//   for assignments, given that you clearly cite that this is not
-//   code of your own design.
-//
-// - Code originally adapted from: http://www.terathon.com/code/tangent.html
-//   - Updated version now found here: http://foundationsofgameenginedev.com/FGED2-sample.pdf
-//   - See listing 7.4 in section 7.5 (page 9 of the PDF)
-//
-// - Note: For this code to work, your Vertex format must
-//         contain an XMFLOAT3 called Tangent
-//
+// Calculates the tangents of the vertices in a mesh
+// - See TangentGenerator.cpp for the details, and
+//   TangentGeneratorSIMD.cpp for the version used here
 // - Be sure to call this BEFORE creating your D3D vertex/index buffers
 // --------------------------------------------------------
 void Mesh::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices)
 {
-	// Reset tangents
-	for (int i = 0; i < numVerts; i++)
-	{
-		verts[i].Tangent = XMFLOAT3(0, 0, 0);
-	}
-
-	// Calculate tangents one whole triangle at a time
-	for (int i = 0; i < numIndices;)
-	{
-		// Grab indices and vertices of first triangle
-		unsigned int i1 = indices[i++];
-		unsigned int i2 = indices[i++];
-		unsigned int i3 = indices[i++];
-		Vertex* v1 = &verts[i1];
-		Vertex* v2 = &verts[i2];
-		Vertex* v3 = &verts[i3];
-
-		// Calculate vectors relative to triangle positions
-		float x1 = v2->Position.x - v1->Position.x;
-		float y1 = v2->Position.y - v1->Position.y;
-		float z1 = v2->Position.z - v1->Position.z;
-
-		float x2 = v3->Position.x - v1->Position.x;
-		float y2 = v3->Position.y - v1->Position.y;
-		float z2 = v3->Position.z - v1->Position.z;
-
-		// Do the same for vectors relative to triangle uv's
-		float s1 = v2->UV.x - v1->UV.x;
-		float t1 = v2->UV.y - v1->UV.y;
-
-		float s2 = v3->UV.x - v1->UV.x;
-		float t2 = v3->UV.y - v1->UV.y;
-
-		// Create vectors for tangent calculation
-		float r = 1.0f / (s1 * t2 - s2 * t1);
-
-		float tx = (t2 * x1 - t1 * x2) * r;
-		float ty = (t2 * y1 - t1 * y2) * r;
-		float tz = (t2 * z1 - t1 * z2) * r;
-
-		// Adjust tangents of each vert of the triangle
-		v1->Tangent.x += tx;
-		v1->Tangent.y += ty;
-		v1->Tangent.z += tz;
-
-		v2->Tangent.x += tx;
-		v2->Tangent.y += ty;
-		v2->Tangent.z += tz;
-
-		v3->Tangent.x += tx;
-		v3->Tangent.y += ty;
-		v3->Tangent.z += tz;
-	}
-
-	// Ensure all of the tangents are orthogonal to the normals
-	for (int i = 0; i < numVerts; i++)
-	{
-		// Grab the two vectors
-		XMVECTOR normal = XMLoadFloat3(&verts[i].Normal);
-		XMVECTOR tangent = XMLoadFloat3(&verts[i].Tangent);
-
-		// Use Gram-Schmidt orthonormalize to ensure
-		// the normal and tangent are exactly 90 degrees apart
-		tangent = XMVector3Normalize(
-			tangent - normal * XMVector3Dot(normal, tangent));
-
-		// Store the tangent
-		XMStoreFloat3(&verts[i].Tangent, tangent);
-	}
+	GenerateTangentsParallel(verts, numVerts, indices, numIndices);
 }
 
 Mesh::~Mesh() {
@@ -1,8 +1,15 @@
 #pragma once
 
 #include "Vertex.h"
+#include "MeshLoader.h"
+#include "MeshBounds.h"
+#include "OcclusionCulling.h"
+#include <DirectXMath.h>
 #include <d3d11.h>
 #include <wrl/client.h>
+#include <memory>
+#include <vector>
+
 class Mesh
 {
 public:
@@ -13,23 +20,94 @@ public:
 		int numIndices,
 		Microsoft::WRL::ComPtr<ID3D11Device> bufferCreator);
 	Mesh(const wchar_t* filename, 
+		Microsoft::WRL::ComPtr<ID3D11Device> bufferCreator,
+		MeshLoadOptions options = MeshLoadOptions());
+
+	// From a file that's already been loaded (on any thread, see
+	// AssetLoader.h); "name" is only used for debug output
+	Mesh(const wchar_t* name,
+		const LoadedMesh& data,
 		Microsoft::WRL::ComPtr<ID3D11Device> bufferCreator);
 	~Mesh();
 
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer();
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer();
 	int GetIndexCount();
-	void Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+	int GetVertexCount();
+	int GetSourceVertexCount();
+	DirectX::XMFLOAT3 GetBoundsMin();
+	DirectX::XMFLOAT3 GetBoundsMax();
+
+	// Bounding volumes in the mesh's own space, found while
+	// loading (see MeshBounds.h for moving them into world space)
+	const DirectX::BoundingBox& GetBoundingBox();
+	const DirectX::BoundingSphere& GetBoundingSphere();
+	const DirectX::BoundingOrientedBox& GetOrientedBoundingBox();
+	int GetLodCount();
+	MeshLod GetLod(int lod);
+
+	// For ray casts against the full detail triangles, in the mesh's
+	// own space; null if it wasn't built (see MeshLoadOptions::BuildBVH)
+	std::shared_ptr<const MeshBVH> GetBVH();
+
+	// The positions of a simplified level of detail, to draw into
+	// an OcclusionBuffer when this mesh is used as an occluder
+	std::shared_ptr<const OccluderMesh> GetOccluder();
+
+	// Whether the vertex buffer holds PackedVertex instead of Vertex
+	// (loaded with options.PackVertices), which needs a vertex shader
+	// that decodes them, like PackedVertexShader.hlsl
+	bool IsPacked();
+	PackedVertexError GetPackingError();
+
+	// Picks the simplest level of detail whose error, projected onto the
+	// screen, stays under maxPixelError.  "pixelsPerUnit" is how many pixels
+	// one unit of the mesh covers at a distance of one unit (see GameEntity).
+	int SelectLod(float distance, float pixelsPerUnit, float maxPixelError);
+
+	void Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, int lod = 0);
+
+	// Draws instanceCount copies in one call, for a vertex shader with
+	// per instance inputs, which are read from "instances" (bound as
+	// the second vertex buffer) starting at firstInstance
+	void DrawInstanced(
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		int lod,
+		Microsoft::WRL::ComPtr<ID3D11Buffer> instances,
+		unsigned int instanceStride,
+		unsigned int firstInstance,
+		unsigned int instanceCount);
+
+	// Clusters of the full detail level (see MeshletBuilder.h), and
+	// drawing just the given ones (such as those from CullMeshlets)
+	const std::vector<Meshlet>& GetMeshlets();
+	void DrawMeshlets(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, const std::vector<unsigned int>& visible);
 	void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
 
 private:
 	Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer;
 	Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
 	int numIndices;
+	int numVertices;
+	int sourceVertexCount;	// Vertices before welding (one per face corner)
+	DirectX::XMFLOAT3 boundsMin;
+	DirectX::XMFLOAT3 boundsMax;
+	MeshBounds bounds;
+	std::shared_ptr<const MeshBVH> bvh;
+	std::shared_ptr<const OccluderMesh> occluder;
+	std::vector<MeshLod> lods;	// Ranges of the index buffer, full detail first
+	std::vector<Meshlet> meshlets;
+	bool packed;
+	unsigned int vertexStride;	// sizeof(Vertex) or sizeof(PackedVertex)
+	PackedVertexError packingError;
 
-	void SetBufferData(Vertex* objArray,
+	void CreateFromLoadedMesh(const wchar_t* name,
+		const LoadedMesh& data,
+		Microsoft::WRL::ComPtr<ID3D11Device> bufferCreator);
+	void BuildOccluder(const Vertex* vertices, int numVertices, const unsigned int* indices);
+	void SetBufferData(const void* vertexData,
 		int numVertices, 
-		unsigned int* indices,
+		const unsigned int* indices,
 		int numIndices,
 		Microsoft::WRL::ComPtr<ID3D11Device> bufferCreator);
 };
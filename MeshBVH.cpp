@@ -0,0 +1,789 @@
+#include "MeshBVH.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <memory>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define BVH_SIMD_X86
+#include <emmintrin.h>
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+	const int BinCount = 16;
+	const unsigned int MaxLeafTriangles = 16;
+
+	// Relative costs for the surface area heuristic: a box test
+	// is about as expensive as a packet of 4 triangle tests
+	const float TraversalCost = 1.0f;
+	const float PacketCost = 1.0f;
+
+	// Past this depth, ranges are split in half instead, so the
+	// tree (and the traversal stack) can't get too deep
+	const unsigned int MaxSahDepth = 64;
+	const unsigned int MaxStackDepth = 128;
+
+	// Meshes smaller than this aren't worth the threads
+	const size_t MinParallelTriangles = 16384;
+
+	unsigned int PacketCount(unsigned int triangles)
+	{
+		return (triangles + 3) / 4;
+	}
+
+	// Padded to 4 floats per corner, so growing one box by
+	// another is a single SSE min & max
+	struct Bounds
+	{
+		float Min[4];
+		float Max[4];
+
+		void Reset()
+		{
+			for (int a = 0; a < 4; a++)
+			{
+				Min[a] = FLT_MAX;
+				Max[a] = -FLT_MAX;
+			}
+		}
+
+		void Grow(const Bounds& other)
+		{
+#if defined(BVH_SIMD_X86)
+			_mm_storeu_ps(Min, _mm_min_ps(_mm_loadu_ps(Min), _mm_loadu_ps(other.Min)));
+			_mm_storeu_ps(Max, _mm_max_ps(_mm_loadu_ps(Max), _mm_loadu_ps(other.Max)));
+#else
+			for (int a = 0; a < 3; a++)
+			{
+				Min[a] = (std::min)(Min[a], other.Min[a]);
+				Max[a] = (std::max)(Max[a], other.Max[a]);
+			}
+#endif
+		}
+
+		void Grow(const float* point)
+		{
+			for (int a = 0; a < 3; a++)
+			{
+				Min[a] = (std::min)(Min[a], point[a]);
+				Max[a] = (std::max)(Max[a], point[a]);
+			}
+		}
+
+		// Half the surface area, which is all the heuristic needs
+		float Area() const
+		{
+			float x = Max[0] - Min[0];
+			float y = Max[1] - Min[1];
+			float z = Max[2] - Min[2];
+			if (x < 0.0f || y < 0.0f || z < 0.0f)
+				return 0.0f;
+			return x * y + y * z + z * x;
+		}
+	};
+
+	// The inverse direction, nudging zeros so the slab test never
+	// ends up multiplying zero by infinity
+	void InverseDirection(const XMFLOAT3& direction, float* inverse)
+	{
+		const float* d = &direction.x;
+		for (int a = 0; a < 3; a++)
+		{
+			float component = d[a];
+			if (std::fabs(component) < 1e-20f)
+				component = component < 0.0f ? -1e-20f : 1e-20f;
+			inverse[a] = 1.0f / component;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Builds one part of the tree (or all of it) into its own
+// arrays, so parts can be built on different threads and
+// joined together afterwards
+// --------------------------------------------------------
+class MeshBVHBuilder
+{
+public:
+	typedef MeshBVH::Node Node;
+	typedef MeshBVH::TrianglePacket TrianglePacket;
+
+	// A range of triangles still to be split (or made a leaf)
+	struct Task
+	{
+		unsigned int NodeIndex;
+		unsigned int First;
+		unsigned int Count;
+		unsigned int Depth;
+		Bounds Box;
+	};
+
+	MeshBVHBuilder(
+		const Vertex* vertices,
+		const unsigned int* indices,
+		const Bounds* triangleBounds,
+		const float* centroids,
+		unsigned int* order)
+		:
+		vertices(vertices),
+		indices(indices),
+		triangleBounds(triangleBounds),
+		centroids(centroids),
+		order(order)
+	{
+	}
+
+	// --------------------------------------------------------
+	// Builds the tree for the task's range, its root becoming
+	// node 0.  Ranges of deferBelow triangles or fewer are
+	// left for later, as tasks added to "deferred", with empty
+	// nodes where their subtrees will go.
+	// --------------------------------------------------------
+	void Build(Task root, unsigned int deferBelow, std::vector<Task>* deferred)
+	{
+		root.NodeIndex = 0;
+		nodes.push_back(Node());
+
+		std::vector<Task> stack(1, root);
+		while (!stack.empty())
+		{
+			Task task = stack.back();
+			stack.pop_back();
+
+			if (deferred && task.Count <= deferBelow && task.NodeIndex != 0)
+			{
+				deferred->push_back(task);
+				continue;
+			}
+
+			Node& node = nodes[task.NodeIndex];
+			for (int a = 0; a < 3; a++)
+			{
+				node.Min[a] = task.Box.Min[a];
+				node.Max[a] = task.Box.Max[a];
+			}
+
+			Task left, right;
+			if (!Split(task, left, right))
+			{
+				MakeLeaf(task);
+				continue;
+			}
+
+			// Children always sit next to each other
+			unsigned int childIndex = (unsigned int)nodes.size();
+			nodes[task.NodeIndex].LeftOrFirst = childIndex;
+			nodes[task.NodeIndex].Count = 0;
+			nodes.push_back(Node());
+			nodes.push_back(Node());
+
+			left.NodeIndex = childIndex;
+			right.NodeIndex = childIndex + 1;
+			stack.push_back(right);
+			stack.push_back(left);
+		}
+	}
+
+	// --------------------------------------------------------
+	// Copies a part built separately into this one, in place
+	// of the empty node the part was deferred from
+	// --------------------------------------------------------
+	void Attach(unsigned int nodeIndex, const MeshBVHBuilder& part)
+	{
+		// The part's node i (past its root) ends up at nodeBase + i
+		unsigned int nodeBase = (unsigned int)nodes.size() - 1;
+		unsigned int packetBase = (unsigned int)packets.size();
+		for (size_t i = 0; i < part.nodes.size(); i++)
+		{
+			Node node = part.nodes[i];
+			node.LeftOrFirst += node.Count > 0 ? packetBase : nodeBase;
+			if (i == 0)
+				nodes[nodeIndex] = node;
+			else
+				nodes.push_back(node);
+		}
+		packets.insert(packets.end(), part.packets.begin(), part.packets.end());
+	}
+
+	std::vector<Node> nodes;
+	std::vector<TrianglePacket> packets;
+
+private:
+	const Vertex* vertices;
+	const unsigned int* indices;
+	const Bounds* triangleBounds;
+	const float* centroids;
+	unsigned int* order;
+
+	// --------------------------------------------------------
+	// Splits a range in two, using the cheapest split along any
+	// axis by the surface area heuristic.  Returns false if a
+	// leaf would be cheaper.
+	// --------------------------------------------------------
+	bool Split(const Task& task, Task& left, Task& right)
+	{
+		unsigned int* first = order + task.First;
+		unsigned int* last = first + task.Count;
+
+		Bounds centroidBounds;
+		centroidBounds.Reset();
+		for (unsigned int* t = first; t != last; t++)
+			centroidBounds.Grow(&centroids[*t * 3]);
+
+		float leafCost = PacketCount(task.Count) * PacketCost;
+		float bestCost = FLT_MAX;
+		int bestAxis = -1;
+		int bestBin = 0;
+		Bounds bestLeft, bestRight;
+
+		if (task.Depth < MaxSahDepth)
+		{
+			// All three axes are binned in one pass over the triangles
+			// (a flat axis puts everything in its first bin)
+			Bounds bins[3][BinCount];
+			unsigned int counts[3][BinCount] = {};
+			float scales[3];
+			for (int axis = 0; axis < 3; axis++)
+			{
+				float extent = centroidBounds.Max[axis] - centroidBounds.Min[axis];
+				scales[axis] = extent > 0.0f ? BinCount / extent : 0.0f;
+				for (int b = 0; b < BinCount; b++)
+					bins[axis][b].Reset();
+			}
+
+			for (unsigned int* t = first; t != last; t++)
+			{
+				const Bounds& box = triangleBounds[*t];
+				for (int axis = 0; axis < 3; axis++)
+				{
+					int bin = BinOf(*t, axis, centroidBounds.Min[axis], scales[axis]);
+					counts[axis][bin]++;
+					bins[axis][bin].Grow(box);
+				}
+			}
+
+			for (int axis = 0; axis < 3; axis++)
+			{
+				// Sweep from the right, then from the left, so each
+				// boundary knows the boxes & counts on both sides
+				float rightAreas[BinCount];
+				Bounds rightBoxes[BinCount];
+				unsigned int rightCounts[BinCount];
+				Bounds running;
+				running.Reset();
+				unsigned int runningCount = 0;
+				for (int b = BinCount - 1; b > 0; b--)
+				{
+					running.Grow(bins[axis][b]);
+					runningCount += counts[axis][b];
+					rightAreas[b] = running.Area();
+					rightBoxes[b] = running;
+					rightCounts[b] = runningCount;
+				}
+
+				running.Reset();
+				runningCount = 0;
+				for (int b = 0; b < BinCount - 1; b++)
+				{
+					running.Grow(bins[axis][b]);
+					runningCount += counts[axis][b];
+					if (runningCount == 0 || rightCounts[b + 1] == 0)
+						continue;
+
+					float cost =
+						running.Area() * PacketCount(runningCount) +
+						rightAreas[b + 1] * PacketCount(rightCounts[b + 1]);
+					if (cost < bestCost)
+					{
+						bestCost = cost;
+						bestAxis = axis;
+						bestBin = b;
+						bestLeft = running;
+						bestRight = rightBoxes[b + 1];
+					}
+				}
+			}
+		}
+
+		if (bestAxis >= 0)
+		{
+			float area = task.Box.Area();
+			float splitCost = TraversalCost + (area > 0.0f ? bestCost / area : 0.0f) * PacketCost;
+			if (task.Count <= MaxLeafTriangles && leafCost <= splitCost)
+				return false;
+
+			float scale = BinCount / (centroidBounds.Max[bestAxis] - centroidBounds.Min[bestAxis]);
+			float minCentroid = centroidBounds.Min[bestAxis];
+			unsigned int* middle = std::partition(first, last, [&](unsigned int t)
+			{
+				return BinOf(t, bestAxis, minCentroid, scale) <= bestBin;
+			});
+
+			MakeChildren(task, (unsigned int)(middle - first), bestLeft, bestRight, left, right);
+			return true;
+		}
+
+		// Every centroid in the same place (or too deep): small
+		// ranges become leaves, bigger ones are cut in half
+		if (task.Count <= MaxLeafTriangles)
+			return false;
+
+		unsigned int half = task.Count / 2;
+		Bounds leftBox, rightBox;
+		leftBox.Reset();
+		rightBox.Reset();
+		for (unsigned int i = 0; i < task.Count; i++)
+			(i < half ? leftBox : rightBox).Grow(triangleBounds[first[i]]);
+
+		MakeChildren(task, half, leftBox, rightBox, left, right);
+		return true;
+	}
+
+	int BinOf(unsigned int triangle, int axis, float minCentroid, float scale) const
+	{
+		int bin = (int)((centroids[triangle * 3 + axis] - minCentroid) * scale);
+		return (std::min)(bin, BinCount - 1);
+	}
+
+	static void MakeChildren(const Task& task, unsigned int leftCount, const Bounds& leftBox, const Bounds& rightBox, Task& left, Task& right)
+	{
+		left.First = task.First;
+		left.Count = leftCount;
+		left.Depth = task.Depth + 1;
+		left.Box = leftBox;
+
+		right.First = task.First + leftCount;
+		right.Count = task.Count - leftCount;
+		right.Depth = task.Depth + 1;
+		right.Box = rightBox;
+	}
+
+	// Packs the range's triangles, 4 to a packet
+	void MakeLeaf(const Task& task)
+	{
+		Node& node = nodes[task.NodeIndex];
+		node.LeftOrFirst = (unsigned int)packets.size();
+		node.Count = PacketCount(task.Count);
+
+		for (unsigned int i = 0; i < task.Count; i += 4)
+		{
+			TrianglePacket packet = {};
+			for (unsigned int lane = 0; lane < 4; lane++)
+			{
+				packet.Triangle[lane] = ~0u;
+				if (i + lane >= task.Count)
+					continue;
+
+				unsigned int triangle = order[task.First + i + lane];
+				const float* p0 = &vertices[indices[triangle * 3 + 0]].Position.x;
+				const float* p1 = &vertices[indices[triangle * 3 + 1]].Position.x;
+				const float* p2 = &vertices[indices[triangle * 3 + 2]].Position.x;
+				for (int a = 0; a < 3; a++)
+				{
+					packet.Corner[a][lane] = p0[a];
+					packet.Edge1[a][lane] = p1[a] - p0[a];
+					packet.Edge2[a][lane] = p2[a] - p0[a];
+				}
+				packet.Triangle[lane] = triangle;
+			}
+			packets.push_back(packet);
+		}
+	}
+};
+
+namespace
+{
+	// --------------------------------------------------------
+	// Möller-Trumbore against one lane of a packet, updating
+	// the hit if it's closer
+	// --------------------------------------------------------
+	void IntersectLane(
+		const MeshBVHBuilder::TrianglePacket& packet,
+		int lane,
+		const float* origin,
+		const float* direction,
+		RayHit& hit,
+		bool& found)
+	{
+		float e1[3], e2[3], toOrigin[3];
+		for (int a = 0; a < 3; a++)
+		{
+			e1[a] = packet.Edge1[a][lane];
+			e2[a] = packet.Edge2[a][lane];
+			toOrigin[a] = origin[a] - packet.Corner[a][lane];
+		}
+
+		float p[3] = {
+			direction[1] * e2[2] - direction[2] * e2[1],
+			direction[2] * e2[0] - direction[0] * e2[2],
+			direction[0] * e2[1] - direction[1] * e2[0] };
+		float det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+		if (det == 0.0f)
+			return;
+		float invDet = 1.0f / det;
+
+		float u = (toOrigin[0] * p[0] + toOrigin[1] * p[1] + toOrigin[2] * p[2]) * invDet;
+		float q[3] = {
+			toOrigin[1] * e1[2] - toOrigin[2] * e1[1],
+			toOrigin[2] * e1[0] - toOrigin[0] * e1[2],
+			toOrigin[0] * e1[1] - toOrigin[1] * e1[0] };
+		float v = (direction[0] * q[0] + direction[1] * q[1] + direction[2] * q[2]) * invDet;
+		float t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * invDet;
+
+		if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t >= 0.0f && t < hit.Distance)
+		{
+			hit.Distance = t;
+			hit.Triangle = packet.Triangle[lane];
+			hit.U = u;
+			hit.V = v;
+			found = true;
+		}
+	}
+
+#if defined(BVH_SIMD_X86)
+	// The same as IntersectLane(), for all four lanes at once
+	void IntersectPacket(
+		const MeshBVHBuilder::TrianglePacket& packet,
+		const __m128* origin,
+		const __m128* direction,
+		RayHit& hit,
+		bool& found)
+	{
+		__m128 e1x = _mm_loadu_ps(packet.Edge1[0]);
+		__m128 e1y = _mm_loadu_ps(packet.Edge1[1]);
+		__m128 e1z = _mm_loadu_ps(packet.Edge1[2]);
+		__m128 e2x = _mm_loadu_ps(packet.Edge2[0]);
+		__m128 e2y = _mm_loadu_ps(packet.Edge2[1]);
+		__m128 e2z = _mm_loadu_ps(packet.Edge2[2]);
+
+		__m128 px = _mm_sub_ps(_mm_mul_ps(direction[1], e2z), _mm_mul_ps(direction[2], e2y));
+		__m128 py = _mm_sub_ps(_mm_mul_ps(direction[2], e2x), _mm_mul_ps(direction[0], e2z));
+		__m128 pz = _mm_sub_ps(_mm_mul_ps(direction[0], e2y), _mm_mul_ps(direction[1], e2x));
+		__m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+		__m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+		__m128 tx = _mm_sub_ps(origin[0], _mm_loadu_ps(packet.Corner[0]));
+		__m128 ty = _mm_sub_ps(origin[1], _mm_loadu_ps(packet.Corner[1]));
+		__m128 tz = _mm_sub_ps(origin[2], _mm_loadu_ps(packet.Corner[2]));
+		__m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, px), _mm_mul_ps(ty, py)), _mm_mul_ps(tz, pz)), invDet);
+
+		__m128 qx = _mm_sub_ps(_mm_mul_ps(ty, e1z), _mm_mul_ps(tz, e1y));
+		__m128 qy = _mm_sub_ps(_mm_mul_ps(tz, e1x), _mm_mul_ps(tx, e1z));
+		__m128 qz = _mm_sub_ps(_mm_mul_ps(tx, e1y), _mm_mul_ps(ty, e1x));
+		__m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(direction[0], qx), _mm_mul_ps(direction[1], qy)), _mm_mul_ps(direction[2], qz)), invDet);
+		__m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+
+		// Zero edges (unused lanes) give a zero det, and NaNs fail every comparison
+		__m128 zero = _mm_setzero_ps();
+		__m128 mask = _mm_cmpneq_ps(det, zero);
+		mask = _mm_and_ps(mask, _mm_cmpge_ps(u, zero));
+		mask = _mm_and_ps(mask, _mm_cmpge_ps(v, zero));
+		mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+		mask = _mm_and_ps(mask, _mm_cmpge_ps(t, zero));
+		mask = _mm_and_ps(mask, _mm_cmplt_ps(t, _mm_set1_ps(hit.Distance)));
+
+		int hits = _mm_movemask_ps(mask);
+		if (hits == 0)
+			return;
+
+		float ts[4], us[4], vs[4];
+		_mm_storeu_ps(ts, t);
+		_mm_storeu_ps(us, u);
+		_mm_storeu_ps(vs, v);
+		for (int lane = 0; lane < 4; lane++)
+		{
+			if ((hits & (1 << lane)) && ts[lane] < hit.Distance)
+			{
+				hit.Distance = ts[lane];
+				hit.Triangle = packet.Triangle[lane];
+				hit.U = us[lane];
+				hit.V = vs[lane];
+				found = true;
+			}
+		}
+	}
+
+	// Where the ray enters the box, or FLT_MAX if it misses
+	// it (or only reaches it past maxDistance)
+	float BoxEntry(const MeshBVHBuilder::Node& node, __m128 origin, __m128 inverse, float maxDistance)
+	{
+		__m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.Min), origin), inverse);
+		__m128 t2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.Max), origin), inverse);
+		__m128 tNear = _mm_min_ps(t1, t2);
+		__m128 tFar = _mm_max_ps(t1, t2);
+
+		// Only xyz count: the loads' w is the node's indices
+		__m128 entry = _mm_max_ss(tNear, _mm_max_ss(
+			_mm_shuffle_ps(tNear, tNear, _MM_SHUFFLE(1, 1, 1, 1)),
+			_mm_shuffle_ps(tNear, tNear, _MM_SHUFFLE(2, 2, 2, 2))));
+		__m128 exit = _mm_min_ss(tFar, _mm_min_ss(
+			_mm_shuffle_ps(tFar, tFar, _MM_SHUFFLE(1, 1, 1, 1)),
+			_mm_shuffle_ps(tFar, tFar, _MM_SHUFFLE(2, 2, 2, 2))));
+		entry = _mm_max_ss(entry, _mm_setzero_ps());
+		exit = _mm_min_ss(exit, _mm_set_ss(maxDistance));
+
+		float entryT = _mm_cvtss_f32(entry);
+		return entryT <= _mm_cvtss_f32(exit) ? entryT : FLT_MAX;
+	}
+#else
+	float BoxEntry(const MeshBVHBuilder::Node& node, const float* origin, const float* inverse, float maxDistance)
+	{
+		float entry = 0.0f;
+		float exit = maxDistance;
+		for (int a = 0; a < 3; a++)
+		{
+			float t1 = (node.Min[a] - origin[a]) * inverse[a];
+			float t2 = (node.Max[a] - origin[a]) * inverse[a];
+			entry = (std::max)(entry, (std::min)(t1, t2));
+			exit = (std::min)(exit, (std::max)(t1, t2));
+		}
+		return entry <= exit ? entry : FLT_MAX;
+	}
+#endif
+}
+
+MeshBVH::MeshBVH()
+{
+}
+
+void MeshBVH::Build(
+	const Vertex* vertices,
+	size_t vertexCount,
+	const unsigned int* indices,
+	size_t indexCount,
+	unsigned int threadCount)
+{
+	nodes.clear();
+	packets.clear();
+
+	unsigned int triangleCount = (unsigned int)(indexCount / 3);
+	if (triangleCount == 0 || vertexCount == 0)
+		return;
+
+	if (threadCount == 0)
+		threadCount = JobSystem::GetDefault().GetThreadCount();
+	if (triangleCount < MinParallelTriangles)
+		threadCount = 1;
+
+	// Each triangle's box & centroid, which is all splitting needs
+	std::vector<Bounds> triangleBounds(triangleCount);
+	std::vector<float> centroids(triangleCount * 3);
+	std::vector<unsigned int> order(triangleCount);
+	JobSystem::GetDefault().ParallelFor(triangleCount, [&](size_t begin, size_t end)
+	{
+		for (size_t t = begin; t < end; t++)
+		{
+			Bounds& box = triangleBounds[t];
+			box.Reset();
+			for (int corner = 0; corner < 3; corner++)
+				box.Grow(&vertices[indices[t * 3 + corner]].Position.x);
+			for (int a = 0; a < 3; a++)
+				centroids[t * 3 + a] = (box.Min[a] + box.Max[a]) * 0.5f;
+			order[t] = (unsigned int)t;
+		}
+	}, 1024, threadCount);
+
+	MeshBVHBuilder::Task root = {};
+	root.Count = triangleCount;
+	root.Box.Reset();
+	for (const Bounds& box : triangleBounds)
+		root.Box.Grow(box);
+
+	MeshBVHBuilder top(vertices, indices, triangleBounds.data(), centroids.data(), order.data());
+	if (threadCount == 1)
+	{
+		top.Build(root, 0, 0);
+	}
+	else
+	{
+		// Split the top of the tree here until there are plenty of
+		// ranges to go around, then build those on every thread.
+		// Each range only ever touches its own part of "order".
+		std::vector<MeshBVHBuilder::Task> deferred;
+		top.Build(root, triangleCount / (threadCount * 8), &deferred);
+
+		std::vector<std::unique_ptr<MeshBVHBuilder>> parts(deferred.size());
+		JobSystem::GetDefault().ParallelFor(deferred.size(), [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				parts[i].reset(new MeshBVHBuilder(vertices, indices, triangleBounds.data(), centroids.data(), order.data()));
+				parts[i]->Build(deferred[i], 0, 0);
+			}
+		}, 1, threadCount);
+
+		for (size_t i = 0; i < deferred.size(); i++)
+			top.Attach(deferred[i].NodeIndex, *parts[i]);
+	}
+
+	nodes.swap(top.nodes);
+	packets.swap(top.packets);
+}
+
+bool MeshBVH::IsEmpty() const
+{
+	return nodes.empty();
+}
+
+MeshBVHStats MeshBVH::GetStats() const
+{
+	MeshBVHStats stats = {};
+	if (nodes.empty())
+		return stats;
+
+	stats.Nodes = (unsigned int)nodes.size();
+	auto area = [](const Node& node)
+	{
+		float x = node.Max[0] - node.Min[0];
+		float y = node.Max[1] - node.Min[1];
+		float z = node.Max[2] - node.Min[2];
+		return x * y + y * z + z * x;
+	};
+	float rootArea = area(nodes[0]);
+
+	std::vector<std::pair<unsigned int, unsigned int>> stack(1, std::make_pair(0u, 1u));
+	while (!stack.empty())
+	{
+		unsigned int index = stack.back().first;
+		unsigned int depth = stack.back().second;
+		stack.pop_back();
+
+		const Node& node = nodes[index];
+		float relativeArea = rootArea > 0.0f ? area(node) / rootArea : 1.0f;
+		stats.MaxDepth = (std::max)(stats.MaxDepth, depth);
+		if (node.Count > 0)
+		{
+			stats.Leaves++;
+			stats.SahCost += relativeArea * node.Count * PacketCost;
+			for (unsigned int p = 0; p < node.Count; p++)
+				for (int lane = 0; lane < 4; lane++)
+					if (packets[node.LeftOrFirst + p].Triangle[lane] != ~0u)
+						stats.Triangles++;
+		}
+		else
+		{
+			stats.SahCost += relativeArea * TraversalCost;
+			stack.push_back(std::make_pair(node.LeftOrFirst, depth + 1));
+			stack.push_back(std::make_pair(node.LeftOrFirst + 1, depth + 1));
+		}
+	}
+	return stats;
+}
+
+bool MeshBVH::Intersect(
+	const XMFLOAT3& origin,
+	const XMFLOAT3& direction,
+	float maxDistance,
+	RayHit& hit) const
+{
+	if (nodes.empty())
+		return false;
+
+	float inverse[3];
+	InverseDirection(direction, inverse);
+
+#if defined(BVH_SIMD_X86)
+	__m128 origin4 = _mm_set_ps(0.0f, origin.z, origin.y, origin.x);
+	__m128 inverse4 = _mm_set_ps(0.0f, inverse[2], inverse[1], inverse[0]);
+	__m128 originSplat[3] = { _mm_set1_ps(origin.x), _mm_set1_ps(origin.y), _mm_set1_ps(origin.z) };
+	__m128 directionSplat[3] = { _mm_set1_ps(direction.x), _mm_set1_ps(direction.y), _mm_set1_ps(direction.z) };
+#define BVH_BOX_ENTRY(node, limit) BoxEntry(node, origin4, inverse4, limit)
+#else
+	const float* origin4 = &origin.x;
+	const float* inverse4 = inverse;
+#define BVH_BOX_ENTRY(node, limit) BoxEntry(node, origin4, inverse4, limit)
+#endif
+
+	hit.Distance = maxDistance;
+	bool found = false;
+	if (BVH_BOX_ENTRY(nodes[0], hit.Distance) == FLT_MAX)
+		return false;
+
+	// Nodes still to visit, and where the ray enters them
+	struct Pending
+	{
+		unsigned int Node;
+		float Entry;
+	};
+	Pending stack[MaxStackDepth];
+	int stackSize = 0;
+	unsigned int current = 0;
+
+	while (true)
+	{
+		const Node& node = nodes[current];
+		if (node.Count > 0)
+		{
+			for (unsigned int p = 0; p < node.Count; p++)
+			{
+#if defined(BVH_SIMD_X86)
+				IntersectPacket(packets[node.LeftOrFirst + p], originSplat, directionSplat, hit, found);
+#else
+				for (int lane = 0; lane < 4; lane++)
+					IntersectLane(packets[node.LeftOrFirst + p], lane, &origin.x, &direction.x, hit, found);
+#endif
+			}
+		}
+		else
+		{
+			// Nearer child first, saving the other for later
+			unsigned int nearChild = node.LeftOrFirst;
+			unsigned int farChild = nearChild + 1;
+			float nearEntry = BVH_BOX_ENTRY(nodes[nearChild], hit.Distance);
+			float farEntry = BVH_BOX_ENTRY(nodes[farChild], hit.Distance);
+			if (farEntry < nearEntry)
+			{
+				std::swap(nearChild, farChild);
+				std::swap(nearEntry, farEntry);
+			}
+
+			if (nearEntry != FLT_MAX)
+			{
+				if (farEntry != FLT_MAX)
+				{
+					Pending pending = { farChild, farEntry };
+					stack[stackSize++] = pending;
+				}
+				current = nearChild;
+				continue;
+			}
+		}
+
+		// Next saved node the ray still reaches before its closest hit
+		bool next = false;
+		while (stackSize > 0)
+		{
+			Pending pending = stack[--stackSize];
+			if (pending.Entry <= hit.Distance)
+			{
+				current = pending.Node;
+				next = true;
+				break;
+			}
+		}
+		if (!next)
+			break;
+	}
+#undef BVH_BOX_ENTRY
+
+	return found;
+}
+
+bool MeshBVH::IntersectBruteForce(
+	const XMFLOAT3& origin,
+	const XMFLOAT3& direction,
+	float maxDistance,
+	RayHit& hit) const
+{
+	hit.Distance = maxDistance;
+	bool found = false;
+	for (const TrianglePacket& packet : packets)
+		for (int lane = 0; lane < 4; lane++)
+			IntersectLane(packet, lane, &origin.x, &direction.x, hit, found);
+	return found;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Vertex.h"
+#include <DirectXMath.h>
+#include <cstddef>
+#include <vector>
+
+// --------------------------------------------------------
+// Where a ray hit a mesh
+//
+// The hit point is the triangle's corners weighted by
+// (1 - U - V, U, V), and Distance is along the ray's direction
+// in multiples of its length
+// --------------------------------------------------------
+struct RayHit
+{
+	float Distance;
+	unsigned int Triangle;	// Index of the triangle's first index / 3
+	float U;
+	float V;
+};
+
+// How a BVH turned out
+struct MeshBVHStats
+{
+	unsigned int Triangles;
+	unsigned int Nodes;
+	unsigned int Leaves;
+	unsigned int MaxDepth;
+	float SahCost;			// Expected cost of a ray through the root, in node tests
+};
+
+// --------------------------------------------------------
+// A bounding volume hierarchy over a mesh's triangles, for
+// ray casts (mouse picking, gameplay line of sight, ...)
+//
+// - Split with a binned surface area heuristic: 16 bins along
+//   each axis, picking the cheapest split of the three
+// - Triangles are stored 4 at a time, already set up for the
+//   ray test, so each leaf tests 4 triangles per SSE instruction
+// - The top of the tree is split on the calling thread, then
+//   the subtrees are built in parallel.  Every split only
+//   depends on the triangles, so the tree is the same whatever
+//   the thread count.
+// --------------------------------------------------------
+class MeshBVH
+{
+public:
+	MeshBVH();
+
+	// Builds over a triangle list (such as a mesh's full level
+	// of detail) on threadCount threads (0 = one per core)
+	void Build(
+		const Vertex* vertices,
+		size_t vertexCount,
+		const unsigned int* indices,
+		size_t indexCount,
+		unsigned int threadCount = 0);
+
+	bool IsEmpty() const;
+	MeshBVHStats GetStats() const;
+
+	// The nearest hit along origin + direction * Distance, for a
+	// Distance from 0 to maxDistance.  Both sides of triangles count.
+	bool Intersect(
+		const DirectX::XMFLOAT3& origin,
+		const DirectX::XMFLOAT3& direction,
+		float maxDistance,
+		RayHit& hit) const;
+
+	// Tests every triangle, for checking Intersect() against
+	bool IntersectBruteForce(
+		const DirectX::XMFLOAT3& origin,
+		const DirectX::XMFLOAT3& direction,
+		float maxDistance,
+		RayHit& hit) const;
+
+private:
+	// 32 bytes, so two fit in a cache line
+	// - Interior nodes: children are at LeftOrFirst & LeftOrFirst + 1
+	// - Leaves: Count packets, starting at LeftOrFirst
+	struct Node
+	{
+		float Min[3];
+		unsigned int LeftOrFirst;
+		float Max[3];
+		unsigned int Count;
+	};
+
+	// Four triangles, as a corner and two edges, one triangle per
+	// lane.  Unused lanes have zero edges, which the test rejects.
+	struct TrianglePacket
+	{
+		float Corner[3][4];
+		float Edge1[3][4];
+		float Edge2[3][4];
+		unsigned int Triangle[4];
+	};
+
+	std::vector<Node> nodes;
+	std::vector<TrianglePacket> packets;
+
+	// Builds a part of the tree into its own arrays (see MeshBVH.cpp)
+	friend class MeshBVHBuilder;
+};
@@ -0,0 +1,232 @@
+#include "MeshBounds.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// Directions whose extreme points seed Ritter's sphere
+	const XMFLOAT3 extremeDirections[7] =
+	{
+		XMFLOAT3(1, 0, 0),
+		XMFLOAT3(0, 1, 0),
+		XMFLOAT3(0, 0, 1),
+		XMFLOAT3(1, 1, 1),
+		XMFLOAT3(1, 1, -1),
+		XMFLOAT3(1, -1, 1),
+		XMFLOAT3(1, -1, -1),
+	};
+
+	// --------------------------------------------------------
+	// Grows the sphere just enough to take in each point that's
+	// outside it, visiting them from "start" and wrapping around
+	// - Each new sphere contains the last, so at the end every
+	//   point is inside
+	// --------------------------------------------------------
+	void GrowSphere(const Vertex* vertices, size_t vertexCount, size_t start, XMVECTOR& center, float& radius)
+	{
+		for (size_t n = 0; n < vertexCount; n++)
+		{
+			size_t i = start + n;
+			if (i >= vertexCount)
+				i -= vertexCount;
+
+			XMVECTOR toPoint = XMLoadFloat3(&vertices[i].Position) - center;
+			float distanceSq = XMVectorGetX(XMVector3LengthSq(toPoint));
+			if (distanceSq <= radius * radius)
+				continue;
+
+			// Move the near side of the sphere out to the point
+			float distance = std::sqrt(distanceSq);
+			float newRadius = (radius + distance) * 0.5f;
+			center += toPoint * ((newRadius - radius) / distance);
+			radius = newRadius;
+		}
+	}
+}
+
+void CalculateMeshBounds(
+	const Vertex* vertices,
+	size_t vertexCount,
+	MeshBounds& bounds,
+	bool fitOrientedBox)
+{
+	bounds = MeshBounds();
+	if (vertexCount == 0)
+		return;
+
+	XMVECTOR boxMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR boxMax = XMVectorReplicate(-FLT_MAX);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		XMVECTOR p = XMLoadFloat3(&vertices[i].Position);
+		boxMin = XMVectorMin(boxMin, p);
+		boxMax = XMVectorMax(boxMax, p);
+	}
+	BoundingBox::CreateFromPoints(bounds.Box, boxMin, boxMax);
+
+	bounds.Sphere = CalculateBoundingSphere(vertices, vertexCount);
+
+	if (fitOrientedBox)
+	{
+		BoundingOrientedBox::CreateFromPoints(bounds.OrientedBox, vertexCount, &vertices[0].Position, sizeof(Vertex));
+
+		// The fit can lose to the plain box on boxy meshes
+		float fittedVolume = bounds.OrientedBox.Extents.x * bounds.OrientedBox.Extents.y * bounds.OrientedBox.Extents.z;
+		float boxVolume = bounds.Box.Extents.x * bounds.Box.Extents.y * bounds.Box.Extents.z;
+		if (fittedVolume < boxVolume)
+			return;
+	}
+
+	bounds.OrientedBox.Center = bounds.Box.Center;
+	bounds.OrientedBox.Extents = bounds.Box.Extents;
+	bounds.OrientedBox.Orientation = XMFLOAT4(0, 0, 0, 1);
+}
+
+BoundingSphere CalculateBoundingSphere(
+	const Vertex* vertices,
+	size_t vertexCount,
+	int refinePasses)
+{
+	if (vertexCount == 0)
+		return BoundingSphere(XMFLOAT3(0, 0, 0), 0.0f);
+
+	// The furthest apart pair of extreme points starts the sphere
+	size_t minPoint[7] = {};
+	size_t maxPoint[7] = {};
+	float minDot[7];
+	float maxDot[7];
+	std::fill(minDot, minDot + 7, FLT_MAX);
+	std::fill(maxDot, maxDot + 7, -FLT_MAX);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const XMFLOAT3& p = vertices[i].Position;
+		for (int d = 0; d < 7; d++)
+		{
+			const XMFLOAT3& dir = extremeDirections[d];
+			float dot = p.x * dir.x + p.y * dir.y + p.z * dir.z;
+			if (dot < minDot[d]) { minDot[d] = dot; minPoint[d] = i; }
+			if (dot > maxDot[d]) { maxDot[d] = dot; maxPoint[d] = i; }
+		}
+	}
+
+	XMVECTOR center = XMVectorZero();
+	float radius = -1.0f;
+	for (int d = 0; d < 7; d++)
+	{
+		XMVECTOR a = XMLoadFloat3(&vertices[minPoint[d]].Position);
+		XMVECTOR b = XMLoadFloat3(&vertices[maxPoint[d]].Position);
+		float halfLength = XMVectorGetX(XMVector3Length(b - a)) * 0.5f;
+		if (halfLength > radius)
+		{
+			center = (a + b) * 0.5f;
+			radius = halfLength;
+		}
+	}
+	GrowSphere(vertices, vertexCount, 0, center, radius);
+
+	// Shrink & regrow, starting somewhere different each time,
+	// since the order points are met in decides where it ends up
+	XMVECTOR bestCenter = center;
+	float bestRadius = radius;
+	for (int pass = 0; pass < refinePasses; pass++)
+	{
+		float shrink = pass < refinePasses / 2 ? 0.95f : 0.99f;
+		radius = bestRadius * shrink;
+		center = bestCenter;
+		GrowSphere(vertices, vertexCount, vertexCount * (pass + 1) / (refinePasses + 1), center, radius);
+
+		if (radius < bestRadius)
+		{
+			bestCenter = center;
+			bestRadius = radius;
+		}
+	}
+
+	// Rounding while growing can leave a point a hair outside
+	float radiusSq = 0.0f;
+	for (size_t i = 0; i < vertexCount; i++)
+		radiusSq = (std::max)(radiusSq, XMVectorGetX(XMVector3LengthSq(XMLoadFloat3(&vertices[i].Position) - bestCenter)));
+
+	BoundingSphere sphere;
+	XMStoreFloat3(&sphere.Center, bestCenter);
+	sphere.Radius = std::sqrt(radiusSq);
+	return sphere;
+}
+
+BoundingBox TransformBounds(const BoundingBox& local, FXMMATRIX world)
+{
+	// Each world axis' extent is how far the box's three
+	// half-edges reach along it, whichever way they point
+	XMVECTOR extents = XMLoadFloat3(&local.Extents);
+	XMVECTOR worldExtents =
+		XMVectorAbs(world.r[0]) * XMVectorSplatX(extents) +
+		XMVectorAbs(world.r[1]) * XMVectorSplatY(extents) +
+		XMVectorAbs(world.r[2]) * XMVectorSplatZ(extents);
+
+	BoundingBox result;
+	XMStoreFloat3(&result.Center, XMVector3Transform(XMLoadFloat3(&local.Center), world));
+	XMStoreFloat3(&result.Extents, worldExtents);
+	return result;
+}
+
+BoundingSphere TransformBounds(const BoundingSphere& local, FXMMATRIX world)
+{
+	float scaleSq = XMVectorGetX(XMVectorMax(
+		XMVector3LengthSq(world.r[0]),
+		XMVectorMax(XMVector3LengthSq(world.r[1]), XMVector3LengthSq(world.r[2]))));
+
+	BoundingSphere result;
+	XMStoreFloat3(&result.Center, XMVector3Transform(XMLoadFloat3(&local.Center), world));
+	result.Radius = local.Radius * std::sqrt(scaleSq);
+	return result;
+}
+
+BoundingOrientedBox TransformBounds(const BoundingOrientedBox& local, FXMMATRIX world)
+{
+	// The box's half-edges, in world space
+	XMMATRIX rotation = XMMatrixRotationQuaternion(XMLoadFloat4(&local.Orientation));
+	XMVECTOR extents = XMLoadFloat3(&local.Extents);
+	XMVECTOR edges[3] =
+	{
+		XMVector3TransformNormal(rotation.r[0] * XMVectorSplatX(extents), world),
+		XMVector3TransformNormal(rotation.r[1] * XMVectorSplatY(extents), world),
+		XMVector3TransformNormal(rotation.r[2] * XMVectorSplatZ(extents), world),
+	};
+
+	// New axes: the first edge, then the others made square to it
+	// - They're already square unless non-uniform scale skewed them
+	XMVECTOR axis0 = XMVector3Normalize(edges[0]);
+	XMVECTOR axis1 = XMVector3Normalize(edges[1] - axis0 * XMVector3Dot(edges[1], axis0));
+	XMVECTOR axis2 = XMVector3Cross(axis0, axis1);
+
+	BoundingOrientedBox result;
+	XMStoreFloat3(&result.Center, XMVector3Transform(XMLoadFloat3(&local.Center), world));
+
+	// A flattened box has no axes to speak of, so fall back to world axes
+	float flatness = XMVectorGetX(XMVector3LengthSq(axis2));
+	if (!(flatness > 0.5f))
+	{
+		XMStoreFloat3(&result.Extents, XMVectorAbs(edges[0]) + XMVectorAbs(edges[1]) + XMVectorAbs(edges[2]));
+		result.Orientation = XMFLOAT4(0, 0, 0, 1);
+		return result;
+	}
+
+	// Each new extent is how far all three edges reach along that axis
+	XMVECTOR axes[3] = { axis0, axis1, axis2 };
+	float* worldExtents = &result.Extents.x;
+	for (int a = 0; a < 3; a++)
+	{
+		worldExtents[a] =
+			std::fabs(XMVectorGetX(XMVector3Dot(edges[0], axes[a]))) +
+			std::fabs(XMVectorGetX(XMVector3Dot(edges[1], axes[a]))) +
+			std::fabs(XMVectorGetX(XMVector3Dot(edges[2], axes[a])));
+	}
+
+	XMMATRIX basis(axis0, axis1, axis2, XMVectorSet(0, 0, 0, 1));
+	XMStoreFloat4(&result.Orientation, XMQuaternionNormalize(XMQuaternionRotationMatrix(basis)));
+	return result;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Vertex.h"
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+#include <cstddef>
+
+// --------------------------------------------------------
+// Bounding volumes of a mesh, in its own space
+// --------------------------------------------------------
+struct MeshBounds
+{
+	DirectX::BoundingBox Box;
+	DirectX::BoundingSphere Sphere;
+	DirectX::BoundingOrientedBox OrientedBox;	// Just Box, unless one was fitted
+};
+
+// --------------------------------------------------------
+// Finds all of a mesh's bounds.  The oriented box is fitted
+// along the points' principal axes (BoundingOrientedBox::
+// CreateFromPoints()) only if fitOrientedBox is set.
+// --------------------------------------------------------
+void CalculateMeshBounds(
+	const Vertex* vertices,
+	size_t vertexCount,
+	MeshBounds& bounds,
+	bool fitOrientedBox = true);
+
+// --------------------------------------------------------
+// A tight bounding sphere
+//
+// - Ritter's sphere, started from whichever of 7 pairs of
+//   extreme points are furthest apart, then grown to fit
+// - Then shrunk a little and regrown, refinePasses times,
+//   keeping the smallest (Larsson, "Fast and Tight Fitting
+//   Bounding Spheres"), which usually ends up within a few
+//   percent of the smallest possible sphere
+// --------------------------------------------------------
+DirectX::BoundingSphere CalculateBoundingSphere(
+	const Vertex* vertices,
+	size_t vertexCount,
+	int refinePasses = 8);
+
+// --------------------------------------------------------
+// Moves local bounds into world space, given a world matrix
+// like Transform::GetWorldMatrix()
+//
+// - Box: the axis-aligned box around the transformed box,
+//   straight from the matrix's absolute values (Arvo)
+// - Sphere: grows by the matrix's largest axis scale
+// - Oriented box: exact under rotation, translation & scale;
+//   if non-uniform scale skews it, the box around the result
+// --------------------------------------------------------
+DirectX::BoundingBox TransformBounds(const DirectX::BoundingBox& local, DirectX::FXMMATRIX world);
+DirectX::BoundingSphere TransformBounds(const DirectX::BoundingSphere& local, DirectX::FXMMATRIX world);
+DirectX::BoundingOrientedBox TransformBounds(const DirectX::BoundingOrientedBox& local, DirectX::FXMMATRIX world);
@@ -0,0 +1,230 @@
+#include "MeshCache.h"
+#include "Helpers.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	const char cacheMagic[4] = { 'D', 'X', 'M', 'S' };
+
+	// Keeps the arrays 16-byte aligned within the file (and so
+	// within the mapping, which always starts on a page boundary)
+	inline unsigned long long AlignUp(unsigned long long value)
+	{
+		return (value + 15) & ~15ull;
+	}
+
+	inline unsigned long long Mix(unsigned long long h)
+	{
+		h ^= h >> 33;
+		h *= 0xFF51AFD7ED558CCDull;
+		h ^= h >> 33;
+		h *= 0xC4CEB9FE1A85EC53ull;
+		h ^= h >> 33;
+		return h;
+	}
+
+	// Maps a cache file and checks it's for this source (by size)
+	// and settings, and that everything in it is where it should be
+	std::shared_ptr<MappedFile> MapMeshCache(
+		const std::wstring& cachePath,
+		const MappedFile& source,
+		unsigned int settingsKey)
+	{
+		std::shared_ptr<MappedFile> cache = std::make_shared<MappedFile>(cachePath.c_str());
+		if (!cache->IsOpen() || cache->GetSize() < sizeof(MeshCacheHeader))
+			return 0;
+
+		// Is this a cache for this exact source file, built the way we want?
+		const MeshCacheHeader* header = GetMeshCacheHeader(*cache);
+		if (memcmp(header->Magic, cacheMagic, sizeof(cacheMagic)) != 0 ||
+			header->Version != MESH_CACHE_VERSION ||
+			header->VertexStride != sizeof(Vertex) ||
+			header->SourceSize != source.GetSize() ||
+			header->SettingsKey != settingsKey)
+			return 0;
+
+		// Make sure the arrays are actually inside the file
+		unsigned long long vertexEnd = header->VertexOffset + (unsigned long long)header->VertexCount * sizeof(Vertex);
+		unsigned long long indexEnd = header->IndexOffset + (unsigned long long)header->IndexCount * sizeof(unsigned int);
+		unsigned long long lodEnd = header->LodOffset + (unsigned long long)header->LodCount * sizeof(MeshLod);
+		unsigned long long meshletEnd = header->MeshletOffset + (unsigned long long)header->MeshletCount * sizeof(Meshlet);
+		if (header->VertexOffset < sizeof(MeshCacheHeader) ||
+			header->IndexOffset < vertexEnd ||
+			header->LodOffset < indexEnd ||
+			header->MeshletOffset < lodEnd ||
+			meshletEnd > cache->GetSize() ||
+			header->LodCount == 0)
+			return 0;
+
+		// ...and so are the levels of detail and meshlets
+		const MeshLod* lods = (const MeshLod*)(cache->GetData() + header->LodOffset);
+		for (unsigned int i = 0; i < header->LodCount; i++)
+		{
+			if ((unsigned long long)lods[i].IndexOffset + lods[i].IndexCount > header->IndexCount)
+				return 0;
+		}
+
+		const Meshlet* meshlets = (const Meshlet*)(cache->GetData() + header->MeshletOffset);
+		for (unsigned int i = 0; i < header->MeshletCount; i++)
+		{
+			if ((unsigned long long)meshlets[i].IndexOffset + meshlets[i].TriangleCount * 3ull > header->IndexCount)
+				return 0;
+		}
+
+		// ...and every index is a real vertex.  That's a pass over
+		// the indices, but they're about to be read for the GPU anyway.
+		const unsigned int* indices = (const unsigned int*)(cache->GetData() + header->IndexOffset);
+		unsigned int maxIndex = 0;
+		for (unsigned int i = 0; i < header->IndexCount; i++)
+			maxIndex = (std::max)(maxIndex, indices[i]);
+		if (header->IndexCount > 0 && maxIndex >= header->VertexCount)
+			return 0;
+
+		return cache;
+	}
+
+	// Overwrites just the header's SourceWriteTime.  If that fails
+	// the source is just hashed again next time.
+	void UpdateSourceWriteTime(const std::wstring& cachePath, unsigned long long writeTime)
+	{
+		FILE* file = OpenForUpdating(cachePath);
+		if (!file)
+			return;
+
+		if (fseek(file, offsetof(MeshCacheHeader, SourceWriteTime), SEEK_SET) == 0)
+			fwrite(&writeTime, sizeof(writeTime), 1, file);
+		fclose(file);
+	}
+}
+
+// --------------------------------------------------------
+// Hashes 8 bytes at a time with four independent lanes, so
+// it runs at close to memory speed on large files
+// --------------------------------------------------------
+unsigned long long HashBytes(const void* data, size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	const unsigned long long prime = 0x9E3779B97F4A7C15ull;
+	unsigned long long lanes[4] = { prime, prime * 3, prime * 5, prime * 7 };
+
+	size_t i = 0;
+	for (; i + 32 <= size; i += 32)
+	{
+		for (int l = 0; l < 4; l++)
+		{
+			unsigned long long word;
+			memcpy(&word, bytes + i + l * 8, 8);
+			lanes[l] = (lanes[l] ^ word) * prime;
+			lanes[l] ^= lanes[l] >> 31;
+		}
+	}
+
+	unsigned long long h = Mix(lanes[0]) ^ Mix(lanes[1] + 1) ^ Mix(lanes[2] + 2) ^ Mix(lanes[3] + 3);
+	for (; i < size; i++)
+		h = (h ^ bytes[i]) * prime;
+
+	return Mix(h ^ (unsigned long long)size);
+}
+
+std::wstring GetMeshCachePath(const wchar_t* sourceFile)
+{
+	std::wstring path = sourceFile;
+
+	// Replace the extension (if there is one in the file name itself)
+	size_t dot = path.find_last_of(L'.');
+	size_t slash = path.find_last_of(L"/\\");
+	if (dot != std::wstring::npos && (slash == std::wstring::npos || dot > slash))
+		path.erase(dot);
+
+	return path + L".dxmesh";
+}
+
+const MeshCacheHeader* GetMeshCacheHeader(const MappedFile& cache)
+{
+	return (const MeshCacheHeader*)cache.GetData();
+}
+
+std::shared_ptr<MappedFile> OpenMeshCache(
+	const std::wstring& cachePath,
+	const MappedFile& source,
+	unsigned int settingsKey)
+{
+	std::shared_ptr<MappedFile> cache = MapMeshCache(cachePath, source, settingsKey);
+	if (!cache)
+		return 0;
+
+	// Written since the cache was (or copied, or checked out)?
+	// Only then is it worth hashing to see if it really changed.
+	const MeshCacheHeader* header = GetMeshCacheHeader(*cache);
+	if (header->SourceWriteTime == source.GetWriteTime())
+		return cache;
+
+	unsigned long long sourceHash = HashBytes(source.GetData(), source.GetSize());
+	if (header->SourceHash != sourceHash)
+		return 0;
+
+	// It hasn't, so record the new time to skip hashing next time.
+	// The file can't be written while it's mapped, so it's mapped
+	// again afterwards (and checked again, in case it changed).
+	cache.reset();
+	UpdateSourceWriteTime(cachePath, source.GetWriteTime());
+	cache = MapMeshCache(cachePath, source, settingsKey);
+	if (!cache || GetMeshCacheHeader(*cache)->SourceHash != sourceHash)
+		return 0;
+
+	return cache;
+}
+
+bool WriteMeshCache(
+	const std::wstring& cachePath,
+	MeshCacheHeader header,
+	const Vertex* vertices,
+	const unsigned int* indices,
+	const MeshLod* lods,
+	const Meshlet* meshlets)
+{
+	memcpy(header.Magic, cacheMagic, sizeof(cacheMagic));
+	header.Version = MESH_CACHE_VERSION;
+	header.VertexStride = sizeof(Vertex);
+	header.VertexOffset = AlignUp(sizeof(MeshCacheHeader));
+	header.IndexOffset = AlignUp(header.VertexOffset + (unsigned long long)header.VertexCount * sizeof(Vertex));
+	header.LodOffset = AlignUp(header.IndexOffset + (unsigned long long)header.IndexCount * sizeof(unsigned int));
+	header.MeshletOffset = AlignUp(header.LodOffset + (unsigned long long)header.LodCount * sizeof(MeshLod));
+	header.Padding = 0;
+
+	std::wstring tempPath = cachePath + L".tmp";
+	FILE* file = OpenForWriting(tempPath);
+	if (!file)
+		return false;
+
+	// Zeroes to fill the gaps between aligned sections
+	const char padding[16] = {};
+	size_t vertexPadding = (size_t)(header.VertexOffset - sizeof(MeshCacheHeader));
+	size_t indexPadding = (size_t)(header.IndexOffset - header.VertexOffset - (unsigned long long)header.VertexCount * sizeof(Vertex));
+	size_t lodPadding = (size_t)(header.LodOffset - header.IndexOffset - (unsigned long long)header.IndexCount * sizeof(unsigned int));
+	size_t meshletPadding = (size_t)(header.MeshletOffset - header.LodOffset - (unsigned long long)header.LodCount * sizeof(MeshLod));
+
+	bool success =
+		fwrite(&header, sizeof(header), 1, file) == 1 &&
+		fwrite(padding, 1, vertexPadding, file) == vertexPadding &&
+		fwrite(vertices, sizeof(Vertex), header.VertexCount, file) == header.VertexCount &&
+		fwrite(padding, 1, indexPadding, file) == indexPadding &&
+		fwrite(indices, sizeof(unsigned int), header.IndexCount, file) == header.IndexCount &&
+		fwrite(padding, 1, lodPadding, file) == lodPadding &&
+		fwrite(lods, sizeof(MeshLod), header.LodCount, file) == header.LodCount &&
+		fwrite(padding, 1, meshletPadding, file) == meshletPadding &&
+		fwrite(meshlets, sizeof(Meshlet), header.MeshletCount, file) == header.MeshletCount;
+
+	// Only a finished cache replaces the old one
+	if (fclose(file) != 0 || !success || !ReplaceWithFile(tempPath, cachePath))
+	{
+		RemoveFile(tempPath);
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Vertex.h"
+#include "MappedFile.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+#include <DirectXMath.h>
+#include <memory>
+#include <string>
+
+// --------------------------------------------------------
+// Binary mesh cache (.dxmesh)
+//
+// Stores a mesh's final vertex & index arrays exactly as they
+// get uploaded to the GPU, so later loads can memory-map the
+// file and hand its bytes straight to CreateBuffer without
+// parsing anything.
+//
+// Layout: a MeshCacheHeader, followed by the vertex array, the
+// index array (all levels of detail), the MeshLod table and the
+// Meshlet table, at the offsets given in the header.
+// --------------------------------------------------------
+
+// Bump this whenever the layout or contents of the file change,
+// so caches written by older builds are rebuilt automatically
+#define MESH_CACHE_VERSION 6
+
+struct MeshCacheHeader
+{
+	char Magic[4];							// Always "DXMS"
+	unsigned int Version;					// MESH_CACHE_VERSION
+	unsigned long long SourceHash;			// HashBytes() of the source .obj
+	unsigned long long SourceSize;			// Size of the source .obj, in bytes
+	unsigned long long SourceWriteTime;		// MappedFile::GetWriteTime() of the source .obj
+	unsigned int SettingsKey;				// Load options the mesh was built with
+	unsigned int VertexStride;				// sizeof(Vertex) when written
+	unsigned int VertexCount;
+	unsigned int IndexCount;				// All levels of detail together
+	unsigned int SourceVertexCount;			// Vertex count before welding
+	unsigned int LodCount;
+	unsigned int MeshletCount;
+	unsigned int Padding;
+	DirectX::XMFLOAT3 BoundsMin;			// Axis-aligned bounds of the positions
+	DirectX::XMFLOAT3 BoundsMax;
+	DirectX::XMFLOAT4 BoundingSphere;		// Center in xyz, radius in w
+	DirectX::XMFLOAT3 OrientedBoxCenter;	// See MeshBounds.h
+	DirectX::XMFLOAT3 OrientedBoxExtents;
+	DirectX::XMFLOAT4 OrientedBoxOrientation;
+	unsigned long long VertexOffset;		// Byte offsets from the start of the file
+	unsigned long long IndexOffset;
+	unsigned long long LodOffset;
+	unsigned long long MeshletOffset;
+};
+
+// A fast, non-cryptographic 64-bit hash for detecting changed files
+unsigned long long HashBytes(const void* data, size_t size);
+
+// The cache file that goes with a source file ("cube.obj" -> "cube.dxmesh")
+std::wstring GetMeshCachePath(const wchar_t* sourceFile);
+
+// Maps a cache file and checks it against the source it should have
+// been built from.  Returns null if the file is missing, from an older
+// version, corrupt or stale, in which case it should be rebuilt.
+//
+// The source is only hashed if it's the right size but has been
+// written since the cache was, so an up to date cache costs nothing
+// more than a look at the header (and a pass over the indices, to
+// check they're all in range).  If the hash still matches, the new
+// write time is saved in the cache so it isn't hashed again.
+std::shared_ptr<MappedFile> OpenMeshCache(
+	const std::wstring& cachePath,
+	const MappedFile& source,
+	unsigned int settingsKey);
+
+// Header of a cache file returned by OpenMeshCache()
+const MeshCacheHeader* GetMeshCacheHeader(const MappedFile& cache);
+
+// Writes a cache file.  "header" only needs the source and count
+// fields filled in; the rest is taken care of here.  It's written
+// to a temporary file first and renamed into place, so a crash
+// part way through never leaves a truncated cache.
+bool WriteMeshCache(
+	const std::wstring& cachePath,
+	MeshCacheHeader header,
+	const Vertex* vertices,
+	const unsigned int* indices,
+	const MeshLod* lods,
+	const Meshlet* meshlets);
@@ -0,0 +1,221 @@
+#include "MeshLoader.h"
+#include "MeshCache.h"
+#include "MeshWelder.h"
+#include "VertexCacheOptimizer.h"
+#include "TangentGeneratorSIMD.h"
+#include "VertexPacking.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+	// Packs the options that change the final arrays into one value,
+	// so a cache built with different options is never reused
+	unsigned int GetSettingsKey(const MeshLoadOptions& options)
+	{
+		struct
+		{
+			float WeldEpsilon;
+			unsigned char WeldVertices;
+			unsigned char OptimizeForGPU;
+			unsigned char GenerateMeshlets;
+			unsigned char FitOrientedBounds;
+			unsigned int LodCount;
+		} settings = {};
+
+		settings.WeldEpsilon = options.WeldEpsilon > 0.0f ? options.WeldEpsilon : 0.0f;
+		settings.WeldVertices = options.WeldVertices;
+		settings.OptimizeForGPU = options.OptimizeForGPU;
+		settings.GenerateMeshlets = options.GenerateMeshlets;
+		settings.FitOrientedBounds = options.FitOrientedBounds;
+		settings.LodCount = options.LodCount > 1 ? options.LodCount : 1;
+		return (unsigned int)HashBytes(&settings, sizeof(settings));
+	}
+
+	void CalculateBounds(const std::vector<Vertex>& verts, XMFLOAT3& boundsMin, XMFLOAT3& boundsMax)
+	{
+		boundsMin = verts[0].Position;
+		boundsMax = verts[0].Position;
+		for (size_t i = 1; i < verts.size(); i++)
+		{
+			const XMFLOAT3& p = verts[i].Position;
+			boundsMin.x = (std::min)(boundsMin.x, p.x);
+			boundsMin.y = (std::min)(boundsMin.y, p.y);
+			boundsMin.z = (std::min)(boundsMin.z, p.z);
+			boundsMax.x = (std::max)(boundsMax.x, p.x);
+			boundsMax.y = (std::max)(boundsMax.y, p.y);
+			boundsMax.z = (std::max)(boundsMax.z, p.z);
+		}
+	}
+
+	// Builds the compressed copy of the vertices
+	void PackLoadedVertices(LoadedMesh& mesh)
+	{
+		mesh.PackedVertices.resize(mesh.VertexCount);
+		PackVertices(
+			mesh.Vertices,
+			mesh.VertexCount,
+			mesh.BoundsMin,
+			mesh.BoundsMax,
+			mesh.PackedVertices.data(),
+			&mesh.PackingError);
+	}
+
+	// Over the full detail triangles, which come first
+	void BuildLoadedBVH(LoadedMesh& mesh, unsigned int threadCount)
+	{
+		mesh.BVH = std::make_shared<MeshBVH>();
+		mesh.BVH->Build(mesh.Vertices, mesh.VertexCount, mesh.Indices, mesh.Lods[0].IndexCount, threadCount);
+	}
+}
+
+// --------------------------------------------------------
+// The source file is always mapped, but only hashed when its
+// write time says it may have changed since it was cached
+// (see OpenMeshCache()), or when a new cache is written.
+// Hashing runs at memory speed, so even then it's a tiny
+// fraction of what parsing the file would cost.
+// --------------------------------------------------------
+bool LoadMeshFile(const wchar_t* filename, const MeshLoadOptions& options, LoadedMesh& mesh)
+{
+	PROFILE_SCOPE("LoadMeshFile");
+	MappedFile source(filename);
+	if (!source.IsOpen())
+		return false;
+
+	unsigned int settingsKey = GetSettingsKey(options);
+	std::wstring cachePath = GetMeshCachePath(filename);
+
+	// Up to date cache?  Then point straight into it
+	if (options.UseCache)
+	{
+		std::shared_ptr<MappedFile> cache = OpenMeshCache(cachePath, source, settingsKey);
+		if (cache)
+		{
+			const MeshCacheHeader* header = GetMeshCacheHeader(*cache);
+			mesh.Cache = cache;
+			mesh.Vertices = (const Vertex*)(cache->GetData() + header->VertexOffset);
+			mesh.Indices = (const unsigned int*)(cache->GetData() + header->IndexOffset);
+			mesh.VertexCount = header->VertexCount;
+			mesh.IndexCount = header->IndexCount;
+			mesh.SourceVertexCount = header->SourceVertexCount;
+			mesh.BoundsMin = header->BoundsMin;
+			mesh.BoundsMax = header->BoundsMax;
+			BoundingBox::CreateFromPoints(mesh.Bounds.Box, XMLoadFloat3(&header->BoundsMin), XMLoadFloat3(&header->BoundsMax));
+			mesh.Bounds.Sphere = BoundingSphere(
+				XMFLOAT3(header->BoundingSphere.x, header->BoundingSphere.y, header->BoundingSphere.z),
+				header->BoundingSphere.w);
+			mesh.Bounds.OrientedBox = BoundingOrientedBox(
+				header->OrientedBoxCenter,
+				header->OrientedBoxExtents,
+				header->OrientedBoxOrientation);
+			mesh.Lods.assign(
+				(const MeshLod*)(cache->GetData() + header->LodOffset),
+				(const MeshLod*)(cache->GetData() + header->LodOffset) + header->LodCount);
+			mesh.Meshlets.assign(
+				(const Meshlet*)(cache->GetData() + header->MeshletOffset),
+				(const Meshlet*)(cache->GetData() + header->MeshletOffset) + header->MeshletCount);
+			mesh.FromCache = true;
+			if (mesh.IndexCount == 0)
+				return false;
+
+			if (options.PackVertices)
+				PackLoadedVertices(mesh);
+			if (options.BuildBVH)
+				BuildLoadedBVH(mesh, options.ParseThreads);
+			return true;
+		}
+	}
+
+	// Otherwise, build it from the source
+	ObjData obj;
+	ParseObjParallel(source.GetData(), source.GetData() + source.GetSize(), obj, options.ParseThreads);
+
+	MeshData& data = mesh.Data;
+	BuildMeshData(obj, data, options.WeldVertices);
+	if (data.Indices.empty())
+		return false;
+
+	// Before welding, there was one vertex per face corner
+	unsigned int sourceVertexCount = (unsigned int)data.Indices.size();
+	if (options.WeldEpsilon > 0.0f)
+		WeldVertices(data, options.WeldEpsilon);
+
+	// Welding drops triangles that collapse, which might be all of them
+	if (data.Indices.empty())
+		return false;
+
+	// Welding is what makes vertex reuse possible, so this has to come after it
+	if (options.OptimizeForGPU)
+		OptimizeVertexCache(&data.Indices[0], data.Indices.size(), data.Vertices.size());
+
+	// Meshlets keep the triangles in roughly the same order, just
+	// grouped, so this barely affects the vertex cache
+	if (options.GenerateMeshlets)
+		BuildMeshlets(&data.Vertices[0], data.Vertices.size(), &data.Indices[0], data.Indices.size(), mesh.Meshlets);
+
+	// Vertex order has to follow the final triangle order
+	if (options.OptimizeForGPU)
+		OptimizeVertexFetch(data);
+
+	GenerateTangentsParallel(
+		&data.Vertices[0],
+		(int)data.Vertices.size(),
+		&data.Indices[0],
+		(int)data.Indices.size(),
+		options.ParseThreads);
+
+	// The simpler levels reuse the full mesh's vertices (and so its tangents)
+	GenerateLods(data, options.LodCount, mesh.Lods);
+
+	mesh.Cache.reset();
+	mesh.Vertices = &data.Vertices[0];
+	mesh.Indices = &data.Indices[0];
+	mesh.VertexCount = (unsigned int)data.Vertices.size();
+	mesh.IndexCount = (unsigned int)data.Indices.size();
+	mesh.SourceVertexCount = sourceVertexCount;
+	CalculateBounds(data.Vertices, mesh.BoundsMin, mesh.BoundsMax);
+	CalculateMeshBounds(mesh.Vertices, mesh.VertexCount, mesh.Bounds, options.FitOrientedBounds);
+	mesh.FromCache = false;
+
+	// Packing is quick, so it isn't cached
+	if (options.PackVertices)
+		PackLoadedVertices(mesh);
+
+	// The BVH is quick to build too, so it isn't cached either
+	if (options.BuildBVH)
+		BuildLoadedBVH(mesh, options.ParseThreads);
+
+	// Save it for next time (failing to is harmless, since
+	// the mesh will just be built from source again)
+	if (options.UseCache)
+	{
+		MeshCacheHeader header = {};
+		header.SourceHash = HashBytes(source.GetData(), source.GetSize());
+		header.SourceSize = source.GetSize();
+		header.SourceWriteTime = source.GetWriteTime();
+		header.SettingsKey = settingsKey;
+		header.VertexCount = mesh.VertexCount;
+		header.IndexCount = mesh.IndexCount;
+		header.SourceVertexCount = mesh.SourceVertexCount;
+		header.BoundsMin = mesh.BoundsMin;
+		header.BoundsMax = mesh.BoundsMax;
+		header.BoundingSphere = XMFLOAT4(
+			mesh.Bounds.Sphere.Center.x,
+			mesh.Bounds.Sphere.Center.y,
+			mesh.Bounds.Sphere.Center.z,
+			mesh.Bounds.Sphere.Radius);
+		header.OrientedBoxCenter = mesh.Bounds.OrientedBox.Center;
+		header.OrientedBoxExtents = mesh.Bounds.OrientedBox.Extents;
+		header.OrientedBoxOrientation = mesh.Bounds.OrientedBox.Orientation;
+		header.LodCount = (unsigned int)mesh.Lods.size();
+		header.MeshletCount = (unsigned int)mesh.Meshlets.size();
+		WriteMeshCache(cachePath, header, mesh.Vertices, mesh.Indices, &mesh.Lods[0], mesh.Meshlets.data());
+	}
+
+	return true;
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "ObjParser.h"
+#include "MappedFile.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+#include "VertexPacking.h"
+#include "MeshBounds.h"
+#include "MeshBVH.h"
+#include <DirectXMath.h>
+#include <memory>
+
+// --------------------------------------------------------
+// Options for how a mesh file is processed while loading it
+// --------------------------------------------------------
+struct MeshLoadOptions
+{
+	// Share one vertex between all face corners that use the
+	// same position/uv/normal, instead of one vertex per corner
+	bool WeldVertices;
+
+	// If above zero, also merge vertices whose attributes are
+	// all within this distance of each other (after welding)
+	float WeldEpsilon;
+
+	// Reorder triangles & vertices for the GPU's vertex caches
+	// (see VertexCacheOptimizer.h)
+	bool OptimizeForGPU;
+
+	// Split the full detail mesh into meshlets for cluster culling
+	// (see MeshletBuilder.h)
+	bool GenerateMeshlets;
+
+	// Fit an oriented bounding box to the mesh, rather than
+	// just reusing its axis-aligned one (see MeshBounds.h)
+	bool FitOrientedBounds;
+
+	// Levels of detail to generate, including the full mesh
+	// (see MeshSimplifier.h).  1 means just the full mesh.
+	unsigned int LodCount;
+
+	// Threads used to parse large files, calculate their tangents
+	// and build their BVHs (0 = one per core, 1 = serial)
+	unsigned int ParseThreads;
+
+	// Also make a compressed copy of the vertices (see VertexPacking.h)
+	bool PackVertices;
+
+	// Build a BVH over the full detail triangles, for ray casts
+	// (see MeshBVH.h)
+	bool BuildBVH;
+
+	// Load from (and save to) a binary .dxmesh file next to the source,
+	// skipping all of the parsing & processing when it's up to date
+	bool UseCache;
+
+	MeshLoadOptions() :
+		WeldVertices(true),
+		WeldEpsilon(0.0f),
+		OptimizeForGPU(true),
+		GenerateMeshlets(true),
+		FitOrientedBounds(true),
+		LodCount(4),
+		ParseThreads(0),
+		PackVertices(false),
+		BuildBVH(true),
+		UseCache(true)
+	{
+	}
+};
+
+// --------------------------------------------------------
+// The final, GPU-ready arrays of a loaded mesh
+//
+// - Built from source, the arrays live in Data
+// - Loaded from a cache, they point straight into the mapped
+//   file, which stays mapped for as long as this object lives
+// - Either way, use Vertices & Indices to get at them
+// --------------------------------------------------------
+struct LoadedMesh
+{
+	MeshData Data;
+	std::shared_ptr<MappedFile> Cache;
+
+	const Vertex* Vertices;
+	const unsigned int* Indices;
+	unsigned int VertexCount;
+	unsigned int IndexCount;		// All levels of detail together
+	unsigned int SourceVertexCount;	// Vertices before welding (one per face corner)
+
+	DirectX::XMFLOAT3 BoundsMin;
+	DirectX::XMFLOAT3 BoundsMax;
+
+	// Box, sphere & oriented box around the vertices
+	MeshBounds Bounds;
+
+	// Ranges of Indices making up each level of detail
+	std::vector<MeshLod> Lods;
+
+	// Clusters of the full detail level, if they were generated
+	std::vector<Meshlet> Meshlets;
+
+	// The compressed vertices, if options.PackVertices was set,
+	// and how far they are from the originals
+	std::vector<PackedVertex> PackedVertices;
+	PackedVertexError PackingError;
+
+	// Ray cast acceleration, if options.BuildBVH was set
+	std::shared_ptr<MeshBVH> BVH;
+
+	bool FromCache;
+
+	LoadedMesh() :
+		Vertices(0),
+		Indices(0),
+		VertexCount(0),
+		IndexCount(0),
+		SourceVertexCount(0),
+		BoundsMin(0, 0, 0),
+		BoundsMax(0, 0, 0),
+		Bounds(),
+		PackingError(),
+		FromCache(false)
+	{
+	}
+
+	// The pointers refer to this object's own storage
+	LoadedMesh(const LoadedMesh&) = delete;
+	LoadedMesh& operator=(const LoadedMesh&) = delete;
+};
+
+// --------------------------------------------------------
+// Loads an .obj file all the way to GPU-ready vertex & index
+// arrays: parse, weld, optimize for the vertex cache, build
+// meshlets, calculate tangents, generate levels of detail and
+// find the bounding volumes.
+//
+// With options.UseCache, the result is written to a .dxmesh
+// file (see MeshCache.h) and later loads just map that file,
+// as long as the .obj hasn't changed since.
+//
+// Returns false if the file couldn't be read or has no faces
+// --------------------------------------------------------
+bool LoadMeshFile(const wchar_t* filename, const MeshLoadOptions& options, LoadedMesh& mesh);
@@ -0,0 +1,493 @@
+#include "MeshSimplifier.h"
+#include "VertexCacheOptimizer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+	// --------------------------------------------------------
+	// Sum of (area weighted) squared distances to a set of planes,
+	// stored as the symmetric 3x3 matrix A, vector b and scalar c
+	// of  v'Av + 2b'v + c
+	// --------------------------------------------------------
+	struct Quadric
+	{
+		double A00, A11, A22, A01, A02, A12;
+		double B0, B1, B2;
+		double C;
+		double Weight;
+
+		void AddPlane(double nx, double ny, double nz, double d, double weight)
+		{
+			A00 += weight * nx * nx;
+			A11 += weight * ny * ny;
+			A22 += weight * nz * nz;
+			A01 += weight * nx * ny;
+			A02 += weight * nx * nz;
+			A12 += weight * ny * nz;
+			B0 += weight * nx * d;
+			B1 += weight * ny * d;
+			B2 += weight * nz * d;
+			C += weight * d * d;
+			Weight += weight;
+		}
+
+		void Add(const Quadric& q)
+		{
+			A00 += q.A00; A11 += q.A11; A22 += q.A22;
+			A01 += q.A01; A02 += q.A02; A12 += q.A12;
+			B0 += q.B0; B1 += q.B1; B2 += q.B2;
+			C += q.C;
+			Weight += q.Weight;
+		}
+
+		// Mean squared distance from p to the planes
+		double Error(const XMFLOAT3& p) const
+		{
+			double x = p.x, y = p.y, z = p.z;
+			double error =
+				x * (A00 * x + A01 * y + A02 * z) +
+				y * (A01 * x + A11 * y + A12 * z) +
+				z * (A02 * x + A12 * y + A22 * z) +
+				2.0 * (B0 * x + B1 * y + B2 * z) + C;
+
+			return Weight > 0.0 ? (std::max)(error, 0.0) / Weight : 0.0;
+		}
+	};
+
+	struct Collapse
+	{
+		unsigned int From;
+		unsigned int To;
+		double Error;
+
+		bool operator<(const Collapse& other) const { return Error < other.Error; }
+	};
+
+	inline XMFLOAT3 Cross(const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c)
+	{
+		float x1 = b.x - a.x, y1 = b.y - a.y, z1 = b.z - a.z;
+		float x2 = c.x - a.x, y2 = c.y - a.y, z2 = c.z - a.z;
+		return XMFLOAT3(y1 * z2 - z1 * y2, z1 * x2 - x1 * z2, x1 * y2 - y1 * x2);
+	}
+
+	inline float Dot(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	inline bool SamePosition(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return a.x == b.x && a.y == b.y && a.z == b.z;
+	}
+
+	// --------------------------------------------------------
+	// Groups vertices that share a position (the copies of a
+	// vertex on either side of a UV or normal seam), returning
+	// the first vertex of each one's group
+	// --------------------------------------------------------
+	std::vector<unsigned int> GroupPositions(const Vertex* vertices, size_t vertexCount)
+	{
+		std::vector<unsigned int> order(vertexCount);
+		for (size_t i = 0; i < vertexCount; i++)
+			order[i] = (unsigned int)i;
+
+		std::sort(order.begin(), order.end(), [vertices](unsigned int a, unsigned int b)
+		{
+			const XMFLOAT3& pa = vertices[a].Position;
+			const XMFLOAT3& pb = vertices[b].Position;
+			if (pa.x != pb.x) return pa.x < pb.x;
+			if (pa.y != pb.y) return pa.y < pb.y;
+			if (pa.z != pb.z) return pa.z < pb.z;
+			return a < b;
+		});
+
+		std::vector<unsigned int> group(vertexCount);
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			bool sameAsPrevious = i > 0 && SamePosition(vertices[order[i]].Position, vertices[order[i - 1]].Position);
+			group[order[i]] = sameAsPrevious ? group[order[i - 1]] : order[i];
+		}
+
+		return group;
+	}
+
+	// --------------------------------------------------------
+	// Finds the vertices that must stay where they are: ones
+	// with more than one used copy (seams), and ones on an edge
+	// that isn't shared by exactly two opposing triangles
+	// (open borders and non-manifold edges)
+	// --------------------------------------------------------
+	std::vector<bool> FindLockedVertices(
+		const unsigned int* indices,
+		size_t indexCount,
+		const std::vector<unsigned int>& group)
+	{
+		size_t vertexCount = group.size();
+		std::vector<bool> locked(vertexCount, false);
+
+		// Seams: two different vertices of one position group in use
+		std::vector<unsigned int> usedCopy(vertexCount, 0xFFFFFFFF);
+		for (size_t i = 0; i < indexCount; i++)
+		{
+			unsigned int v = indices[i];
+			unsigned int& copy = usedCopy[group[v]];
+			if (copy == 0xFFFFFFFF)
+				copy = v;
+			else if (copy != v)
+				locked[group[v]] = true;
+		}
+
+		// Borders: sort every directed edge (by position group), then
+		// each one should appear exactly once, along with its reverse
+		std::vector<unsigned long long> edges;
+		edges.reserve(indexCount);
+		for (size_t i = 0; i + 2 < indexCount; i += 3)
+		{
+			for (int e = 0; e < 3; e++)
+			{
+				unsigned long long a = group[indices[i + e]];
+				unsigned long long b = group[indices[i + (e + 1) % 3]];
+				edges.push_back((a << 32) | b);
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+
+		for (size_t i = 0; i < edges.size(); i++)
+		{
+			unsigned long long edge = edges[i];
+			unsigned long long reverse = (edge << 32) | (edge >> 32);
+			bool duplicated =
+				(i > 0 && edges[i - 1] == edge) ||
+				(i + 1 < edges.size() && edges[i + 1] == edge);
+			bool opposed = std::binary_search(edges.begin(), edges.end(), reverse);
+
+			if (duplicated || !opposed)
+			{
+				locked[(unsigned int)(edge >> 32)] = true;
+				locked[(unsigned int)(edge & 0xFFFFFFFF)] = true;
+			}
+		}
+
+		// Spread the flag from each group's first vertex to all of its copies
+		for (size_t v = 0; v < vertexCount; v++)
+			locked[v] = locked[group[v]];
+
+		return locked;
+	}
+
+	// --------------------------------------------------------
+	// Would moving "from" onto "to" flip or badly fold any of
+	// the triangles around "from"?  Triangles that use both
+	// vertices disappear, so they don't count.
+	// --------------------------------------------------------
+	bool CollapseFlipsTriangles(
+		const Vertex* vertices,
+		const unsigned int* indices,
+		const unsigned int* triangles,
+		unsigned int triangleCount,
+		unsigned int from,
+		unsigned int to)
+	{
+		const XMFLOAT3& target = vertices[to].Position;
+		for (unsigned int i = 0; i < triangleCount; i++)
+		{
+			const unsigned int* tri = indices + triangles[i] * 3;
+			if (tri[0] == to || tri[1] == to || tri[2] == to)
+				continue;
+
+			XMFLOAT3 corners[3] =
+			{
+				vertices[tri[0]].Position,
+				vertices[tri[1]].Position,
+				vertices[tri[2]].Position
+			};
+			XMFLOAT3 before = Cross(corners[0], corners[1], corners[2]);
+
+			for (int c = 0; c < 3; c++)
+			{
+				if (tri[c] == from)
+					corners[c] = target;
+			}
+			XMFLOAT3 after = Cross(corners[0], corners[1], corners[2]);
+
+			// Reject anything that turns more than ~75 degrees
+			float lengths = std::sqrt(Dot(before, before) * Dot(after, after));
+			if (Dot(before, after) <= 0.25f * lengths)
+				return true;
+		}
+
+		return false;
+	}
+
+	// --------------------------------------------------------
+	// Simplification state that persists between calls to
+	// Simplify(), so a whole LOD chain can be built in one go:
+	// each level just carries on collapsing from the last one,
+	// with the quadrics still measuring against the full mesh
+	// --------------------------------------------------------
+	class QuadricSimplifier
+	{
+	public:
+		QuadricSimplifier(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount);
+
+		size_t Simplify(size_t targetIndexCount, float maxError);
+
+		const unsigned int* GetIndices() const { return indices.empty() ? 0 : &indices[0]; }
+		size_t GetIndexCount() const { return indices.size(); }
+		float GetError() const { return error; }
+
+	private:
+		const Vertex* vertices;
+		size_t vertexCount;
+		std::vector<unsigned int> indices;
+		float error;
+
+		std::vector<unsigned int> group;
+		std::vector<bool> locked;
+		std::vector<Quadric> quadrics;
+
+		// Scratch space, kept around between passes
+		std::vector<unsigned int> remap;
+		std::vector<bool> changed;
+		std::vector<unsigned int> firstTriangle;
+		std::vector<unsigned int> vertexTriangles;
+		std::vector<Collapse> collapses;
+	};
+
+	QuadricSimplifier::QuadricSimplifier(
+		const Vertex* vertices,
+		size_t vertexCount,
+		const unsigned int* sourceIndices,
+		size_t indexCount)
+		:
+		vertices(vertices),
+		vertexCount(vertexCount),
+		indices(sourceIndices, sourceIndices + (indexCount - indexCount % 3)),
+		error(0.0f),
+		remap(vertexCount),
+		changed(vertexCount),
+		firstTriangle(vertexCount + 1)
+	{
+		if (indices.empty() || vertexCount == 0)
+			return;
+
+		group = GroupPositions(vertices, vertexCount);
+		locked = FindLockedVertices(&indices[0], indices.size(), group);
+
+		// Each vertex starts with the planes of the triangles around it
+		Quadric empty = {};
+		quadrics.assign(vertexCount, empty);
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			const XMFLOAT3& p0 = vertices[indices[i]].Position;
+			XMFLOAT3 normal = Cross(p0, vertices[indices[i + 1]].Position, vertices[indices[i + 2]].Position);
+			double length = std::sqrt((double)Dot(normal, normal));
+			if (length == 0.0)
+				continue;
+
+			double nx = normal.x / length, ny = normal.y / length, nz = normal.z / length;
+			double d = -(nx * p0.x + ny * p0.y + nz * p0.z);
+			for (int c = 0; c < 3; c++)
+				quadrics[indices[i + c]].AddPlane(nx, ny, nz, d, length * 0.5);
+		}
+
+		// Seam copies share one quadric, so they score consistently
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			if (group[v] != v)
+				quadrics[group[v]].Add(quadrics[v]);
+		}
+		for (size_t v = 0; v < vertexCount; v++)
+			quadrics[v] = quadrics[group[v]];
+	}
+
+	// --------------------------------------------------------
+	// Works in passes.  Each pass scores every possible collapse
+	// along the current edges, then performs the cheapest ones in
+	// order, skipping any that touch a vertex already changed in
+	// this pass (their scores are out of date).  The triangles are
+	// rebuilt between passes, until the target is reached or no
+	// collapse is cheap enough.
+	// --------------------------------------------------------
+	size_t QuadricSimplifier::Simplify(size_t targetIndexCount, float maxError)
+	{
+		double maxSquaredError = (double)maxError * maxError;
+
+		while (indices.size() > targetIndexCount)
+		{
+			size_t indexCount = indices.size();
+			size_t triangleCount = indexCount / 3;
+
+			// Triangles around each vertex (as in OptimizeVertexCache)
+			std::fill(firstTriangle.begin(), firstTriangle.end(), 0);
+			for (size_t i = 0; i < indexCount; i++)
+				firstTriangle[indices[i] + 1]++;
+			for (size_t v = 0; v < vertexCount; v++)
+				firstTriangle[v + 1] += firstTriangle[v];
+
+			vertexTriangles.resize(indexCount);
+			{
+				std::vector<unsigned int> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+				for (size_t i = 0; i < indexCount; i++)
+					vertexTriangles[fill[indices[i]]++] = (unsigned int)(i / 3);
+			}
+
+			// Score every edge, keeping whichever direction is cheaper.  Edges
+			// inside the mesh are in two triangles (once each way round), so
+			// only the a < b copy is used; border edges are locked anyway.
+			collapses.clear();
+			for (size_t i = 0; i < indexCount; i += 3)
+			{
+				for (int e = 0; e < 3; e++)
+				{
+					unsigned int a = indices[i + e];
+					unsigned int b = indices[i + (e + 1) % 3];
+					if (a > b || group[a] == group[b] || (locked[a] && locked[b]))
+						continue;
+
+					Quadric combined = quadrics[a];
+					combined.Add(quadrics[b]);
+
+					Collapse collapse = { a, b, DBL_MAX };
+					if (!locked[a])
+						collapse.Error = combined.Error(vertices[b].Position);
+
+					double reverseError = locked[b] ? DBL_MAX : combined.Error(vertices[a].Position);
+					if (reverseError < collapse.Error)
+					{
+						collapse.From = b;
+						collapse.To = a;
+						collapse.Error = reverseError;
+					}
+
+					if (collapse.Error <= maxSquaredError)
+						collapses.push_back(collapse);
+				}
+			}
+			std::sort(collapses.begin(), collapses.end());
+
+			// An interior collapse removes two triangles, so this is
+			// about as many as can be done without overshooting
+			size_t collapseGoal = (triangleCount - targetIndexCount / 3) / 2 + 1;
+			size_t collapsed = 0;
+
+			for (size_t v = 0; v < vertexCount; v++)
+				remap[v] = (unsigned int)v;
+			std::fill(changed.begin(), changed.end(), false);
+
+			for (size_t i = 0; i < collapses.size() && collapsed < collapseGoal; i++)
+			{
+				const Collapse& collapse = collapses[i];
+				if (changed[collapse.From] || changed[collapse.To])
+					continue;
+
+				unsigned int first = firstTriangle[collapse.From];
+				if (CollapseFlipsTriangles(
+					vertices,
+					&indices[0],
+					&vertexTriangles[first],
+					firstTriangle[collapse.From + 1] - first,
+					collapse.From,
+					collapse.To))
+					continue;
+
+				remap[collapse.From] = collapse.To;
+				quadrics[collapse.To].Add(quadrics[collapse.From]);
+				changed[collapse.From] = true;
+				changed[collapse.To] = true;
+
+				error = (std::max)(error, (float)std::sqrt(collapse.Error));
+				collapsed++;
+			}
+
+			if (collapsed == 0)
+				break;
+
+			// Rebuild the triangles, dropping the ones that collapsed
+			size_t kept = 0;
+			for (size_t i = 0; i < indexCount; i += 3)
+			{
+				unsigned int a = remap[indices[i]];
+				unsigned int b = remap[indices[i + 1]];
+				unsigned int c = remap[indices[i + 2]];
+				if (a == b || b == c || a == c)
+					continue;
+
+				indices[kept++] = a;
+				indices[kept++] = b;
+				indices[kept++] = c;
+			}
+			indices.resize(kept);
+		}
+
+		return indices.size();
+	}
+}
+
+size_t SimplifyMesh(
+	const Vertex* vertices,
+	size_t vertexCount,
+	const unsigned int* indices,
+	size_t indexCount,
+	size_t targetIndexCount,
+	float maxError,
+	unsigned int* destination,
+	float* resultError)
+{
+	QuadricSimplifier simplifier(vertices, vertexCount, indices, indexCount);
+	size_t count = simplifier.Simplify(targetIndexCount, maxError);
+
+	if (count > 0)
+		memcpy(destination, simplifier.GetIndices(), count * sizeof(unsigned int));
+	if (resultError)
+		*resultError = simplifier.GetError();
+	return count;
+}
+
+// --------------------------------------------------------
+// Each level carries on from the one before it, but the
+// quadrics still describe the full mesh, so every level's
+// error is measured against the real surface
+// --------------------------------------------------------
+void GenerateLods(MeshData& mesh, unsigned int lodCount, std::vector<MeshLod>& lods)
+{
+	lods.clear();
+
+	MeshLod full = { 0, (unsigned int)mesh.Indices.size(), 0.0f };
+	lods.push_back(full);
+	if (mesh.Indices.empty() || lodCount < 2)
+		return;
+
+	QuadricSimplifier simplifier(&mesh.Vertices[0], mesh.Vertices.size(), &mesh.Indices[0], mesh.Indices.size());
+	std::vector<unsigned int> level;
+	size_t previousCount = full.IndexCount;
+
+	for (unsigned int lod = 1; lod < lodCount; lod++)
+	{
+		size_t target = (previousCount / 2) / 3 * 3;
+		if (target < 3)
+			break;
+
+		size_t count = simplifier.Simplify(target, FLT_MAX);
+
+		// Not worth a level if it barely got any simpler
+		if (count == 0 || count > previousCount * 9 / 10)
+			break;
+
+		// Reordering doesn't change the triangles, so this
+		// copy can go on to be simplified further
+		level.assign(simplifier.GetIndices(), simplifier.GetIndices() + count);
+		OptimizeVertexCache(&level[0], count, mesh.Vertices.size());
+
+		MeshLod simplified = { (unsigned int)mesh.Indices.size(), (unsigned int)count, simplifier.GetError() };
+		lods.push_back(simplified);
+		mesh.Indices.insert(mesh.Indices.end(), level.begin(), level.end());
+		previousCount = count;
+	}
+}
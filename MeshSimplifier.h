@@ -0,0 +1,56 @@
+#pragma once
+
+#include "ObjParser.h"
+#include <cstddef>
+#include <vector>
+
+// --------------------------------------------------------
+// One level of detail within a mesh's index buffer
+//
+// All levels share the mesh's vertex buffer; each is just
+// a different range of the index buffer.
+// --------------------------------------------------------
+struct MeshLod
+{
+	unsigned int IndexOffset;
+	unsigned int IndexCount;
+
+	// How far (in the mesh's own units) this level's surface
+	// strays from the full detail mesh.  Divide by distance and
+	// multiply by the projection's scale to get it in pixels.
+	float Error;
+};
+
+// --------------------------------------------------------
+// Simplifies a triangle list with quadric error metrics
+// (Garland & Heckbert), by collapsing edges until the index
+// count reaches targetIndexCount or the next collapse would
+// move the surface more than maxError
+//
+// - Vertices are only ever collapsed onto other existing
+//   vertices, so the result uses the same vertex buffer
+// - Vertices on UV/normal seams and on open borders are never
+//   moved, so seams don't tear and outlines don't shrink
+// - Collapses that would flip (or nearly flip) a triangle's
+//   normal are rejected
+//
+// "destination" needs room for indexCount indices.  Returns
+// the new index count, and the error in resultError.
+// --------------------------------------------------------
+size_t SimplifyMesh(
+	const Vertex* vertices,
+	size_t vertexCount,
+	const unsigned int* indices,
+	size_t indexCount,
+	size_t targetIndexCount,
+	float maxError,
+	unsigned int* destination,
+	float* resultError);
+
+// --------------------------------------------------------
+// Builds up to lodCount levels of detail (including the full
+// mesh) by halving the triangle count at each level.  The
+// extra levels are appended to mesh.Indices and described in
+// "lods".  Stops early once the mesh can't be reduced further.
+// --------------------------------------------------------
+void GenerateLods(MeshData& mesh, unsigned int lodCount, std::vector<MeshLod>& lods);
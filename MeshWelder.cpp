@@ -0,0 +1,130 @@
+#include "MeshWelder.h"
+
+#include <cmath>
+#include <unordered_map>
+
+using namespace DirectX;
+
+namespace
+{
+	inline bool Close(float a, float b, float epsilon)
+	{
+		return std::fabs(a - b) <= epsilon;
+	}
+
+	bool AttributesClose(const Vertex& a, const Vertex& b, float epsilon)
+	{
+		return
+			Close(a.Position.x, b.Position.x, epsilon) &&
+			Close(a.Position.y, b.Position.y, epsilon) &&
+			Close(a.Position.z, b.Position.z, epsilon) &&
+			Close(a.Normal.x, b.Normal.x, epsilon) &&
+			Close(a.Normal.y, b.Normal.y, epsilon) &&
+			Close(a.Normal.z, b.Normal.z, epsilon) &&
+			Close(a.UV.x, b.UV.x, epsilon) &&
+			Close(a.UV.y, b.UV.y, epsilon);
+	}
+
+	// Packs a grid cell coordinate into a single hashable key
+	inline unsigned long long CellKey(long long x, long long y, long long z)
+	{
+		return
+			((unsigned long long)(x & 0x1FFFFF) << 42) |
+			((unsigned long long)(y & 0x1FFFFF) << 21) |
+			((unsigned long long)(z & 0x1FFFFF));
+	}
+}
+
+// --------------------------------------------------------
+// Vertices are bucketed into a grid of epsilon-sized cells
+// by position.  Anything within epsilon of a vertex has to be
+// in its cell or one of the 26 neighbours, so only those few
+// buckets need to be searched for a match.
+// --------------------------------------------------------
+unsigned int WeldVertices(MeshData& mesh, float epsilon)
+{
+	size_t vertexCount = mesh.Vertices.size();
+	if (vertexCount == 0 || epsilon <= 0.0f)
+		return 0;
+
+	// Each cell stores the first kept vertex in it, and
+	// "nextInCell" chains the rest of that cell's vertices
+	std::unordered_map<unsigned long long, unsigned int> cells;
+	cells.reserve(vertexCount);
+	std::vector<unsigned int> nextInCell;
+	nextInCell.reserve(vertexCount);
+
+	std::vector<Vertex> welded;
+	welded.reserve(vertexCount);
+	std::vector<unsigned int> remap(vertexCount);
+
+	const unsigned int endOfCell = 0xFFFFFFFF;
+	float inverseCellSize = 1.0f / epsilon;
+
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const Vertex& v = mesh.Vertices[i];
+		long long cx = (long long)std::floor(v.Position.x * inverseCellSize);
+		long long cy = (long long)std::floor(v.Position.y * inverseCellSize);
+		long long cz = (long long)std::floor(v.Position.z * inverseCellSize);
+
+		// Search this cell and its neighbours for a match
+		unsigned int match = endOfCell;
+		for (int dx = -1; dx <= 1 && match == endOfCell; dx++)
+		{
+			for (int dy = -1; dy <= 1 && match == endOfCell; dy++)
+			{
+				for (int dz = -1; dz <= 1 && match == endOfCell; dz++)
+				{
+					auto cell = cells.find(CellKey(cx + dx, cy + dy, cz + dz));
+					if (cell == cells.end())
+						continue;
+
+					for (unsigned int w = cell->second; w != endOfCell; w = nextInCell[w])
+					{
+						if (AttributesClose(v, welded[w], epsilon))
+						{
+							match = w;
+							break;
+						}
+					}
+				}
+			}
+		}
+
+		if (match == endOfCell)
+		{
+			// Nothing close enough, so keep this vertex
+			// and make it the head of its cell's chain
+			match = (unsigned int)welded.size();
+			welded.push_back(v);
+
+			auto inserted = cells.insert(std::make_pair(CellKey(cx, cy, cz), match));
+			nextInCell.push_back(inserted.second ? endOfCell : inserted.first->second);
+			inserted.first->second = match;
+		}
+
+		remap[i] = match;
+	}
+
+	// Remap the triangles, dropping any that collapsed
+	// because two of their corners were merged
+	size_t kept = 0;
+	for (size_t i = 0; i + 2 < mesh.Indices.size(); i += 3)
+	{
+		unsigned int a = remap[mesh.Indices[i]];
+		unsigned int b = remap[mesh.Indices[i + 1]];
+		unsigned int c = remap[mesh.Indices[i + 2]];
+		if (a == b || b == c || a == c)
+			continue;
+
+		mesh.Indices[kept++] = a;
+		mesh.Indices[kept++] = b;
+		mesh.Indices[kept++] = c;
+	}
+	mesh.Indices.resize(kept);
+
+	unsigned int removed = (unsigned int)(vertexCount - welded.size());
+	mesh.Vertices.swap(welded);
+	return removed;
+}
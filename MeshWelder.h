@@ -0,0 +1,16 @@
+#pragma once
+
+#include "ObjParser.h"
+
+// --------------------------------------------------------
+// Merges vertices whose attributes are all within "epsilon"
+// of each other (position, normal and uv, compared per
+// component), rewriting the index list to match
+//
+// - Catches duplicates an exact index weld can't, such as
+//   exporters that write the same position several times
+// - Tangents are ignored, since they're calculated afterwards
+// - Triangles that collapse to a line are removed
+// - Returns the number of vertices that were removed
+// --------------------------------------------------------
+unsigned int WeldVertices(MeshData& mesh, float epsilon);
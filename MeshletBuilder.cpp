@@ -0,0 +1,252 @@
+#include "MeshletBuilder.h"
+#include "Frustum.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// --------------------------------------------------------
+	// Fills in a finished meshlet's bounding sphere and normal
+	// cone from its triangles
+	// --------------------------------------------------------
+	void CalculateMeshletBounds(
+		const Vertex* vertices,
+		const unsigned int* indices,
+		const unsigned int* meshletVertices,
+		Meshlet& meshlet)
+	{
+		// Sphere around the middle of the box, which is
+		// plenty tight for clusters this small
+		XMVECTOR boxMin = XMVectorReplicate(FLT_MAX);
+		XMVECTOR boxMax = XMVectorReplicate(-FLT_MAX);
+		for (unsigned int i = 0; i < meshlet.VertexCount; i++)
+		{
+			XMVECTOR p = XMLoadFloat3(&vertices[meshletVertices[i]].Position);
+			boxMin = XMVectorMin(boxMin, p);
+			boxMax = XMVectorMax(boxMax, p);
+		}
+
+		XMVECTOR center = (boxMin + boxMax) * 0.5f;
+		float radiusSq = 0.0f;
+		for (unsigned int i = 0; i < meshlet.VertexCount; i++)
+		{
+			XMVECTOR p = XMLoadFloat3(&vertices[meshletVertices[i]].Position);
+			radiusSq = (std::max)(radiusSq, XMVectorGetX(XMVector3LengthSq(p - center)));
+		}
+		XMStoreFloat3(&meshlet.Center, center);
+		meshlet.Radius = std::sqrt(radiusSq);
+
+		// The cone's axis is the average face normal, and its
+		// width is set by the normal furthest from that
+		const unsigned int* tris = indices + meshlet.IndexOffset;
+		XMVECTOR normals[MESHLET_MAX_TRIANGLES];
+		unsigned int normalCount = 0;
+		XMVECTOR axis = XMVectorZero();
+		for (unsigned int t = 0; t < meshlet.TriangleCount && normalCount < MESHLET_MAX_TRIANGLES; t++)
+		{
+			XMVECTOR p0 = XMLoadFloat3(&vertices[tris[t * 3]].Position);
+			XMVECTOR p1 = XMLoadFloat3(&vertices[tris[t * 3 + 1]].Position);
+			XMVECTOR p2 = XMLoadFloat3(&vertices[tris[t * 3 + 2]].Position);
+
+			// Clockwise winding, so this points out of the front face
+			XMVECTOR normal = XMVector3Cross(p1 - p0, p2 - p0);
+			if (XMVectorGetX(XMVector3LengthSq(normal)) == 0.0f)
+				continue;
+
+			normals[normalCount] = XMVector3Normalize(normal);
+			axis += normals[normalCount];
+			normalCount++;
+		}
+
+		meshlet.ConeAxis = XMFLOAT3(0, 0, 0);
+		meshlet.ConeCutoff = 1.0f;
+		if (normalCount == 0 || XMVectorGetX(XMVector3LengthSq(axis)) == 0.0f)
+			return;
+
+		axis = XMVector3Normalize(axis);
+		float minDot = 1.0f;
+		for (unsigned int i = 0; i < normalCount; i++)
+			minDot = (std::min)(minDot, XMVectorGetX(XMVector3Dot(axis, normals[i])));
+
+		// Cones wider than ~84 degrees either side almost never cull anything
+		XMStoreFloat3(&meshlet.ConeAxis, axis);
+		if (minDot > 0.1f)
+			meshlet.ConeCutoff = std::sqrt(1.0f - minDot * minDot);
+	}
+}
+
+void BuildMeshlets(
+	const Vertex* vertices,
+	size_t vertexCount,
+	unsigned int* indices,
+	size_t indexCount,
+	std::vector<Meshlet>& meshlets,
+	unsigned int maxVertices,
+	unsigned int maxTriangles)
+{
+	meshlets.clear();
+
+	maxVertices = (std::max)(3u, (std::min)(maxVertices, (unsigned int)MESHLET_MAX_VERTICES));
+	maxTriangles = (std::max)(1u, (std::min)(maxTriangles, (unsigned int)MESHLET_MAX_TRIANGLES));
+
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Triangles around each vertex (as in OptimizeVertexCache)
+	std::vector<unsigned int> firstTriangle(vertexCount + 1, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		firstTriangle[indices[i] + 1]++;
+	for (size_t v = 0; v < vertexCount; v++)
+		firstTriangle[v + 1] += firstTriangle[v];
+
+	std::vector<unsigned int> vertexTriangles(triangleCount * 3);
+	{
+		std::vector<unsigned int> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+		for (size_t i = 0; i < triangleCount * 3; i++)
+			vertexTriangles[fill[indices[i]]++] = (unsigned int)(i / 3);
+	}
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<unsigned int> reordered;
+	reordered.reserve(triangleCount * 3);
+
+	// Which meshlet each vertex was last added to, so membership
+	// checks don't need clearing between meshlets
+	const unsigned int noMeshlet = 0xFFFFFFFF;
+	std::vector<unsigned int> vertexMeshlet(vertexCount, noMeshlet);
+
+	unsigned int meshletVertices[MESHLET_MAX_VERTICES];
+	size_t seedCursor = 0;
+
+	while (reordered.size() < triangleCount * 3)
+	{
+		unsigned int meshletIndex = (unsigned int)meshlets.size();
+		Meshlet meshlet = {};
+		meshlet.IndexOffset = (unsigned int)reordered.size();
+
+		// Start from the next unused triangle in the original order,
+		// which (after vertex cache optimization) is near the last one
+		while (emitted[seedCursor])
+			seedCursor++;
+		unsigned int next = (unsigned int)seedCursor;
+		XMVECTOR vertexSum = XMVectorZero();
+
+		while (next != noMeshlet)
+		{
+			// Add it
+			emitted[next] = true;
+			meshlet.TriangleCount++;
+			for (int c = 0; c < 3; c++)
+			{
+				unsigned int v = indices[next * 3 + c];
+				reordered.push_back(v);
+				if (vertexMeshlet[v] != meshletIndex)
+				{
+					vertexMeshlet[v] = meshletIndex;
+					meshletVertices[meshlet.VertexCount++] = v;
+					vertexSum += XMLoadFloat3(&vertices[v].Position);
+				}
+			}
+
+			if (meshlet.TriangleCount == maxTriangles)
+				break;
+
+			// Find the best neighbour that still fits
+			XMVECTOR middle = vertexSum / (float)meshlet.VertexCount;
+			next = noMeshlet;
+			unsigned int bestNewVertices = 4;
+			float bestDistance = FLT_MAX;
+
+			for (unsigned int i = 0; i < meshlet.VertexCount; i++)
+			{
+				unsigned int v = meshletVertices[i];
+				for (unsigned int j = firstTriangle[v]; j < firstTriangle[v + 1]; j++)
+				{
+					unsigned int t = vertexTriangles[j];
+					if (emitted[t])
+						continue;
+
+					const unsigned int* tri = indices + t * 3;
+					unsigned int newVertices =
+						(vertexMeshlet[tri[0]] != meshletIndex) +
+						(vertexMeshlet[tri[1]] != meshletIndex) +
+						(vertexMeshlet[tri[2]] != meshletIndex);
+					if (meshlet.VertexCount + newVertices > maxVertices || newVertices > bestNewVertices)
+						continue;
+
+					XMVECTOR centroid =
+						(XMLoadFloat3(&vertices[tri[0]].Position) +
+						XMLoadFloat3(&vertices[tri[1]].Position) +
+						XMLoadFloat3(&vertices[tri[2]].Position)) / 3.0f;
+					float distance = XMVectorGetX(XMVector3LengthSq(centroid - middle));
+
+					if (newVertices < bestNewVertices || distance < bestDistance)
+					{
+						next = t;
+						bestNewVertices = newVertices;
+						bestDistance = distance;
+					}
+				}
+			}
+		}
+
+		CalculateMeshletBounds(vertices, &reordered[0], meshletVertices, meshlet);
+		meshlets.push_back(meshlet);
+	}
+
+	std::copy(reordered.begin(), reordered.end(), indices);
+}
+
+// --------------------------------------------------------
+// The frustum is pulled from world * view * projection, so
+// its planes are already in the mesh's space, and the camera
+// is moved there with the inverse of world * view
+// --------------------------------------------------------
+void CullMeshlets(
+	const Meshlet* meshlets,
+	size_t meshletCount,
+	const XMFLOAT4X4& world,
+	const XMFLOAT4X4& view,
+	const XMFLOAT4X4& projection,
+	std::vector<unsigned int>& visible)
+{
+	visible.clear();
+
+	XMMATRIX worldView = XMMatrixMultiply(XMLoadFloat4x4(&world), XMLoadFloat4x4(&view));
+	XMFLOAT4X4 worldViewProjection;
+	XMStoreFloat4x4(&worldViewProjection, XMMatrixMultiply(worldView, XMLoadFloat4x4(&projection)));
+
+	Frustum frustum;
+	ExtractFrustumPlanes(worldViewProjection, frustum);
+
+	XMVECTOR determinant;
+	XMMATRIX viewToObject = XMMatrixInverse(&determinant, worldView);
+	XMFLOAT3 cameraPos;
+	XMStoreFloat3(&cameraPos, XMVector3Transform(XMVectorZero(), viewToObject));
+
+	// A mirrored world matrix turns every triangle inside out
+	float facing = XMVectorGetX(determinant) < 0.0f ? -1.0f : 1.0f;
+
+	for (size_t i = 0; i < meshletCount; i++)
+	{
+		const Meshlet& m = meshlets[i];
+		if (!FrustumIntersectsSphere(frustum, m.Center, m.Radius))
+			continue;
+
+		// Every triangle faces away if the camera is behind the whole cone
+		float dx = m.Center.x - cameraPos.x;
+		float dy = m.Center.y - cameraPos.y;
+		float dz = m.Center.z - cameraPos.z;
+		float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+		float alongAxis = facing * (dx * m.ConeAxis.x + dy * m.ConeAxis.y + dz * m.ConeAxis.z);
+		if (alongAxis >= m.ConeCutoff * distance + m.Radius)
+			continue;
+
+		visible.push_back((unsigned int)i);
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Vertex.h"
+#include <DirectXMath.h>
+#include <cstddef>
+#include <vector>
+
+// Limits that match what mesh shader hardware is designed around
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+// --------------------------------------------------------
+// A small cluster of neighbouring triangles that can be
+// culled as a unit
+//
+// Each meshlet's triangles sit next to each other in the
+// mesh's index buffer, so the ones that survive culling can
+// be drawn with plain DrawIndexed() calls.
+// --------------------------------------------------------
+struct Meshlet
+{
+	// Bounding sphere, in the mesh's own space
+	DirectX::XMFLOAT3 Center;
+	float Radius;
+
+	// Normal cone: every triangle faces within the cone around
+	// ConeAxis.  A ConeCutoff of 1 means it can't be backface culled.
+	DirectX::XMFLOAT3 ConeAxis;
+	float ConeCutoff;
+
+	unsigned int IndexOffset;
+	unsigned int TriangleCount;
+	unsigned int VertexCount;
+	unsigned int Padding;
+};
+
+// --------------------------------------------------------
+// Splits a triangle list into meshlets of at most maxVertices
+// unique vertices and maxTriangles triangles, reordering the
+// indices in place so each meshlet's triangles are contiguous.
+//
+// Meshlets are grown one triangle at a time, always taking the
+// neighbouring triangle that adds the fewest new vertices (and
+// then the one closest to the meshlet), which keeps them round
+// and tightly bounded.
+// --------------------------------------------------------
+void BuildMeshlets(
+	const Vertex* vertices,
+	size_t vertexCount,
+	unsigned int* indices,
+	size_t indexCount,
+	std::vector<Meshlet>& meshlets,
+	unsigned int maxVertices = MESHLET_MAX_VERTICES,
+	unsigned int maxTriangles = MESHLET_MAX_TRIANGLES);
+
+// --------------------------------------------------------
+// Culls meshlets against the camera, returning the indices of
+// the ones that may be visible in "visible"
+//
+// - Clusters outside the view frustum are removed
+// - Clusters facing entirely away from the camera are removed
+// - Both tests run in the mesh's own space, by moving the
+//   camera there instead of moving every meshlet out
+// --------------------------------------------------------
+void CullMeshlets(
+	const Meshlet* meshlets,
+	size_t meshletCount,
+	const DirectX::XMFLOAT4X4& world,
+	const DirectX::XMFLOAT4X4& view,
+	const DirectX::XMFLOAT4X4& projection,
+	std::vector<unsigned int>& visible);
@@ -0,0 +1,536 @@
+#include "ObjParser.h"
+#include "MappedFile.h"
+#include "JobSystem.h"
+
+#include <cmath>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Hand-rolled, locale-independent number scanning
+//
+// - sscanf/strtof are slow (locale lookups, format string
+//   parsing) and are the bulk of the cost of loading an OBJ
+// - These only understand what OBJ files actually contain:
+//   optional sign, digits, optional fraction and exponent
+// - Each returns a pointer just past whatever it consumed
+// --------------------------------------------------------
+namespace
+{
+	// Powers of ten that are exactly representable as doubles,
+	// so a mantissa of up to 15 or so digits scales with a single rounding
+	const double exactPowersOfTen[] =
+	{
+		1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+		1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+		1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	inline bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+	inline bool IsBlank(char c) { return c == ' ' || c == '\t'; }
+
+	inline const char* SkipBlanks(const char* p, const char* end)
+	{
+		while (p < end && IsBlank(*p)) p++;
+		return p;
+	}
+
+	inline const char* SkipLine(const char* p, const char* end)
+	{
+		while (p < end && *p != '\n') p++;
+		return p < end ? p + 1 : end;
+	}
+
+	const char* ScanFloat(const char* p, const char* end, float& out)
+	{
+		p = SkipBlanks(p, end);
+
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+		{
+			negative = (*p == '-');
+			p++;
+		}
+
+		// Accumulate up to 19 significant digits, which always fit
+		// in 64 bits - anything past that can't change a float anyway
+		unsigned long long mantissa = 0;
+		int digits = 0;
+		int exponent = 0;
+		for (; p < end && IsDigit(*p); p++)
+		{
+			if (digits < 19) { mantissa = mantissa * 10 + (*p - '0'); if (mantissa) digits++; }
+			else exponent++;
+		}
+
+		if (p < end && *p == '.')
+		{
+			for (p++; p < end && IsDigit(*p); p++)
+			{
+				if (digits < 19) { mantissa = mantissa * 10 + (*p - '0'); if (mantissa) digits++; exponent--; }
+			}
+		}
+
+		if (p < end && (*p == 'e' || *p == 'E'))
+		{
+			const char* e = p + 1;
+			bool negativeExponent = false;
+			if (e < end && (*e == '-' || *e == '+'))
+			{
+				negativeExponent = (*e == '-');
+				e++;
+			}
+
+			// Only treat it as an exponent if digits actually follow
+			if (e < end && IsDigit(*e))
+			{
+				int value = 0;
+				for (; e < end && IsDigit(*e); e++)
+				{
+					if (value < 10000) value = value * 10 + (*e - '0');
+				}
+				exponent += negativeExponent ? -value : value;
+				p = e;
+			}
+		}
+
+		double result = (double)mantissa;
+		if (mantissa != 0 && exponent != 0)
+		{
+			if (exponent > 0 && exponent <= 22) result *= exactPowersOfTen[exponent];
+			else if (exponent < 0 && exponent >= -22) result /= exactPowersOfTen[-exponent];
+			else result *= std::pow(10.0, (double)exponent);
+		}
+
+		out = (float)(negative ? -result : result);
+		return p;
+	}
+
+	// Scans an optionally signed integer.  Returns false
+	// (without moving p) if there are no digits here.
+	inline bool ScanInt(const char*& p, const char* end, int& out)
+	{
+		const char* s = p;
+		bool negative = false;
+		if (s < end && (*s == '-' || *s == '+'))
+		{
+			negative = (*s == '-');
+			s++;
+		}
+
+		if (s >= end || !IsDigit(*s))
+			return false;
+
+		int value = 0;
+		for (; s < end && IsDigit(*s); s++)
+			value = value * 10 + (*s - '0');
+
+		out = negative ? -value : value;
+		p = s;
+		return true;
+	}
+
+	// When a chunk of a file is parsed on its own, negative (relative)
+	// indices can't be resolved yet since we don't know how many
+	// elements came before the chunk.  They're stored with this bias
+	// subtracted (which keeps them below -1, the "missing" marker)
+	// and fixed up once the chunks are merged.
+	const int relativeIndexBias = 1 << 30;
+
+	// OBJ indices are 1-based, and negative ones count
+	// backwards from the most recent element
+	inline int ResolveIndex(int index, size_t count, bool deferRelative)
+	{
+		if (index > 0) return index - 1;
+		if (index < 0) return (int)count + index - (deferRelative ? relativeIndexBias : 0);
+		return -1;
+	}
+
+	// Scans one "v", "v/t", "v//n" or "v/t/n" face corner
+	const char* ScanCorner(const char* p, const char* end, const ObjData& obj, bool deferRelative, ObjCorner& corner)
+	{
+		int value = 0;
+		corner.Position = -1;
+		corner.UV = -1;
+		corner.Normal = -1;
+
+		if (ScanInt(p, end, value))
+			corner.Position = ResolveIndex(value, obj.Positions.size(), deferRelative);
+
+		if (p < end && *p == '/')
+		{
+			p++;
+			if (ScanInt(p, end, value))
+				corner.UV = ResolveIndex(value, obj.UVs.size(), deferRelative);
+
+			if (p < end && *p == '/')
+			{
+				p++;
+				if (ScanInt(p, end, value))
+					corner.Normal = ResolveIndex(value, obj.Normals.size(), deferRelative);
+			}
+		}
+
+		return p;
+	}
+
+	// Resolves an index that was deferred by ResolveIndex, now
+	// that the number of elements before its chunk is known
+	inline void FixRelativeIndex(int& index, size_t offset)
+	{
+		if (index < -1)
+			index += relativeIndexBias + (int)offset;
+	}
+
+	// Looks up an attribute, tolerating missing or out of range indices
+	template <typename T>
+	inline bool Fetch(const std::vector<T>& stream, int index, T& out)
+	{
+		if (index < 0 || index >= (int)stream.size())
+			return false;
+		out = stream[index];
+		return true;
+	}
+
+	// Builds a single vertex from a face corner, converting it to
+	// DirectX's left-handed space.  Returns false if the corner has
+	// no normal (in which case the normal is left as zero).
+	bool MakeVertex(const ObjData& obj, const ObjCorner& corner, Vertex& v)
+	{
+		if (!Fetch(obj.Positions, corner.Position, v.Position))
+			v.Position = XMFLOAT3(0, 0, 0);
+
+		// Files without uvs all share a single (0,0) coordinate
+		if (!Fetch(obj.UVs, corner.UV, v.UV))
+			v.UV = XMFLOAT2(0, 0);
+
+		bool hasNormal = Fetch(obj.Normals, corner.Normal, v.Normal);
+		if (!hasNormal)
+			v.Normal = XMFLOAT3(0, 0, 0);
+
+		v.Tangent = XMFLOAT3(0, 0, 0);
+		v.TangentSign = 1.0f;
+
+		// Flip the UV's since they're probably "upside down"
+		v.UV.y = 1.0f - v.UV.y;
+
+		// Flip Z (LH vs. RH) for the position and normal
+		v.Position.z *= -1.0f;
+		v.Normal.z *= -1.0f;
+
+		return hasNormal;
+	}
+
+	inline size_t HashCorner(const ObjCorner& corner)
+	{
+		unsigned long long h =
+			(unsigned long long)(unsigned int)corner.Position * 0x9E3779B97F4A7C15ull ^
+			(unsigned long long)(unsigned int)corner.UV * 0xC2B2AE3D27D4EB4Full ^
+			(unsigned long long)(unsigned int)corner.Normal * 0x165667B19E3779F9ull;
+		return (size_t)(h ^ (h >> 29));
+	}
+}
+
+// --------------------------------------------------------
+// The parser itself.  With deferRelative set, negative
+// indices are left for MergeChunks() to resolve (see
+// relativeIndexBias above).
+// --------------------------------------------------------
+static void ParseObjRange(const char* begin, const char* end, ObjData& obj, bool deferRelative)
+{
+	// Faces are gathered here before triangulating
+	std::vector<ObjCorner> face;
+
+	const char* p = begin;
+	while (p < end)
+	{
+		p = SkipBlanks(p, end);
+		if (p + 1 >= end)
+			break;
+
+		if (p[0] == 'v' && IsBlank(p[1]))
+		{
+			XMFLOAT3 pos;
+			p = ScanFloat(p + 2, end, pos.x);
+			p = ScanFloat(p, end, pos.y);
+			p = ScanFloat(p, end, pos.z);
+			obj.Positions.push_back(pos);
+		}
+		else if (p[0] == 'v' && p[1] == 'n')
+		{
+			XMFLOAT3 norm;
+			p = ScanFloat(p + 2, end, norm.x);
+			p = ScanFloat(p, end, norm.y);
+			p = ScanFloat(p, end, norm.z);
+			obj.Normals.push_back(norm);
+		}
+		else if (p[0] == 'v' && p[1] == 't')
+		{
+			XMFLOAT2 uv;
+			p = ScanFloat(p + 2, end, uv.x);
+			p = ScanFloat(p, end, uv.y);
+			obj.UVs.push_back(uv);
+		}
+		else if (p[0] == 'f' && IsBlank(p[1]))
+		{
+			face.clear();
+			p = SkipBlanks(p + 2, end);
+			while (p < end && *p != '\n' && *p != '\r' && *p != '#')
+			{
+				ObjCorner corner;
+				const char* next = ScanCorner(p, end, obj, deferRelative, corner);
+				if (next == p)
+					break;
+
+				face.push_back(corner);
+				p = SkipBlanks(next, end);
+			}
+
+			// Fan triangulate, flipping the winding order from
+			// the file's counter-clockwise to DirectX's clockwise
+			for (size_t i = 1; i + 1 < face.size(); i++)
+			{
+				obj.Corners.push_back(face[0]);
+				obj.Corners.push_back(face[i + 1]);
+				obj.Corners.push_back(face[i]);
+			}
+		}
+
+		p = SkipLine(p, end);
+	}
+}
+
+// --------------------------------------------------------
+// Parses OBJ text, appending every position, uv, normal and
+// (triangulated) face it finds to "obj"
+//
+// - Lines of any length are supported
+// - Faces with more than three corners are split into a fan
+//   of triangles, exactly as the old quad handling did
+// - Anything we don't understand (comments, groups, materials,
+//   smoothing groups) is skipped
+// --------------------------------------------------------
+void ParseObj(const char* begin, const char* end, ObjData& obj)
+{
+	ParseObjRange(begin, end, obj, false);
+}
+
+// --------------------------------------------------------
+// Appends separately parsed chunks to "obj", in order,
+// offsetting each chunk's relative indices by the number
+// of elements that came before it
+// --------------------------------------------------------
+static void MergeChunks(std::vector<ObjData>& chunks, ObjData& obj)
+{
+	size_t positionCount = obj.Positions.size();
+	size_t uvCount = obj.UVs.size();
+	size_t normalCount = obj.Normals.size();
+	size_t cornerCount = obj.Corners.size();
+	for (const ObjData& chunk : chunks)
+	{
+		positionCount += chunk.Positions.size();
+		uvCount += chunk.UVs.size();
+		normalCount += chunk.Normals.size();
+		cornerCount += chunk.Corners.size();
+	}
+
+	obj.Positions.reserve(positionCount);
+	obj.UVs.reserve(uvCount);
+	obj.Normals.reserve(normalCount);
+	obj.Corners.reserve(cornerCount);
+
+	for (ObjData& chunk : chunks)
+	{
+		size_t positionOffset = obj.Positions.size();
+		size_t uvOffset = obj.UVs.size();
+		size_t normalOffset = obj.Normals.size();
+		for (ObjCorner& corner : chunk.Corners)
+		{
+			FixRelativeIndex(corner.Position, positionOffset);
+			FixRelativeIndex(corner.UV, uvOffset);
+			FixRelativeIndex(corner.Normal, normalOffset);
+		}
+
+		obj.Positions.insert(obj.Positions.end(), chunk.Positions.begin(), chunk.Positions.end());
+		obj.UVs.insert(obj.UVs.end(), chunk.UVs.begin(), chunk.UVs.end());
+		obj.Normals.insert(obj.Normals.end(), chunk.Normals.begin(), chunk.Normals.end());
+		obj.Corners.insert(obj.Corners.end(), chunk.Corners.begin(), chunk.Corners.end());
+
+		// Free each chunk as soon as it's copied
+		chunk = ObjData();
+	}
+}
+
+// --------------------------------------------------------
+// Parses OBJ text on several threads at once
+//
+// - The text is split into chunks at line boundaries, and each
+//   chunk is parsed into its own ObjData by a job
+// - The chunks are then concatenated in file order, resolving
+//   any relative (negative) face indices along the way
+// - The result is identical to ParseObj(), bit for bit, since
+//   every line is scanned by exactly the same code
+//
+// threadCount - Number of threads to use (0 = one per core)
+// --------------------------------------------------------
+void ParseObjParallel(const char* begin, const char* end, ObjData& obj, unsigned int threadCount)
+{
+	if (threadCount == 0)
+		threadCount = JobSystem::GetDefault().GetThreadCount();
+
+	// Not worth spinning up threads for small files
+	const size_t minChunkSize = 256 * 1024;
+	size_t size = (size_t)(end - begin);
+	if (threadCount <= 1 || size < minChunkSize * 2)
+	{
+		ParseObj(begin, end, obj);
+		return;
+	}
+
+	// A few chunks per thread, so a thread that gets a run of cheap
+	// lines (comments, uvs) can pick up more work instead of idling
+	size_t chunkCount = threadCount * 4;
+	if (size / chunkCount < minChunkSize)
+		chunkCount = size / minChunkSize;
+
+	std::vector<const char*> chunkStarts(chunkCount + 1);
+	chunkStarts[0] = begin;
+	chunkStarts[chunkCount] = end;
+	for (size_t i = 1; i < chunkCount; i++)
+	{
+		// Move each split point forward to the start of the next line
+		const char* split = begin + size * i / chunkCount;
+		if (split < chunkStarts[i - 1])
+			split = chunkStarts[i - 1];
+		while (split < end && split[-1] != '\n')
+			split++;
+		chunkStarts[i] = split;
+	}
+
+	// Parse all of the chunks
+	std::vector<ObjData> chunks(chunkCount);
+	JobSystem::GetDefault().ParallelFor(chunkCount, [&](size_t first, size_t last)
+	{
+		for (size_t i = first; i < last; i++)
+			ParseObjRange(chunkStarts[i], chunkStarts[i + 1], chunks[i], true);
+	}, 1, threadCount);
+
+	MergeChunks(chunks, obj);
+}
+
+// --------------------------------------------------------
+// Memory-maps the given file and parses it in place
+// --------------------------------------------------------
+bool ParseObjFile(const wchar_t* filename, ObjData& obj, unsigned int threadCount)
+{
+	MappedFile file(filename);
+	if (!file.IsOpen())
+		return false;
+
+	ParseObjParallel(file.GetData(), file.GetData() + file.GetSize(), obj, threadCount);
+	return true;
+}
+
+// --------------------------------------------------------
+// Turns parsed OBJ data into a vertex & index list
+//
+// The model is most likely in a right-handed space, especially
+// if it came from Maya.  We want to convert to a left-handed
+// space for DirectX.  This means we need to:
+//  - Invert the Z position
+//  - Invert the normal's Z
+//  - Flip the winding order (already done while parsing)
+// We also need to flip the UV coordinate since DirectX defines
+// (0,0) as the top left of the texture, and many 3D modeling
+// packages use the bottom left as (0,0)
+//
+// OBJs index positions, uvs and normals separately, so with
+// weldCorners set every distinct (position, uv, normal) triple
+// becomes one shared vertex and the index buffer references it
+// from each face.  Without it, every face corner becomes its
+// own vertex and the index buffer is simply 0, 1, 2, ...
+// --------------------------------------------------------
+void BuildMeshData(const ObjData& obj, MeshData& mesh, bool weldCorners)
+{
+	size_t cornerCount = obj.Corners.size() - obj.Corners.size() % 3;
+	mesh.Vertices.clear();
+	mesh.Vertices.reserve(weldCorners ? cornerCount / 2 : cornerCount);
+	mesh.Indices.resize(cornerCount);
+
+	// Open-addressing hash table from corner triple to vertex index.
+	// At least twice as many slots as corners keeps it under half full.
+	const unsigned int emptySlot = 0xFFFFFFFF;
+	std::vector<unsigned int> table;
+	std::vector<ObjCorner> vertexCorners;
+	size_t mask = 0;
+	if (weldCorners)
+	{
+		size_t tableSize = 16;
+		while (tableSize < cornerCount * 2) tableSize <<= 1;
+		table.assign(tableSize, emptySlot);
+		vertexCorners.reserve(cornerCount / 2);
+		mask = tableSize - 1;
+	}
+
+	for (size_t i = 0; i < cornerCount; i += 3)
+	{
+		Vertex tri[3];
+		bool hasNormals = true;
+		for (size_t c = 0; c < 3; c++)
+			hasNormals &= MakeVertex(obj, obj.Corners[i + c], tri[c]);
+
+		// No normals in the file means faceted shading is the best
+		// we can do, so fall back to the triangle's own normal.
+		// These corners can't be shared with other faces.
+		if (!hasNormals)
+		{
+			XMVECTOR p0 = XMLoadFloat3(&tri[0].Position);
+			XMVECTOR faceNormal = XMVector3Normalize(XMVector3Cross(
+				XMLoadFloat3(&tri[1].Position) - p0,
+				XMLoadFloat3(&tri[2].Position) - p0));
+
+			for (size_t c = 0; c < 3; c++)
+				XMStoreFloat3(&tri[c].Normal, faceNormal);
+		}
+
+		for (size_t c = 0; c < 3; c++)
+		{
+			const ObjCorner& corner = obj.Corners[i + c];
+			if (!weldCorners || !hasNormals)
+			{
+				mesh.Indices[i + c] = (unsigned int)mesh.Vertices.size();
+				mesh.Vertices.push_back(tri[c]);
+				continue;
+			}
+
+			// Find this triple's slot (or the empty slot it belongs in)
+			size_t slot = HashCorner(corner) & mask;
+			while (table[slot] != emptySlot)
+			{
+				const ObjCorner& other = vertexCorners[table[slot]];
+				if (other.Position == corner.Position && other.UV == corner.UV && other.Normal == corner.Normal)
+					break;
+				slot = (slot + 1) & mask;
+			}
+
+			if (table[slot] == emptySlot)
+			{
+				table[slot] = (unsigned int)mesh.Vertices.size();
+				mesh.Vertices.push_back(tri[c]);
+				vertexCorners.push_back(corner);
+			}
+
+			mesh.Indices[i + c] = table[slot];
+		}
+	}
+}
+
+bool LoadObjMeshData(const wchar_t* filename, MeshData& mesh, bool weldCorners, unsigned int threadCount)
+{
+	ObjData obj;
+	if (!ParseObjFile(filename, obj, threadCount))
+		return false;
+
+	BuildMeshData(obj, mesh, weldCorners);
+	return true;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Vertex.h"
+#include <DirectXMath.h>
+#include <vector>
+
+// --------------------------------------------------------
+// A single corner of an OBJ face
+//
+// Stored as 0-based indices into the position, uv and normal
+// streams of an ObjData, or -1 if the file left that part out
+// (for instance "f 1//1 2//2 3//3" has no uvs)
+// --------------------------------------------------------
+struct ObjCorner
+{
+	int Position;
+	int UV;
+	int Normal;
+};
+
+// --------------------------------------------------------
+// The raw attribute streams of an OBJ file, exactly as they
+// appear in the file (no handedness conversion yet)
+//
+// Faces are fan-triangulated while parsing, so every three
+// corners make up one triangle, already in DirectX's
+// clockwise winding order
+// --------------------------------------------------------
+struct ObjData
+{
+	std::vector<DirectX::XMFLOAT3> Positions;
+	std::vector<DirectX::XMFLOAT3> Normals;
+	std::vector<DirectX::XMFLOAT2> UVs;
+	std::vector<ObjCorner> Corners;
+};
+
+// --------------------------------------------------------
+// CPU-side mesh data, laid out exactly the way
+// Mesh::SetBufferData wants it
+// --------------------------------------------------------
+struct MeshData
+{
+	std::vector<Vertex> Vertices;
+	std::vector<unsigned int> Indices;
+};
+
+// Memory-maps and parses an entire OBJ file, appending to "obj".
+// Large files are split across threadCount threads (0 = one per core).
+bool ParseObjFile(const wchar_t* filename, ObjData& obj, unsigned int threadCount = 0);
+
+// Parses OBJ text in [begin, end), appending to "obj"
+void ParseObj(const char* begin, const char* end, ObjData& obj);
+
+// Same as ParseObj(), but splits the text into chunks that are
+// parsed on separate threads.  The results are identical.
+void ParseObjParallel(const char* begin, const char* end, ObjData& obj, unsigned int threadCount = 0);
+
+// Expands parsed OBJ data into vertices & indices, converting
+// from the file's right-handed space to DirectX's left-handed one.
+// With weldCorners, face corners that reference the same position,
+// uv and normal share a single vertex.
+void BuildMeshData(const ObjData& obj, MeshData& mesh, bool weldCorners = true);
+
+// Convenience wrapper: ParseObjFile() followed by BuildMeshData()
+bool LoadObjMeshData(const wchar_t* filename, MeshData& mesh, bool weldCorners = true, unsigned int threadCount = 0);
@@ -0,0 +1,392 @@
+#include "OcclusionCulling.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// Below these, other threads cost more than they save
+	const size_t MinParallelTriangles = 512;
+	const size_t MinParallelTests = 1024;
+}
+
+// --------------------------------------------------------
+// Copies out the positions the triangles use, renumbered in
+// the order they're first used
+// --------------------------------------------------------
+void OccluderMesh::Build(
+	const Vertex* vertices,
+	size_t vertexCount,
+	const unsigned int* indices,
+	size_t indexCount)
+{
+	Positions.clear();
+	Indices.clear();
+	indexCount -= indexCount % 3;
+	Indices.reserve(indexCount);
+
+	const unsigned int unused = 0xFFFFFFFF;
+	std::vector<unsigned int> remap(vertexCount, unused);
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		unsigned int index = indices[i];
+		if (remap[index] == unused)
+		{
+			remap[index] = (unsigned int)Positions.size();
+			Positions.push_back(vertices[index].Position);
+		}
+		Indices.push_back(remap[index]);
+	}
+}
+
+size_t OccluderMesh::GetTriangleCount() const
+{
+	return Indices.size() / 3;
+}
+
+OcclusionBuffer::OcclusionBuffer(unsigned int width, unsigned int height) :
+	stats()
+{
+	XMStoreFloat4x4(&viewProjection, XMMatrixIdentity());
+	Resize(width, height);
+}
+
+void OcclusionBuffer::Resize(unsigned int newWidth, unsigned int newHeight)
+{
+	tilesX = (std::max)(1u, (newWidth + TileWidth - 1) / TileWidth);
+	tilesY = (std::max)(1u, (newHeight + TileHeight - 1) / TileHeight);
+	width = tilesX * TileWidth;
+	height = tilesY * TileHeight;
+	depths.assign(width * height, 1.0f);
+	tileMaxDepths.assign(tilesX * tilesY, 1.0f);
+}
+
+unsigned int OcclusionBuffer::GetWidth() const { return width; }
+unsigned int OcclusionBuffer::GetHeight() const { return height; }
+const OcclusionStats& OcclusionBuffer::GetStats() const { return stats; }
+
+void OcclusionBuffer::Begin(const XMFLOAT4X4& newViewProjection)
+{
+	viewProjection = newViewProjection;
+	std::fill(depths.begin(), depths.end(), 1.0f);
+	std::fill(tileMaxDepths.begin(), tileMaxDepths.end(), 1.0f);
+	occluders.clear();
+	stats = OcclusionStats();
+}
+
+void OcclusionBuffer::AddOccluder(const OccluderMesh* mesh, const XMFLOAT4X4& world)
+{
+	if (!mesh || mesh->GetTriangleCount() == 0)
+		return;
+
+	Occluder occluder;
+	occluder.Mesh = mesh;
+	XMStoreFloat4x4(&occluder.WorldViewProjection, XMLoadFloat4x4(&world) * XMLoadFloat4x4(&viewProjection));
+	occluder.FirstTriangle = 0;
+	occluders.push_back(occluder);
+}
+
+// --------------------------------------------------------
+// Sets up every occluder's triangles in parallel (each has its
+// own range of the list), then draws bands of tile rows in
+// parallel, each going through the whole list in order
+// --------------------------------------------------------
+void OcclusionBuffer::Rasterize(unsigned int threadCount)
+{
+	if (threadCount == 0)
+		threadCount = JobSystem::GetDefault().GetThreadCount();
+
+	size_t triangleCount = 0;
+	for (Occluder& occluder : occluders)
+	{
+		occluder.FirstTriangle = (unsigned int)triangleCount;
+		triangleCount += occluder.Mesh->GetTriangleCount();
+	}
+	triangles.resize(triangleCount);
+	if (triangleCount < MinParallelTriangles)
+		threadCount = 1;
+
+	JobSystem::GetDefault().ParallelFor(occluders.size(), [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+			SetUpTriangles(occluders[i]);
+	}, 1, threadCount);
+
+	JobSystem::GetDefault().ParallelFor(tilesY, [&](size_t begin, size_t end)
+	{
+		DrawTileRows((int)begin, (int)end);
+	}, 1, threadCount);
+
+	stats.Occluders = (unsigned int)occluders.size();
+	stats.Triangles = (unsigned int)triangleCount;
+	stats.TrianglesDrawn = 0;
+	for (const ScreenTriangle& triangle : triangles)
+		stats.TrianglesDrawn += triangle.MinTileX <= triangle.MaxTileX;
+}
+
+// --------------------------------------------------------
+// Projects an occluder's vertices onto the buffer (x & y in
+// pixels, y down, z as depth), then turns each triangle into
+// edge functions & a depth plane.  Triangles of either
+// winding are kept, since the nearest depth wins anyway.
+// --------------------------------------------------------
+void OcclusionBuffer::SetUpTriangles(const Occluder& occluder)
+{
+	const OccluderMesh& mesh = *occluder.Mesh;
+	XMMATRIX worldViewProjection = XMLoadFloat4x4(&occluder.WorldViewProjection);
+
+	// w is negative for vertices behind the near plane
+	std::vector<XMFLOAT4> screen(mesh.Positions.size());
+	for (size_t v = 0; v < screen.size(); v++)
+	{
+		XMFLOAT4 clip;
+		XMStoreFloat4(&clip, XMVector3Transform(XMLoadFloat3(&mesh.Positions[v]), worldViewProjection));
+		if (clip.z < 0.0f || clip.w <= 0.0f)
+		{
+			screen[v] = XMFLOAT4(0.0f, 0.0f, 0.0f, -1.0f);
+			continue;
+		}
+
+		float inverseW = 1.0f / clip.w;
+		screen[v] = XMFLOAT4(
+			(clip.x * inverseW * 0.5f + 0.5f) * width,
+			(0.5f - clip.y * inverseW * 0.5f) * height,
+			clip.z * inverseW,
+			1.0f);
+	}
+
+	for (size_t t = 0; t < mesh.GetTriangleCount(); t++)
+	{
+		ScreenTriangle& triangle = triangles[occluder.FirstTriangle + t];
+		triangle.MinTileX = triangle.MinTileY = 0;
+		triangle.MaxTileX = triangle.MaxTileY = -1;
+
+		const XMFLOAT4* v[3] =
+		{
+			&screen[mesh.Indices[t * 3]],
+			&screen[mesh.Indices[t * 3 + 1]],
+			&screen[mesh.Indices[t * 3 + 2]],
+		};
+		if (v[0]->w < 0.0f || v[1]->w < 0.0f || v[2]->w < 0.0f)
+			continue;
+
+		float x1 = v[1]->x - v[0]->x, y1 = v[1]->y - v[0]->y, z1 = v[1]->z - v[0]->z;
+		float x2 = v[2]->x - v[0]->x, y2 = v[2]->y - v[0]->y, z2 = v[2]->z - v[0]->z;
+		float determinant = x1 * y2 - x2 * y1;
+		if (!(determinant != 0.0f))
+			continue;
+
+		// Pixels whose centers are inside the triangle's box
+		float minX = (std::max)((std::min)((std::min)(v[0]->x, v[1]->x), v[2]->x), 0.0f);
+		float maxX = (std::min)((std::max)((std::max)(v[0]->x, v[1]->x), v[2]->x), (float)width);
+		float minY = (std::max)((std::min)((std::min)(v[0]->y, v[1]->y), v[2]->y), 0.0f);
+		float maxY = (std::min)((std::max)((std::max)(v[0]->y, v[1]->y), v[2]->y), (float)height);
+		int firstX = (int)std::ceil(minX - 0.5f);
+		int lastX = (int)std::floor(maxX - 0.5f);
+		int firstY = (int)std::ceil(minY - 0.5f);
+		int lastY = (int)std::floor(maxY - 0.5f);
+		if (firstX > lastX || firstY > lastY)
+			continue;
+
+		// Each edge's function is zero along it, and has the
+		// sign of -determinant on the opposite corner's side
+		float sign = determinant > 0.0f ? -1.0f : 1.0f;
+		for (int e = 0; e < 3; e++)
+		{
+			const XMFLOAT4& a = *v[e];
+			const XMFLOAT4& b = *v[(e + 1) % 3];
+			float edgeA = (b.y - a.y) * sign;
+			float edgeB = (a.x - b.x) * sign;
+			triangle.EdgeA[e] = edgeA;
+			triangle.EdgeB[e] = edgeB;
+			triangle.EdgeC[e] = -(edgeA * a.x + edgeB * a.y);
+		}
+
+		triangle.DepthX = (z1 * y2 - z2 * y1) / determinant;
+		triangle.DepthY = (x1 * z2 - x2 * z1) / determinant;
+		triangle.Depth0 = v[0]->z - triangle.DepthX * v[0]->x - triangle.DepthY * v[0]->y;
+
+		triangle.MinTileX = firstX / (int)TileWidth;
+		triangle.MaxTileX = lastX / (int)TileWidth;
+		triangle.MinTileY = firstY / (int)TileHeight;
+		triangle.MaxTileY = lastY / (int)TileHeight;
+	}
+}
+
+// Every triangle touching the rows, in order, then the rows' tile maximums
+void OcclusionBuffer::DrawTileRows(int firstRow, int lastRow)
+{
+	for (const ScreenTriangle& triangle : triangles)
+	{
+		if (triangle.MinTileX > triangle.MaxTileX || triangle.MaxTileY < firstRow || triangle.MinTileY >= lastRow)
+			continue;
+		DrawTriangle(triangle, firstRow, lastRow);
+	}
+
+	const unsigned int tileSize = TileWidth * TileHeight;
+	for (int tile = firstRow * (int)tilesX; tile < lastRow * (int)tilesX; tile++)
+	{
+		const float* pixels = &depths[tile * tileSize];
+		tileMaxDepths[tile] = *std::max_element(pixels, pixels + tileSize);
+	}
+}
+
+// --------------------------------------------------------
+// Half a tile row (4 pixels) at a time: the three edge
+// functions & the depth at each pixel's center, keeping the
+// nearer depth wherever all three edges are non-negative
+// --------------------------------------------------------
+void OcclusionBuffer::DrawTriangle(const ScreenTriangle& triangle, int firstRow, int lastRow)
+{
+	const XMVECTOR zero = XMVectorZero();
+	const XMVECTOR columnCenters = XMVectorSet(0.5f, 1.5f, 2.5f, 3.5f);
+	XMVECTOR edgeA0 = XMVectorReplicate(triangle.EdgeA[0]);
+	XMVECTOR edgeA1 = XMVectorReplicate(triangle.EdgeA[1]);
+	XMVECTOR edgeA2 = XMVectorReplicate(triangle.EdgeA[2]);
+	XMVECTOR depthX = XMVectorReplicate(triangle.DepthX);
+
+	int firstTileY = (std::max)(triangle.MinTileY, firstRow);
+	int lastTileY = (std::min)(triangle.MaxTileY, lastRow - 1);
+	for (int tileY = firstTileY; tileY <= lastTileY; tileY++)
+	{
+		for (unsigned int row = 0; row < TileHeight; row++)
+		{
+			float y = (float)(tileY * (int)TileHeight + (int)row) + 0.5f;
+			XMVECTOR rowEdge0 = XMVectorReplicate(triangle.EdgeB[0] * y + triangle.EdgeC[0]);
+			XMVECTOR rowEdge1 = XMVectorReplicate(triangle.EdgeB[1] * y + triangle.EdgeC[1]);
+			XMVECTOR rowEdge2 = XMVectorReplicate(triangle.EdgeB[2] * y + triangle.EdgeC[2]);
+			XMVECTOR rowDepth = XMVectorReplicate(triangle.DepthY * y + triangle.Depth0);
+
+			for (int tileX = triangle.MinTileX; tileX <= triangle.MaxTileX; tileX++)
+			{
+				float* tileRow = &depths[((tileY * tilesX + tileX) * TileHeight + row) * TileWidth];
+				for (unsigned int half = 0; half < TileWidth; half += 4)
+				{
+					XMVECTOR x = columnCenters + XMVectorReplicate((float)(tileX * (int)TileWidth + (int)half));
+					XMVECTOR inside = XMVectorAndInt(
+						XMVectorAndInt(
+							XMVectorGreaterOrEqual(XMVectorMultiplyAdd(x, edgeA0, rowEdge0), zero),
+							XMVectorGreaterOrEqual(XMVectorMultiplyAdd(x, edgeA1, rowEdge1), zero)),
+						XMVectorGreaterOrEqual(XMVectorMultiplyAdd(x, edgeA2, rowEdge2), zero));
+					if (XMVector4EqualInt(inside, XMVectorFalseInt()))
+						continue;
+
+					XMFLOAT4* pixels = (XMFLOAT4*)(tileRow + half);
+					XMVECTOR current = XMLoadFloat4(pixels);
+					XMVECTOR depth = XMVectorMultiplyAdd(x, depthX, rowDepth);
+					XMStoreFloat4(pixels, XMVectorSelect(current, XMVectorMin(current, depth), inside));
+				}
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Projects the box's corners for the pixels it covers and its
+// nearest depth, then looks for a pixel at least that far
+// away, skipping tiles whose furthest pixel is nearer
+// --------------------------------------------------------
+bool OcclusionBuffer::IsBoxVisible(const XMFLOAT3& center, const XMFLOAT3& extents) const
+{
+	XMMATRIX m = XMLoadFloat4x4(&viewProjection);
+	XMVECTOR clipCenter = XMVector3Transform(XMLoadFloat3(&center), m);
+	XMVECTOR axes[3] = { m.r[0] * extents.x, m.r[1] * extents.y, m.r[2] * extents.z };
+
+	float minX = FLT_MAX, maxX = -FLT_MAX;
+	float minY = FLT_MAX, maxY = -FLT_MAX;
+	float nearest = FLT_MAX;
+	for (int corner = 0; corner < 8; corner++)
+	{
+		XMVECTOR clip = clipCenter;
+		for (int axis = 0; axis < 3; axis++)
+			clip = (corner & (1 << axis)) ? clip + axes[axis] : clip - axes[axis];
+
+		XMFLOAT4 p;
+		XMStoreFloat4(&p, clip);
+		if (p.z < 0.0f || p.w <= 0.0f)
+			return true;
+
+		float inverseW = 1.0f / p.w;
+		float x = (p.x * inverseW * 0.5f + 0.5f) * width;
+		float y = (0.5f - p.y * inverseW * 0.5f) * height;
+		minX = (std::min)(minX, x);
+		maxX = (std::max)(maxX, x);
+		minY = (std::min)(minY, y);
+		maxY = (std::max)(maxY, y);
+		nearest = (std::min)(nearest, p.z * inverseW);
+	}
+
+	if (!(maxX >= 0.0f && maxY >= 0.0f && minX < (float)width && minY < (float)height))
+		return true;
+
+	// Every pixel the box touches, not just those whose centers it covers
+	int firstX = (int)(std::max)(minX, 0.0f);
+	int lastX = (int)(std::min)(maxX, (float)(width - 1));
+	int firstY = (int)(std::max)(minY, 0.0f);
+	int lastY = (int)(std::min)(maxY, (float)(height - 1));
+
+	for (int tileY = firstY / (int)TileHeight; tileY <= lastY / (int)TileHeight; tileY++)
+	{
+		for (int tileX = firstX / (int)TileWidth; tileX <= lastX / (int)TileWidth; tileX++)
+		{
+			unsigned int tile = tileY * tilesX + tileX;
+			if (nearest > tileMaxDepths[tile])
+				continue;
+
+			int rowStart = (std::max)(firstY - tileY * (int)TileHeight, 0);
+			int rowEnd = (std::min)(lastY - tileY * (int)TileHeight, (int)TileHeight - 1);
+			int columnStart = (std::max)(firstX - tileX * (int)TileWidth, 0);
+			int columnEnd = (std::min)(lastX - tileX * (int)TileWidth, (int)TileWidth - 1);
+			const float* pixels = &depths[tile * TileWidth * TileHeight];
+			for (int row = rowStart; row <= rowEnd; row++)
+				for (int column = columnStart; column <= columnEnd; column++)
+					if (pixels[row * TileWidth + column] >= nearest)
+						return true;
+		}
+	}
+	return false;
+}
+
+void OcclusionBuffer::FilterVisible(
+	const CullingBounds& bounds,
+	std::vector<unsigned int>& indices,
+	unsigned int threadCount)
+{
+	if (threadCount == 0)
+		threadCount = JobSystem::GetDefault().GetThreadCount();
+	if (indices.size() < MinParallelTests)
+		threadCount = 1;
+
+	// Each test writes its own flag, and the list is compacted
+	// afterwards, so the order never depends on the threads
+	visibleFlags.resize(indices.size());
+	JobSystem::GetDefault().ParallelFor(indices.size(), [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			unsigned int o = indices[i];
+			XMFLOAT3 center(bounds.BoxX[o], bounds.BoxY[o], bounds.BoxZ[o]);
+			XMFLOAT3 extents(bounds.ExtentX[o], bounds.ExtentY[o], bounds.ExtentZ[o]);
+			visibleFlags[i] = IsBoxVisible(center, extents) ? 1 : 0;
+		}
+	}, 64, threadCount);
+
+	size_t kept = 0;
+	for (size_t i = 0; i < indices.size(); i++)
+		if (visibleFlags[i])
+			indices[kept++] = indices[i];
+
+	stats.Tested += (unsigned int)indices.size();
+	stats.Occluded += (unsigned int)(indices.size() - kept);
+	indices.resize(kept);
+}
+
+float OcclusionBuffer::GetDepth(unsigned int x, unsigned int y) const
+{
+	unsigned int tile = (y / TileHeight) * tilesX + x / TileWidth;
+	return depths[(tile * TileHeight + y % TileHeight) * TileWidth + x % TileWidth];
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "Vertex.h"
+#include "FrustumCulling.h"
+#include <DirectXMath.h>
+#include <cstddef>
+#include <vector>
+
+// --------------------------------------------------------
+// The cut down copy of a mesh that gets drawn into an
+// OcclusionBuffer: just the positions of one (usually
+// simplified) level of detail, without the vertices it
+// doesn't use
+// --------------------------------------------------------
+struct OccluderMesh
+{
+	std::vector<DirectX::XMFLOAT3> Positions;
+	std::vector<unsigned int> Indices;
+
+	void Build(
+		const Vertex* vertices,
+		size_t vertexCount,
+		const unsigned int* indices,
+		size_t indexCount);
+
+	size_t GetTriangleCount() const;
+};
+
+// What the last frame of occlusion culling did
+struct OcclusionStats
+{
+	unsigned int Occluders;
+	unsigned int Triangles;			// In all the occluders
+	unsigned int TrianglesDrawn;	// Left after skipping those crossing the near plane or off screen
+	unsigned int Tested;			// Bounds checked against the buffer
+	unsigned int Occluded;			// ... that were hidden
+};
+
+// --------------------------------------------------------
+// A small depth buffer of occluders for culling objects
+// hidden behind them, drawn on the CPU
+//
+// Each frame: Begin() with the camera, AddOccluder() for the
+// big things nearest it, Rasterize(), then test bounds.  An
+// object is hidden when its box's nearest point is behind
+// the occluders at every pixel its box covers on screen.
+//
+// - The buffer is split into 8x4 pixel tiles, each kept
+//   together in memory with the furthest depth in it kept
+//   alongside, so most tests never look at single pixels
+// - Rows of tiles are drawn on separate threads.  Every
+//   pixel is worked out from its own coordinates and only
+//   ever keeps the nearest depth, so the result is identical
+//   whatever the thread count.
+// - A row of a tile is 4 pixels per SIMD instruction
+// - Occluder triangles that cross the near plane are skipped
+//   rather than clipped, which can only leave more visible
+//
+// Occluders should be solid and not much bigger than what
+// they stand for (a simplified LOD made from the mesh's own
+// vertices is fine), or they'll hide things they shouldn't.
+// --------------------------------------------------------
+class OcclusionBuffer
+{
+public:
+	static const unsigned int TileWidth = 8;
+	static const unsigned int TileHeight = 4;
+
+	// Sizes are rounded up to whole tiles
+	OcclusionBuffer(unsigned int width = 256, unsigned int height = 144);
+	void Resize(unsigned int width, unsigned int height);
+	unsigned int GetWidth() const;
+	unsigned int GetHeight() const;
+
+	// Clears the buffer and the occluder list for a new frame
+	void Begin(const DirectX::XMFLOAT4X4& viewProjection);
+
+	// Queues a mesh to draw; it has to stay alive until Rasterize()
+	void AddOccluder(const OccluderMesh* mesh, const DirectX::XMFLOAT4X4& world);
+
+	// Draws every queued occluder on threadCount threads (0 = one per core)
+	void Rasterize(unsigned int threadCount = 0);
+
+	// Could any of this world space box be seen past the occluders?
+	// Boxes crossing the near plane or off screen always can.
+	bool IsBoxVisible(const DirectX::XMFLOAT3& center, const DirectX::XMFLOAT3& extents) const;
+
+	// Keeps just the objects in "indices" whose boxes are visible,
+	// in the same order, testing on threadCount threads
+	void FilterVisible(
+		const CullingBounds& bounds,
+		std::vector<unsigned int>& indices,
+		unsigned int threadCount = 0);
+
+	// The nearest occluder's depth (0 - 1) at a pixel, 1 if none
+	float GetDepth(unsigned int x, unsigned int y) const;
+
+	const OcclusionStats& GetStats() const;
+
+private:
+	struct Occluder
+	{
+		const OccluderMesh* Mesh;
+		DirectX::XMFLOAT4X4 WorldViewProjection;
+		unsigned int FirstTriangle;
+	};
+
+	// A triangle ready to draw: edge functions (A*x + B*y + C,
+	// positive inside), a depth plane & the tiles it covers
+	struct ScreenTriangle
+	{
+		float EdgeA[3], EdgeB[3], EdgeC[3];
+		float DepthX, DepthY, Depth0;
+		int MinTileX, MaxTileX, MinTileY, MaxTileY;	// Empty if skipped
+	};
+
+	unsigned int width, height;
+	unsigned int tilesX, tilesY;
+	DirectX::XMFLOAT4X4 viewProjection;
+
+	std::vector<float> depths;			// Tile by tile, a row of each tile at a time
+	std::vector<float> tileMaxDepths;	// The furthest pixel in each tile
+
+	std::vector<Occluder> occluders;
+	std::vector<ScreenTriangle> triangles;
+	std::vector<unsigned char> visibleFlags;
+	OcclusionStats stats;
+
+	void SetUpTriangles(const Occluder& occluder);
+	void DrawTileRows(int firstRow, int lastRow);
+	void DrawTriangle(const ScreenTriangle& triangle, int firstRow, int lastRow);
+};
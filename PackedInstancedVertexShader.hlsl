@@ -0,0 +1,40 @@
+#include "ShaderIncludes.hlsli"
+
+cbuffer ExternalData : register(b0)
+{
+	matrix view;
+	matrix projection;
+
+	// See PackedVertexShader.hlsl
+	float3 positionOffset;
+	float3 positionScale;
+}
+
+// --------------------------------------------------------
+// PackedVertexShader.hlsl with per instance world matrices,
+// like InstancedVertexShader.hlsl
+// --------------------------------------------------------
+VertexToPixel main( PackedVertexShaderInput input, InstanceInput instance )
+{
+	// Decode
+	float3 localPosition = positionOffset + input.packedPosition.xyz * positionScale;
+	float3 normal = OctahedronToDirection(input.normalTangent.xy);
+	float3 tangent = OctahedronToDirection(input.normalTangent.zw);
+
+	matrix world = InstanceWorld(instance);
+	matrix worldInvTranspose = InstanceWorldInvTranspose(instance);
+
+	VertexToPixel output;
+
+	matrix wvp = mul(projection, mul(view, world));
+	output.screenPosition = mul(wvp, float4(localPosition, 1.0f));
+
+	output.uv = input.uv;
+
+	output.normal = mul((float3x3)worldInvTranspose, normal);
+	output.worldPosition = mul(world, float4(localPosition, 1)).xyz;
+	output.tangent = mul((float3x3)world, tangent);
+	output.tangentSign = input.packedPosition.w * 2.0f - 1.0f;
+
+	return output;
+}
@@ -113,7 +113,7 @@ float4 main(VertexToPixel input) : SV_TARGET
 
 	// Gram-Schmidt orthonormalization
 	float3 T = normalize(input.tangent - input.normal * dot(input.tangent, input.normal));
-	float3 B = cross(T, input.normal);
+	float3 B = cross(T, input.normal) * input.tangentSign;
 	float3x3 TBN = float3x3(T, B, input.normal);
 	input.normal = mul(unpackedNormal, TBN);
 
@@ -0,0 +1,298 @@
+#include "Profiler.h"
+#include "Helpers.h"
+
+#include <chrono>
+#include <cstdio>
+
+std::atomic<bool> Profiler::enabled(false);
+const unsigned int Profiler::BufferCapacity;
+
+namespace
+{
+	// The calling thread's name, until it has a buffer to put it in
+	thread_local const char* threadName = 0;
+
+	// How many scopes the calling thread is in
+	thread_local unsigned int threadDepth = 0;
+
+	// --------------------------------------------------------
+	// Marks a thread's buffer retired when the thread exits, so
+	// a new thread can have it once it's been read
+	// --------------------------------------------------------
+	struct RetireOnExit
+	{
+		std::atomic<bool>* Retired;
+		RetireOnExit() : Retired(0) {}
+		~RetireOnExit() { if (Retired) Retired->store(true); }
+	};
+	thread_local RetireOnExit retireOnExit;
+
+	// A string as a JSON string literal
+	void WriteJsonString(FILE* file, const char* text)
+	{
+		fputc('"', file);
+		for (const char* c = text; *c; c++)
+		{
+			if (*c == '"' || *c == '\\')
+				fprintf(file, "\\%c", *c);
+			else if ((unsigned char)*c < 0x20)
+				fprintf(file, "\\u%04x", (unsigned int)(unsigned char)*c);
+			else
+				fputc(*c, file);
+		}
+		fputc('"', file);
+	}
+}
+
+Profiler::ThreadBuffer::ThreadBuffer() :
+	Index(0),
+	Events(new ProfileEvent[BufferCapacity]),
+	Written(0),
+	Read(0),
+	Dropped(0),
+	Retired(false)
+{
+}
+
+Profiler::Profiler() :
+	lastFrame(),
+	captureFramesLeft(0),
+	enabledBeforeCapture(false)
+{
+}
+
+// --------------------------------------------------------
+// Never destroyed, on purpose: threads that outlive it (the
+// job system's workers, joined by another static's destructor)
+// still mark their buffers retired as they exit
+// --------------------------------------------------------
+Profiler& Profiler::GetDefault()
+{
+	static Profiler* profiler = new Profiler();
+	return *profiler;
+}
+
+void Profiler::SetEnabled(bool enabled) { Profiler::enabled = enabled; }
+
+bool Profiler::IsEnabled() { return enabled; }
+
+long long Profiler::Now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+	threadName = name;
+
+	// If it already has a buffer, rename that too
+	Profiler& profiler = GetDefault();
+	std::lock_guard<std::mutex> lock(profiler.threadMutex);
+	for (std::unique_ptr<ThreadBuffer>& buffer : profiler.threads)
+		if (&buffer->Retired == retireOnExit.Retired)
+			buffer->Name = name;
+}
+
+// --------------------------------------------------------
+// Adds an event to the calling thread's buffer, unless it's
+// full.  Only this thread writes the slot, and EndFrame()
+// won't read it until "Written" says it's there.
+// --------------------------------------------------------
+void Profiler::Record(const char* name, long long start, long long end, unsigned int depth)
+{
+	if (!enabled.load(std::memory_order_relaxed))
+		return;
+
+	ThreadBuffer* buffer = GetDefault().GetThreadBuffer();
+	unsigned long long written = buffer->Written.load(std::memory_order_relaxed);
+	if (written - buffer->Read.load(std::memory_order_acquire) >= BufferCapacity)
+	{
+		buffer->Dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	ProfileEvent& event = buffer->Events[written & (BufferCapacity - 1)];
+	event.Name = name;
+	event.Start = start;
+	event.End = end;
+	event.Thread = buffer->Index;
+	event.Depth = depth;
+	buffer->Written.store(written + 1, std::memory_order_release);
+}
+
+// --------------------------------------------------------
+// The calling thread's buffer, made (or taken over from a
+// thread that's gone) the first time it records anything
+// --------------------------------------------------------
+Profiler::ThreadBuffer* Profiler::GetThreadBuffer()
+{
+	thread_local ThreadBuffer* buffer = 0;
+	if (buffer)
+		return buffer;
+
+	std::lock_guard<std::mutex> lock(threadMutex);
+	for (std::unique_ptr<ThreadBuffer>& retired : threads)
+	{
+		if (retired->Retired.load() && retired->Read.load() == retired->Written.load())
+		{
+			buffer = retired.get();
+			buffer->Retired = false;
+			break;
+		}
+	}
+
+	if (!buffer)
+	{
+		threads.push_back(std::unique_ptr<ThreadBuffer>(new ThreadBuffer()));
+		buffer = threads.back().get();
+		buffer->Index = (unsigned int)threads.size() - 1;
+	}
+
+	buffer->Name = threadName ? threadName : "Thread " + std::to_string(buffer->Index);
+	retireOnExit.Retired = &buffer->Retired;
+	return buffer;
+}
+
+// --------------------------------------------------------
+// Empties every thread's buffer into the last frame, and into
+// the capture while there is one
+// --------------------------------------------------------
+void Profiler::EndFrame()
+{
+	long long now = Now();
+	lastFrame.Start = lastFrame.End != 0 ? lastFrame.End : now;
+	lastFrame.End = now;
+	lastFrame.Events.clear();
+
+	{
+		std::lock_guard<std::mutex> lock(threadMutex);
+		for (std::unique_ptr<ThreadBuffer>& buffer : threads)
+		{
+			unsigned long long read = buffer->Read.load(std::memory_order_relaxed);
+			unsigned long long written = buffer->Written.load(std::memory_order_acquire);
+			for (; read < written; read++)
+				lastFrame.Events.push_back(buffer->Events[read & (BufferCapacity - 1)]);
+			buffer->Read.store(written, std::memory_order_release);
+		}
+	}
+
+	if (captureFramesLeft > 0)
+	{
+		captured.insert(captured.end(), lastFrame.Events.begin(), lastFrame.Events.end());
+
+		ProfileFrame frame;
+		frame.Start = lastFrame.Start;
+		frame.End = lastFrame.End;
+		capturedFrames.push_back(frame);
+
+		if (--captureFramesLeft == 0)
+			SetEnabled(enabledBeforeCapture);
+	}
+}
+
+const ProfileFrame& Profiler::GetLastFrame() { return lastFrame; }
+
+// --------------------------------------------------------
+// Starts with the next frame, since the current one began
+// before the profiler may have been enabled
+// --------------------------------------------------------
+void Profiler::StartCapture(unsigned int frameCount)
+{
+	if (captureFramesLeft == 0)
+		enabledBeforeCapture = IsEnabled();
+
+	captured.clear();
+	capturedFrames.clear();
+	captureFramesLeft = frameCount;
+	if (frameCount > 0)
+		SetEnabled(true);
+}
+
+bool Profiler::IsCapturing() { return captureFramesLeft > 0; }
+
+unsigned int Profiler::GetCapturedFrameCount() { return (unsigned int)capturedFrames.size(); }
+
+// --------------------------------------------------------
+// Writes the capture in the Trace Event format: every scope as
+// a complete ("X") event, in microseconds from the start of
+// the first frame, plus metadata naming each thread
+// --------------------------------------------------------
+bool Profiler::SaveChromeTrace(const std::wstring& filename)
+{
+	FILE* file = OpenForWriting(filename);
+	if (!file)
+		return false;
+
+	long long origin = capturedFrames.empty() ? 0 : capturedFrames[0].Start;
+	unsigned int threadCount = GetThreadCount();
+	unsigned int framesRow = threadCount;
+
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	for (unsigned int t = 0; t < threadCount; t++)
+	{
+		fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", t);
+		WriteJsonString(file, GetThreadName(t).c_str());
+		fprintf(file, "}},\n");
+	}
+	fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"Frames\"}}", framesRow);
+
+	for (size_t f = 0; f < capturedFrames.size(); f++)
+	{
+		fprintf(file, ",\n{\"name\":\"Frame %zu\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+			f,
+			framesRow,
+			(capturedFrames[f].Start - origin) / 1000.0,
+			(capturedFrames[f].End - capturedFrames[f].Start) / 1000.0);
+	}
+
+	for (const ProfileEvent& event : captured)
+	{
+		fprintf(file, ",\n{\"name\":");
+		WriteJsonString(file, event.Name);
+		fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+			event.Thread,
+			(event.Start - origin) / 1000.0,
+			(event.End - event.Start) / 1000.0);
+	}
+
+	fprintf(file, "\n]}\n");
+	bool written = ferror(file) == 0;
+	fclose(file);
+	return written;
+}
+
+unsigned int Profiler::GetThreadCount()
+{
+	std::lock_guard<std::mutex> lock(threadMutex);
+	return (unsigned int)threads.size();
+}
+
+std::string Profiler::GetThreadName(unsigned int thread)
+{
+	std::lock_guard<std::mutex> lock(threadMutex);
+	return thread < threads.size() ? threads[thread]->Name : std::string();
+}
+
+unsigned long long Profiler::GetDroppedCount()
+{
+	std::lock_guard<std::mutex> lock(threadMutex);
+	unsigned long long dropped = 0;
+	for (std::unique_ptr<ThreadBuffer>& buffer : threads)
+		dropped += buffer->Dropped.load();
+	return dropped;
+}
+
+void ProfileScope::Begin(const char* name)
+{
+	this->name = name;
+	depth = threadDepth++;
+	start = Profiler::Now();
+}
+
+void ProfileScope::End()
+{
+	long long end = Profiler::Now();
+	threadDepth--;
+	Profiler::Record(name, start, end, depth);
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Times the rest of the enclosing scope, when the profiler
+// is enabled.  The name must be a string literal (or live as
+// long as the program), since only the pointer is kept.
+//
+// Define DISABLE_PROFILER to compile every marker out.
+// --------------------------------------------------------
+#if defined(DISABLE_PROFILER)
+#define PROFILE_SCOPE(name) ((void)0)
+#else
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#endif
+
+// One timed scope
+struct ProfileEvent
+{
+	const char* Name;
+	long long Start;		// Nanoseconds, from Profiler::Now()
+	long long End;
+	unsigned int Thread;	// See Profiler::GetThreadName()
+	unsigned int Depth;		// How many scopes it's inside on its thread
+};
+
+// Everything that finished between two calls to EndFrame()
+struct ProfileFrame
+{
+	long long Start;
+	long long End;
+	std::vector<ProfileEvent> Events;	// In the order they finished, per thread
+};
+
+// --------------------------------------------------------
+// A hierarchical CPU profiler
+//
+// - Each thread records into its own ring buffer, which only
+//   that thread writes & only EndFrame() reads, so recording
+//   takes no locks.  A full buffer drops events (and counts
+//   them) rather than waiting.
+// - While disabled, a scope costs one relaxed atomic load
+// - EndFrame(), called once a frame from the main loop, moves
+//   everything recorded into the last frame, and into the
+//   capture if one is running
+// - A capture can be saved as Chrome trace JSON, for viewing
+//   in chrome://tracing or ui.perfetto.dev
+// --------------------------------------------------------
+class Profiler
+{
+public:
+	static Profiler& GetDefault();
+
+	static void SetEnabled(bool enabled);
+	static bool IsEnabled();
+
+	// The clock every event is timed on, in nanoseconds
+	static long long Now();
+
+	// Names the calling thread in captures & the timeline
+	static void SetThreadName(const char* name);
+
+	// Records a scope that's already finished; PROFILE_SCOPE()
+	// is usually simpler
+	static void Record(const char* name, long long start, long long end, unsigned int depth);
+
+	// Collects what every thread has recorded since the last
+	// call.  This and the frame & capture methods below aren't
+	// thread safe, so mustn't be called at the same time.
+	void EndFrame();
+	const ProfileFrame& GetLastFrame();
+
+	// Records the next frameCount frames (enabling the profiler)
+	void StartCapture(unsigned int frameCount);
+	bool IsCapturing();
+	unsigned int GetCapturedFrameCount();
+
+	// Saves the last capture as Chrome trace JSON, with each
+	// frame as a span of its own on a "Frames" row
+	bool SaveChromeTrace(const std::wstring& filename);
+
+	unsigned int GetThreadCount();
+	std::string GetThreadName(unsigned int thread);
+	unsigned long long GetDroppedCount();	// Events lost to full buffers
+
+	// Events each thread can record between calls to EndFrame()
+	static const unsigned int BufferCapacity = 1 << 14;
+
+private:
+	// A thread's events.  The thread writing them only moves
+	// "written" forward, and EndFrame() only moves "read".
+	struct ThreadBuffer
+	{
+		std::string Name;
+		unsigned int Index;
+		std::unique_ptr<ProfileEvent[]> Events;
+		std::atomic<unsigned long long> Written;
+		std::atomic<unsigned long long> Read;
+		std::atomic<unsigned long long> Dropped;
+		std::atomic<bool> Retired;	// Its thread has exited
+
+		ThreadBuffer();
+	};
+
+	Profiler();
+
+	std::mutex threadMutex;	// Only for adding & naming threads
+	std::vector<std::unique_ptr<ThreadBuffer>> threads;
+
+	ProfileFrame lastFrame;
+	std::vector<ProfileEvent> captured;
+	std::vector<ProfileFrame> capturedFrames;	// Just the times
+	unsigned int captureFramesLeft;
+	bool enabledBeforeCapture;
+
+	static std::atomic<bool> enabled;
+
+	ThreadBuffer* GetThreadBuffer();
+	friend class ProfileScope;
+};
+
+// Times its own lifetime (see PROFILE_SCOPE())
+class ProfileScope
+{
+public:
+	explicit ProfileScope(const char* name)
+	{
+		active = Profiler::enabled.load(std::memory_order_relaxed);
+		if (active)
+			Begin(name);
+	}
+
+	~ProfileScope()
+	{
+		if (active)
+			End();
+	}
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	const char* name;
+	long long start;
+	unsigned int depth;
+	bool active;
+
+	void Begin(const char* name);
+	void End();
+};
@@ -0,0 +1,76 @@
+#include "RenderSnapshot.h"
+#include "Material.h"
+
+RenderSnapshot::RenderSnapshot() :
+	Camera(),
+	Instancing(false),
+	MeshletCulling(false),
+	Frame(0)
+{
+}
+
+RenderSnapshot::~RenderSnapshot()
+{
+	ReleaseUi();
+}
+
+// Empties everything, keeping the memory for the next frame
+void RenderSnapshot::Clear()
+{
+	Materials.clear();
+	Entities.clear();
+	Lights.clear();
+	Batches.Begin();
+	Instancing = false;
+	MeshletCulling = false;
+	ReleaseUi();
+}
+
+// --------------------------------------------------------
+// A scene only has a handful of materials, so a linear
+// search beats hashing
+// --------------------------------------------------------
+unsigned int RenderSnapshot::AddMaterial(Material* material)
+{
+	for (unsigned int i = 0; i < Materials.size(); i++)
+		if (Materials[i].Source == material)
+			return i;
+
+	SnapshotMaterial copy;
+	copy.Source = material;
+	copy.ColorTint = material->GetColorTint();
+	copy.Roughness = material->GetRoughness();
+	Materials.push_back(copy);
+	return (unsigned int)Materials.size() - 1;
+}
+
+// --------------------------------------------------------
+// ImGui's own draw data is only good until its next
+// NewFrame(), which the next update calls while this is
+// being drawn, so every list is cloned
+// --------------------------------------------------------
+void RenderSnapshot::CaptureUi(const ImDrawData* drawData)
+{
+	ReleaseUi();
+	if (!drawData || !drawData->Valid)
+		return;
+
+	for (int i = 0; i < drawData->CmdListsCount; i++)
+		uiDrawLists.push_back(drawData->CmdLists[i]->CloneOutput());
+
+	uiDrawData = *drawData;
+	uiDrawData.CmdLists = uiDrawLists.data();
+}
+
+ImDrawData* RenderSnapshot::GetUiDrawData()
+{
+	return uiDrawData.Valid ? &uiDrawData : 0;
+}
+
+void RenderSnapshot::ReleaseUi()
+{
+	for (ImDrawList* list : uiDrawLists)
+		IM_DELETE(list);
+	uiDrawLists.clear();
+	uiDrawData.Clear();
+}
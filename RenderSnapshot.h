@@ -0,0 +1,92 @@
+#pragma once
+
+#include "Lights.h"
+#include "InstanceBatcher.h"
+#include "ImGui/imgui.h"
+
+#include <DirectXMath.h>
+#include <vector>
+
+class Mesh;
+class Material;
+
+// The camera, as it was when the snapshot was taken
+struct SnapshotCamera
+{
+	DirectX::XMFLOAT4X4 View;
+	DirectX::XMFLOAT4X4 Projection;
+	DirectX::XMFLOAT3 Position;
+};
+
+// --------------------------------------------------------
+// A material's values, as they were.  Its shaders & textures
+// are still used through Source, since they never change
+// once it's made.
+// --------------------------------------------------------
+struct SnapshotMaterial
+{
+	Material* Source;
+	DirectX::XMFLOAT4 ColorTint;
+	float Roughness;
+};
+
+// One entity to draw
+struct SnapshotEntity
+{
+	DirectX::XMFLOAT4X4 World;
+	DirectX::XMFLOAT4X4 WorldInvTranspose;
+	Mesh* Geometry;
+	unsigned int MaterialIndex;	// Into RenderSnapshot::Materials
+	int Lod;
+};
+
+// --------------------------------------------------------
+// Everything needed to draw one frame, copied out of the
+// scene at the end of its update, so it can be drawn while
+// the next frame is being updated (see FramePipeline)
+//
+// Nothing in here points at anything the update changes:
+// matrices, material values, lights & the camera are all
+// copies, and the ImGui draw lists are cloned.  Meshes and
+// the shaders & textures of materials are shared, so they
+// must outlive any snapshot that uses them.
+//
+// A snapshot is filled by one thread and then only read,
+// by another, until it's cleared for another frame.
+// --------------------------------------------------------
+struct RenderSnapshot
+{
+	SnapshotCamera Camera;
+	std::vector<SnapshotMaterial> Materials;
+	std::vector<SnapshotEntity> Entities;	// Only the visible ones
+	std::vector<Light> Lights;
+
+	// Entities grouped for instancing, when Instancing is set
+	// (sources are indices into Entities)
+	bool Instancing;
+	InstanceBatcher Batches;
+
+	bool MeshletCulling;
+	unsigned long long Frame;	// Counts up from 1 as snapshots are taken
+
+	RenderSnapshot();
+	~RenderSnapshot();
+
+	RenderSnapshot(const RenderSnapshot&) = delete;
+	RenderSnapshot& operator=(const RenderSnapshot&) = delete;
+
+	void Clear();
+
+	// The index of a material in Materials, adding it if it's new
+	unsigned int AddMaterial(Material* material);
+
+	// Copies ImGui's draw data from its last ImGui::Render()
+	void CaptureUi(const ImDrawData* drawData);
+	ImDrawData* GetUiDrawData();	// Null if none was captured
+
+private:
+	ImDrawData uiDrawData;
+	std::vector<ImDrawList*> uiDrawLists;	// Clones, owned by the snapshot
+
+	void ReleaseUi();
+};
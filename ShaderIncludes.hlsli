@@ -19,6 +19,7 @@ struct VertexToPixel
 	float3 normal			: NORMAL;
 	float3 worldPosition	: POSITION;
 	float3 tangent			: TANGENT;
+	float tangentSign		: BINORMAL;		// -1 where the texture is mirrored
 };
 
 // Struct representing a single vertex worth of data
@@ -37,6 +38,59 @@ struct VertexShaderInput
 	float3 normal			: NORMAL;
 	float2 uv				: TEXCOORD;
 	float3 tangent			: TANGENT;
+	float tangentSign		: BINORMAL;		// -1 where the texture is mirrored
 };
 
+// The compressed version of the vertex above (PackedVertex in
+// VertexPacking.h), decoded by PackedVertexShader.hlsl
+// - The input layout's formats do the first step of decoding,
+//   so everything arrives as floats
+struct PackedVertexShaderInput
+{
+	float4 packedPosition	: POSITION;		// 0-1 across the mesh's bounds, w = tangent sign (0 or 1)
+	float4 normalTangent	: NORMAL;		// Octahedral normal in xy, tangent in zw
+	float2 uv				: TEXCOORD;
+};
+
+// Octahedral decode (see VertexPacking.cpp)
+float3 OctahedronToDirection(float2 e)
+{
+	float3 v = float3(e, 1.0f - abs(e.x) - abs(e.y));
+	float t = max(-v.z, 0.0f);
+	v.xy += v.xy >= 0.0f ? -t : t;
+	return normalize(v);
+}
+
+// Per instance data for the instanced vertex shaders (InstanceData
+// in InstanceBatcher.h), one matrix row per element
+// - The "_PER_INSTANCE" semantics tell SimpleVertexShader to read
+//   these from the second vertex buffer, once per instance
+struct InstanceInput
+{
+	float4 world0				: WORLD_PER_INSTANCE0;
+	float4 world1				: WORLD_PER_INSTANCE1;
+	float4 world2				: WORLD_PER_INSTANCE2;
+	float4 world3				: WORLD_PER_INSTANCE3;
+	float4 worldInvTranspose0	: WORLDINVTRANSPOSE_PER_INSTANCE0;
+	float4 worldInvTranspose1	: WORLDINVTRANSPOSE_PER_INSTANCE1;
+	float4 worldInvTranspose2	: WORLDINVTRANSPOSE_PER_INSTANCE2;
+	float4 worldInvTranspose3	: WORLDINVTRANSPOSE_PER_INSTANCE3;
+};
+
+// The rows arrive as C++ stored them, so they're transposed to match
+// matrices from a constant buffer (which are read column by column)
+matrix InstanceWorld(InstanceInput instance)
+{
+	return transpose(matrix(instance.world0, instance.world1, instance.world2, instance.world3));
+}
+
+matrix InstanceWorldInvTranspose(InstanceInput instance)
+{
+	return transpose(matrix(
+		instance.worldInvTranspose0,
+		instance.worldInvTranspose1,
+		instance.worldInvTranspose2,
+		instance.worldInvTranspose3));
+}
+
 #endif
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "SimpleShader.h"
+#include "Profiler.h"
 
 // Default error reporting state
 bool ISimpleShader::ReportErrors = false;
@@ -342,6 +343,7 @@ void ISimpleShader::SetShader()
 // --------------------------------------------------------
 void ISimpleShader::CopyAllBufferData()
 {
+	PROFILE_SCOPE("CopyAllBufferData");
 	// Ensure the shader is valid
 	if (!shaderValid) return;
 
@@ -25,7 +25,29 @@ Sky::Sky(
 	vs(_vs)
 {
 	srv = CreateCubemap(right, left, up, down, front, back);
+	CreateRenderStates();
+}
+
+Sky::Sky(
+	std::shared_ptr<Mesh> _mesh,
+	Microsoft::WRL::ComPtr<ID3D11SamplerState> _sampler,
+	Microsoft::WRL::ComPtr<ID3D11Device> _device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> _context,
+	std::shared_ptr<SimplePixelShader> _ps,
+	std::shared_ptr<SimpleVertexShader> _vs,
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cubeMap) :
+	mesh(_mesh),
+	sampler(_sampler),
+	device(_device),
+	context(_context),
+	ps(_ps),
+	vs(_vs),
+	srv(cubeMap)
+{
+	CreateRenderStates();
+}
 
+void Sky::CreateRenderStates() {
 	D3D11_RASTERIZER_DESC rasterizerState = {};
 	rasterizerState.FillMode = D3D11_FILL_SOLID;
 	rasterizerState.CullMode = D3D11_CULL_FRONT;
@@ -37,7 +59,8 @@ Sky::Sky(
 	device->CreateDepthStencilState(&depthStencilState, depthBuffer.GetAddressOf());
 }
 
-void Sky::Draw(Camera cam) {
+// With matrices captured earlier, so it needn't touch a live camera
+void Sky::Draw(const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection) {
 	context->RSSetState(rasterizer.Get());
 	context->OMSetDepthStencilState(depthBuffer.Get(), 0);
 	
@@ -46,8 +69,8 @@ void Sky::Draw(Camera cam) {
 	ps->SetSamplerState("SkySampler", sampler);
 
 	vs->SetShader();
-	vs->SetMatrix4x4("view", cam.GetViewMatrix());
-	vs->SetMatrix4x4("projection", cam.GetProjectionMatrix());
+	vs->SetMatrix4x4("view", view);
+	vs->SetMatrix4x4("projection", projection);
 	vs->CopyAllBufferData();
 
 	mesh->Draw(context);
@@ -1,7 +1,6 @@
 #pragma once
 
 #include "Mesh.h"
-#include "Camera.h"
 #include "SimpleShader.h"
 #include <d3d11.h>
 #include <wrl/client.h>
@@ -21,9 +20,19 @@ public:
 		const wchar_t* down,
 		const wchar_t* front,
 		const wchar_t* back);
+
+	// With a cube map that's already been made
+	// (such as by AssetLoader::LoadCubemap())
+	Sky(std::shared_ptr<Mesh> _mesh,
+		Microsoft::WRL::ComPtr<ID3D11SamplerState> _sampler,
+		Microsoft::WRL::ComPtr<ID3D11Device> _device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> _context,
+		std::shared_ptr<SimplePixelShader> _ps,
+		std::shared_ptr<SimpleVertexShader> _vs,
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cubeMap);
 	~Sky();
 
-	void Draw(Camera cam);
+	void Draw(const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection);
 
 private:
 	Microsoft::WRL::ComPtr<ID3D11Device> device;
@@ -38,6 +47,8 @@ private:
 	std::shared_ptr<SimplePixelShader> ps;
 	std::shared_ptr<SimpleVertexShader> vs;
 
+	void CreateRenderStates();
+
 	// --------------------------------------------------------
 	// Author: Chris Cascioli
 	// Purpose: Creates a cube map on the GPU from 6 individual textures
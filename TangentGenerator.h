@@ -0,0 +1,13 @@
+#pragma once
+
+#include "Vertex.h"
+
+// Calculates a tangent for every vertex from the mesh's triangles,
+// orthogonalized against each vertex's normal
+void GenerateTangents(Vertex* verts, int numVerts, const unsigned int* indices, int numIndices);
+
+// Works out whether each vertex's texture runs the way the pixel
+// shader assumes (bitangent = cross(tangent, normal)): +1 where it
+// does, -1 where the texture is mirrored.
+// Call it after GenerateTangents().
+void CalculateTangentSigns(const Vertex* verts, int numVerts, const unsigned int* indices, int numIndices, float* signs);
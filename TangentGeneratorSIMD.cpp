@@ -0,0 +1,676 @@
+#include "TangentGeneratorSIMD.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define TANGENT_SIMD_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC lets any function use any intrinsic, while GCC & Clang
+// need to be told which functions may use the newer ones
+#if defined(TANGENT_SIMD_X86) && !defined(_MSC_VER)
+#define TANGENT_TARGET(isa) __attribute__((target(isa)))
+#else
+#define TANGENT_TARGET(isa)
+#endif
+
+namespace
+{
+	// --------------------------------------------------------
+	// Each vertex's running totals: tangent xyz, 0, bitangent
+	// xyz, 0.  Keeping them together means adding one triangle
+	// into a vertex touches a single cache line.
+	// --------------------------------------------------------
+	const size_t AccumulatorStride = 8;
+
+	// --------------------------------------------------------
+	// One triangle's tangent & bitangent, worked out the same
+	// way as GenerateTangents()
+	// --------------------------------------------------------
+	void TriangleTangents(const Vertex* verts, const unsigned int* tri, float* tangent, float* bitangent)
+	{
+		const Vertex& v1 = verts[tri[0]];
+		const Vertex& v2 = verts[tri[1]];
+		const Vertex& v3 = verts[tri[2]];
+
+		float x1 = v2.Position.x - v1.Position.x;
+		float y1 = v2.Position.y - v1.Position.y;
+		float z1 = v2.Position.z - v1.Position.z;
+
+		float x2 = v3.Position.x - v1.Position.x;
+		float y2 = v3.Position.y - v1.Position.y;
+		float z2 = v3.Position.z - v1.Position.z;
+
+		float s1 = v2.UV.x - v1.UV.x;
+		float t1 = v2.UV.y - v1.UV.y;
+
+		float s2 = v3.UV.x - v1.UV.x;
+		float t2 = v3.UV.y - v1.UV.y;
+
+		// No UV area?  Then the triangle adds nothing
+		float det = s1 * t2 - s2 * t1;
+		float r = det != 0.0f ? 1.0f / det : 0.0f;
+
+		tangent[0] = (t2 * x1 - t1 * x2) * r;
+		tangent[1] = (t2 * y1 - t1 * y2) * r;
+		tangent[2] = (t2 * z1 - t1 * z2) * r;
+		bitangent[0] = (s1 * x2 - s2 * x1) * r;
+		bitangent[1] = (s1 * y2 - s2 * y1) * r;
+		bitangent[2] = (s1 * z2 - s2 * z1) * r;
+	}
+
+	// --------------------------------------------------------
+	// Adds each triangle's tangent & bitangent into its corners'
+	// accumulators or, if "frames" isn't null, just stores them
+	// there (8 floats per triangle, laid out like an accumulator)
+	// --------------------------------------------------------
+	void AccumulateTrianglesScalar(const Vertex* verts, const unsigned int* indices, float* accumulators, float* frames, size_t first, size_t last)
+	{
+		for (size_t t = first; t < last; t++)
+		{
+			const unsigned int* tri = indices + t * 3;
+			float tangent[3], bitangent[3];
+			TriangleTangents(verts, tri, tangent, bitangent);
+
+			if (frames)
+			{
+				float* f = frames + t * AccumulatorStride;
+				f[0] = tangent[0];
+				f[1] = tangent[1];
+				f[2] = tangent[2];
+				f[3] = 0.0f;
+				f[4] = bitangent[0];
+				f[5] = bitangent[1];
+				f[6] = bitangent[2];
+				f[7] = 0.0f;
+				continue;
+			}
+
+			for (int c = 0; c < 3; c++)
+			{
+				float* a = accumulators + tri[c] * AccumulatorStride;
+				a[0] += tangent[0];
+				a[1] += tangent[1];
+				a[2] += tangent[2];
+				a[4] += bitangent[0];
+				a[5] += bitangent[1];
+				a[6] += bitangent[2];
+			}
+		}
+	}
+
+	// --------------------------------------------------------
+	// Gram-Schmidt against the normal, normalize, then compare
+	// against the accumulated bitangent for the sign (see
+	// CalculateTangentSigns())
+	// --------------------------------------------------------
+	void OrthonormalizeScalar(Vertex* verts, const float* accumulators, size_t first, size_t last)
+	{
+		for (size_t i = first; i < last; i++)
+		{
+			const float* a = accumulators + i * AccumulatorStride;
+			const DirectX::XMFLOAT3& n = verts[i].Normal;
+
+			float d = n.x * a[0] + n.y * a[1] + n.z * a[2];
+			float tx = a[0] - n.x * d;
+			float ty = a[1] - n.y * d;
+			float tz = a[2] - n.z * d;
+
+			float length = std::sqrt(tx * tx + ty * ty + tz * tz);
+			float scale = length != 0.0f ? 1.0f / length : 0.0f;
+			tx *= scale;
+			ty *= scale;
+			tz *= scale;
+			verts[i].Tangent = DirectX::XMFLOAT3(tx, ty, tz);
+
+			float handedness =
+				(ty * n.z - tz * n.y) * a[4] +
+				(tz * n.x - tx * n.z) * a[5] +
+				(tx * n.y - ty * n.x) * a[6];
+			verts[i].TangentSign = handedness > 0.0f ? -1.0f : 1.0f;
+		}
+	}
+
+#if defined(TANGENT_SIMD_X86)
+	// --------------------------------------------------------
+	// SSE4: four triangles (or vertices) at a time
+	//
+	// Vertices are loaded whole and transposed in registers, so
+	// each register holds one component of four different ones
+	// --------------------------------------------------------
+
+	// x, y & z of four vertices' XMFLOAT3s (the 4th float loaded is ignored)
+	TANGENT_TARGET("sse4.1")
+	void LoadTransposedSSE(const float* p0, const float* p1, const float* p2, const float* p3, __m128& x, __m128& y, __m128& z)
+	{
+		__m128 r0 = _mm_loadu_ps(p0);
+		__m128 r1 = _mm_loadu_ps(p1);
+		__m128 r2 = _mm_loadu_ps(p2);
+		__m128 r3 = _mm_loadu_ps(p3);
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+		x = r0;
+		y = r1;
+		z = r2;
+	}
+
+	// u & v of four vertices
+	TANGENT_TARGET("sse4.1")
+	void LoadUVsSSE(const Vertex& v0, const Vertex& v1, const Vertex& v2, const Vertex& v3, __m128& u, __m128& v)
+	{
+		__m128 uv01 = _mm_movelh_ps(
+			_mm_castpd_ps(_mm_load_sd((const double*)&v0.UV)),
+			_mm_castpd_ps(_mm_load_sd((const double*)&v1.UV)));
+		__m128 uv23 = _mm_movelh_ps(
+			_mm_castpd_ps(_mm_load_sd((const double*)&v2.UV)),
+			_mm_castpd_ps(_mm_load_sd((const double*)&v3.UV)));
+		u = _mm_shuffle_ps(uv01, uv23, _MM_SHUFFLE(2, 0, 2, 0));
+		v = _mm_shuffle_ps(uv01, uv23, _MM_SHUFFLE(3, 1, 3, 1));
+	}
+
+	// Turns x/y/z(/w) registers back into one (x, y, z, w) per lane
+	TANGENT_TARGET("sse4.1")
+	void TransposeBackSSE(__m128 x, __m128 y, __m128 z, __m128 w, __m128* rows)
+	{
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+		rows[0] = x;
+		rows[1] = y;
+		rows[2] = z;
+		rows[3] = w;
+	}
+
+	TANGENT_TARGET("sse4.1")
+	void TransposeBackSSE(__m128 x, __m128 y, __m128 z, __m128* rows)
+	{
+		TransposeBackSSE(x, y, z, _mm_setzero_ps(), rows);
+	}
+
+	// Adds triangle "t" (tangent & bitangent are (x, y, z, 0)) into
+	// its corners, or stores it in frames (see AccumulateTrianglesScalar())
+	TANGENT_TARGET("sse4.1")
+	void StoreOrScatterSSE(float* accumulators, float* frames, size_t t, const unsigned int* tri, __m128 tangent, __m128 bitangent)
+	{
+		if (frames)
+		{
+			_mm_storeu_ps(frames + t * AccumulatorStride, tangent);
+			_mm_storeu_ps(frames + t * AccumulatorStride + 4, bitangent);
+			return;
+		}
+
+		for (int c = 0; c < 3; c++)
+		{
+			float* a = accumulators + tri[c] * AccumulatorStride;
+			_mm_storeu_ps(a, _mm_add_ps(_mm_loadu_ps(a), tangent));
+			_mm_storeu_ps(a + 4, _mm_add_ps(_mm_loadu_ps(a + 4), bitangent));
+		}
+	}
+
+	// The per-triangle math from TriangleTangents(), with each
+	// lane working on a different triangle
+	TANGENT_TARGET("sse4.1")
+	void TriangleTangentsSSE(
+		const __m128* px, const __m128* py, const __m128* pz, const __m128* u, const __m128* v,
+		__m128& tx, __m128& ty, __m128& tz, __m128& bx, __m128& by, __m128& bz)
+	{
+		__m128 x1 = _mm_sub_ps(px[1], px[0]);
+		__m128 y1 = _mm_sub_ps(py[1], py[0]);
+		__m128 z1 = _mm_sub_ps(pz[1], pz[0]);
+		__m128 x2 = _mm_sub_ps(px[2], px[0]);
+		__m128 y2 = _mm_sub_ps(py[2], py[0]);
+		__m128 z2 = _mm_sub_ps(pz[2], pz[0]);
+		__m128 s1 = _mm_sub_ps(u[1], u[0]);
+		__m128 t1 = _mm_sub_ps(v[1], v[0]);
+		__m128 s2 = _mm_sub_ps(u[2], u[0]);
+		__m128 t2 = _mm_sub_ps(v[2], v[0]);
+
+		__m128 det = _mm_sub_ps(_mm_mul_ps(s1, t2), _mm_mul_ps(s2, t1));
+		__m128 r = _mm_and_ps(_mm_div_ps(_mm_set1_ps(1.0f), det), _mm_cmpneq_ps(det, _mm_setzero_ps()));
+
+		tx = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, x1), _mm_mul_ps(t1, x2)), r);
+		ty = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, y1), _mm_mul_ps(t1, y2)), r);
+		tz = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, z1), _mm_mul_ps(t1, z2)), r);
+		bx = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(s1, x2), _mm_mul_ps(s2, x1)), r);
+		by = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(s1, y2), _mm_mul_ps(s2, y1)), r);
+		bz = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(s1, z2), _mm_mul_ps(s2, z1)), r);
+	}
+
+	TANGENT_TARGET("sse4.1")
+	void AccumulateTrianglesSSE4(const Vertex* verts, const unsigned int* indices, float* accumulators, float* frames, size_t first, size_t last)
+	{
+		for (size_t t = first; t + 4 <= last; t += 4)
+		{
+			const unsigned int* tri = indices + t * 3;
+
+			__m128 px[3], py[3], pz[3], u[3], v[3];
+			for (int c = 0; c < 3; c++)
+			{
+				const Vertex& v0 = verts[tri[c]];
+				const Vertex& v1 = verts[tri[3 + c]];
+				const Vertex& v2 = verts[tri[6 + c]];
+				const Vertex& v3 = verts[tri[9 + c]];
+				LoadTransposedSSE(&v0.Position.x, &v1.Position.x, &v2.Position.x, &v3.Position.x, px[c], py[c], pz[c]);
+				LoadUVsSSE(v0, v1, v2, v3, u[c], v[c]);
+			}
+
+			__m128 tx, ty, tz, bx, by, bz;
+			TriangleTangentsSSE(px, py, pz, u, v, tx, ty, tz, bx, by, bz);
+
+			// Scattering back into shared vertices has to be one triangle at a time
+			__m128 tangents[4], bitangents[4];
+			TransposeBackSSE(tx, ty, tz, tangents);
+			TransposeBackSSE(bx, by, bz, bitangents);
+			for (int lane = 0; lane < 4; lane++)
+				StoreOrScatterSSE(accumulators, frames, t + lane, tri + lane * 3, tangents[lane], bitangents[lane]);
+		}
+	}
+
+	// The math from OrthonormalizeScalar(), for four vertices.
+	// Returns the new tangents as (x, y, z, sign) rows.
+	TANGENT_TARGET("sse4.1")
+	void OrthonormalizeLanesSSE(
+		__m128 tX, __m128 tY, __m128 tZ,
+		__m128 bX, __m128 bY, __m128 bZ,
+		__m128 nX, __m128 nY, __m128 nZ,
+		__m128* tangents)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+
+		__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nX, tX), _mm_mul_ps(nY, tY)), _mm_mul_ps(nZ, tZ));
+		tX = _mm_sub_ps(tX, _mm_mul_ps(nX, d));
+		tY = _mm_sub_ps(tY, _mm_mul_ps(nY, d));
+		tZ = _mm_sub_ps(tZ, _mm_mul_ps(nZ, d));
+
+		__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tX, tX), _mm_mul_ps(tY, tY)), _mm_mul_ps(tZ, tZ)));
+		__m128 scale = _mm_and_ps(_mm_div_ps(one, length), _mm_cmpneq_ps(length, zero));
+		tX = _mm_mul_ps(tX, scale);
+		tY = _mm_mul_ps(tY, scale);
+		tZ = _mm_mul_ps(tZ, scale);
+
+		__m128 handedness = _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(_mm_sub_ps(_mm_mul_ps(tY, nZ), _mm_mul_ps(tZ, nY)), bX),
+			_mm_mul_ps(_mm_sub_ps(_mm_mul_ps(tZ, nX), _mm_mul_ps(tX, nZ)), bY)),
+			_mm_mul_ps(_mm_sub_ps(_mm_mul_ps(tX, nY), _mm_mul_ps(tY, nX)), bZ));
+		__m128 sign = _mm_blendv_ps(one, _mm_set1_ps(-1.0f), _mm_cmpgt_ps(handedness, zero));
+		TransposeBackSSE(tX, tY, tZ, sign, tangents);
+	}
+
+	// TangentSign follows Tangent, so a (x, y, z, sign) row is
+	// one 16 byte store
+	static_assert(offsetof(Vertex, TangentSign) == offsetof(Vertex, Tangent) + 12, "Vertex::TangentSign must follow Tangent");
+
+	TANGENT_TARGET("sse4.1")
+	void StoreTangentSSE(Vertex& vert, __m128 tangentAndSign)
+	{
+		_mm_storeu_ps(&vert.Tangent.x, tangentAndSign);
+	}
+
+	TANGENT_TARGET("sse4.1")
+	void OrthonormalizeSSE4(Vertex* verts, const float* accumulators, size_t first, size_t last)
+	{
+		for (size_t i = first; i + 4 <= last; i += 4)
+		{
+			const float* a = accumulators + i * AccumulatorStride;
+			__m128 tX, tY, tZ, bX, bY, bZ, nX, nY, nZ;
+			LoadTransposedSSE(a, a + 8, a + 16, a + 24, tX, tY, tZ);
+			LoadTransposedSSE(a + 4, a + 12, a + 20, a + 28, bX, bY, bZ);
+			LoadTransposedSSE(&verts[i].Normal.x, &verts[i + 1].Normal.x, &verts[i + 2].Normal.x, &verts[i + 3].Normal.x, nX, nY, nZ);
+
+			__m128 tangents[4];
+			OrthonormalizeLanesSSE(tX, tY, tZ, bX, bY, bZ, nX, nY, nZ, tangents);
+			for (int lane = 0; lane < 4; lane++)
+				StoreTangentSSE(verts[i + lane], tangents[lane]);
+		}
+	}
+
+	// --------------------------------------------------------
+	// AVX2: eight triangles at a time
+	//
+	// The low half of each register holds lanes 0-3 and the high
+	// half lanes 4-7, so the SSE transposes work on each half.
+	// (Hardware gathers would avoid the transposes, but they're
+	// much slower on many CPUs.)
+	// --------------------------------------------------------
+	TANGENT_TARGET("avx2")
+	__m256 Combine(__m128 low, __m128 high)
+	{
+		return _mm256_insertf128_ps(_mm256_castps128_ps256(low), high, 1);
+	}
+
+	TANGENT_TARGET("avx2")
+	void AccumulateTrianglesAVX2(const Vertex* verts, const unsigned int* indices, float* accumulators, float* frames, size_t first, size_t last)
+	{
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 one = _mm256_set1_ps(1.0f);
+
+		for (size_t t = first; t + 8 <= last; t += 8)
+		{
+			const unsigned int* tri = indices + t * 3;
+
+			__m256 px[3], py[3], pz[3], u[3], v[3];
+			for (int c = 0; c < 3; c++)
+			{
+				__m128 lowX, lowY, lowZ, lowU, lowV, highX, highY, highZ, highU, highV;
+				const Vertex& v0 = verts[tri[c]];
+				const Vertex& v1 = verts[tri[3 + c]];
+				const Vertex& v2 = verts[tri[6 + c]];
+				const Vertex& v3 = verts[tri[9 + c]];
+				const Vertex& v4 = verts[tri[12 + c]];
+				const Vertex& v5 = verts[tri[15 + c]];
+				const Vertex& v6 = verts[tri[18 + c]];
+				const Vertex& v7 = verts[tri[21 + c]];
+				LoadTransposedSSE(&v0.Position.x, &v1.Position.x, &v2.Position.x, &v3.Position.x, lowX, lowY, lowZ);
+				LoadTransposedSSE(&v4.Position.x, &v5.Position.x, &v6.Position.x, &v7.Position.x, highX, highY, highZ);
+				LoadUVsSSE(v0, v1, v2, v3, lowU, lowV);
+				LoadUVsSSE(v4, v5, v6, v7, highU, highV);
+				px[c] = Combine(lowX, highX);
+				py[c] = Combine(lowY, highY);
+				pz[c] = Combine(lowZ, highZ);
+				u[c] = Combine(lowU, highU);
+				v[c] = Combine(lowV, highV);
+			}
+
+			__m256 x1 = _mm256_sub_ps(px[1], px[0]);
+			__m256 y1 = _mm256_sub_ps(py[1], py[0]);
+			__m256 z1 = _mm256_sub_ps(pz[1], pz[0]);
+			__m256 x2 = _mm256_sub_ps(px[2], px[0]);
+			__m256 y2 = _mm256_sub_ps(py[2], py[0]);
+			__m256 z2 = _mm256_sub_ps(pz[2], pz[0]);
+			__m256 s1 = _mm256_sub_ps(u[1], u[0]);
+			__m256 t1 = _mm256_sub_ps(v[1], v[0]);
+			__m256 s2 = _mm256_sub_ps(u[2], u[0]);
+			__m256 t2 = _mm256_sub_ps(v[2], v[0]);
+
+			__m256 det = _mm256_sub_ps(_mm256_mul_ps(s1, t2), _mm256_mul_ps(s2, t1));
+			__m256 r = _mm256_and_ps(_mm256_div_ps(one, det), _mm256_cmp_ps(det, zero, _CMP_NEQ_UQ));
+
+			__m256 tx = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(t2, x1), _mm256_mul_ps(t1, x2)), r);
+			__m256 ty = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(t2, y1), _mm256_mul_ps(t1, y2)), r);
+			__m256 tz = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(t2, z1), _mm256_mul_ps(t1, z2)), r);
+			__m256 bx = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(s1, x2), _mm256_mul_ps(s2, x1)), r);
+			__m256 by = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(s1, y2), _mm256_mul_ps(s2, y1)), r);
+			__m256 bz = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(s1, z2), _mm256_mul_ps(s2, z1)), r);
+
+			__m128 tangents[8], bitangents[8];
+			TransposeBackSSE(_mm256_castps256_ps128(tx), _mm256_castps256_ps128(ty), _mm256_castps256_ps128(tz), tangents);
+			TransposeBackSSE(_mm256_extractf128_ps(tx, 1), _mm256_extractf128_ps(ty, 1), _mm256_extractf128_ps(tz, 1), tangents + 4);
+			TransposeBackSSE(_mm256_castps256_ps128(bx), _mm256_castps256_ps128(by), _mm256_castps256_ps128(bz), bitangents);
+			TransposeBackSSE(_mm256_extractf128_ps(bx, 1), _mm256_extractf128_ps(by, 1), _mm256_extractf128_ps(bz, 1), bitangents + 4);
+			for (int lane = 0; lane < 8; lane++)
+				StoreOrScatterSSE(accumulators, frames, t + lane, tri + lane * 3, tangents[lane], bitangents[lane]);
+		}
+	}
+
+	TANGENT_TARGET("avx2")
+	void OrthonormalizeAVX2(Vertex* verts, const float* accumulators, size_t first, size_t last)
+	{
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 minusOne = _mm256_set1_ps(-1.0f);
+
+		for (size_t i = first; i + 8 <= last; i += 8)
+		{
+			const float* a = accumulators + i * AccumulatorStride;
+			__m128 loT[3], hiT[3], loB[3], hiB[3], loN[3], hiN[3];
+			LoadTransposedSSE(a, a + 8, a + 16, a + 24, loT[0], loT[1], loT[2]);
+			LoadTransposedSSE(a + 32, a + 40, a + 48, a + 56, hiT[0], hiT[1], hiT[2]);
+			LoadTransposedSSE(a + 4, a + 12, a + 20, a + 28, loB[0], loB[1], loB[2]);
+			LoadTransposedSSE(a + 36, a + 44, a + 52, a + 60, hiB[0], hiB[1], hiB[2]);
+			LoadTransposedSSE(&verts[i].Normal.x, &verts[i + 1].Normal.x, &verts[i + 2].Normal.x, &verts[i + 3].Normal.x, loN[0], loN[1], loN[2]);
+			LoadTransposedSSE(&verts[i + 4].Normal.x, &verts[i + 5].Normal.x, &verts[i + 6].Normal.x, &verts[i + 7].Normal.x, hiN[0], hiN[1], hiN[2]);
+
+			__m256 tX = Combine(loT[0], hiT[0]), tY = Combine(loT[1], hiT[1]), tZ = Combine(loT[2], hiT[2]);
+			__m256 nX = Combine(loN[0], hiN[0]), nY = Combine(loN[1], hiN[1]), nZ = Combine(loN[2], hiN[2]);
+
+			__m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nX, tX), _mm256_mul_ps(nY, tY)), _mm256_mul_ps(nZ, tZ));
+			tX = _mm256_sub_ps(tX, _mm256_mul_ps(nX, d));
+			tY = _mm256_sub_ps(tY, _mm256_mul_ps(nY, d));
+			tZ = _mm256_sub_ps(tZ, _mm256_mul_ps(nZ, d));
+
+			__m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(tX, tX), _mm256_mul_ps(tY, tY)), _mm256_mul_ps(tZ, tZ)));
+			__m256 scale = _mm256_and_ps(_mm256_div_ps(one, length), _mm256_cmp_ps(length, zero, _CMP_NEQ_UQ));
+			tX = _mm256_mul_ps(tX, scale);
+			tY = _mm256_mul_ps(tY, scale);
+			tZ = _mm256_mul_ps(tZ, scale);
+
+			__m256 bX = Combine(loB[0], hiB[0]), bY = Combine(loB[1], hiB[1]), bZ = Combine(loB[2], hiB[2]);
+			__m256 handedness = _mm256_add_ps(_mm256_add_ps(
+				_mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(tY, nZ), _mm256_mul_ps(tZ, nY)), bX),
+				_mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(tZ, nX), _mm256_mul_ps(tX, nZ)), bY)),
+				_mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(tX, nY), _mm256_mul_ps(tY, nX)), bZ));
+			__m256 sign = _mm256_blendv_ps(one, minusOne, _mm256_cmp_ps(handedness, zero, _CMP_GT_OQ));
+
+			__m128 tangents[8];
+			TransposeBackSSE(_mm256_castps256_ps128(tX), _mm256_castps256_ps128(tY), _mm256_castps256_ps128(tZ), _mm256_castps256_ps128(sign), tangents);
+			TransposeBackSSE(_mm256_extractf128_ps(tX, 1), _mm256_extractf128_ps(tY, 1), _mm256_extractf128_ps(tZ, 1), _mm256_extractf128_ps(sign, 1), tangents + 4);
+			for (int lane = 0; lane < 8; lane++)
+				StoreTangentSSE(verts[i + lane], tangents[lane]);
+		}
+	}
+#endif
+
+	// --------------------------------------------------------
+	// Runs a triangle or vertex range through the chosen kernel,
+	// finishing any leftovers with the scalar one
+	// --------------------------------------------------------
+	void AccumulateTriangles(TangentKernel kernel, const Vertex* verts, const unsigned int* indices, float* accumulators, float* frames, size_t first, size_t last)
+	{
+		size_t done = first;
+#if defined(TANGENT_SIMD_X86)
+		if (kernel == TangentKernel::AVX2)
+		{
+			done = first + ((last - first) & ~(size_t)7);
+			AccumulateTrianglesAVX2(verts, indices, accumulators, frames, first, done);
+		}
+		else if (kernel == TangentKernel::SSE4)
+		{
+			done = first + ((last - first) & ~(size_t)3);
+			AccumulateTrianglesSSE4(verts, indices, accumulators, frames, first, done);
+		}
+#endif
+		AccumulateTrianglesScalar(verts, indices, accumulators, frames, done, last);
+	}
+
+	void Orthonormalize(TangentKernel kernel, Vertex* verts, const float* accumulators, size_t first, size_t last)
+	{
+		size_t done = first;
+#if defined(TANGENT_SIMD_X86)
+		if (kernel == TangentKernel::AVX2)
+		{
+			done = first + ((last - first) & ~(size_t)7);
+			OrthonormalizeAVX2(verts, accumulators, first, done);
+		}
+		else if (kernel == TangentKernel::SSE4)
+		{
+			done = first + ((last - first) & ~(size_t)3);
+			OrthonormalizeSSE4(verts, accumulators, first, done);
+		}
+#endif
+		OrthonormalizeScalar(verts, accumulators, done, last);
+	}
+
+	TangentKernel DetectTangentKernel()
+	{
+#if !defined(TANGENT_SIMD_X86)
+		return TangentKernel::Scalar;
+#else
+		bool sse4 = false;
+		bool avx2 = false;
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		int maxLeaf = info[0];
+
+		__cpuid(info, 1);
+		sse4 = (info[2] & (1 << 19)) != 0;
+
+		// AVX also needs the OS to save the upper halves of the registers
+		bool osSavesAVX = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+		if (maxLeaf >= 7 && osSavesAVX)
+		{
+			__cpuidex(info, 7, 0);
+			avx2 = (info[1] & (1 << 5)) != 0;
+		}
+#else
+		__builtin_cpu_init();
+		sse4 = __builtin_cpu_supports("sse4.1") != 0;
+		avx2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+		if (avx2)
+			return TangentKernel::AVX2;
+		if (sse4)
+			return TangentKernel::SSE4;
+		return TangentKernel::Scalar;
+#endif
+	}
+}
+
+TangentKernel GetBestTangentKernel()
+{
+	static const TangentKernel best = DetectTangentKernel();
+	return best;
+}
+
+namespace
+{
+	// Falls back to whatever this CPU can actually run
+	TangentKernel ResolveTangentKernel(TangentKernel kernel)
+	{
+		TangentKernel best = GetBestTangentKernel();
+		if (kernel == TangentKernel::Auto || (int)kernel > (int)best)
+			return best;
+		return kernel;
+	}
+}
+
+TangentKernel GenerateTangentsSIMD(
+	Vertex* verts,
+	int numVerts,
+	const unsigned int* indices,
+	int numIndices,
+	TangentKernel kernel)
+{
+	kernel = ResolveTangentKernel(kernel);
+
+	size_t vertexCount = numVerts > 0 ? (size_t)numVerts : 0;
+	size_t triangleCount = numIndices > 0 ? (size_t)numIndices / 3 : 0;
+	if (vertexCount == 0)
+		return kernel;
+
+	std::vector<float> accumulators(vertexCount * AccumulatorStride, 0.0f);
+	AccumulateTriangles(kernel, verts, indices, &accumulators[0], 0, 0, triangleCount);
+	Orthonormalize(kernel, verts, &accumulators[0], 0, vertexCount);
+
+	return kernel;
+}
+
+// --------------------------------------------------------
+// Vertices are shared between triangles, so threads can't
+// just split the triangles and add into the vertices.  Instead:
+//
+// 1. Each range of triangles works out its own tangents (no
+//    sharing).  Meanwhile one job lists each vertex's triangles,
+//    in triangle order: a counting pass over the indices, a
+//    prefix sum, then a pass filling the lists in.
+// 2. Each range of vertices adds up its triangles' tangents,
+//    in that order, then orthonormalizes them
+//
+// Every vertex's sum is the same additions in the same order
+// as the serial version, so the result is identical to
+// GenerateTangentsSIMD() whatever the thread count.  The extra
+// memory is one frame per triangle plus the lists, whatever
+// the thread count.
+// --------------------------------------------------------
+TangentKernel GenerateTangentsParallel(
+	Vertex* verts,
+	int numVerts,
+	const unsigned int* indices,
+	int numIndices,
+	unsigned int threadCount,
+	TangentKernel kernel)
+{
+	kernel = ResolveTangentKernel(kernel);
+	if (threadCount == 0)
+		threadCount = JobSystem::GetDefault().GetThreadCount();
+
+	// The extra passes cost about as much as the serial version, so
+	// threads only pay off on big meshes with a few cores to spare
+	// (see BenchmarkTangents())
+	const size_t minParallelTriangles = 1024 * 1024;
+	const unsigned int minParallelThreads = 4;
+	size_t vertexCount = numVerts > 0 ? (size_t)numVerts : 0;
+	size_t triangleCount = numIndices > 0 ? (size_t)numIndices / 3 : 0;
+	if (threadCount < minParallelThreads || triangleCount < minParallelTriangles)
+		return GenerateTangentsSIMD(verts, numVerts, indices, numIndices, kernel);
+
+	// Everything is allocated up front, so the list job can't throw
+	// - The big arrays are left uninitialized, since clearing them
+	//   up front would be a long single threaded step
+	size_t indexCount = triangleCount * 3;
+	std::unique_ptr<float[]> frames(new float[triangleCount * AccumulatorStride]);
+	std::unique_ptr<float[]> accumulators(new float[vertexCount * AccumulatorStride]);
+	std::unique_ptr<unsigned int[]> vertexTriangles(new unsigned int[indexCount]);
+	std::vector<unsigned int> firstTriangle(vertexCount + 1, 0);
+	std::vector<unsigned int> cursors(vertexCount);
+
+	// 1. Each vertex's triangles (one job) alongside the tangents
+	//    per triangle (everyone else)
+	JobSystem& jobs = JobSystem::GetDefault();
+	JobCounter lists;
+	jobs.Run([&]()
+	{
+		for (size_t i = 0; i < indexCount; i++)
+			firstTriangle[indices[i] + 1]++;
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			firstTriangle[v + 1] += firstTriangle[v];
+			cursors[v] = firstTriangle[v];
+		}
+		for (size_t i = 0; i < indexCount; i++)
+			vertexTriangles[cursors[indices[i]]++] = (unsigned int)(i / 3);
+	}, &lists);
+
+	// - If this throws, the list job still has to finish before
+	//   the arrays it's filling go away
+	try
+	{
+		jobs.ParallelFor(triangleCount, [&](size_t begin, size_t end)
+		{
+			AccumulateTriangles(kernel, verts, indices, 0, frames.get(), begin, end);
+		}, 4096, threadCount);
+	}
+	catch (...)
+	{
+		jobs.WaitQuietly(lists);
+		throw;
+	}
+	jobs.Wait(lists);
+
+	// 2. Sum & orthonormalize each range of vertices
+	jobs.ParallelFor(vertexCount, [&](size_t begin, size_t end)
+	{
+		for (size_t v = begin; v < end; v++)
+		{
+			float sum[AccumulatorStride] = {};
+			for (unsigned int j = firstTriangle[v]; j < firstTriangle[v + 1]; j++)
+			{
+				const float* f = &frames[vertexTriangles[j] * AccumulatorStride];
+				for (size_t k = 0; k < AccumulatorStride; k++)
+					sum[k] += f[k];
+			}
+			std::copy(sum, sum + AccumulatorStride, &accumulators[v * AccumulatorStride]);
+		}
+
+		Orthonormalize(kernel, verts, accumulators.get(), begin, end);
+	}, 1024, threadCount);
+
+	return kernel;
+}
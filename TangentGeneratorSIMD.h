@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Instruction sets the SIMD tangent generator can use
+// --------------------------------------------------------
+enum class TangentKernel
+{
+	Auto,	// The best one this CPU supports
+	Scalar,
+	SSE4,	// 4 triangles / vertices at a time
+	AVX2	// 8 at a time
+};
+
+// The kernel Auto picks on this CPU
+TangentKernel GetBestTangentKernel();
+
+// --------------------------------------------------------
+// The same tangents as GenerateTangents() (within floating
+// point tolerance), plus each vertex's TangentSign (as
+// CalculateTangentSigns() works it out), computed several at
+// a time.
+//
+// - Vertices are loaded as they are and transposed in
+//   registers, so each SIMD lane holds a different triangle
+//   or vertex
+// - Triangles with no UV area add nothing, rather than
+//   turning their vertices' tangents into NaNs
+//
+// Returns the kernel that was actually used, since the one
+// asked for may not be supported by this CPU
+// --------------------------------------------------------
+TangentKernel GenerateTangentsSIMD(
+	Vertex* verts,
+	int numVerts,
+	const unsigned int* indices,
+	int numIndices,
+	TangentKernel kernel = TangentKernel::Auto);
+
+// --------------------------------------------------------
+// GenerateTangentsSIMD() spread across threadCount threads
+// (0 = one per core), for big meshes.  The output is identical,
+// bit for bit, to GenerateTangentsSIMD() with the same kernel,
+// whatever the thread count.  Small meshes just run on this one.
+// --------------------------------------------------------
+TangentKernel GenerateTangentsParallel(
+	Vertex* verts,
+	int numVerts,
+	const unsigned int* indices,
+	int numIndices,
+	unsigned int threadCount = 0,
+	TangentKernel kernel = TangentKernel::Auto);
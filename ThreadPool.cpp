@@ -0,0 +1,66 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(
+	unsigned int threadCount,
+	std::function<void()> threadStart,
+	std::function<void()> threadEnd)
+	:
+	stopping(false)
+{
+	if (threadCount == 0)
+		threadCount = (std::max)(1u, std::thread::hardware_concurrency());
+
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		workers.push_back(std::thread([this, threadStart, threadEnd]()
+		{
+			if (threadStart)
+				threadStart();
+
+			WorkerLoop();
+
+			if (threadEnd)
+				threadEnd();
+		}));
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		stopping = true;
+	}
+	jobAdded.notify_all();
+
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+unsigned int ThreadPool::GetThreadCount()
+{
+	return (unsigned int)workers.size();
+}
+
+// --------------------------------------------------------
+// Runs jobs until the pool is destroyed and the queue is empty
+// --------------------------------------------------------
+void ThreadPool::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			jobAdded.wait(lock, [this]() { return stopping || !jobs.empty(); });
+			if (jobs.empty())
+				return;
+
+			job = std::move(jobs.front());
+			jobs.pop();
+		}
+		job();
+	}
+}
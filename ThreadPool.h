@@ -0,0 +1,60 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// --------------------------------------------------------
+// A fixed set of worker threads that run jobs in the order
+// they were submitted
+//
+// - threadStart & threadEnd run on every worker as it starts
+//   and stops, for per-thread setup like CoInitializeEx()
+// - The destructor waits for every job already submitted
+// --------------------------------------------------------
+class ThreadPool
+{
+public:
+	ThreadPool(
+		unsigned int threadCount = 0,	// 0 = one per core
+		std::function<void()> threadStart = nullptr,
+		std::function<void()> threadEnd = nullptr);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	unsigned int GetThreadCount();
+
+	// Queues a job, returning a future for whatever it returns
+	// (or throws, which the future rethrows from get())
+	template<typename Job>
+	auto Submit(Job job) -> std::future<decltype(job())>
+	{
+		typedef decltype(job()) Result;
+		std::shared_ptr<std::packaged_task<Result()>> task =
+			std::make_shared<std::packaged_task<Result()>>(job);
+
+		std::future<Result> result = task->get_future();
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			jobs.push([task]() { (*task)(); });
+		}
+		jobAdded.notify_one();
+		return result;
+	}
+
+private:
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()>> jobs;
+	std::mutex queueMutex;
+	std::condition_variable jobAdded;
+	bool stopping;
+
+	void WorkerLoop();
+};
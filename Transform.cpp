@@ -1,113 +1,349 @@
 #include "Transform.h"
+
+#include <algorithm>
+#include <cmath>
+
 using namespace DirectX;
 
+namespace
+{
+	// --------------------------------------------------------
+	// The angles that XMMatrixRotationRollPitchYaw() would turn
+	// into this rotation (it applies roll, then pitch, then yaw)
+	// --------------------------------------------------------
+	XMFLOAT3 PitchYawRollFromQuaternion(FXMVECTOR rotation)
+	{
+		XMFLOAT4X4 r;
+		XMStoreFloat4x4(&r, XMMatrixRotationQuaternion(rotation));
+
+		float pitch = std::asin((std::max)(-1.0f, (std::min)(1.0f, -r._32)));
+		float yaw, roll;
+		if (std::fabs(r._32) < 0.9999f)
+		{
+			yaw = std::atan2(r._31, r._33);
+			roll = std::atan2(r._12, r._22);
+		}
+		else
+		{
+			// Looking straight up or down, where yaw & roll do the same thing
+			yaw = std::atan2(-r._13, r._11);
+			roll = 0.0f;
+		}
+		return XMFLOAT3(pitch, yaw, roll);
+	}
+}
+
 Transform::Transform() :
-	position(0, 0, 0),
-	pitchYawRoll(0, 0, 0),
-	scale(1, 1, 1)
+	store(&TransformStore::GetDefault())
+{
+	index = store->Allocate(this);
+}
+
+Transform::Transform(TransformStore& store) :
+	store(&store)
 {
-	XMStoreFloat4x4(&world, XMMatrixIdentity());
-	XMStoreFloat4x4(&worldInverseTranspose, XMMatrixIdentity());
+	index = store.Allocate(this);
+}
+
+Transform::Transform(const Transform& other) :
+	store(other.store)
+{
+	index = store->Allocate(this);
+	*this = other;
+}
+
+Transform::Transform(Transform&& other) noexcept :
+	store(other.store),
+	index(other.index)
+{
+	other.index = TransformStore::Invalid;
+	if (index != TransformStore::Invalid)
+		store->owners[index] = this;
+}
+
+// --------------------------------------------------------
+// Copies the local values & parent into this slot, which
+// keeps its own children
+// --------------------------------------------------------
+Transform& Transform::operator=(const Transform& other)
+{
+	if (this == &other)
+		return *this;
+
+	// An assignment from another store moves this one over there
+	if (index == TransformStore::Invalid || store != other.store)
+	{
+		if (index != TransformStore::Invalid)
+			store->Free(index);
+		store = other.store;
+		index = store->Allocate(this);
+	}
+
+	TransformStore& s = *store;
+	unsigned int from = other.index;
+	s.SaveForInterpolation(index);
+	if (from == TransformStore::Invalid)
+	{
+		s.Detach(index);
+		s.positionX[index] = s.positionY[index] = s.positionZ[index] = 0.0f;
+		s.pitch[index] = s.yaw[index] = s.roll[index] = 0.0f;
+		s.scaleX[index] = s.scaleY[index] = s.scaleZ[index] = 1.0f;
+		s.SetOrientation(index, XMQuaternionIdentity());
+	}
+	else
+	{
+		// Copying a descendant can't make this its own ancestor
+		unsigned int parent = s.parents[from];
+		if (parent != TransformStore::Invalid && s.IsAncestor(index, parent))
+			parent = TransformStore::Invalid;
+		if (s.parents[index] != parent)
+		{
+			s.Detach(index);
+			s.Attach(index, parent);
+		}
+		s.positionX[index] = s.positionX[from];
+		s.positionY[index] = s.positionY[from];
+		s.positionZ[index] = s.positionZ[from];
+		s.pitch[index] = s.pitch[from];
+		s.yaw[index] = s.yaw[from];
+		s.roll[index] = s.roll[from];
+		s.scaleX[index] = s.scaleX[from];
+		s.scaleY[index] = s.scaleY[from];
+		s.scaleZ[index] = s.scaleZ[from];
+		s.rotations[index] = s.rotations[from];
+		s.rights[index] = s.rights[from];
+		s.ups[index] = s.ups[from];
+		s.forwards[index] = s.forwards[from];
+	}
+	s.MarkDirty(index);
+	return *this;
+}
+
+Transform& Transform::operator=(Transform&& other) noexcept
+{
+	if (this == &other)
+		return *this;
+
+	if (index != TransformStore::Invalid)
+		store->Free(index);
+
+	store = other.store;
+	index = other.index;
+	other.index = TransformStore::Invalid;
+	if (index != TransformStore::Invalid)
+		store->owners[index] = this;
+	return *this;
+}
+
+Transform::~Transform()
+{
+	if (index != TransformStore::Invalid)
+		store->Free(index);
 }
 
 void Transform::MoveAbsolute(float x, float y, float z) {
-	position.x += x;
-	position.y += y;
-	position.z += z;
+	store->SaveForInterpolation(index);
+	store->positionX[index] += x;
+	store->positionY[index] += y;
+	store->positionZ[index] += z;
+	store->MarkDirty(index);
 }
 
 void Transform::MoveRelative(float x, float y, float z) {
-	XMVECTOR targetPos = XMVectorSet(x, y, z, 0.0f);
-	XMVECTOR currentRotation = XMQuaternionRotationRollPitchYaw(pitchYawRoll.x, pitchYawRoll.y, pitchYawRoll.z);
-	XMVECTOR move = XMVector3Rotate(targetPos, currentRotation);
+	XMVECTOR move =
+		XMLoadFloat3(&store->rights[index]) * x +
+		XMLoadFloat3(&store->ups[index]) * y +
+		XMLoadFloat3(&store->forwards[index]) * z;
 
-	XMStoreFloat3(&position, XMLoadFloat3(&position) + move);
+	XMFLOAT3 offset;
+	XMStoreFloat3(&offset, move);
+	MoveAbsolute(offset.x, offset.y, offset.z);
 }
 
 void Transform::Rotate(float p, float y, float r) {
-	pitchYawRoll.x += p;
-	pitchYawRoll.y += y;
-	pitchYawRoll.z += r;
+	store->SaveForInterpolation(index);
+	store->pitch[index] += p;
+	store->yaw[index] += y;
+	store->roll[index] += r;
+	store->SetOrientation(index, XMQuaternionRotationRollPitchYaw(store->pitch[index], store->yaw[index], store->roll[index]));
+	store->MarkDirty(index);
+}
+
+void Transform::RotateAxisAngle(DirectX::XMFLOAT3 axis, float angle) {
+	XMVECTOR turn = XMQuaternionRotationAxis(XMLoadFloat3(&axis), angle);
+	SetOrientation(XMQuaternionMultiply(XMLoadFloat4(&store->rotations[index]), turn));
+}
+
+void Transform::SlerpRotation(DirectX::XMFLOAT4 target, float t) {
+	SetOrientation(XMQuaternionSlerp(XMLoadFloat4(&store->rotations[index]), XMLoadFloat4(&target), t));
 }
 
 void Transform::Scale(float x, float y, float z) {
-	scale.x *= x;
-	scale.y *= y;
-	scale.z *= z;
+	store->SaveForInterpolation(index);
+	store->scaleX[index] *= x;
+	store->scaleY[index] *= y;
+	store->scaleZ[index] *= z;
+	store->MarkDirty(index);
 }
 
 void Transform::SetPosition(float x, float y, float z) {
-	position.x = x;
-	position.y = y;
-	position.z = z;
+	store->SaveForInterpolation(index);
+	store->positionX[index] = x;
+	store->positionY[index] = y;
+	store->positionZ[index] = z;
+	store->MarkDirty(index);
 }
 
 void Transform::SetPitchYawRoll(float p, float y, float r) {
-	pitchYawRoll.x = p;
-	pitchYawRoll.y = y;
-	pitchYawRoll.z = r;
+	store->SaveForInterpolation(index);
+	store->pitch[index] = p;
+	store->yaw[index] = y;
+	store->roll[index] = r;
+	store->SetOrientation(index, XMQuaternionRotationRollPitchYaw(p, y, r));
+	store->MarkDirty(index);
 }
 
 void Transform::SetScale(float x, float y, float z) {
-	scale.x = x;
-	scale.y = y;
-	scale.z = z;
+	store->SaveForInterpolation(index);
+	store->scaleX[index] = x;
+	store->scaleY[index] = y;
+	store->scaleZ[index] = z;
+	store->MarkDirty(index);
+}
+
+void Transform::SetRotation(DirectX::XMFLOAT4 rotation) {
+	SetOrientation(XMLoadFloat4(&rotation));
+}
+
+DirectX::XMFLOAT3 Transform::GetPosition() {
+	return XMFLOAT3(store->positionX[index], store->positionY[index], store->positionZ[index]);
+}
+
+DirectX::XMFLOAT3 Transform::GetPitchYawRoll() {
+	return XMFLOAT3(store->pitch[index], store->yaw[index], store->roll[index]);
+}
+
+DirectX::XMFLOAT3 Transform::GeScale() {
+	return XMFLOAT3(store->scaleX[index], store->scaleY[index], store->scaleZ[index]);
 }
 
-DirectX::XMFLOAT3 Transform::GetPosition() { return position; }
-DirectX::XMFLOAT3 Transform::GetPitchYawRoll() { return pitchYawRoll; }
-DirectX::XMFLOAT3 Transform::GeScale() { return scale; }
+DirectX::XMFLOAT4 Transform::GetRotation() { return store->rotations[index]; }
+DirectX::XMFLOAT3 Transform::GetRight() { return store->rights[index]; }
+DirectX::XMFLOAT3 Transform::GetUp() { return store->ups[index]; }
+DirectX::XMFLOAT3 Transform::GetForward() { return store->forwards[index]; }
 
-DirectX::XMFLOAT3 Transform::GetRight() {
-	XMVECTOR currentRotation = XMQuaternionRotationRollPitchYaw(pitchYawRoll.x, pitchYawRoll.y, pitchYawRoll.z);
-	XMVECTOR rot = XMVector3Rotate(XMVectorSet(1, 0, 0, 0), currentRotation);
+DirectX::XMFLOAT4X4 Transform::GetLocalMatrix() {
+	XMFLOAT4X4 local;
+	XMStoreFloat4x4(&local, store->BuildLocalMatrix(index));
+	return local;
+}
 
-	XMFLOAT3 right;
-	XMStoreFloat3(&right, rot);
+DirectX::XMFLOAT4X4 Transform::GetWorldMatrix() {
+	store->UpdateWorld(index);
 
-	return right;
+	return store->worlds[index];
 }
 
-DirectX::XMFLOAT3 Transform::GetUp() {
-	XMVECTOR currentRotation = XMQuaternionRotationRollPitchYaw(pitchYawRoll.x, pitchYawRoll.y, pitchYawRoll.z);
-	XMVECTOR rot = XMVector3Rotate(XMVectorSet(0, 1, 0, 0), currentRotation);
+DirectX::XMFLOAT4X4 Transform::GetWorldInverseTransposeMatrix() {
+	store->UpdateInverseTranspose(index);
+
+	return store->worldInverseTransposes[index];
+}
 
-	XMFLOAT3 up;
-	XMStoreFloat3(&up, rot);
+DirectX::XMFLOAT3 Transform::GetWorldPosition() {
+	store->UpdateWorld(index);
 
-	return up;
+	const XMFLOAT4X4& world = store->worlds[index];
+	return XMFLOAT3(world._41, world._42, world._43);
 }
 
-DirectX::XMFLOAT3 Transform::GetForward() {
-	XMVECTOR currentRotation = XMQuaternionRotationRollPitchYaw(pitchYawRoll.x, pitchYawRoll.y, pitchYawRoll.z);
-	XMVECTOR rot = XMVector3Rotate(XMVectorSet(0, 0, 1, 0), currentRotation);
+void Transform::SetParent(Transform* newParent, bool keepWorldTransform) {
+	TransformStore& s = *store;
+	unsigned int parent = newParent ? newParent->index : TransformStore::Invalid;
+	if (newParent && (newParent->store != store || parent == TransformStore::Invalid))
+		return;
+	if (parent == s.parents[index] || parent == index)
+		return;
 
-	XMFLOAT3 fwd;
-	XMStoreFloat3(&fwd, rot);
+	// Parenting to a descendant would make a loop
+	if (parent != TransformStore::Invalid && s.IsAncestor(index, parent))
+		return;
 
-	return fwd;
+	XMFLOAT4X4 oldWorld = GetWorldMatrix();
+	s.Detach(index);
+	s.Attach(index, parent);
+
+	if (keepWorldTransform)
+	{
+		// New local = old world, relative to the new parent's world
+		XMMATRIX worldMat = XMLoadFloat4x4(&oldWorld);
+		if (newParent)
+		{
+			XMFLOAT4X4 parentWorld = newParent->GetWorldMatrix();
+			worldMat = worldMat * XMMatrixInverse(0, XMLoadFloat4x4(&parentWorld));
+		}
+		SetLocalFromMatrix(worldMat);
+	}
+
+	s.MarkDirty(index);
 }
 
-DirectX::XMFLOAT4X4 Transform::GetWorldMatrix() { 
-	UpdateMatrices();
+Transform* Transform::GetParent() {
+	if (index == TransformStore::Invalid || store->parents[index] == TransformStore::Invalid)
+		return 0;
+	return store->owners[store->parents[index]];
+}
 
-	return world;
+void Transform::AddChild(Transform* child, bool keepWorldTransform) {
+	if (child)
+		child->SetParent(this, keepWorldTransform);
 }
 
-DirectX::XMFLOAT4X4 Transform::GetWorldInverseTransposeMatrix() {
-	UpdateMatrices();
+void Transform::RemoveChild(Transform* child, bool keepWorldTransform) {
+	if (child && child->GetParent() == this)
+		child->SetParent(0, keepWorldTransform);
+}
+
+size_t Transform::GetChildCount() {
+	return index == TransformStore::Invalid ? 0 : store->childCounts[index];
+}
 
-	return worldInverseTranspose;
+Transform* Transform::GetChild(size_t childIndex) {
+	unsigned int child = store->firstChildren[index];
+	for (size_t i = 0; i < childIndex && child != TransformStore::Invalid; i++)
+		child = store->nextSiblings[child];
+	return child == TransformStore::Invalid ? 0 : store->owners[child];
 }
 
-void Transform::UpdateMatrices() {
-	XMMATRIX trans = XMMatrixTranslation(position.x, position.y, position.z);
-	XMMATRIX rot = XMMatrixRotationRollPitchYaw(pitchYawRoll.x, pitchYawRoll.y, pitchYawRoll.z);
-	XMMATRIX sc = XMMatrixScaling(scale.x, scale.y, scale.z);
+TransformStore* Transform::GetStore() { return store; }
+
+// --------------------------------------------------------
+// Splits a matrix back into position, rotation & scale
+// - Shear (from a non-uniformly scaled parent) can't be
+//   represented, so it's lost
+// --------------------------------------------------------
+void Transform::SetLocalFromMatrix(FXMMATRIX matrix) {
+	XMVECTOR scaleVec, rotationQuat, translation;
+	if (!XMMatrixDecompose(&scaleVec, &rotationQuat, &translation, matrix))
+		return;
 
-	XMMATRIX worldMat = sc * rot * trans;
+	XMFLOAT3 pos, sc;
+	XMStoreFloat3(&pos, translation);
+	XMStoreFloat3(&sc, scaleVec);
+	SetPosition(pos.x, pos.y, pos.z);
+	SetScale(sc.x, sc.y, sc.z);
+	SetOrientation(rotationQuat);
+}
 
-	XMStoreFloat4x4(&world, worldMat);
-	XMStoreFloat4x4(&worldInverseTranspose, XMMatrixInverse(0, XMMatrixTranspose(worldMat)));
+// A quaternion rotation, with the angles worked out to match
+void Transform::SetOrientation(FXMVECTOR rotation) {
+	store->SaveForInterpolation(index);
+	XMVECTOR normalized = XMQuaternionNormalize(rotation);
+	XMFLOAT3 angles = PitchYawRollFromQuaternion(normalized);
 
+	store->pitch[index] = angles.x;
+	store->yaw[index] = angles.y;
+	store->roll[index] = angles.z;
+	store->SetOrientation(index, normalized);
+	store->MarkDirty(index);
 }
@@ -1,43 +1,93 @@
 #pragma once
 
+#include "TransformStore.h"
 #include <DirectXMath.h>
 
+// --------------------------------------------------------
+// Position, rotation & scale relative to an optional parent
+//
+// A lightweight handle: the values and matrices themselves
+// live in a TransformStore (the default one, unless another
+// is given), which can rebuild all the dirty matrices in one
+// batch with TransformStore::UpdateMatrices().  Anything
+// still dirty when a Get...Matrix() is called is brought up
+// to date on the spot, along with its parents.
+//
+// Rotations can be given as pitch/yaw/roll or as quaternions;
+// either way both are kept, along with the right, up &
+// forward vectors, so reading any of them is just a copy.
+//
+// Between fixed timestep ticks, the matrices of anything the
+// last tick moved are blended towards its latest values
+// (see TransformStore), so they can lag the Get...() values.
+//
+// Copying a transform copies its local values and parent,
+// but not its children.  Moving one hands its place in the
+// hierarchy (parent and children) over to the new object,
+// and can't throw, so a growing std::vector moves them.  A
+// transform that's been moved from can only be assigned to
+// or destroyed.
+// --------------------------------------------------------
 class Transform
 {
 public:
 	Transform();
+	explicit Transform(TransformStore& store);
+	Transform(const Transform& other);
+	Transform(Transform&& other) noexcept;
+	Transform& operator=(const Transform& other);
+	Transform& operator=(Transform&& other) noexcept;
+	~Transform();
 
 	// Setters
 	void SetPosition(float x, float y, float z);
 	void SetPitchYawRoll(float p, float y, float r);
 	void SetScale(float x, float y, float z);
+	void SetRotation(DirectX::XMFLOAT4 rotation);
 
 	// Transformers
 	void MoveAbsolute(float x, float y, float z);
 	void MoveRelative(float x, float y, float z);
 	void Rotate(float p, float y, float r);
 	void Scale(float x, float y, float z);
+	void RotateAxisAngle(DirectX::XMFLOAT3 axis, float angle);	// Axis in the parent's space
+	void SlerpRotation(DirectX::XMFLOAT4 target, float t);		// t = 0 stays, 1 reaches target
 
-	// Getters
+	// Getters (relative to the parent)
 	DirectX::XMFLOAT3 GetPosition();
 	DirectX::XMFLOAT3 GetPitchYawRoll();
 	DirectX::XMFLOAT3 GeScale();
+	DirectX::XMFLOAT4 GetRotation();
 
 	DirectX::XMFLOAT3 GetRight();
 	DirectX::XMFLOAT3 GetUp();
 	DirectX::XMFLOAT3 GetForward();
 
+	// Including every parent's transform
+	DirectX::XMFLOAT4X4 GetLocalMatrix();
 	DirectX::XMFLOAT4X4 GetWorldMatrix();
 	DirectX::XMFLOAT4X4 GetWorldInverseTransposeMatrix();
+	DirectX::XMFLOAT3 GetWorldPosition();
+
+	// Hierarchy (only between transforms in the same store)
+	// - With keepWorldTransform, the local values are changed so the
+	//   transform stays where it is in the world under its new parent
+	// - A parent that's destroyed leaves its children as roots
+	void SetParent(Transform* newParent, bool keepWorldTransform = false);
+	Transform* GetParent();
+	void AddChild(Transform* child, bool keepWorldTransform = false);
+	void RemoveChild(Transform* child, bool keepWorldTransform = false);
+	size_t GetChildCount();
+	Transform* GetChild(size_t index);
+
+	TransformStore* GetStore();
 
 private:
-	DirectX::XMFLOAT4X4 world;
-	DirectX::XMFLOAT4X4 worldInverseTranspose;
+	friend class TransformStore;
 
-	DirectX::XMFLOAT3 position;
-	DirectX::XMFLOAT3 pitchYawRoll;
-	DirectX::XMFLOAT3 scale;
+	TransformStore* store;
+	unsigned int index;		// Slot in the store
 
-	void UpdateMatrices();
+	void SetLocalFromMatrix(DirectX::FXMMATRIX matrix);
+	void SetOrientation(DirectX::FXMVECTOR rotation);
 };
-
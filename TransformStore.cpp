@@ -0,0 +1,466 @@
+#include "TransformStore.h"
+#include "JobSystem.h"
+#include "Transform.h"
+#include "MatrixMath.h"
+
+#include <algorithm>
+
+using namespace DirectX;
+
+namespace
+{
+	// Levels smaller than this aren't worth waking threads for
+	const size_t MinParallelCount = 4096;
+}
+
+const unsigned int TransformStore::Invalid;
+
+TransformStore::TransformStore() :
+	ticking(false),
+	interpolationAlpha(1.0f)
+{
+}
+
+TransformStore::~TransformStore()
+{
+	// Anything still alive outlived its store; leave it empty
+	// so its destructor doesn't touch freed memory
+	for (Transform* owner : owners)
+		if (owner)
+			owner->index = Invalid;
+}
+
+TransformStore& TransformStore::GetDefault()
+{
+	static TransformStore store;
+	return store;
+}
+
+size_t TransformStore::GetCount() { return flags.size() - freeSlots.size(); }
+
+size_t TransformStore::GetDirtyCount() { return dirty.size(); }
+
+size_t TransformStore::GetInterpolatedCount() { return interpolated.size(); }
+
+unsigned int TransformStore::Allocate(Transform* owner)
+{
+	unsigned int slot;
+	if (!freeSlots.empty())
+	{
+		slot = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else
+	{
+		slot = (unsigned int)flags.size();
+		positionX.push_back(0); positionY.push_back(0); positionZ.push_back(0);
+		pitch.push_back(0); yaw.push_back(0); roll.push_back(0);
+		scaleX.push_back(1); scaleY.push_back(1); scaleZ.push_back(1);
+		rotations.push_back(XMFLOAT4(0, 0, 0, 1));
+		rights.push_back(XMFLOAT3(1, 0, 0));
+		ups.push_back(XMFLOAT3(0, 1, 0));
+		forwards.push_back(XMFLOAT3(0, 0, 1));
+		parents.push_back(Invalid);
+		firstChildren.push_back(Invalid);
+		nextSiblings.push_back(Invalid);
+		previousSiblings.push_back(Invalid);
+		childCounts.push_back(0);
+		depths.push_back(0);
+		flags.push_back(0);
+		owners.push_back(0);
+		worlds.push_back(XMFLOAT4X4());
+		worldInverseTransposes.push_back(XMFLOAT4X4());
+		previousPositions.push_back(XMFLOAT3(0, 0, 0));
+		previousRotations.push_back(XMFLOAT4(0, 0, 0, 1));
+		previousScales.push_back(XMFLOAT3(1, 1, 1));
+
+		freeSlots.reserve(flags.capacity());
+		dirty.reserve(flags.capacity());
+		interpolated.reserve(flags.capacity());
+	}
+
+	SetDefaults(slot);
+	owners[slot] = owner;
+	return slot;
+}
+
+// --------------------------------------------------------
+// Gives a slot back, leaving its children as roots
+// - It may still be in the dirty list; UpdateMatrices()
+//   skips slots that aren't alive
+// --------------------------------------------------------
+void TransformStore::Free(unsigned int slot)
+{
+	Detach(slot);
+	while (firstChildren[slot] != Invalid)
+	{
+		unsigned int child = firstChildren[slot];
+		Detach(child);
+		MarkDirty(child);
+	}
+
+	flags[slot] &= Queued;
+	owners[slot] = 0;
+	freeSlots.push_back(slot);
+}
+
+// An identity transform with no parent or children, already up to date
+void TransformStore::SetDefaults(unsigned int slot)
+{
+	positionX[slot] = positionY[slot] = positionZ[slot] = 0.0f;
+	pitch[slot] = yaw[slot] = roll[slot] = 0.0f;
+	scaleX[slot] = scaleY[slot] = scaleZ[slot] = 1.0f;
+	rotations[slot] = XMFLOAT4(0, 0, 0, 1);
+	rights[slot] = XMFLOAT3(1, 0, 0);
+	ups[slot] = XMFLOAT3(0, 1, 0);
+	forwards[slot] = XMFLOAT3(0, 0, 1);
+	parents[slot] = Invalid;
+	firstChildren[slot] = Invalid;
+	nextSiblings[slot] = Invalid;
+	previousSiblings[slot] = Invalid;
+	childCounts[slot] = 0;
+	depths[slot] = 0;
+	flags[slot] = (flags[slot] & Queued) | Alive;
+	XMStoreFloat4x4(&worlds[slot], XMMatrixIdentity());
+	XMStoreFloat4x4(&worldInverseTransposes[slot], XMMatrixIdentity());
+}
+
+// --------------------------------------------------------
+// Marks a slot's matrices & every descendant's as dirty
+// - A dirty slot's descendants are already all dirty (none
+//   can be rebuilt without rebuilding it first), so there's
+//   no need to go any further down from one
+// - Each matrix is rebuilt on its own, so that only holds
+//   once both are dirty
+// --------------------------------------------------------
+void TransformStore::MarkDirty(unsigned int slot)
+{
+	if ((flags[slot] & (WorldDirty | InverseTransposeDirty)) == (WorldDirty | InverseTransposeDirty))
+		return;
+
+	flags[slot] |= WorldDirty | InverseTransposeDirty;
+	if (!(flags[slot] & Queued))
+	{
+		flags[slot] |= Queued;
+		dirty.push_back(slot);
+	}
+
+	for (unsigned int child = firstChildren[slot]; child != Invalid; child = nextSiblings[child])
+		MarkDirty(child);
+}
+
+// --------------------------------------------------------
+// Called before a tick changes a slot's local values, to
+// keep the ones it had before the tick
+// - Slots freed & reused since stay in the list, without
+//   the flag; everything reading it checks the flag
+// --------------------------------------------------------
+void TransformStore::SaveForInterpolation(unsigned int slot)
+{
+	if (!ticking || (flags[slot] & Interpolated))
+		return;
+
+	flags[slot] |= Interpolated;
+	previousPositions[slot] = XMFLOAT3(positionX[slot], positionY[slot], positionZ[slot]);
+	previousRotations[slot] = rotations[slot];
+	previousScales[slot] = XMFLOAT3(scaleX[slot], scaleY[slot], scaleZ[slot]);
+	interpolated.push_back(slot);
+}
+
+// --------------------------------------------------------
+// Starts a tick: whatever the last one changed but this one
+// doesn't is drawn exactly where it is from now on
+// --------------------------------------------------------
+void TransformStore::BeginTick()
+{
+	for (unsigned int slot : interpolated)
+	{
+		if (flags[slot] & Interpolated)
+		{
+			flags[slot] &= ~Interpolated;
+			MarkDirty(slot);
+		}
+	}
+	interpolated.clear();
+	ticking = true;
+}
+
+void TransformStore::EndTick()
+{
+	ticking = false;
+}
+
+void TransformStore::SetInterpolation(float alpha)
+{
+	interpolationAlpha = (std::min)(1.0f, (std::max)(0.0f, alpha));
+	for (unsigned int slot : interpolated)
+		if (flags[slot] & Interpolated)
+			MarkDirty(slot);
+}
+
+// Brings one chain up to date, parents first
+void TransformStore::UpdateWorld(unsigned int slot)
+{
+	if (!(flags[slot] & WorldDirty))
+		return;
+
+	unsigned int parent = parents[slot];
+	if (parent != Invalid)
+		UpdateWorld(parent);
+
+	XMMATRIX local = BuildLocalMatrix(slot);
+	if (parent != Invalid)
+		local = local * XMLoadFloat4x4(&worlds[parent]);
+	XMStoreFloat4x4(&worlds[slot], local);
+	flags[slot] &= ~WorldDirty;
+}
+
+// --------------------------------------------------------
+// The inverse transpose of a product is the product of the
+// inverse transposes, so this chains the same way world
+// matrices do, and never needs a general inverse
+// --------------------------------------------------------
+void TransformStore::UpdateInverseTranspose(unsigned int slot)
+{
+	if (!(flags[slot] & InverseTransposeDirty))
+		return;
+
+	unsigned int parent = parents[slot];
+	if (parent != Invalid)
+		UpdateInverseTranspose(parent);
+
+	XMMATRIX inverseTranspose = BuildLocalInverseTranspose(slot);
+	if (parent != Invalid)
+		inverseTranspose = inverseTranspose * XMLoadFloat4x4(&worldInverseTransposes[parent]);
+	XMStoreFloat4x4(&worldInverseTransposes[slot], inverseTranspose);
+	flags[slot] &= ~InverseTransposeDirty;
+}
+
+// Links a detached slot in as parent's first child
+void TransformStore::Attach(unsigned int slot, unsigned int parent)
+{
+	parents[slot] = parent;
+	if (parent == Invalid)
+	{
+		SetDepths(slot, 0);
+		return;
+	}
+
+	unsigned int next = firstChildren[parent];
+	nextSiblings[slot] = next;
+	previousSiblings[slot] = Invalid;
+	if (next != Invalid)
+		previousSiblings[next] = slot;
+	firstChildren[parent] = slot;
+	childCounts[parent]++;
+	SetDepths(slot, depths[parent] + 1);
+}
+
+void TransformStore::Detach(unsigned int slot)
+{
+	unsigned int parent = parents[slot];
+	if (parent == Invalid)
+		return;
+
+	unsigned int previous = previousSiblings[slot];
+	unsigned int next = nextSiblings[slot];
+	if (previous != Invalid)
+		nextSiblings[previous] = next;
+	else
+		firstChildren[parent] = next;
+	if (next != Invalid)
+		previousSiblings[next] = previous;
+	childCounts[parent]--;
+
+	parents[slot] = Invalid;
+	nextSiblings[slot] = Invalid;
+	previousSiblings[slot] = Invalid;
+	SetDepths(slot, 0);
+}
+
+void TransformStore::SetDepths(unsigned int slot, unsigned int depth)
+{
+	// Children are always one deeper than their parent already
+	if (depths[slot] == depth)
+		return;
+
+	depths[slot] = depth;
+	for (unsigned int child = firstChildren[slot]; child != Invalid; child = nextSiblings[child])
+		SetDepths(child, depth + 1);
+}
+
+bool TransformStore::IsAncestor(unsigned int ancestor, unsigned int slot)
+{
+	for (unsigned int parent = slot; parent != Invalid; parent = parents[parent])
+		if (parent == ancestor)
+			return true;
+	return false;
+}
+
+// The basis vectors are the rows of the rotation matrix
+void TransformStore::SetOrientation(unsigned int slot, FXMVECTOR rotation)
+{
+	XMMATRIX rotationMat = XMMatrixRotationQuaternion(rotation);
+	XMStoreFloat4(&rotations[slot], rotation);
+	XMStoreFloat3(&rights[slot], rotationMat.r[0]);
+	XMStoreFloat3(&ups[slot], rotationMat.r[1]);
+	XMStoreFloat3(&forwards[slot], rotationMat.r[2]);
+}
+
+// --------------------------------------------------------
+// Scale * rotation * translation, without any trig
+// - Between ticks, a slot the last one changed is blended
+//   from its previous values (but not during a tick, so the
+//   simulation sees where things actually are)
+// --------------------------------------------------------
+XMMATRIX TransformStore::BuildLocalMatrix(unsigned int slot)
+{
+	if ((flags[slot] & Interpolated) && !ticking)
+	{
+		XMVECTOR position, rotation, scale;
+		Interpolate(slot, position, rotation, scale);
+		XMMATRIX rotationMat = XMMatrixRotationQuaternion(rotation);
+		return XMMATRIX(
+			rotationMat.r[0] * XMVectorSplatX(scale),
+			rotationMat.r[1] * XMVectorSplatY(scale),
+			rotationMat.r[2] * XMVectorSplatZ(scale),
+			XMVectorSetW(position, 1.0f));
+	}
+
+	return XMMATRIX(
+		XMLoadFloat3(&rights[slot]) * scaleX[slot],
+		XMLoadFloat3(&ups[slot]) * scaleY[slot],
+		XMLoadFloat3(&forwards[slot]) * scaleZ[slot],
+		XMVectorSet(positionX[slot], positionY[slot], positionZ[slot], 1.0f));
+}
+
+XMMATRIX TransformStore::BuildLocalInverseTranspose(unsigned int slot)
+{
+	if ((flags[slot] & Interpolated) && !ticking)
+	{
+		XMVECTOR position, rotation, scale;
+		Interpolate(slot, position, rotation, scale);
+		XMMATRIX rotationMat = XMMatrixRotationQuaternion(rotation);
+		return InverseTransposeTRS(
+			rotationMat.r[0],
+			rotationMat.r[1],
+			rotationMat.r[2],
+			XMVectorSetW(scale, 1.0f),
+			XMVectorSetW(position, 0.0f));
+	}
+
+	return InverseTransposeTRS(
+		XMLoadFloat3(&rights[slot]),
+		XMLoadFloat3(&ups[slot]),
+		XMLoadFloat3(&forwards[slot]),
+		XMVectorSet(scaleX[slot], scaleY[slot], scaleZ[slot], 1.0f),
+		XMVectorSet(positionX[slot], positionY[slot], positionZ[slot], 0.0f));
+}
+
+// Local values interpolationAlpha of the way from before the last tick to now
+void TransformStore::Interpolate(unsigned int slot, XMVECTOR& position, XMVECTOR& rotation, XMVECTOR& scale)
+{
+	position = XMVectorLerp(
+		XMLoadFloat3(&previousPositions[slot]),
+		XMVectorSet(positionX[slot], positionY[slot], positionZ[slot], 0.0f),
+		interpolationAlpha);
+	rotation = XMQuaternionSlerp(
+		XMLoadFloat4(&previousRotations[slot]),
+		XMLoadFloat4(&rotations[slot]),
+		interpolationAlpha);
+	scale = XMVectorLerp(
+		XMLoadFloat3(&previousScales[slot]),
+		XMVectorSet(scaleX[slot], scaleY[slot], scaleZ[slot], 0.0f),
+		interpolationAlpha);
+}
+
+// World & inverse transpose matrices for slots whose
+// parents are already up to date
+void TransformStore::BuildMatrices(const unsigned int* slots, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		unsigned int slot = slots[i];
+		unsigned int parent = parents[slot];
+		XMMATRIX world = BuildLocalMatrix(slot);
+		XMMATRIX inverseTranspose = BuildLocalInverseTranspose(slot);
+		if (parent != Invalid)
+		{
+			world = world * XMLoadFloat4x4(&worlds[parent]);
+			inverseTranspose = inverseTranspose * XMLoadFloat4x4(&worldInverseTransposes[parent]);
+		}
+		XMStoreFloat4x4(&worlds[slot], world);
+		XMStoreFloat4x4(&worldInverseTransposes[slot], inverseTranspose);
+		flags[slot] &= ~(WorldDirty | InverseTransposeDirty);
+	}
+}
+
+// --------------------------------------------------------
+// Rebuilds everything queued since the last call
+// - Queued slots are sorted by depth in the hierarchy, so
+//   each level only reads the one above, which is finished,
+//   and by slot within a level, to stream through memory
+// - Slots within a level don't depend on each other, so a
+//   level is split between threads
+// --------------------------------------------------------
+void TransformStore::UpdateMatrices(unsigned int threadCount)
+{
+	if (threadCount == 0)
+		threadCount = JobSystem::GetDefault().GetThreadCount();
+
+	// Skip anything freed or already brought up to date since it was queued
+	for (unsigned int slot : dirty)
+		flags[slot] &= ~Queued;
+	pending.clear();
+	if (dirty.size() * 8 > flags.size())
+	{
+		// With this much to do, finding it in order is cheaper than sorting
+		for (unsigned int slot = 0; slot < (unsigned int)flags.size(); slot++)
+			if ((flags[slot] & Alive) && (flags[slot] & (WorldDirty | InverseTransposeDirty)))
+				pending.push_back(slot);
+	}
+	else
+	{
+		for (unsigned int slot : dirty)
+			if ((flags[slot] & Alive) && (flags[slot] & (WorldDirty | InverseTransposeDirty)))
+				pending.push_back(slot);
+
+		// In slot order, so each level walks the arrays forwards
+		std::sort(pending.begin(), pending.end());
+	}
+	dirty.clear();
+	if (pending.empty())
+		return;
+
+	unsigned int levelCount = 0;
+	for (unsigned int slot : pending)
+		levelCount = (std::max)(levelCount, depths[slot] + 1);
+
+	// A counting sort by depth
+	levelStarts.assign(levelCount + 1, 0);
+	for (unsigned int slot : pending)
+		levelStarts[depths[slot] + 1]++;
+	for (unsigned int level = 0; level < levelCount; level++)
+		levelStarts[level + 1] += levelStarts[level];
+	byLevel.resize(pending.size());
+	for (unsigned int slot : pending)
+		byLevel[levelStarts[depths[slot]]++] = slot;
+	for (unsigned int level = levelCount; level > 0; level--)
+		levelStarts[level] = levelStarts[level - 1];
+	levelStarts[0] = 0;
+
+	for (unsigned int level = 0; level < levelCount; level++)
+	{
+		const unsigned int* slots = byLevel.data() + levelStarts[level];
+		size_t count = levelStarts[level + 1] - levelStarts[level];
+		auto build = [&](size_t begin, size_t end)
+		{
+			BuildMatrices(slots + begin, end - begin);
+		};
+
+		if (threadCount > 1 && count >= MinParallelCount)
+			JobSystem::GetDefault().ParallelFor(count, build, 256, threadCount);
+		else
+			build(0, count);
+	}
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstddef>
+#include <vector>
+
+class Transform;
+
+// --------------------------------------------------------
+// Storage for every Transform, kept as parallel arrays
+//
+// A Transform is just a slot index into one of these.  Each
+// value (position x, pitch, scale z, ...) has its own array,
+// so rebuilding matrices reads whole cache lines of useful
+// data.  Orientation is also kept as a quaternion and as the
+// right, up & forward vectors it turns the axes into, updated
+// whenever it changes, so nothing that reads it converts from
+// Euler angles, and a local matrix is just those three rows
+// scaled, plus the position.
+//
+// Changing a transform marks its slot and its descendants'
+// dirty and queues them.  UpdateMatrices() then rebuilds the
+// world & inverse transpose matrices of everything queued in
+// one pass, a hierarchy level at a time (parents before their
+// children), splitting each level over several threads.
+// A Get...Matrix() call on a dirty transform in between just
+// brings that one chain up to date, as before.
+//
+// With a fixed timestep (see FixedTimestep), the simulation
+// runs between BeginTick() and EndTick().  Each transform a
+// tick changes remembers where it was before, and after the
+// ticks SetInterpolation() draws it that far from there to
+// where it is now.  Only the matrices are blended: the local
+// values (GetPosition(), ...) are always the latest tick's.
+//
+// Not thread safe: only UpdateMatrices() uses other threads.
+// --------------------------------------------------------
+class TransformStore
+{
+public:
+	TransformStore();
+	~TransformStore();
+
+	TransformStore(const TransformStore&) = delete;
+	TransformStore& operator=(const TransformStore&) = delete;
+
+	// The store that default-constructed transforms live in
+	static TransformStore& GetDefault();
+
+	// Rebuilds every dirty matrix on threadCount threads (0 = one
+	// per core).  Small batches stay on the calling thread.
+	void UpdateMatrices(unsigned int threadCount = 0);
+
+	// Around each simulation tick, then once after all of them
+	// with how far (0 - 1) the frame is past the last tick but one
+	void BeginTick();
+	void EndTick();
+	void SetInterpolation(float alpha);
+
+	size_t GetCount();			// Transforms alive right now
+	size_t GetDirtyCount();		// Queued for the next UpdateMatrices()
+	size_t GetInterpolatedCount();	// Changed by the last tick
+
+private:
+	friend class Transform;
+
+	static const unsigned int Invalid = 0xFFFFFFFF;
+
+	enum Flags : unsigned char
+	{
+		Alive = 1,
+		WorldDirty = 2,
+		InverseTransposeDirty = 4,
+		Queued = 8,				// In the dirty list (even if cleaned since)
+		Interpolated = 16,		// Changed by the last tick, so drawn between two states
+	};
+
+	// Local values, one array each
+	std::vector<float> positionX, positionY, positionZ;
+	std::vector<float> pitch, yaw, roll;
+	std::vector<float> scaleX, scaleY, scaleZ;
+
+	// The same orientation again, kept whole rather than split
+	// into arrays, since it's only read a slot at a time
+	std::vector<DirectX::XMFLOAT4> rotations;
+	std::vector<DirectX::XMFLOAT3> rights, ups, forwards;
+
+	// Hierarchy, with each slot's children as a linked list
+	std::vector<unsigned int> parents;
+	std::vector<unsigned int> firstChildren;
+	std::vector<unsigned int> nextSiblings;
+	std::vector<unsigned int> previousSiblings;
+	std::vector<unsigned int> childCounts;
+	std::vector<unsigned int> depths;
+
+	std::vector<unsigned char> flags;
+	std::vector<Transform*> owners;
+	std::vector<DirectX::XMFLOAT4X4> worlds;
+	std::vector<DirectX::XMFLOAT4X4> worldInverseTransposes;
+
+	// Local values before the last tick changed them
+	std::vector<DirectX::XMFLOAT3> previousPositions;
+	std::vector<DirectX::XMFLOAT4> previousRotations;
+	std::vector<DirectX::XMFLOAT3> previousScales;
+	std::vector<unsigned int> interpolated;
+	bool ticking;
+	float interpolationAlpha;
+
+	// Both have room for every slot, so adding to them never
+	// allocates (which lets Transform's moves be noexcept)
+	std::vector<unsigned int> freeSlots;
+	std::vector<unsigned int> dirty;
+
+	// Scratch space for UpdateMatrices()
+	std::vector<unsigned int> pending;
+	std::vector<unsigned int> levelStarts;
+	std::vector<unsigned int> byLevel;
+
+	unsigned int Allocate(Transform* owner);
+	void Free(unsigned int slot);
+	void SetDefaults(unsigned int slot);
+
+	void MarkDirty(unsigned int slot);
+	void SaveForInterpolation(unsigned int slot);
+	void UpdateWorld(unsigned int slot);
+	void UpdateInverseTranspose(unsigned int slot);
+
+	void Attach(unsigned int slot, unsigned int parent);
+	void Detach(unsigned int slot);
+	void SetDepths(unsigned int slot, unsigned int depth);
+	bool IsAncestor(unsigned int ancestor, unsigned int slot);
+
+	// Sets the quaternion & basis vectors (but not the angles)
+	void SetOrientation(unsigned int slot, DirectX::FXMVECTOR rotation);
+
+	void Interpolate(unsigned int slot, DirectX::XMVECTOR& position, DirectX::XMVECTOR& rotation, DirectX::XMVECTOR& scale);
+	DirectX::XMMATRIX BuildLocalMatrix(unsigned int slot);
+	DirectX::XMMATRIX BuildLocalInverseTranspose(unsigned int slot);
+	void BuildMatrices(const unsigned int* slots, size_t count);
+};
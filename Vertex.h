@@ -13,4 +13,5 @@ struct Vertex
 	DirectX::XMFLOAT3 Normal;
 	DirectX::XMFLOAT2 UV;
 	DirectX::XMFLOAT3 Tangent;
+	float TangentSign;		// -1 where the texture is mirrored (see CalculateTangentSigns())
 };
\ No newline at end of file
@@ -0,0 +1,291 @@
+#include "VertexCacheOptimizer.h"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	// Size of the LRU cache the triangle order is optimized for
+	const int maxCacheSize = 32;
+
+	// Vertices with more triangles left than this all get the same boost
+	const int maxValence = 32;
+
+	const unsigned int notInCache = 0xFFFFFFFF;
+
+	// --------------------------------------------------------
+	// Forsyth's scoring, precomputed into tables:
+	// - The three most recent vertices get a fixed score, so that
+	//   strips don't flip-flop between neighbouring triangles
+	// - Older cache entries decay towards zero as they age
+	// - Vertices with few triangles left are boosted, so isolated
+	//   triangles are finished off instead of left behind
+	// --------------------------------------------------------
+	struct ScoreTables
+	{
+		float Cache[maxCacheSize];
+		float Valence[maxValence + 1];
+
+		ScoreTables()
+		{
+			for (int i = 0; i < maxCacheSize; i++)
+			{
+				if (i < 3)
+					Cache[i] = 0.75f;
+				else
+					Cache[i] = std::pow(1.0f - (i - 3) / (float)(maxCacheSize - 3), 1.5f);
+			}
+
+			Valence[0] = 0.0f;
+			for (int i = 1; i <= maxValence; i++)
+				Valence[i] = 2.0f / std::sqrt((float)i);
+		}
+	};
+
+	const ScoreTables scoreTables;
+
+	inline float VertexScore(unsigned int cachePosition, unsigned int remainingTriangles)
+	{
+		// No triangles left means the vertex doesn't matter any more
+		if (remainingTriangles == 0)
+			return -1.0f;
+
+		float score = cachePosition == notInCache ? 0.0f : scoreTables.Cache[cachePosition];
+		return score + scoreTables.Valence[remainingTriangles < (unsigned int)maxValence ? remainingTriangles : maxValence];
+	}
+}
+
+// --------------------------------------------------------
+// Each step emits the highest scoring triangle, pushes its
+// vertices to the front of the simulated cache, and rescores
+// only the vertices that were in the cache (and the triangles
+// that use them).  The next best triangle is almost always
+// one of those, so the whole mesh is never rescanned.
+// --------------------------------------------------------
+void OptimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0 || vertexCount == 0)
+		return;
+
+	// Triangles using each vertex, as one flat array with an
+	// offset per vertex.  Each vertex's list only holds the
+	// triangles it hasn't emitted yet, in its first "remaining"
+	// entries.
+	std::vector<unsigned int> remaining(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		remaining[indices[i]]++;
+
+	std::vector<unsigned int> firstTriangle(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+		firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+
+	std::vector<unsigned int> vertexTriangles(triangleCount * 3);
+	{
+		std::vector<unsigned int> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			for (int c = 0; c < 3; c++)
+				vertexTriangles[fill[indices[t * 3 + c]]++] = (unsigned int)t;
+		}
+	}
+
+	// Starting scores (nothing is in the cache yet)
+	std::vector<unsigned int> cachePosition(vertexCount, notInCache);
+	std::vector<float> vertexScore(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		vertexScore[v] = VertexScore(notInCache, remaining[v]);
+
+	std::vector<float> triangleScore(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		triangleScore[t] =
+			vertexScore[indices[t * 3]] +
+			vertexScore[indices[t * 3 + 1]] +
+			vertexScore[indices[t * 3 + 2]];
+	}
+
+	// The cache holds up to three extra entries while it's being
+	// updated, which are the ones that just fell out of it
+	unsigned int cache[maxCacheSize + 3];
+	unsigned int cacheSize = 0;
+
+	std::vector<unsigned int> optimized(triangleCount * 3);
+	size_t deadEndCursor = 0;
+
+	for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+	{
+		// Find the best triangle using a cached vertex.  If there isn't
+		// one, fall back to the next unemitted triangle in the original
+		// order, which keeps this linear (rather than rescanning the mesh).
+		unsigned int best = notInCache;
+		float bestScore = -1.0f;
+		for (unsigned int i = 0; i < cacheSize; i++)
+		{
+			unsigned int v = cache[i];
+			for (unsigned int j = firstTriangle[v]; j < firstTriangle[v] + remaining[v]; j++)
+			{
+				unsigned int t = vertexTriangles[j];
+				if (triangleScore[t] > bestScore)
+				{
+					best = t;
+					bestScore = triangleScore[t];
+				}
+			}
+		}
+
+		if (best == notInCache)
+		{
+			while (emitted[deadEndCursor])
+				deadEndCursor++;
+			best = (unsigned int)deadEndCursor;
+		}
+
+		// Emit it, and take it out of its vertices' lists
+		emitted[best] = true;
+		const unsigned int* tri = indices + best * 3;
+		memcpy(&optimized[emittedCount * 3], tri, sizeof(unsigned int) * 3);
+
+		for (int c = 0; c < 3; c++)
+		{
+			unsigned int v = tri[c];
+			unsigned int* list = &vertexTriangles[firstTriangle[v]];
+			for (unsigned int j = 0; j < remaining[v]; j++)
+			{
+				if (list[j] == best)
+				{
+					list[j] = list[remaining[v] - 1];
+					break;
+				}
+			}
+			remaining[v]--;
+		}
+
+		// Move its vertices to the front of the cache, keeping
+		// the order of everything else
+		unsigned int newCache[maxCacheSize + 3];
+		unsigned int newCacheSize = 0;
+		for (int c = 0; c < 3; c++)
+			newCache[newCacheSize++] = tri[c];
+
+		for (unsigned int i = 0; i < cacheSize; i++)
+		{
+			unsigned int v = cache[i];
+			if (v != tri[0] && v != tri[1] && v != tri[2])
+				newCache[newCacheSize++] = v;
+		}
+
+		// Rescore everything that was or still is in the cache
+		for (unsigned int i = 0; i < newCacheSize; i++)
+		{
+			unsigned int v = newCache[i];
+			cachePosition[v] = i < (unsigned int)maxCacheSize ? i : notInCache;
+
+			float score = VertexScore(cachePosition[v], remaining[v]);
+			float delta = score - vertexScore[v];
+			vertexScore[v] = score;
+
+			for (unsigned int j = firstTriangle[v]; j < firstTriangle[v] + remaining[v]; j++)
+				triangleScore[vertexTriangles[j]] += delta;
+		}
+
+		cacheSize = newCacheSize < (unsigned int)maxCacheSize ? newCacheSize : maxCacheSize;
+		memcpy(cache, newCache, sizeof(unsigned int) * cacheSize);
+	}
+
+	memcpy(indices, &optimized[0], sizeof(unsigned int) * triangleCount * 3);
+}
+
+size_t OptimizeVertexFetch(MeshData& mesh)
+{
+	const unsigned int unused = 0xFFFFFFFF;
+	std::vector<unsigned int> remap(mesh.Vertices.size(), unused);
+	std::vector<Vertex> reordered;
+	reordered.reserve(mesh.Vertices.size());
+
+	for (unsigned int& index : mesh.Indices)
+	{
+		if (remap[index] == unused)
+		{
+			remap[index] = (unsigned int)reordered.size();
+			reordered.push_back(mesh.Vertices[index]);
+		}
+
+		index = remap[index];
+	}
+
+	mesh.Vertices.swap(reordered);
+	return mesh.Vertices.size();
+}
+
+void OptimizeMeshForGPU(MeshData& mesh)
+{
+	if (mesh.Indices.empty())
+		return;
+
+	OptimizeVertexCache(&mesh.Indices[0], mesh.Indices.size(), mesh.Vertices.size());
+	OptimizeVertexFetch(mesh);
+}
+
+// --------------------------------------------------------
+// Caches on real hardware are tiny (16-64 entries), so a
+// linear search of the entries is as fast as anything fancier
+// --------------------------------------------------------
+VertexCacheStats SimulateVertexCache(
+	const unsigned int* indices,
+	size_t indexCount,
+	size_t vertexCount,
+	unsigned int cacheSize,
+	VertexCacheType type)
+{
+	VertexCacheStats stats = {};
+	if (indexCount < 3 || cacheSize == 0)
+		return stats;
+
+	std::vector<unsigned int> cache(cacheSize, 0xFFFFFFFF);
+	std::vector<bool> used(vertexCount, false);
+	unsigned int usedCount = 0;
+	unsigned int fifoHead = 0;
+
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		unsigned int v = indices[i];
+		if (!used[v])
+		{
+			used[v] = true;
+			usedCount++;
+		}
+
+		unsigned int slot = 0;
+		while (slot < cacheSize && cache[slot] != v)
+			slot++;
+
+		if (type == VertexCacheType::FIFO)
+		{
+			if (slot == cacheSize)
+			{
+				stats.Transforms++;
+				cache[fifoHead] = v;
+				fifoHead = (fifoHead + 1) % cacheSize;
+			}
+		}
+		else
+		{
+			// Slot 0 is the most recent; shift older entries down
+			if (slot == cacheSize)
+			{
+				stats.Transforms++;
+				slot = cacheSize - 1;
+			}
+
+			memmove(cache.data() + 1, cache.data(), sizeof(unsigned int) * slot);
+			cache[0] = v;
+		}
+	}
+
+	stats.ACMR = stats.Transforms / (float)(indexCount / 3);
+	stats.ATVR = stats.Transforms / (float)usedCount;
+	return stats;
+}
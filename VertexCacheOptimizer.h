@@ -0,0 +1,53 @@
+#pragma once
+
+#include "ObjParser.h"
+#include <cstddef>
+
+// --------------------------------------------------------
+// Reorders triangles so that each one reuses as many of the
+// vertices the GPU has recently transformed as possible
+// (Tom Forsyth's "Linear-Speed Vertex Cache Optimisation")
+//
+// - Only the order of the triangles changes; each triangle's
+//   own corner order (and so its winding) is kept
+// - Works well for any real cache size, since it targets a
+//   generic LRU cache rather than one specific GPU
+// --------------------------------------------------------
+void OptimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount);
+
+// --------------------------------------------------------
+// Reorders the vertices to match the order the (already
+// optimized) triangles first use them, so the GPU reads the
+// vertex buffer more or less front to back.  Vertices that
+// no triangle uses are removed.
+//
+// Returns the new vertex count
+// --------------------------------------------------------
+size_t OptimizeVertexFetch(MeshData& mesh);
+
+// Convenience wrapper: both of the above, in the right order
+void OptimizeMeshForGPU(MeshData& mesh);
+
+// --------------------------------------------------------
+// Post-transform vertex cache simulation
+// --------------------------------------------------------
+enum class VertexCacheType
+{
+	FIFO,	// Oldest vertex is replaced; hits don't refresh (most real GPUs)
+	LRU		// Least recently used vertex is replaced
+};
+
+struct VertexCacheStats
+{
+	unsigned int Transforms;	// Cache misses, each of which runs the vertex shader
+	float ACMR;					// Average cache miss ratio: transforms per triangle (0.5 - 3)
+	float ATVR;					// Average transform to vertex ratio: transforms per used vertex (1 is ideal)
+};
+
+// Runs an index list through a simulated cache of the given size
+VertexCacheStats SimulateVertexCache(
+	const unsigned int* indices,
+	size_t indexCount,
+	size_t vertexCount,
+	unsigned int cacheSize,
+	VertexCacheType type);
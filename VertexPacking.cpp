@@ -0,0 +1,193 @@
+#include "VertexPacking.h"
+
+#include <DirectXPackedVector.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	const float PI = 3.14159265f;
+
+	// Matches the GPU's SNORM conversion, where -32768 also means -1
+	float FromSnorm16(short v)
+	{
+		return (std::max)(v / 32767.0f, -1.0f);
+	}
+
+	// --------------------------------------------------------
+	// Octahedral decode: the square unfolds onto the faces of
+	// an octahedron, which is then pushed out to the sphere
+	// --------------------------------------------------------
+	XMFLOAT3 OctahedronToDirection(float x, float y)
+	{
+		float z = 1.0f - std::fabs(x) - std::fabs(y);
+		float t = (std::max)(-z, 0.0f);
+		x += x >= 0.0f ? -t : t;
+		y += y >= 0.0f ? -t : t;
+
+		float length = std::sqrt(x * x + y * y + z * z);
+		return XMFLOAT3(x / length, y / length, z / length);
+	}
+
+	// --------------------------------------------------------
+	// Octahedral encode, rounded to 16 bit SNORMs.  Just rounding
+	// each component isn't always the closest of the four nearby
+	// codes once decoded, so all four are tried.
+	// --------------------------------------------------------
+	void DirectionToOctahedron(const XMFLOAT3& d, short& outX, short& outY)
+	{
+		float l1 = std::fabs(d.x) + std::fabs(d.y) + std::fabs(d.z);
+		if (!(l1 > 0.0f))
+		{
+			outX = 0;
+			outY = 0;
+			return;
+		}
+
+		// Project onto the octahedron, folding the lower half outwards
+		float x = d.x / l1;
+		float y = d.y / l1;
+		if (d.z < 0.0f)
+		{
+			float foldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+			float foldedY = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+			x = foldedX;
+			y = foldedY;
+		}
+
+		float baseX = std::floor(x * 32767.0f);
+		float baseY = std::floor(y * 32767.0f);
+		float bestDot = -2.0f;
+		for (int i = 0; i < 4; i++)
+		{
+			float codeX = (std::max)(-32767.0f, (std::min)(32767.0f, baseX + (i & 1)));
+			float codeY = (std::max)(-32767.0f, (std::min)(32767.0f, baseY + (i >> 1)));
+			XMFLOAT3 decoded = OctahedronToDirection(codeX / 32767.0f, codeY / 32767.0f);
+
+			float dot = decoded.x * d.x + decoded.y * d.y + decoded.z * d.z;
+			if (dot > bestDot)
+			{
+				bestDot = dot;
+				outX = (short)codeX;
+				outY = (short)codeY;
+			}
+		}
+	}
+
+	// Angle between a direction & its decoded version, in degrees
+	// (atan2 stays accurate for the tiny angles involved)
+	float AngleBetween(const XMFLOAT3& original, const XMFLOAT3& decoded)
+	{
+		XMVECTOR a = XMLoadFloat3(&original);
+		if (!(XMVectorGetX(XMVector3LengthSq(a)) > 0.0f))
+			return 0.0f;
+
+		a = XMVector3Normalize(a);
+		XMVECTOR b = XMLoadFloat3(&decoded);
+		float sine = XMVectorGetX(XMVector3Length(XMVector3Cross(a, b)));
+		float cosine = XMVectorGetX(XMVector3Dot(a, b));
+		return std::atan2(sine, cosine) * 180.0f / PI;
+	}
+}
+
+void GetPackedPositionTransform(
+	const XMFLOAT3& boundsMin,
+	const XMFLOAT3& boundsMax,
+	XMFLOAT3& offset,
+	XMFLOAT3& scale)
+{
+	offset = boundsMin;
+	scale = XMFLOAT3(
+		boundsMax.x - boundsMin.x,
+		boundsMax.y - boundsMin.y,
+		boundsMax.z - boundsMin.z);
+}
+
+void PackVertices(
+	const Vertex* vertices,
+	size_t vertexCount,
+	const XMFLOAT3& boundsMin,
+	const XMFLOAT3& boundsMax,
+	PackedVertex* packed,
+	PackedVertexError* error)
+{
+	XMFLOAT3 offset, scale;
+	GetPackedPositionTransform(boundsMin, boundsMax, offset, scale);
+
+	// A flat axis packs to zero and decodes to the bounds
+	float invScale[3] = {
+		scale.x > 0.0f ? 1.0f / scale.x : 0.0f,
+		scale.y > 0.0f ? 1.0f / scale.y : 0.0f,
+		scale.z > 0.0f ? 1.0f / scale.z : 0.0f };
+	const float* min = &offset.x;
+
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const Vertex& v = vertices[i];
+		PackedVertex& p = packed[i];
+
+		const float* position = &v.Position.x;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float unorm = (position[axis] - min[axis]) * invScale[axis];
+			unorm = (std::max)(0.0f, (std::min)(1.0f, unorm));
+			p.Position[axis] = (unsigned short)std::floor(unorm * 65535.0f + 0.5f);
+		}
+		p.Position[3] = v.TangentSign < 0.0f ? 0 : 65535;
+
+		DirectionToOctahedron(v.Normal, p.NormalTangent[0], p.NormalTangent[1]);
+		DirectionToOctahedron(v.Tangent, p.NormalTangent[2], p.NormalTangent[3]);
+
+		p.UV[0] = XMConvertFloatToHalf(v.UV.x);
+		p.UV[1] = XMConvertFloatToHalf(v.UV.y);
+	}
+
+	if (!error)
+		return;
+
+	// Measure what was lost by decoding everything again
+	*error = PackedVertexError();
+	error->VertexCount = (unsigned int)vertexCount;
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const Vertex& original = vertices[i];
+		Vertex decoded;
+		UnpackVertex(packed[i], boundsMin, boundsMax, decoded);
+
+		float dx = decoded.Position.x - original.Position.x;
+		float dy = decoded.Position.y - original.Position.y;
+		float dz = decoded.Position.z - original.Position.z;
+		error->MaxPositionError = (std::max)(error->MaxPositionError, std::sqrt(dx * dx + dy * dy + dz * dz));
+
+		error->MaxNormalError = (std::max)(error->MaxNormalError, AngleBetween(original.Normal, decoded.Normal));
+		error->MaxTangentError = (std::max)(error->MaxTangentError, AngleBetween(original.Tangent, decoded.Tangent));
+
+		error->MaxUVError = (std::max)(error->MaxUVError, (std::max)(
+			std::fabs(decoded.UV.x - original.UV.x),
+			std::fabs(decoded.UV.y - original.UV.y)));
+	}
+}
+
+void UnpackVertex(
+	const PackedVertex& packed,
+	const XMFLOAT3& boundsMin,
+	const XMFLOAT3& boundsMax,
+	Vertex& vertex)
+{
+	XMFLOAT3 offset, scale;
+	GetPackedPositionTransform(boundsMin, boundsMax, offset, scale);
+
+	vertex.Position = XMFLOAT3(
+		offset.x + packed.Position[0] / 65535.0f * scale.x,
+		offset.y + packed.Position[1] / 65535.0f * scale.y,
+		offset.z + packed.Position[2] / 65535.0f * scale.z);
+	vertex.TangentSign = packed.Position[3] / 65535.0f * 2.0f - 1.0f;
+
+	vertex.Normal = OctahedronToDirection(FromSnorm16(packed.NormalTangent[0]), FromSnorm16(packed.NormalTangent[1]));
+	vertex.Tangent = OctahedronToDirection(FromSnorm16(packed.NormalTangent[2]), FromSnorm16(packed.NormalTangent[3]));
+
+	vertex.UV = XMFLOAT2(XMConvertHalfToFloat(packed.UV[0]), XMConvertHalfToFloat(packed.UV[1]));
+}
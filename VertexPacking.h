@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Vertex.h"
+#include <DirectXMath.h>
+#include <cstddef>
+
+// --------------------------------------------------------
+// A compressed alternative to Vertex: 20 bytes instead of 44
+//
+// - Position: 16 bits per axis across the mesh's bounds
+//   (R16G16B16A16_UNORM), with the tangent sign in W
+// - Normal & tangent: octahedral encoded, 16 bits per
+//   component (R16G16B16A16_SNORM)
+// - UV: half floats (R16G16_FLOAT)
+//
+// PackedVertexShader.hlsl decodes it, given the offset and
+// scale from GetPackedPositionTransform().
+// --------------------------------------------------------
+struct PackedVertex
+{
+	unsigned short Position[4];	// xyz across the bounds, w = tangent sign (0 = -1, 65535 = +1)
+	short NormalTangent[4];		// Octahedral normal in xy, octahedral tangent in zw
+	unsigned short UV[2];		// Half floats
+};
+
+// --------------------------------------------------------
+// The worst error packing introduced, over every vertex
+// --------------------------------------------------------
+struct PackedVertexError
+{
+	float MaxPositionError;		// Distance, in the mesh's units
+	float MaxNormalError;		// Degrees
+	float MaxTangentError;		// Degrees
+	float MaxUVError;			// In texture coordinates
+	unsigned int VertexCount;
+};
+
+// Offset & scale that turn a packed position (0-1 per axis)
+// back into the mesh's own space: position = offset + unorm * scale
+void GetPackedPositionTransform(
+	const DirectX::XMFLOAT3& boundsMin,
+	const DirectX::XMFLOAT3& boundsMax,
+	DirectX::XMFLOAT3& offset,
+	DirectX::XMFLOAT3& scale);
+
+// --------------------------------------------------------
+// Packs vertices, which must all lie within the bounds.
+//
+// If "error" isn't null, every vertex is decoded again and
+// compared against the original.
+// --------------------------------------------------------
+void PackVertices(
+	const Vertex* vertices,
+	size_t vertexCount,
+	const DirectX::XMFLOAT3& boundsMin,
+	const DirectX::XMFLOAT3& boundsMax,
+	PackedVertex* packed,
+	PackedVertexError* error = 0);
+
+// Decodes a vertex the same way the shader does
+void UnpackVertex(
+	const PackedVertex& packed,
+	const DirectX::XMFLOAT3& boundsMin,
+	const DirectX::XMFLOAT3& boundsMax,
+	Vertex& vertex);
@@ -39,6 +39,7 @@ VertexToPixel main( VertexShaderInput input )
 	output.normal = mul((float3x3)worldInvTranspose, input.normal);
 	output.worldPosition = mul(world, float4(input.localPosition, 1)).xyz;
 	output.tangent = mul((float3x3)world, input.tangent);
+	output.tangentSign = input.tangentSign;
 
 	// Whatever we return will make its way through the pipeline to the
 	// next programmable stage we're using (the pixel shader for now)